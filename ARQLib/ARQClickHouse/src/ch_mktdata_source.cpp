@@ -19,11 +19,13 @@ RecordCollection CHMarketSource::load( const std::string_view marketName, const
 
 	CHConn conn( m_dsh );
 
+	const CompiledTIDSet compiledFilter( filter );
+
 	collection.visitVectors( [&] <c_MktData T> ( std::vector<Record<T>>& vector )
 	{
 		std::vector<std::string_view> ids;
 
-		TIDSet::IDs idSpec = filter.empty() ? TIDSet::All{} : filter.getIDsForType( Traits<T>::typeEnum() );
+		TIDSet::IDs idSpec = filter.empty() ? TIDSet::All{} : compiledFilter.getIDsForType( Traits<T>::typeEnum() );
 		if( std::holds_alternative<TIDSet::None>( idSpec ) )
 			return;                                   // filter explicitly specifies 'None' for this type, so skip entirely
 		else if( std::holds_alternative<TIDSet::All>( idSpec ) )
@@ -40,10 +42,17 @@ RecordCollection CHMarketSource::load( const std::string_view marketName, const
 
 void CHMarketSource::save( const std::string_view marketName, const RecordCollection& records )
 {
+	// Nothing to insert, so no need for a connection either
+	if( !records.size() )
+		return;
+
 	CHConn conn( m_dsh );
 
 	records.visitVectors( [&] <c_MktData T> ( const std::vector<Record<T>>& vector )
 	{
+		if( vector.empty() )
+			return;
+
 		// Insert into ClickHouse DB
 		insert<T>( conn, marketName, vector );
 	} );
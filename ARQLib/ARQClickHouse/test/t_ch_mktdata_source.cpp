@@ -0,0 +1,34 @@
+#include <ARQClickHouse/ch_mktdata_source.h>
+
+#include <ARQUtils/error.h>
+#include <ARQMarket/mktdata_entities.h>
+
+#include <gtest/gtest.h>
+
+using namespace ARQ;
+
+namespace
+{
+
+// Not in the data source config, so any attempt to connect throws
+constexpr std::string_view UNCONFIGURED_DSH = "T_ARQCLICKHOUSE_UNCONFIGURED";
+
+}
+
+TEST( CHMarketSourceTest, SavingNothingDoesNotConnect )
+{
+	CH::MD::CHMarketSource source( UNCONFIGURED_DSH );
+
+	EXPECT_NO_THROW( source.save( "LIVE", MD::RecordCollection() ) );
+}
+
+TEST( CHMarketSourceTest, SavingRecordsConnects )
+{
+	CH::MD::CHMarketSource source( UNCONFIGURED_DSH );
+
+	MD::RecordCollection records;
+	records.get<MD::Record<MD::FXRate>>().push_back( MD::Record<MD::FXRate>{ .header = { .id = "GBPUSD" } } );
+
+	// The same source does try to connect once there's something to insert
+	EXPECT_THROW( source.save( "LIVE", records ), ARQException );
+}
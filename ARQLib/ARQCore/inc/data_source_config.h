@@ -58,6 +58,15 @@ struct DataSourceConfig
 	};
 
 	std::unordered_map<std::string, ConnProps> connPropsMap;
+
+	// Optional settings for the source's implementation, from its [options] table - values are held as strings
+	std::unordered_map<std::string, std::string> options;
+
+	[[nodiscard]] bool isOptionSet( const std::string_view name ) const
+	{
+		const auto it = options.find( std::string( name ) );
+		return it != options.end() && ( it->second == "true" || it->second == "1" );
+	}
 };
 
 class DataSourceConfigManager
@@ -8,6 +8,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include <mutex>
 
 namespace ARQ
@@ -25,6 +26,15 @@ class ISerialisableType : public SerialisableTypeConcept
 public:
 	virtual Buffer serialise( const T& obj )                      const = 0;
 	virtual void   deserialise( const BufferView buf, T& objOut ) const = 0;
+
+	// Serialises onto the end of out and returns the number of bytes written, so a caller can reuse one buffer for many objects.
+	// The default goes via serialise - override it where the format can write into out directly
+	virtual size_t serialiseAppend( const T& obj, std::vector<uint8_t>& out ) const
+	{
+		const Buffer buf = serialise( obj );
+		out.insert( out.end(), buf.data.get(), buf.data.get() + buf.size );
+		return buf.size;
+	}
 };
 
 class Serialiser
@@ -32,6 +42,9 @@ class Serialiser
 public:
 	template<typename T>
 	Buffer serialise( const T& obj ) const;
+
+	template<typename T>
+	size_t serialiseAppend( const T& obj, std::vector<uint8_t>& out ) const;
 	
 	template<typename T>
 	T deserialise( const BufferView buf ) const;
@@ -75,6 +88,13 @@ Buffer Serialiser::serialise( const T& obj ) const
 	return typeSerialiser.serialise( obj );
 }
 
+template<typename T>
+size_t Serialiser::serialiseAppend( const T& obj, std::vector<uint8_t>& out ) const
+{
+	const ISerialisableType<T>& typeSerialiser = getTypeSerialiser<T>();
+	return typeSerialiser.serialiseAppend( obj, out );
+}
+
 template<typename T>
 T Serialiser::deserialise( const BufferView buf ) const
 {
@@ -174,6 +174,28 @@ void DataSourceConfigManager::parseConfig( const std::string_view tomlCfg )
 				cfg.connPropsMap[connPropsName] = connProps;
 			}
 
+			// Parse the optional options subtable
+
+			if( const toml::node* optionsNode = sourceTable->get( "options" ) )
+			{
+				const toml::table* optionsTable = optionsNode->as_table();
+				if( !optionsTable )
+					throw ARQException( std::format( "Entry '{}' in [data_sources] has 'options' key but it's not a table", dsh ) );
+
+				for( const auto& [key, val] : *optionsTable )
+				{
+					const std::string optionName = std::string( key.str() );
+					if( const std::optional<std::string> str = val.value<std::string>() )
+						cfg.options[optionName] = *str;
+					else if( const std::optional<bool> flag = val.value<bool>() )
+						cfg.options[optionName] = *flag ? "true" : "false";
+					else if( const std::optional<int64_t> num = val.value<int64_t>() )
+						cfg.options[optionName] = std::to_string( *num );
+					else
+						throw ARQException( std::format( "Option '{}' for dsh '{}' must be a string, boolean or integer", optionName, dsh ) );
+				}
+			}
+
 			// Insert into map
 
 			auto [it, inserted] = m_configMap.emplace( dsh, std::move( cfg ) );
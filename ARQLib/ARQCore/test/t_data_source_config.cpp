@@ -191,4 +191,41 @@ TEST( DataSourceConfigManagerTest, MultipleConnPropsEntries )
         EXPECT_EQ( connPropsSecond.port, 5433 );
         ASSERT_FALSE( connPropsSecond.username.has_value() );
     } );
-}
\ No newline at end of file
+}
+
+TEST( DataSourceConfigManagerTest, OptionsTable )
+{
+    const std::string tomlContent = R"(
+        [data_sources]
+        [data_sources.with_options]
+        type = "Redis"
+        [data_sources.with_options.conn_props.Main]
+        hostname = "localhost"
+        port = 6379
+        [data_sources.with_options.options]
+        read_cache = true
+        mode = "fast"
+        depth = 4
+
+        [data_sources.without_options]
+        type = "Redis"
+        [data_sources.without_options.conn_props.Main]
+        hostname = "localhost"
+        port = 6379
+    )";
+
+    DataSourceConfigManager mgr;
+    ASSERT_NO_THROW( mgr.load( tomlContent ) );
+
+    ASSERT_NO_THROW( {
+        const auto& cfg = mgr.get( "with_options" );
+        EXPECT_TRUE( cfg.isOptionSet( "read_cache" ) );
+        EXPECT_EQ( cfg.options.at( "mode" ), "fast" );
+        EXPECT_EQ( cfg.options.at( "depth" ), "4" );
+        EXPECT_FALSE( cfg.isOptionSet( "mode" ) );
+
+        const auto& cfgWithout = mgr.get( "without_options" );
+        EXPECT_TRUE( cfgWithout.options.empty() );
+        EXPECT_FALSE( cfgWithout.isOptionSet( "read_cache" ) );
+    } );
+}
@@ -1,76 +1,153 @@
-//#include <benchmark/benchmark.h>
-//#include <ARQMarket/market.h>
-//
-//#include <random>
-//
-//using namespace ARQ;
-//
-//constexpr int NUM_ENTRIES = 100;
-//Mkt::Market market;
-//
-//// Populate MarketStore with some initial data
-//static void SetupMarket()
-//{
-//    std::mt19937 rng( std::random_device{}() );
-//    std::uniform_real_distribution<double> dist( 1.0, 100.0 );
-//
-//    for( int i = 0; i < NUM_ENTRIES; ++i )
-//    {
-//        const std::string rateID = "FX_" + std::to_string(i);
-//        ARQ::MDEntities::FXRate rate;
-//        rate.ID = rateID;
-//        rate.mid = dist( rng );
-//        rate.ask = dist( rng );
-//        rate.bid = dist( rng );
-//        market.setFXRate( rate );
-//
-//        const std::string eqID = "EQ_" + std::to_string( i );
-//        ARQ::MDEntities::EQPrice eq;
-//        eq.ID = eqID;
-//        eq.ask = dist( rng );
-//        eq.bid = dist( rng );
-//        eq.open = dist( rng );
-//        eq.close = dist( rng );
-//        market.setEQPrice( eq );
-//    }
-//}
-//
-//static void BenchmarkFXRead( benchmark::State& state )
-//{
-//    std::mt19937 rng( std::random_device{}() );
-//    std::uniform_int_distribution<int> idDist ( 0, NUM_ENTRIES - 1 );
-//
-//    for( auto _ : state )
-//    {
-//        const std::string id = "FX_" + std::to_string( idDist( rng ) );
-//        benchmark::DoNotOptimize( market.getFXRate( id ) );
-//    }
-//}
-//BENCHMARK(BenchmarkFXRead);
-//
-//static void BenchmarkFXWrite( benchmark::State& state )
-//{
-//    std::mt19937 rng (std::random_device{}() );
-//    std::uniform_int_distribution<int> idDist( 0, NUM_ENTRIES - 1 );
-//    std::uniform_real_distribution<double> dist( 1.0, 100.0 );
-//
-//    for( auto _ : state )
-//    {
-//        const std::string id = "FX_" + std::to_string( state.iterations() % NUM_ENTRIES );
-//        ARQ::MDEntities::FXRate rate;
-//        rate.ID = id;
-//        rate.mid = dist( rng );
-//        rate.ask = dist( rng );
-//        rate.bid = dist( rng );
-//        market.setFXRate( rate );
-//    }
-//}
-//BENCHMARK( BenchmarkFXWrite );
-
-int main(int argc, char** argv)
+#include <benchmark/benchmark.h>
+#include "b_market_utils.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::MD::Bench;
+
+// Market sizes run from 1k to 1M instruments, and update batch sizes from a single tick to a full refresh of 10k records
+
+static void MarketSizes( benchmark::internal::Benchmark* bench )
+{
+	bench->ArgName( "instruments" )->RangeMultiplier( 10 )->Range( 1'000, 1'000'000 );
+}
+
+static void MarketSizesAndBatchSizes( benchmark::internal::Benchmark* bench )
+{
+	bench->ArgNames( { "instruments", "batch" } );
+	for( int64_t size = 1'000; size <= 1'000'000; size *= 10 )
+	{
+		for( const int64_t batch : { 1, 100, 10'000 } )
+			bench->Args( { size, batch } );
+	}
+}
+
+static void BM_MarketUpdate( benchmark::State& state )
+{
+	const int64_t size      = state.range( 0 );
+	const int64_t batchSize = state.range( 1 );
+
+	const auto market = makeFXMarket( size );
+	const auto idxs   = randomIndexes( size );
+	const auto& ids   = fxIDs( size );
+
+	// Market::update consumes its batch, so batches are built ahead in pools of around 256k records and timing only pauses to refill
+	// the pool - pausing around every update would cost more than the smaller updates being timed
+	const size_t                  poolSize = std::max<size_t>( 1, ( 1 << 18 ) / batchSize );
+	std::vector<RecordCollection> pool;
+	pool.reserve( poolSize );
+
+	size_t  next = 0;
+	int64_t ts   = 1;
+	auto    fillPool = [&] ()
+	{
+		pool.clear();
+		for( size_t b = 0; b < poolSize; ++b, ++ts )
+		{
+			RecordCollection& rc      = pool.emplace_back();
+			auto&             records = rc.get<Record<FXRate>>();
+			records.reserve( batchSize );
+			for( int64_t i = 0; i < batchSize; ++i )
+				records.push_back( makeFXRecord( ids[idxs[next++ % idxs.size()]], 1.0 + i, ts ) );
+		}
+	};
+
+	fillPool();
+	size_t poolIdx = 0;
+	for( auto _ : state )
+	{
+		if( poolIdx == pool.size() )
+		{
+			state.PauseTiming();
+			fillPool();
+			poolIdx = 0;
+			state.ResumeTiming();
+		}
+
+		market->update( std::move( pool[poolIdx++] ) );
+	}
+
+	state.SetItemsProcessed( state.iterations() * batchSize );
+}
+BENCHMARK( BM_MarketUpdate )->Apply( MarketSizesAndBatchSizes )->Unit( benchmark::kMicrosecond );
+
+static void BM_SnapshotGet_ByID( benchmark::State& state )
 {
-    /*SetupMarket();
-    ::benchmark::Initialize(&argc, argv);
-    ::benchmark::RunSpecifiedBenchmarks();*/
-    return 0;
+	const int64_t size     = state.range( 0 );
+	const auto    snapshot = sharedFXMarket( size ).snapshot();
+	const auto    idxs     = randomIndexes( size );
+	const auto&   ids      = fxIDs( size );
+
+	size_t next = 0;
+	for( auto _ : state )
+		benchmark::DoNotOptimize( snapshot->get<FXRate>( ids[idxs[next++ % idxs.size()]] ) );
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_SnapshotGet_ByID )->Apply( MarketSizes );
+
+static void BM_SnapshotGet_ByHandle( benchmark::State& state )
+{
+	const int64_t size     = state.range( 0 );
+	const auto    snapshot = sharedFXMarket( size ).snapshot();
+	const auto    idxs     = randomIndexes( size );
+	const auto&   ids      = fxIDs( size );
+
+	std::vector<InstrumentHandle<FXRate>> handles;
+	handles.reserve( idxs.size() );
+	for( const int64_t idx : idxs )
+		handles.push_back( *snapshot->resolve<FXRate>( ids[idx] ) );
+
+	size_t next = 0;
+	for( auto _ : state )
+		benchmark::DoNotOptimize( snapshot->get<FXRate>( handles[next++ % handles.size()] ) );
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_SnapshotGet_ByHandle )->Apply( MarketSizes );
+
+static void BM_SnapshotForEach( benchmark::State& state )
+{
+	const auto snapshot = sharedFXMarket( state.range( 0 ) ).snapshot();
+	for( auto _ : state )
+	{
+		double total = 0.0;
+		snapshot->forEach<FXRate>( [&total] ( const Record<FXRate>& rcd ) { total += rcd.data.mid; } );
+		benchmark::DoNotOptimize( total );
+	}
+
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_SnapshotForEach )->Apply( MarketSizes )->Unit( benchmark::kMicrosecond );
+
+int main( int argc, char** argv )
+{
+	// Always keep a machine readable copy of the results, so runs can be compared between releases - unless told where to put one
+	std::vector<char*> args( argv, argv + argc );
+
+	bool hasOut = false;
+	for( int i = 1; i < argc; ++i )
+		hasOut |= std::string_view( argv[i] ).starts_with( "--benchmark_out=" );
+
+	std::string outArg    = "--benchmark_out=b_ARQMarket.json";
+	std::string formatArg = "--benchmark_out_format=json";
+	if( !hasOut )
+	{
+		args.push_back( outArg.data() );
+		args.push_back( formatArg.data() );
+	}
+
+	int numArgs = static_cast<int>( args.size() );
+	::benchmark::Initialize( &numArgs, args.data() );
+	if( ::benchmark::ReportUnrecognizedArguments( numArgs, args.data() ) )
+		return 1;
+
+	::benchmark::RunSpecifiedBenchmarks();
+	::benchmark::Shutdown();
+	return 0;
 }
@@ -0,0 +1,146 @@
+#include <benchmark/benchmark.h>
+#include "b_market_utils.h"
+
+#include <ARQMarket/market_live.h>
+#include <ARQMarket/mktdata_topics.h>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::MD::Bench;
+
+namespace
+{
+
+constexpr int64_t NUM_INSTRUMENTS = 10'000;
+
+MarketUpdateBatch makeFXBatch( const int64_t batchSize, const int64_t ts )
+{
+	const auto& ids  = fxIDs( NUM_INSTRUMENTS );
+	const auto  idxs = randomIndexes( NUM_INSTRUMENTS, batchSize );
+
+	MarketUpdateBatch batch;
+	batch.marketName = MarketName::LIVE;
+	for( const int64_t idx : idxs )
+		batch.records.get<Record<FXRate>>().push_back( makeFXRecord( ids[idx], 1.0 + idx, ts ) );
+
+	return batch;
+}
+
+// Captures the updater's subscription handler so the benchmark can feed it messages directly
+
+class BenchSubscription : public ISubscription
+{
+public:
+	int64_t          getID() override                                  { return 0; }
+	std::string_view getTopic() override                               { return ""; }
+	bool             isValid() override                                { return true; }
+	SubStats         getStats() override                               { return SubStats{}; }
+	void             unsubscribe() override                            {}
+	void             drain( const std::chrono::milliseconds ) override {}
+};
+
+class BenchMessagingService : public IMessagingService
+{
+public:
+	void publish( const std::string_view, const Message& ) override {}
+
+	std::unique_ptr<ISubscription> subscribe( const std::string_view, std::shared_ptr<ISubscriptionHandler> subHandler ) override
+	{
+		handler = std::move( subHandler );
+		return std::make_unique<BenchSubscription>();
+	}
+
+	void        registerEventCallback( const MessagingEventCallbackFunc& ) override {}
+	GlobalStats getStats() const override { return GlobalStats{}; }
+
+	std::shared_ptr<ISubscriptionHandler> handler;
+};
+
+// Hands back a copy of the same batch for every message, with the stream offset moved on so none are dropped as stale
+class BenchBatchHandler : public ISerialisableType<MarketUpdateBatch>
+{
+public:
+	explicit BenchBatchHandler( MarketUpdateBatch batch )
+		: m_batch( std::move( batch ) )
+	{}
+
+	Buffer serialise( const MarketUpdateBatch& ) const override { return Buffer(); }
+
+	void deserialise( const BufferView, MarketUpdateBatch& batch ) const override
+	{
+		batch = m_batch;
+		batch.offsets.emplace( StreamTopicPartition( std::string( getUpdateTopic( Type::FXR ) ), 0 ), ++m_offset );
+	}
+
+private:
+	MarketUpdateBatch m_batch;
+	mutable int64_t   m_offset = 0;
+};
+
+}
+
+// Messaging thread to applied market - deserialise, filter and enqueue on the messaging thread, then group commit on the apply thread
+static void BM_LiveMarketUpdater_Apply( benchmark::State& state )
+{
+	const int64_t batchSize = state.range( 0 );
+
+	auto msgSvc     = std::make_shared<BenchMessagingService>();
+	auto serialiser = std::make_shared<Serialiser>();
+	serialiser->registerHandler<MarketUpdateBatch>( std::make_unique<BenchBatchHandler>( makeFXBatch( batchSize, 1 ) ) );
+
+	MessagingServiceFactory::inst().addCustomService( "BENCH_MSG", msgSvc );
+	SerialiserFactory::inst().addCustomSerialiser( SerialiserFactory::SerialiserImpl::Protobuf, serialiser );
+
+	std::shared_ptr<Market> market = makeFXMarket( NUM_INSTRUMENTS );
+	auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+		market, "", "BENCH_MSG", MarketName::LIVE, TIDSet(), TIDSet()
+	} );
+	updater->start();
+
+	for( auto _ : state )
+		msgSvc->handler->onMsg( Message{ Buffer(), std::string( LiveMarketUpdater::SUB_TOPIC_PFX ) + MarketName::LIVE.str(), {} } );
+
+	// Include draining the apply queue, otherwise this only measures enqueueing
+	updater->flush();
+
+	const LiveMarketUpdater::Stats stats = updater->getStats();
+	state.counters["batch_coalescing"] = stats.batchCoalescingRatio();
+	state.counters["max_queue_depth"]  = static_cast<double>( stats.maxQueueDepth );
+	state.SetItemsProcessed( state.iterations() * batchSize );
+
+	updater->stop();
+	SerialiserFactory::inst().delCustomSerialiser( SerialiserFactory::SerialiserImpl::Protobuf );
+	MessagingServiceFactory::inst().delCustomService( "BENCH_MSG" );
+}
+BENCHMARK( BM_LiveMarketUpdater_Apply )->ArgName( "batch" )->RangeMultiplier( 10 )->Range( 1, 10'000 )->UseRealTime();
+
+static void BM_MarketUpdateBatch_Serialise( benchmark::State& state )
+{
+	const auto              serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
+	const MarketUpdateBatch batch      = makeFXBatch( state.range( 0 ), 1 );
+
+	size_t bytes = 0;
+	for( auto _ : state )
+	{
+		const Buffer buf = serialiser->serialise( batch );
+		bytes += buf.size;
+		benchmark::DoNotOptimize( buf.data.get() );
+	}
+
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+	state.SetBytesProcessed( bytes );
+}
+BENCHMARK( BM_MarketUpdateBatch_Serialise )->ArgName( "batch" )->RangeMultiplier( 10 )->Range( 1, 10'000 );
+
+static void BM_MarketUpdateBatch_Deserialise( benchmark::State& state )
+{
+	const auto   serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
+	const Buffer buf        = serialiser->serialise( makeFXBatch( state.range( 0 ), 1 ) );
+
+	for( auto _ : state )
+		benchmark::DoNotOptimize( serialiser->deserialise<MarketUpdateBatch>( BufferView( buf.data.get(), buf.size ) ) );
+
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+	state.SetBytesProcessed( state.iterations() * buf.size );
+}
+BENCHMARK( BM_MarketUpdateBatch_Deserialise )->ArgName( "batch" )->RangeMultiplier( 10 )->Range( 1, 10'000 );
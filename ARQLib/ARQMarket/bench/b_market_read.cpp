@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include "b_market_utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::MD::Bench;
+
+// Reader scaling on one shared market - snapshot() bumps the snapshot's reference count on every read,
+// read() only pins an epoch in a thread-owned slot. The "WithWriter" variants publish a new snapshot every 100us underneath the readers
+
+namespace
+{
+
+constexpr int64_t NUM_INSTRUMENTS = 10'000;
+
+Market& contendedMarket()
+{
+	static const std::unique_ptr<Market> market = makeFXMarket( NUM_INSTRUMENTS );
+	return *market;
+}
+
+std::atomic<bool> s_writerRunning = false;
+std::thread       s_writer;
+
+void startWriter( const benchmark::State& )
+{
+	Market& market  = contendedMarket();
+	s_writerRunning = true;
+	s_writer = std::thread( [&market] ()
+	{
+		const auto& ids = fxIDs( NUM_INSTRUMENTS );
+		for( int64_t i = 0; s_writerRunning.load( std::memory_order_relaxed ); ++i )
+		{
+			RecordCollection rc;
+			rc.get<Record<FXRate>>().push_back( makeFXRecord( ids[i % NUM_INSTRUMENTS], static_cast<double>( i ), i ) );
+			market.update( std::move( rc ) );
+
+			std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+		}
+	} );
+}
+
+void stopWriter( const benchmark::State& )
+{
+	s_writerRunning = false;
+	if( s_writer.joinable() )
+		s_writer.join();
+}
+
+}
+
+static void BM_MarketRead_SharedSnapshot( benchmark::State& state )
+{
+	const Market& market = contendedMarket();
+	const auto&   ids    = fxIDs( NUM_INSTRUMENTS );
+	const auto    idxs   = randomIndexes( NUM_INSTRUMENTS );
+
+	size_t next = state.thread_index();
+	for( auto _ : state )
+	{
+		const auto snapshot = market.snapshot();
+		benchmark::DoNotOptimize( snapshot->get<FXRate>( ids[idxs[next++ % idxs.size()]] ) );
+	}
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_MarketRead_SharedSnapshot )->ThreadRange( 1, 64 )->UseRealTime();
+BENCHMARK( BM_MarketRead_SharedSnapshot )->Name( "BM_MarketRead_SharedSnapshot/WithWriter" )->Setup( startWriter )->Teardown( stopWriter )->ThreadRange( 1, 64 )->UseRealTime();
+
+static void BM_MarketRead_Guard( benchmark::State& state )
+{
+	const Market& market = contendedMarket();
+	const auto&   ids    = fxIDs( NUM_INSTRUMENTS );
+	const auto    idxs   = randomIndexes( NUM_INSTRUMENTS );
+
+	size_t next = state.thread_index();
+	for( auto _ : state )
+	{
+		const auto guard = market.read();
+		benchmark::DoNotOptimize( guard->get<FXRate>( ids[idxs[next++ % idxs.size()]] ) );
+	}
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_MarketRead_Guard )->ThreadRange( 1, 64 )->UseRealTime();
+BENCHMARK( BM_MarketRead_Guard )->Name( "BM_MarketRead_Guard/WithWriter" )->Setup( startWriter )->Teardown( stopWriter )->ThreadRange( 1, 64 )->UseRealTime();
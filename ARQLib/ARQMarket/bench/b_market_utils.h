@@ -0,0 +1,103 @@
+#pragma once
+
+#include <ARQMarket/market.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// Shared fixtures for the ARQMarket benchmarks
+
+namespace ARQ::MD::Bench
+{
+
+inline std::string fxID( const int64_t i )
+{
+	return "FX_" + std::to_string( i );
+}
+
+inline Record<FXRate> makeFXRecord( std::string id, const double mid, const int64_t ts )
+{
+	Record<FXRate> rcd {};
+	rcd.header.id       = std::move( id );
+	rcd.header.asofTs   = Time::DateTime( Time::Microseconds( ts ) );
+	rcd.header.isActive = true;
+	rcd.data.mid        = mid;
+	rcd.data.bid        = mid - 0.0001;
+	rcd.data.ask        = mid + 0.0001;
+	return rcd;
+}
+
+/**
+ * @brief The ids FX_0 ... FX_<n-1>, built once per size and shared by every benchmark.
+ */
+inline const std::vector<std::string>& fxIDs( const int64_t n )
+{
+	static std::mutex                                  mutex;
+	static std::map<int64_t, std::vector<std::string>> cache;
+
+	std::lock_guard<std::mutex> lock( mutex );
+	auto [it, inserted] = cache.try_emplace( n );
+	if( inserted )
+	{
+		it->second.reserve( n );
+		for( int64_t i = 0; i < n; ++i )
+			it->second.push_back( fxID( i ) );
+	}
+
+	return it->second;
+}
+
+/**
+ * @brief A fresh market holding n FX rates, all with asofTs 0.
+ */
+inline std::unique_ptr<Market> makeFXMarket( const int64_t n )
+{
+	auto market = std::make_unique<Market>();
+
+	RecordCollection rc;
+	auto&            records = rc.get<Record<FXRate>>();
+	records.reserve( n );
+	for( const std::string& id : fxIDs( n ) )
+		records.push_back( makeFXRecord( id, 1.0, 0 ) );
+
+	market->update( std::move( rc ) );
+	return market;
+}
+
+/**
+ * @brief A market of n FX rates shared between benchmarks that only read from it - building the larger ones takes a while.
+ */
+inline const Market& sharedFXMarket( const int64_t n )
+{
+	static std::mutex                                  mutex;
+	static std::map<int64_t, std::unique_ptr<Market>> cache;
+
+	std::lock_guard<std::mutex> lock( mutex );
+	auto& market = cache[n];
+	if( !market )
+		market = makeFXMarket( n );
+
+	return *market;
+}
+
+/**
+ * @brief A fixed sequence of random indexes in [0, n), so every run of a benchmark does the same lookups.
+ */
+inline std::vector<int64_t> randomIndexes( const int64_t n, const size_t count = 1 << 16 )
+{
+	std::mt19937_64                        rng( 42 );
+	std::uniform_int_distribution<int64_t> dist( 0, n - 1 );
+
+	std::vector<int64_t> idxs( count );
+	for( int64_t& idx : idxs )
+		idx = dist( rng );
+
+	return idxs;
+}
+
+}
@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include "b_market_utils.h"
+
+#include <ARQMarket/tid.h>
+
+#include <algorithm>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::MD::Bench;
+
+// Filtering an incoming batch of 10k FX records against a TIDSet naming the given number of ids
+
+namespace
+{
+
+constexpr int64_t BATCH_SIZE = 10'000;
+
+TIDSet makeFilter( const int64_t numIDs )
+{
+	// Every other id, so some of a batch is filtered out - and at the larger sizes the set also holds ids the batch never has
+	TIDSet tids;
+	const auto& ids = fxIDs( 2 * std::max( numIDs, BATCH_SIZE ) );
+	for( int64_t i = 0; i < numIDs; ++i )
+		tids.insert( TID( Type::FXR, ids[2 * i] ) );
+
+	return tids;
+}
+
+}
+
+static void BM_TIDSet_Contains( benchmark::State& state )
+{
+	const TIDSet tids = makeFilter( state.range( 0 ) );
+	const auto&  ids  = fxIDs( BATCH_SIZE );
+
+	for( auto _ : state )
+	{
+		int64_t matched = 0;
+		for( const std::string& id : ids )
+			matched += tids.contains( TID( Type::FXR, id ) );
+		benchmark::DoNotOptimize( matched );
+	}
+
+	state.SetItemsProcessed( state.iterations() * BATCH_SIZE );
+}
+BENCHMARK( BM_TIDSet_Contains )->ArgName( "ids" )->RangeMultiplier( 10 )->Range( 10, 10'000 )->Unit( benchmark::kMicrosecond );
+
+static void BM_CompiledTIDSet_Matches( benchmark::State& state )
+{
+	const CompiledTIDSet filter( makeFilter( state.range( 0 ) ) );
+	const auto&          ids = fxIDs( BATCH_SIZE );
+
+	for( auto _ : state )
+	{
+		int64_t matched = 0;
+		for( const std::string& id : ids )
+			matched += filter.matches( Type::FXR, id );
+		benchmark::DoNotOptimize( matched );
+	}
+
+	state.SetItemsProcessed( state.iterations() * BATCH_SIZE );
+}
+BENCHMARK( BM_CompiledTIDSet_Matches )->ArgName( "ids" )->RangeMultiplier( 10 )->Range( 10, 10'000 )->Unit( benchmark::kMicrosecond );
+
+static void BM_CompiledTIDSet_Compile( benchmark::State& state )
+{
+	const TIDSet tids = makeFilter( state.range( 0 ) );
+	for( auto _ : state )
+		benchmark::DoNotOptimize( CompiledTIDSet( tids ) );
+
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_CompiledTIDSet_Compile )->ArgName( "ids" )->RangeMultiplier( 10 )->Range( 10, 10'000 )->Unit( benchmark::kMicrosecond );
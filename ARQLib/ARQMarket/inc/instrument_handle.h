@@ -0,0 +1,167 @@
+#pragma once
+
+#include <ARQMarket/dll.h>
+
+#include <ARQUtils/hashers.h>
+#include <ARQMarket/mktdata_entities.h>
+
+#include <ankerl/unordered_dense.h>
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief A dense integer handle for an instrument id of a given entity type.
+ *
+ * Handles are issued by an InstrumentSymbolTable and remain valid for the lifetime of the Market that issued them (ids are never
+ * un-interned, even if the record is erased), so callers can resolve an id once and reuse the handle against every later snapshot.
+ *
+ * A handle only means something to snapshots of the market that issued it - each carries the id of its table, and a snapshot of any
+ * other market asserts on it (and finds nothing in release builds) rather than returning whichever record has the same index there.
+ */
+template<c_MktData T>
+struct InstrumentHandle
+{
+	static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+	uint32_t idx     = INVALID;
+	uint32_t tableID = INVALID;
+
+	[[nodiscard]] bool isValid() const noexcept { return idx != INVALID; }
+
+	auto operator<=>( const InstrumentHandle& ) const = default;
+};
+
+/**
+ * @brief Issues the id of each new InstrumentSymbolTable, unique across every entity type. Defined out of line so every module shares
+ *        the one counter - a static in the template would be duplicated in each DLL that instantiates it, and their ids could collide.
+ */
+ARQMarket_API uint32_t nextInstrumentSymbolTableID();
+
+/**
+ * @brief Thread-safe, append-only mapping from instrument id to dense handle for a single entity type.
+ *
+ * Handles are allocated sequentially from zero, so they can be used to index directly into per-snapshot arrays.
+ *
+ * The table never shrinks - an id keeps its handle after its record is erased, as handles held by callers must stay valid - so it
+ * grows with every distinct id the market has ever seen. Markets whose ids churn (e.g. dated instruments) should be rebuilt
+ * periodically rather than living forever.
+ */
+template<c_MktData T>
+class InstrumentSymbolTable
+{
+public:
+	InstrumentSymbolTable()
+		: m_id( nextInstrumentSymbolTableID() )
+	{}
+
+	InstrumentSymbolTable( const InstrumentSymbolTable& )            = delete;
+	InstrumentSymbolTable& operator=( const InstrumentSymbolTable& ) = delete;
+
+	/**
+	 * @brief Identifies this table among every table in the process - stamped on each handle it issues.
+	 */
+	[[nodiscard]] uint32_t id() const noexcept { return m_id; }
+
+	/**
+	 * @brief Whether the handle was issued by this table.
+	 */
+	[[nodiscard]] bool owns( const InstrumentHandle<T> handle ) const noexcept { return handle.tableID == m_id; }
+
+	[[nodiscard]] std::optional<InstrumentHandle<T>> find( const std::string_view id ) const
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+		if( const auto it = m_handles.find( id ); it != m_handles.end() )
+			return InstrumentHandle<T>{ it->second, m_id };
+		else
+			return std::nullopt;
+	}
+
+	/**
+	 * @brief Returns the handle for the given id, allocating a new one if the id has not been seen before.
+	 */
+	[[nodiscard]] InstrumentHandle<T> intern( const std::string_view id )
+	{
+		if( const auto handle = find( id ) )
+			return *handle;
+
+		std::unique_lock<std::shared_mutex> lock( m_mutex );
+		// Another thread may have interned it between dropping the shared lock and taking the unique one
+		const auto [it, _] = m_handles.try_emplace( std::string( id ), static_cast<uint32_t>( m_handles.size() ) );
+		return InstrumentHandle<T>{ it->second, m_id };
+	}
+
+	/**
+	 * @brief As intern, for the id of every record in a batch - out[i] is the handle for records[i].
+	 *        Takes the lock once for the batch (twice if any id is new) rather than once per record.
+	 */
+	void intern( const std::vector<Record<T>>& records, std::vector<InstrumentHandle<T>>& out )
+	{
+		out.assign( records.size(), InstrumentHandle<T>{ InstrumentHandle<T>::INVALID, m_id } );
+
+		bool anyNew = false;
+		{
+			std::shared_lock<std::shared_mutex> lock( m_mutex );
+			for( size_t i = 0; i < records.size(); ++i )
+			{
+				if( const auto it = m_handles.find( records[i].header.id ); it != m_handles.end() )
+					out[i].idx = it->second;
+				else
+					anyNew = true;
+			}
+		}
+
+		if( !anyNew )
+			return;
+
+		std::unique_lock<std::shared_mutex> lock( m_mutex );
+		for( size_t i = 0; i < records.size(); ++i )
+		{
+			if( out[i].isValid() )
+				continue;
+
+			const auto [it, _] = m_handles.try_emplace( records[i].header.id, static_cast<uint32_t>( m_handles.size() ) );
+			out[i].idx = it->second;
+		}
+	}
+
+	/**
+	 * @brief Reverse lookup of the id a handle was issued for.
+	 * @return The id, or std::nullopt if the handle was not issued by this table.
+	 */
+	[[nodiscard]] std::optional<std::string> idOf( const InstrumentHandle<T> handle ) const
+	{
+		if( !owns( handle ) )
+			return std::nullopt;
+
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+		// Entries are never erased, so the ankerl value vector is in handle order
+		if( handle.idx < m_handles.size() )
+			return m_handles.values()[handle.idx].first;
+		else
+			return std::nullopt;
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+		return m_handles.size();
+	}
+
+private:
+	const uint32_t                                                                                    m_id;
+	ankerl::unordered_dense::map<std::string, uint32_t, AnkerlTransparentStringHash, std::equal_to<>> m_handles;
+	mutable std::shared_mutex                                                                         m_mutex;
+};
+
+}
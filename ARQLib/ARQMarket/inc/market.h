@@ -1,12 +1,23 @@
 #pragma once
 #include <ARQMarket/dll.h>
 
+#include <ARQUtils/epoch.h>
 #include <ARQUtils/hashers.h>
+#include <ARQUtils/persistent_array.h>
+#include <ARQUtils/persistent_hash_map.h>
+#include <ARQMarket/instrument_handle.h>
+#include <ARQMarket/market_change_set.h>
+#include <ARQMarket/market_history.h>
+#include <ARQMarket/market_subscriptions.h>
 #include <ARQMarket/mktdata_entities.h>
 
-#include <ankerl/unordered_dense.h>
-
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <mutex>
 
@@ -42,46 +53,227 @@ template<typename T>
 class MarketSnapshotImpl;
 
 template<c_MktData... Entities>
-class MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>
+class MarketSnapshotImpl<EntityRecordList<Record<Entities>...>> : public std::enable_shared_from_this<MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>>
 {
 public:
-	MarketSnapshotImpl() = default;
+	// Shared by a market and every snapshot it produces, so handles resolved against one snapshot are valid for all of them
+	using SymbolTables = std::tuple<InstrumentSymbolTable<Entities>...>;
+	using ChangeSet    = MarketChangeSetImpl<EntityRecordList<Record<Entities>...>>;
+
+public:
+	MarketSnapshotImpl()
+		: m_symbols( std::make_shared<SymbolTables>() )
+	{}
 	MarketSnapshotImpl( Time::DateTime asofTs )
-		: m_asofTs( asofTs )
+		: m_symbols( std::make_shared<SymbolTables>() )
+		, m_asofTs( asofTs )
 	{}
 
 	template<c_MktData Entity>
 	OptConstRef<Record<Entity>> const get( const std::string_view id ) const
 	{
 		const auto& map = std::get<RecordMap<Entity>>( m_data );
-		if( auto it = map.find( id ); it != map.end() )
-			return it->second.get();
+		if( const auto* rcdPtr = map.find( id ) )
+			return rcdPtr->get();
 		else
 			return {};
 	}
 
+	/**
+	 * @brief As get, but shares ownership of the record so it can outlive this snapshot.
+	 */
+	template<c_MktData Entity>
+	[[nodiscard]] std::shared_ptr<const Record<Entity>> getShared( const std::string_view id ) const
+	{
+		const auto& map = std::get<RecordMap<Entity>>( m_data );
+		if( const auto* rcdPtr = map.find( id ) )
+			return *rcdPtr;
+		else
+			return nullptr;
+	}
+
+	/**
+	 * @brief Fast path lookup - a handful of array indexes with no hashing or string comparisons.
+	 *        Handles issued after this snapshot was taken are safe to pass and simply aren't found. Handles must come from this
+	 *        snapshot's market - one from another market asserts, and isn't found in release builds.
+	 */
+	template<c_MktData Entity>
+	OptConstRef<Record<Entity>> const get( const InstrumentHandle<Entity> handle ) const
+	{
+		const bool owned = std::get<InstrumentSymbolTable<Entity>>( *m_symbols ).owns( handle );
+		assert( owned && "InstrumentHandle used with a snapshot of a different market" );
+		if( !owned )
+			return {};
+
+		const auto& arr = std::get<HandleArray<Entity>>( m_byHandle );
+		if( const auto* rcdPtr = arr.find( handle.idx ) )
+			return rcdPtr->get();
+		else
+			return {};
+	}
+
+	/**
+	 * @brief Resolves an id to its handle without interning it.
+	 * @return The handle, or std::nullopt if the id has never been seen by the owning market.
+	 */
+	template<c_MktData Entity>
+	[[nodiscard]] std::optional<InstrumentHandle<Entity>> resolve( const std::string_view id ) const
+	{
+		return std::get<InstrumentSymbolTable<Entity>>( *m_symbols ).find( id );
+	}
+
+	template<c_MktData Entity>
+	[[nodiscard]] size_t size() const { return std::get<RecordMap<Entity>>( m_data ).size(); }
+
+	/**
+	 * @brief Calls func( const Record<Entity>& ) for every Entity record in this snapshot, in no particular order.
+	 */
+	template<c_MktData Entity, typename F>
+	void forEach( F&& func ) const
+	{
+		std::get<RecordMap<Entity>>( m_data ).forEach( [&func] ( const std::string&, const std::shared_ptr<const Record<Entity>>& rcdPtr ) { func( *rcdPtr ); } );
+	}
+
+	/**
+	 * @brief Every Entity record in this snapshot in columnar form, ordered by handle.
+	 *        Built on first request and then shared by all readers of this snapshot, so whole market scans run over contiguous arrays rather than chasing record pointers.
+	 */
+	template<c_MktData Entity>
+	[[nodiscard]] std::shared_ptr<const Columns<Entity>> columns() const
+	{
+		LazyColumns<Entity>& lazy = m_columns.template get<Entity>();
+		std::call_once( lazy.once, [this, &lazy] ()
+		{
+			const auto& arr  = std::get<HandleArray<Entity>>( m_byHandle );
+			auto        cols = std::make_shared<Columns<Entity>>();
+
+			cols->reserve( size<Entity>() );
+			for( size_t idx = 0; idx < arr.size(); ++idx )
+			{
+				if( const auto* rcdPtr = arr.find( idx ); rcdPtr && *rcdPtr )
+					cols->push_back( **rcdPtr );
+			}
+
+			lazy.columns = std::move( cols );
+		} );
+
+		return lazy.columns;
+	}
+
 	[[nodiscard]] Time::DateTime asofTs() const { return m_asofTs; }
 
+	/**
+	 * @brief Monotonically increasing version - each update to the owning market produces the next version.
+	 */
+	[[nodiscard]] uint64_t version() const { return m_version; }
+
+	/**
+	 * @brief The ids touched by the update that produced this snapshot, i.e. the changes relative to version() - 1.
+	 */
+	[[nodiscard]] const ChangeSet& changes() const
+	{
+		static const ChangeSet s_noChanges;
+		return m_changes ? *m_changes : s_noChanges;
+	}
+
+	/**
+	 * @brief Every id that differs between two snapshots, which need not be consecutive versions.
+	 *        Subtrees shared between the snapshots are skipped, so the cost is proportional to the number of changes rather than the size of the market.
+	 */
+	[[nodiscard]] static ChangeSet diff( const MarketSnapshotImpl& older, const MarketSnapshotImpl& newer )
+	{
+		// Consecutive versions of the same market - the update already recorded exactly what changed
+		if( newer.m_changes && older.m_symbols == newer.m_symbols && newer.m_changes->fromVersion() == older.m_version )
+			return *newer.m_changes;
+
+		ChangeSet changeSet( older.m_version, newer.m_version );
+		( diffEntity<Entities>( older, newer, changeSet.template get<Entities>() ), ... );
+		return changeSet;
+	}
+
 private:
-	template<c_MktData Entity> // TODO: Use mimallocator
-	using RecordMap = ankerl::unordered_dense::map<std::string, std::shared_ptr<const Record<Entity>>, AnkerlTransparentStringHash, std::equal_to<>>;
+	// Persistent map so that copying a snapshot is O(1) and updating it only copies the path to each touched id - all other nodes are shared with older snapshots
+	template<c_MktData Entity>
+	using RecordMap = PersistentHashMap<std::string, std::shared_ptr<const Record<Entity>>, AnkerlTransparentStringHash, std::equal_to<>>;
+
+	// The same records indexed by dense handle - also persistent, and erased records just leave an empty slot
+	template<c_MktData Entity>
+	using HandleArray = PersistentArray<std::shared_ptr<const Record<Entity>>>;
+
+	template<c_MktData Entity>
+	struct LazyColumns
+	{
+		std::once_flag                         once;
+		std::shared_ptr<const Columns<Entity>> columns;
+	};
+
+	// Copies start out empty rather than sharing, as a copied snapshot is about to diverge from the original
+	class ColumnCache
+	{
+	public:
+		ColumnCache()
+			: m_cache( std::make_unique<std::tuple<LazyColumns<Entities>...>>() )
+		{}
+		ColumnCache( const ColumnCache& )
+			: ColumnCache()
+		{}
+		ColumnCache& operator=( const ColumnCache& )
+		{
+			m_cache = std::make_unique<std::tuple<LazyColumns<Entities>...>>();
+			return *this;
+		}
+
+		template<c_MktData Entity>
+		[[nodiscard]] LazyColumns<Entity>& get() const { return std::get<LazyColumns<Entity>>( *m_cache ); }
+
+	private:
+		std::unique_ptr<std::tuple<LazyColumns<Entities>...>> m_cache;
+	};
 
 private:
+	explicit MarketSnapshotImpl( std::shared_ptr<SymbolTables> symbols )
+		: m_symbols( std::move( symbols ) )
+	{}
+
 	template<c_MktData Entity>
-	void set( const Record<Entity>& rcd )
+	void set( const InstrumentHandle<Entity> handle, Record<Entity>&& rcd )
 	{
-		std::get<RecordMap<Entity>>( m_data )[rcd.header.id] = std::make_shared<const Record<Entity>>( rcd );
+		auto        rcdPtr = std::make_shared<const Record<Entity>>( std::move( rcd ) );
+		std::string id     = rcdPtr->header.id; // Copy before rcdPtr is moved from - argument evaluation order is unspecified
+		std::get<HandleArray<Entity>>( m_byHandle ).set( handle.idx, rcdPtr );
+		std::get<RecordMap<Entity>>( m_data ).set( std::move( id ), std::move( rcdPtr ) );
 	}
 
 	template<c_MktData Entity>
-	void erase( const std::string_view id )
+	void erase( const InstrumentHandle<Entity> handle, const std::string_view id )
 	{
-		std::get<RecordMap<Entity>>( m_data ).erase( id );
+		if( std::get<RecordMap<Entity>>( m_data ).erase( id ) )
+			std::get<HandleArray<Entity>>( m_byHandle ).set( handle.idx, nullptr );
+	}
+
+	template<c_MktData Entity>
+	static void diffEntity( const MarketSnapshotImpl& older, const MarketSnapshotImpl& newer, EntityChanges<Entity>& changes )
+	{
+		using RcdPtr = std::shared_ptr<const Record<Entity>>;
+		std::get<RecordMap<Entity>>( older.m_data ).diff( std::get<RecordMap<Entity>>( newer.m_data ), [&changes] ( const std::string& id, const RcdPtr* before, const RcdPtr* after )
+		{
+			if( before && after )
+				changes.updated.push_back( id );
+			else if( after )
+				changes.inserted.push_back( id );
+			else
+				changes.erased.push_back( id );
+		} );
 	}
 
 private:
-	std::tuple<RecordMap<Entities>...> m_data;
-	Time::DateTime                     m_asofTs;
+	std::shared_ptr<SymbolTables>        m_symbols;
+	std::tuple<RecordMap<Entities>...>   m_data;
+	std::tuple<HandleArray<Entities>...> m_byHandle;
+	Time::DateTime                       m_asofTs;
+	uint64_t                             m_version = 0;
+	std::shared_ptr<const ChangeSet>     m_changes;
+	ColumnCache                          m_columns;
 
 private:
 	friend MarketImpl<EntityRecordList<Record<Entities>...>>;
@@ -89,61 +281,242 @@ private:
 
 using MarketSnapshot = MarketSnapshotImpl<AllEntityRecords>;
 
+/**
+ * @brief RAII read access to a market's current snapshot, with no shared writes on the read path - unlike Market::snapshot,
+ *        which bumps the snapshot's reference count. The snapshot can't be reclaimed while the guard lives, so keep guards
+ *        short lived, destroy them on the thread that took them and never let them outlive their market.
+ */
+template<typename Snapshot>
+class SnapshotGuardImpl
+{
+public:
+	SnapshotGuardImpl( const SnapshotGuardImpl& )            = delete;
+	SnapshotGuardImpl& operator=( const SnapshotGuardImpl& ) = delete;
+
+	[[nodiscard]] const Snapshot* get()        const noexcept { return m_snapshot; }
+	              const Snapshot* operator->() const noexcept { return m_snapshot; }
+	              const Snapshot& operator*()  const noexcept { return *m_snapshot; }
+
+	/**
+	 * @brief Shares ownership of the guarded snapshot so it can outlive the guard.
+	 */
+	[[nodiscard]] std::shared_ptr<const Snapshot> share() const { return m_snapshot->shared_from_this(); }
+
+private:
+	// The epoch is pinned before the pointer is loaded, so the market can't reclaim whatever is loaded
+	explicit SnapshotGuardImpl( const std::atomic<const Snapshot*>& current )
+		: m_snapshot( current.load( std::memory_order_seq_cst ) )
+	{}
+
+private:
+	EpochGuard      m_epoch;
+	const Snapshot* m_snapshot;
+
+private:
+	template<typename T>
+	friend class MarketImpl;
+};
+
+using SnapshotGuard = SnapshotGuardImpl<MarketSnapshot>;
+
 template<c_MktData... Entities>
 class MarketImpl<EntityRecordList<Record<Entities>...>>
 {
 public:
-	using Snapshot = MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>;
+	using Snapshot       = MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>;
+	using Dispatcher     = MarketChangeDispatcherImpl<EntityRecordList<Record<Entities>...>>;
+	using ChangeEvent    = typename Dispatcher::Event;
+	using ChangeCallback = typename Dispatcher::Callback;
+	using History        = MarketHistoryImpl<EntityRecordList<Record<Entities>...>>;
+	using Guard          = SnapshotGuardImpl<Snapshot>;
 
 public:
 	MarketImpl()
-		: m_currentSnapshot( std::make_shared<Snapshot>() )
+		: m_symbols( std::make_shared<typename Snapshot::SymbolTables>() )
+		, m_currentOwner( std::shared_ptr<Snapshot>( new Snapshot( m_symbols ) ) )
+		, m_current( m_currentOwner.get() )
+	{
+	}
+
+	/**
+	 * @brief Creates a market that also retains a bounded history of its snapshots for snapshotAt queries.
+	 * @param onEvict Optionally receives each snapshot as it falls out of the history, e.g. MarketSnapshotSpillLog::evictCallback.
+	 */
+	explicit MarketImpl( const MarketHistoryParams& historyParams, typename History::EvictCallback onEvict = {} )
+		: MarketImpl()
 	{
+		m_history = std::make_unique<History>( historyParams, std::move( onEvict ) );
+		m_history->record( m_currentOwner );
 	}
 
 public:
 	[[nodiscard]] std::shared_ptr<const Snapshot> snapshot() const
 	{
-		return m_currentSnapshot.load( std::memory_order_acquire );
+		return read().share();
+	}
+
+	/**
+	 * @brief Scoped access to the current snapshot for hot read paths - no reference counting, so readers on different cores never contend.
+	 */
+	[[nodiscard]] Guard read() const
+	{
+		return Guard( m_current );
+	}
+
+	/**
+	 * @brief The market as it was at the given time, i.e. the latest retained snapshot whose asofTs is at or before it.
+	 *        Without history only the current snapshot is retained.
+	 * @return The snapshot, or nullptr if the time is before the oldest retained snapshot.
+	 */
+	[[nodiscard]] std::shared_ptr<const Snapshot> snapshotAt( const Time::DateTime asofTs ) const
+	{
+		if( m_history )
+			return m_history->snapshotAt( asofTs );
+
+		auto current = snapshot();
+		return current->asofTs() <= asofTs ? current : nullptr;
+	}
+
+	/**
+	 * @brief The retained snapshot with exactly the given version, or nullptr if it isn't retained.
+	 */
+	[[nodiscard]] std::shared_ptr<const Snapshot> snapshotAtVersion( const uint64_t version ) const
+	{
+		if( m_history )
+			return m_history->snapshotAtVersion( version );
+
+		auto current = snapshot();
+		return current->version() == version ? current : nullptr;
+	}
+
+	/**
+	 * @brief The snapshot history, or nullptr if this market wasn't created with one.
+	 */
+	[[nodiscard]] const History* history() const noexcept { return m_history.get(); }
+
+	/**
+	 * @brief Resolves an id to a dense handle, interning it if it hasn't been seen yet.
+	 *        The handle can be used with Snapshot::get for this and all future snapshots of this market -
+	 *        ids not yet present in the market can be resolved ahead of their first update.
+	 */
+	template<c_MktData Entity>
+	[[nodiscard]] InstrumentHandle<Entity> resolve( const std::string_view id )
+	{
+		return std::get<InstrumentSymbolTable<Entity>>( *m_symbols ).intern( id );
+	}
+
+	/**
+	 * @brief Registers interest in the given TIDs - the callback is invoked on the market's dispatcher pool for each subsequent insert, update or erase of a matching id, never on the updating thread.
+	 *        Changes are conflated per id (latest value wins) if the subscriber falls behind, so take a snapshot() after subscribing for the initial state.
+	 * @return The subscription - callbacks stop when it is unsubscribed or destroyed.
+	 */
+	[[nodiscard]] std::unique_ptr<MarketSubscription> subscribe( const TIDSet& tids, ChangeCallback callback )
+	{
+		std::lock_guard<std::mutex> lock( m_writerMutex );
+
+		// Only markets with subscribers pay for dispatching
+		if( !m_dispatcher )
+			m_dispatcher = std::make_unique<Dispatcher>( m_currentOwner );
+
+		return m_dispatcher->subscribe( tids, std::move( callback ) );
 	}
 
 	void update( RecordCollection&& records )
 	{
 		std::lock_guard<std::mutex> lock( m_writerMutex );
 
-		// Copy current mkt state
-		std::shared_ptr<Snapshot> newSnapshot = std::make_shared<Snapshot>( *m_currentSnapshot.load( std::memory_order_relaxed ) );
+		// Copy current mkt state - cheap as the record maps are structurally shared with the current snapshot
+		const std::shared_ptr<const Snapshot> currentSnapshot = m_currentOwner;
+		std::shared_ptr<Snapshot>             newSnapshot     = std::make_shared<Snapshot>( *currentSnapshot );
+		auto                                  changeSet       = std::make_shared<typename Snapshot::ChangeSet>( currentSnapshot->m_version, currentSnapshot->m_version + 1 );
 
 		// Update copy with new data
 		Time::DateTime latestTs = newSnapshot->m_asofTs;
-		records.visitVectors( [&newSnapshot, &latestTs] <c_MktData T> ( std::vector<Record<T>>& recs )
+		records.visitVectors( [this, &currentSnapshot, &newSnapshot, &changeSet, &latestTs] <c_MktData T> ( std::vector<Record<T>>& recs )
 		{
-			for( const auto& rec : recs )
+			auto& symbols = std::get<InstrumentSymbolTable<T>>( *m_symbols );
+
+			std::vector<InstrumentHandle<T>> handles;
+			symbols.intern( recs, handles );
+
+			std::vector<InstrumentHandle<T>> touched;
+			touched.reserve( recs.size() );
+
+			for( size_t i = 0; i < recs.size(); ++i )
 			{
-				if( const auto current = newSnapshot->template get<T>( rec.header.id ) )
+				Record<T>&                rec    = recs[i];
+				const InstrumentHandle<T> handle = handles[i];
+				if( const auto current = newSnapshot->template get<T>( handle ) )
 				{
 					if( rec.header.asofTs < current->header.asofTs )
 						continue;
 				}
 
+				if( rec.header.asofTs > latestTs )
+					latestTs = rec.header.asofTs;
+
+				touched.push_back( handle );
 				if( rec.header.isActive )
-					newSnapshot->template set<T>( rec );
+					newSnapshot->template set<T>( handle, std::move( rec ) );
 				else
-					newSnapshot->template erase<T>( rec.header.id );
+					newSnapshot->template erase<T>( handle, rec.header.id );
+			}
 
-				if( rec.header.asofTs > latestTs )
-					latestTs = rec.header.asofTs;
+			// Classify on the net effect of the batch, so an id touched several times is only reported once - as updated whenever it's
+			// present both before and after (even if its values come out the same), and not at all if it's inserted then erased
+			std::ranges::sort( touched );
+			const auto [dupsBegin, dupsEnd] = std::ranges::unique( touched );
+			touched.erase( dupsBegin, dupsEnd );
+
+			EntityChanges<T>& changes = changeSet->template get<T>();
+			for( const InstrumentHandle<T> handle : touched )
+			{
+				const auto before = currentSnapshot->template get<T>( handle );
+				const auto after  = newSnapshot->template get<T>( handle );
+				if( before && after )
+					changes.updated.push_back( after->header.id );
+				else if( after )
+					changes.inserted.push_back( after->header.id );
+				else if( before )
+					changes.erased.push_back( before->header.id );
 			}
 		} );
-		newSnapshot->m_asofTs = latestTs;
+		newSnapshot->m_asofTs  = latestTs;
+		newSnapshot->m_version = currentSnapshot->m_version + 1;
+		newSnapshot->m_changes = std::move( changeSet );
+
+		// Overwrite mkt state with updated snapshot
+		m_current.store( newSnapshot.get(), std::memory_order_seq_cst );
+		retire( std::exchange( m_currentOwner, newSnapshot ) );
 
-		// Overwrite mkt state wiht updated snapshot
-		m_currentSnapshot.store( newSnapshot, std::memory_order_release );
+		if( m_history )
+			m_history->record( newSnapshot );
+
+		if( m_dispatcher )
+			m_dispatcher->notify( std::move( newSnapshot ) );
+	}
+
+private:
+	// Readers may still be guarding the unpublished snapshot, so our reference is only dropped once they've all moved on.
+	// Stamps only ever increase so the oldest retired snapshots are always at the front
+	void retire( std::shared_ptr<const Snapshot> unpublished )
+	{
+		m_retired.emplace_back( Epoch::advance(), std::move( unpublished ) );
+		while( m_retired.size() && Epoch::isSafeToReclaim( m_retired.front().first ) )
+			m_retired.pop_front();
 	}
 
 private:
-	std::atomic<std::shared_ptr<const Snapshot>> m_currentSnapshot;
-	std::mutex m_writerMutex;
+	using RetiredSnapshots = std::deque<std::pair<uint64_t, std::shared_ptr<const Snapshot>>>;
+
+	std::shared_ptr<typename Snapshot::SymbolTables> m_symbols;
+	std::shared_ptr<const Snapshot>                  m_currentOwner; // Only touched by the writer
+	// On its own cache line so readers aren't invalidated by the writer's bookkeeping, only by a new snapshot being published
+	alignas( 64 ) std::atomic<const Snapshot*>       m_current;
+	alignas( 64 ) RetiredSnapshots                   m_retired;
+	std::mutex                                       m_writerMutex;
+	std::unique_ptr<Dispatcher>                      m_dispatcher;
+	std::unique_ptr<History>                         m_history;
 };
 
 using Market = MarketImpl<AllEntityRecords>;
@@ -4,8 +4,11 @@
 #include <ARQMarket/market.h>
 #include <ARQMarket/market_live.h>
 
+#include <chrono>
+#include <filesystem>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace ARQ::MD
 {
@@ -28,17 +31,53 @@ protected:
 	TIDSet      m_mktSrcTIDSet;
 };
 
+struct LiveMarketHandle
+{
+	MarketName                         mktName;
+	std::shared_ptr<Market>            mkt;
+	std::shared_ptr<LiveMarketUpdater> updater;
+};
+
 class LiveMarketBuilder : public BaseMarketBuilder<LiveMarketBuilder>
 {
 public:
 	ARQMarket_API LiveMarketBuilder& withMessagingFeed( const std::string_view msgSvcDSH, const TIDSet& tidSet = TIDSet(), const MarketName& mktName = MarketName() );
 
+	/**
+	 * @brief Adds more markets for buildAndStartAll() - e.g. dated EOD markets alongside LIVE. They share the source, feed and filters of this builder.
+	 */
+	ARQMarket_API LiveMarketBuilder& withMarkets( const std::vector<MarketName>& mktNames );
+
+	/**
+	 * @brief Load each market's baseline with one source load per entity type, run concurrently.
+	 */
+	ARQMarket_API LiveMarketBuilder& withParallelTypeLoads( const bool parallelTypeLoads = true );
+
+	/**
+	 * @brief Warm start each market from, and save it to, a snapshot cache file named after the market in the given directory.
+	 * @param saveInterval How often to also save while LIVE - zero to only save when the updater is stopped.
+	 */
+	ARQMarket_API LiveMarketBuilder& withSnapshotCache( const std::filesystem::path& dir, const std::chrono::seconds saveInterval = std::chrono::seconds( 0 ) );
+
 	ARQMarket_API std::pair<std::shared_ptr<Market>, std::shared_ptr<LiveMarketUpdater>> build();
 
+	/**
+	 * @brief Builds every market and starts their updaters concurrently, so startup takes as long as the slowest baseline load rather than the sum of them.
+	 * If any fail to start then all are stopped and an ARQException naming the failed markets is thrown.
+	 */
+	ARQMarket_API std::vector<LiveMarketHandle> buildAndStartAll();
+
+private:
+	LiveMarketHandle buildOne( const MarketName& mktName ) const;
+
 private:
-	std::string m_msgSvcDSH;
-	TIDSet      m_msgTIDSet;
-	MarketName  m_msgMktName;
+	std::string             m_msgSvcDSH;
+	TIDSet                  m_msgTIDSet;
+	MarketName              m_msgMktName;
+	std::vector<MarketName> m_extraMktNames;
+	bool                    m_parallelTypeLoads = false;
+	std::filesystem::path   m_snapshotCacheDir;
+	std::chrono::seconds    m_snapshotCacheInterval { 0 };
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <ARQMarket/mktdata_entities.h>
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief The ids of a single entity type that differ between two market snapshots.
+ */
+template<c_MktData T>
+struct EntityChanges
+{
+	/// Ids present in the newer snapshot but not the older one
+	std::vector<std::string> inserted;
+	/// Ids present in both snapshots whose record differs
+	std::vector<std::string> updated;
+	/// Ids present in the older snapshot but not the newer one
+	std::vector<std::string> erased;
+
+	[[nodiscard]] bool   empty() const noexcept { return inserted.empty() && updated.empty() && erased.empty(); }
+	[[nodiscard]] size_t size()  const noexcept { return inserted.size() + updated.size() + erased.size(); }
+};
+
+template<typename T>
+class MarketChangeSetImpl;
+
+/**
+ * @brief Every id, per entity type, that differs between the snapshot at fromVersion and the snapshot at toVersion.
+ */
+template<c_MktData... Entities>
+class MarketChangeSetImpl<EntityRecordList<Record<Entities>...>>
+{
+public:
+	MarketChangeSetImpl() = default;
+	MarketChangeSetImpl( const uint64_t fromVersion, const uint64_t toVersion )
+		: m_fromVersion( fromVersion )
+		, m_toVersion( toVersion )
+	{}
+
+	template<c_MktData Entity>
+	[[nodiscard]] const EntityChanges<Entity>& get() const { return std::get<EntityChanges<Entity>>( m_changes ); }
+
+	template<c_MktData Entity>
+	[[nodiscard]] EntityChanges<Entity>& get() { return std::get<EntityChanges<Entity>>( m_changes ); }
+
+	/**
+	 * @brief Calls func.template operator()<T>( const EntityChanges<T>& ) for each entity type.
+	 */
+	template<typename F>
+	void visit( F&& func ) const
+	{
+		( func.template operator()<Entities>( std::get<EntityChanges<Entities>>( m_changes ) ), ... );
+	}
+
+	[[nodiscard]] bool   empty() const noexcept { return ( std::get<EntityChanges<Entities>>( m_changes ).empty() && ... ); }
+	[[nodiscard]] size_t size()  const noexcept { return ( std::get<EntityChanges<Entities>>( m_changes ).size() + ... ); }
+
+	[[nodiscard]] uint64_t fromVersion() const noexcept { return m_fromVersion; }
+	[[nodiscard]] uint64_t toVersion()   const noexcept { return m_toVersion; }
+
+private:
+	std::tuple<EntityChanges<Entities>...> m_changes;
+	uint64_t                               m_fromVersion = 0;
+	uint64_t                               m_toVersion   = 0;
+};
+
+using MarketChangeSet = MarketChangeSetImpl<AllEntityRecords>;
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <ARQMarket/market_change_set.h>
+#include <ARQMarket/mktdata_entities.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+namespace ARQ::MD
+{
+
+template<typename T>
+class MarketSnapshotImpl;
+
+struct MarketHistoryParams
+{
+	/// Most snapshots retained, including the latest
+	size_t maxSnapshots     = DEFAULT_MAX_SNAPSHOTS;
+	/// Approximate budget in bytes for the records retained snapshots hold on to - 0 for no limit
+	size_t maxRetainedBytes = 0;
+
+	static constexpr size_t DEFAULT_MAX_SNAPSHOTS = 4096;
+};
+
+template<typename T>
+class MarketHistoryImpl;
+
+/**
+ * @brief A bounded ring of a market's most recent snapshots, for as-of queries by time or version.
+ *
+ * Consecutive snapshots structurally share everything they have in common, so each retained snapshot only costs the records
+ * its update replaced. Once either limit is exceeded the oldest snapshots are evicted and handed to the eviction callback, if any
+ * (e.g. to spill them to disk).
+ */
+template<c_MktData... Entities>
+class MarketHistoryImpl<EntityRecordList<Record<Entities>...>>
+{
+public:
+	using Snapshot      = MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>;
+	using EvictCallback = std::function<void( std::shared_ptr<const Snapshot> )>;
+
+public:
+	explicit MarketHistoryImpl( const MarketHistoryParams& params, EvictCallback onEvict = {} )
+		: m_params( params )
+		, m_onEvict( std::move( onEvict ) )
+	{}
+
+	/**
+	 * @brief Appends the newest snapshot, evicting the oldest as needed. Only ever called by the owning market's writer.
+	 */
+	void record( std::shared_ptr<const Snapshot> snapshot )
+	{
+		const size_t bytes = approxBytes( *snapshot );
+
+		std::vector<std::shared_ptr<const Snapshot>> evicted;
+		{
+			std::unique_lock<std::shared_mutex> lock( m_mutex );
+
+			m_entries.push_back( Entry{ std::move( snapshot ), bytes } );
+			m_retainedBytes += bytes;
+
+			// The latest snapshot is always kept, however large
+			while( m_entries.size() > 1 && ( m_entries.size() > m_params.maxSnapshots || ( m_params.maxRetainedBytes && m_retainedBytes > m_params.maxRetainedBytes ) ) )
+			{
+				m_retainedBytes -= m_entries.front().bytes;
+				evicted.push_back( std::move( m_entries.front().snapshot ) );
+				m_entries.pop_front();
+			}
+		}
+
+		// Outside the lock so readers aren't held up by the callback or by freeing the evicted records
+		if( m_onEvict )
+		{
+			for( auto& snapshot : evicted )
+				m_onEvict( std::move( snapshot ) );
+		}
+	}
+
+	/**
+	 * @brief The latest retained snapshot whose asofTs is at or before the given time - O(log n).
+	 * @return The snapshot, or nullptr if the time is before the oldest retained snapshot.
+	 */
+	[[nodiscard]] std::shared_ptr<const Snapshot> snapshotAt( const Time::DateTime asofTs ) const
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+
+		// A snapshot's asofTs never goes backwards so the ring is sorted by it
+		const auto it = std::ranges::upper_bound( m_entries, asofTs, std::less<>(), [] ( const Entry& entry ) { return entry.snapshot->asofTs(); } );
+		if( it == m_entries.begin() )
+			return nullptr;
+
+		return std::prev( it )->snapshot;
+	}
+
+	/**
+	 * @brief The retained snapshot with exactly the given version - O(1).
+	 * @return The snapshot, or nullptr if the version has been evicted or doesn't exist yet.
+	 */
+	[[nodiscard]] std::shared_ptr<const Snapshot> snapshotAtVersion( const uint64_t version ) const
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+
+		// Versions are consecutive so the ring can be indexed directly
+		if( m_entries.empty() || version < m_entries.front().snapshot->version() )
+			return nullptr;
+
+		const uint64_t idx = version - m_entries.front().snapshot->version();
+		return idx < m_entries.size() ? m_entries[idx].snapshot : nullptr;
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+		return m_entries.size();
+	}
+
+	[[nodiscard]] size_t retainedBytes() const
+	{
+		std::shared_lock<std::shared_mutex> lock( m_mutex );
+		return m_retainedBytes;
+	}
+
+	[[nodiscard]] const MarketHistoryParams& params() const noexcept { return m_params; }
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<const Snapshot> snapshot;
+		size_t                          bytes;
+	};
+
+	// Roughly what keeping the snapshot costs over its successor - the records its update wrote plus the persistent map nodes on their paths
+	static size_t approxBytes( const Snapshot& snapshot )
+	{
+		static constexpr size_t NODE_PATH_BYTES = 256;
+
+		size_t bytes = 0;
+		snapshot.changes().visit( [&bytes] <c_MktData T> ( const EntityChanges<T>& changes )
+		{
+			bytes += ( changes.inserted.size() + changes.updated.size() ) * ( sizeof( Record<T> ) + NODE_PATH_BYTES );
+			bytes += changes.erased.size() * NODE_PATH_BYTES;
+		} );
+
+		return bytes;
+	}
+
+private:
+	const MarketHistoryParams m_params;
+	const EvictCallback       m_onEvict;
+
+	std::deque<Entry>         m_entries;
+	size_t                    m_retainedBytes = 0;
+	mutable std::shared_mutex m_mutex;
+};
+
+}
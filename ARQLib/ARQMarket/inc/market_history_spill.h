@@ -0,0 +1,100 @@
+#pragma once
+#include <ARQMarket/dll.h>
+
+#include <ARQUtils/bounded_queue.h>
+#include <ARQCore/serialiser.h>
+#include <ARQMarket/market.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief Append-only on-disk log of snapshots evicted from a market's history, so as-of queries can reach back past the in-memory ring.
+ *
+ * Each snapshot is written as a compact frame holding just the records its update changed. The first snapshot written, and any
+ * written after a gap in versions, is instead written in full so the log can always be replayed from its start.
+ * Writes happen on a dedicated thread so that eviction never holds up Market::update on disk IO. If the writer falls that far behind
+ * the queue fills, and snapshots evicted meanwhile are dropped rather than waited on - the next one written goes out in full, so the
+ * log only loses the as-of points that were dropped.
+ */
+class MarketSnapshotSpillLog
+{
+public:
+	/**
+	 * @param path The log file - appended to if it already exists.
+	 * @param serialiser Used to encode records - defaults to the Protobuf serialiser.
+	 */
+	ARQMarket_API explicit MarketSnapshotSpillLog( const std::filesystem::path& path, std::shared_ptr<Serialiser> serialiser = nullptr, const size_t queueCapacity = DEFAULT_QUEUE_CAPACITY );
+	ARQMarket_API ~MarketSnapshotSpillLog();
+
+	MarketSnapshotSpillLog( const MarketSnapshotSpillLog& )            = delete;
+	MarketSnapshotSpillLog& operator=( const MarketSnapshotSpillLog& ) = delete;
+
+	struct Stats
+	{
+		uint64_t written; /// Snapshots written to the file
+		uint64_t dropped; /// Snapshots dropped for arriving with the queue full
+	};
+
+	/**
+	 * @brief Queues a snapshot to be written, or drops it if the queue is full. Never blocks. Snapshots must be appended in version order.
+	 */
+	ARQMarket_API void append( std::shared_ptr<const MarketSnapshot> snapshot );
+
+	/**
+	 * @brief Blocks until everything appended so far has been written and flushed to the file.
+	 */
+	ARQMarket_API void flush();
+
+	[[nodiscard]] ARQMarket_API Stats getStats() const;
+
+	/**
+	 * @brief A callback to pass to the Market history constructor, appending every evicted snapshot to this log.
+	 *        The callback refers to this log, so the log must outlive the market it's given to.
+	 */
+	[[nodiscard]] Market::History::EvictCallback evictCallback()
+	{
+		return [this] ( std::shared_ptr<const MarketSnapshot> snapshot ) { append( std::move( snapshot ) ); };
+	}
+
+	/**
+	 * @brief Rebuilds the market as it was at the given time by replaying a log from its start.
+	 *        The rebuilt snapshot has the same records but its own version numbering.
+	 * @return The snapshot, or nullptr if the log holds nothing at or before asofTs.
+	 */
+	[[nodiscard]] ARQMarket_API static std::shared_ptr<const MarketSnapshot> load( const std::filesystem::path& path, const Time::DateTime asofTs, std::shared_ptr<Serialiser> serialiser = nullptr );
+
+	static constexpr size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+private:
+	void runWriteLoop();
+	void write( const MarketSnapshot& snapshot );
+
+private:
+	std::filesystem::path                               m_path;
+	std::ofstream                                       m_ofs;
+	std::shared_ptr<Serialiser>                         m_serialiser;
+
+	BoundedQueue<std::shared_ptr<const MarketSnapshot>> m_queue;
+	std::thread                                         m_writeThread;
+	uint64_t                                            m_lastWrittenVersion = 0;
+	bool                                                m_hasWritten         = false;
+
+	uint64_t                                            m_appended = 0;
+	uint64_t                                            m_written  = 0;
+	mutable std::mutex                                  m_writtenMutex;
+	std::condition_variable                             m_writtenCV;
+
+	std::atomic<uint64_t>                               m_dropped = 0;
+};
+
+}
@@ -1,12 +1,24 @@
 #pragma once
 #include <ARQMarket/dll.h>
 
+#include <ARQUtils/backoff_policy.h>
+#include <ARQUtils/bounded_queue.h>
 #include <ARQCore/messaging_service.h>
 #include <ARQCore/stream_offset_source.h>
 #include <ARQCore/serialiser.h>
 #include <ARQMarket/mktdata_source.h>
 #include <ARQMarket/mktdata_live_store.h>
+#include <ARQMarket/mktdata_update_codec.h>
 #include <ARQMarket/market.h>
+#include <ARQMarket/market_snapshot_cache.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <thread>
+#include <unordered_set>
 
 namespace ARQ::MD
 {
@@ -23,6 +35,51 @@ public:
 		const MarketName&              mktName;
 		const TIDSet&                  mktSrcTIDSet;
 		const TIDSet&                  msgTIDSet;
+		const size_t                   applyQueueCapacity    = DEFAULT_APPLY_QUEUE_CAPACITY; /// Past this, batches are dropped and their types resynced - or with no market source, the messaging thread waits
+		const bool                     parallelTypeLoads     = false; /// Load the baseline with one IMarketSource::load per entity type, run concurrently
+		const std::filesystem::path    snapshotCachePath     = {};    /// Warm start from, and save the market to, this file - empty to disable
+		const std::chrono::seconds     snapshotCacheInterval = std::chrono::seconds( 0 ); /// Also save this often while LIVE - zero to only save on stop()
+		const BackoffPolicy::Spec      resyncBackoff         = {};    /// Retries of a failed resync from the market source
+	};
+
+	struct Stats
+	{
+		size_t   queueDepth;      /// Batches received but not yet applied
+		size_t   maxQueueDepth;   /// High watermark of queueDepth
+		uint64_t batchesReceived;
+		uint64_t batchesDropped;  /// Batches dropped for arriving with the apply queue full, each resyncing the types it covered
+		uint64_t batchesApplied;  /// Batches that went through the apply path (including any dropped for stale offsets)
+		uint64_t marketUpdates;   /// Market::update calls made - fewer than batchesApplied when batches are coalesced
+		uint64_t recordsReceived;
+		uint64_t recordsApplied;  /// Records passed to Market::update after filtering and per-id conflation
+		uint64_t gapsDetected;    /// Entity types found to have missed a batch, each triggering a resync of that type
+		uint64_t resyncs;         /// Entity types reloaded from the market source after a gap
+		uint64_t resyncFailures;  /// Resyncs given up on - the type carries on from the live stream with the gap
+		size_t   resyncsActive;   /// Entity types currently resyncing, with their live updates held back
+		uint64_t seqGaps;         /// Messages found missing from a publisher's chunked or delta encoded stream
+		uint64_t deltaMisses;     /// Delta encoded records dropped for having no base to fill them in from - their types are resynced
+
+		[[nodiscard]] double batchCoalescingRatio()  const { return marketUpdates   ? static_cast<double>( batchesApplied ) / marketUpdates   : 0.0; }
+		[[nodiscard]] double recordCoalescingRatio() const { return recordsApplied  ? static_cast<double>( recordsReceived ) / recordsApplied : 0.0; }
+	};
+
+	struct BaselineLoadStats
+	{
+		struct TypeLoad
+		{
+			Type                     type;
+			std::chrono::nanoseconds duration;
+			size_t                   numRecords;
+		};
+
+		std::chrono::nanoseconds total   {}; /// start() up to going LIVE
+		std::chrono::nanoseconds offsets {}; /// Loaded before the records, so the records are at least as new as them
+		std::chrono::nanoseconds cache   {}; /// Reading the snapshot cache, overlapping the offsets
+		std::chrono::nanoseconds records {};
+		std::chrono::nanoseconds apply   {}; /// Baseline update plus reconciling anything buffered while loading
+		size_t                   numRecords       = 0;
+		size_t                   numCachedRecords = 0; /// Of numRecords, those taken from the snapshot cache rather than the source
+		std::vector<TypeLoad>    types;      /// Filled in for parallelTypeLoads, and for the types reloaded on a warm start
 	};
 
 	enum class State
@@ -42,13 +99,22 @@ public:
 		, m_msgSvc( MessagingServiceFactory::inst().create( params.msgSvcDSH ) )
 		, m_mktName( params.mktName )
 		, m_mktSrcTIDSet( params.mktSrcTIDSet )
-		, m_msgTIDSet( params.msgTIDSet )
+		, m_mktSrcFilter( params.mktSrcTIDSet )
+		, m_msgFilter( params.msgTIDSet )
 		, m_desc( "LiveMarketUpdater for Mkt: " + m_mktName.str() )
 		, m_state( State::INIT )
 		, m_serialiser( SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf ) )
+		, m_updateDecoder( m_serialiser )
+		, m_applyQueue( params.applyQueueCapacity )
+		, m_parallelTypeLoads( params.parallelTypeLoads )
+		, m_snapshotCache( makeSnapshotCache( params, m_serialiser ) )
+		, m_snapshotCacheInterval( params.snapshotCacheInterval )
+		, m_resyncBackoff( params.resyncBackoff )
 	{
 	}
 
+	ARQMarket_API ~LiveMarketUpdater();
+
 	static std::shared_ptr<LiveMarketUpdater> create( Params&& params )
 	{
 		return std::make_shared<LiveMarketUpdater>( Passkey(), std::move( params ) );
@@ -57,21 +123,76 @@ public:
 	ARQMarket_API void start();
 	ARQMarket_API void stop();
 
+	/**
+	 * @brief Blocks until every batch received so far has been applied to the market.
+	 */
+	ARQMarket_API void flush();
+
+	[[nodiscard]] ARQMarket_API Stats getStats() const;
+
+	/**
+	 * @brief Timings of the baseline load done by start() - only meaningful once start() has returned.
+	 */
+	[[nodiscard]] const BaselineLoadStats& getBaselineLoadStats() const { return m_baselineLoadStats; }
+
+	[[nodiscard]] const MarketName& mktName() const { return m_mktName; }
+
 	[[nodiscard]] ARQMarket_API const std::shared_ptr<Market>& market() { return m_mkt; }
 
-	static constexpr std::string_view SUB_TOPIC_PFX = "ARQ.MktData.Updates.";
+	static constexpr std::string_view SUB_TOPIC_PFX                = "ARQ.MktData.Updates.";
+	static constexpr size_t           DEFAULT_APPLY_QUEUE_CAPACITY = 1024;
 
 private: // ISubscriptionHandler implementation
-	ARQMarket_API void             onMsg( Message&& msg )       override;
-	              std::string_view getDesc()              const override { return m_desc; };
+	ARQMarket_API void                onMsg( Message&& msg )       override;
+	              std::string_view    getDesc()              const override { return m_desc; };
+	              SubscriptionOptions getSubOptions()              override { return SubscriptionOptions::NONE; } // The ARQ_Type header says how each message is encoded
 
 private:
-	void applyUpdate( MarketUpdateBatch&& updateBatch );
+	RecordCollection loadBaseline( const std::string& mktNameStr );
+	RecordCollection loadBaselineByType( IMarketSource& mktSrc, const std::string& mktNameStr, const std::unordered_set<Type>* onlyTypes = nullptr );
+	RecordCollection loadBaselineFromCache( IMarketSource& mktSrc, const std::string& mktNameStr, MarketSnapshotCache::Contents&& cached, std::optional<StreamTopicPartitionOffsets>& offsets );
 
-	using MktEntity2OffsetsMap = std::unordered_map<Type, StreamTopicPartitionOffsets>;
+	ARQMarket_API static std::unique_ptr<MarketSnapshotCache> makeSnapshotCache( const Params& params, const std::shared_ptr<Serialiser>& serialiser );
 
-	MktEntity2OffsetsMap convertOffsets( StreamTopicPartitionOffsets&& tpOffsets ) const;
-	bool                 isOffsetsNewer( const StreamTopicPartitionOffsets& lhs, const StreamTopicPartitionOffsets& rhs ) const;
+	void maybeQueueCacheSave();
+	void runCacheSaveLoop();
+	void saveSnapshotCache( const MarketSnapshot& snapshot, const StreamTopicPartitionOffsets& offsets ) const;
+
+	void runApplyLoop();
+	void dropBatch( const MarketUpdateBatch& batch );
+	void applyUpdates( std::vector<MarketUpdateBatch>&& updateBatches );
+	void markApplied( const size_t numBatches );
+
+	// Gap recovery - a batch whose prevOffsets are past what's been applied means one was missed. Only the entity types affected are reloaded
+	// from the market source, with their live updates held back meanwhile and replayed on top, much as start() does for the whole market
+	struct ResyncResult
+	{
+		std::vector<Type>                          types;
+		RecordCollection                           records;
+		std::optional<StreamTopicPartitionOffsets> offsets;
+		std::string                                error;
+	};
+
+	[[nodiscard]] bool narrowFilter( const Type type, TIDSet& filter ) const;
+	void               startResync( std::vector<Type>&& types );
+	void               resyncDroppedTypes();
+	ResyncResult       loadResync( std::vector<Type>&& types, const TIDSet& filter );
+	void               applyCompletedResyncs( std::vector<MarketUpdateBatch>& pending );
+	void               wakeApplyThread();
+
+	// Stream offsets are held per entity type as a flat array indexed by partition. Update topics are resolved to their type
+	// through a table built once, so reconciling a batch's offsets is a few array compares with no allocation once warmed up
+	static constexpr size_t  NUM_TYPES = RecordCollection().typeCount();
+	static constexpr int64_t NO_OFFSET = -1;
+
+	using PartitionOffsets = std::vector<int64_t>;                    /// Indexed by partition - NO_OFFSET for any not seen
+	using TypeOffsets      = std::array<PartitionOffsets, NUM_TYPES>; /// Indexed by Type
+
+	static void                        resolveOffsets( const StreamTopicPartitionOffsets& tpOffsets, TypeOffsets& out );
+	static StreamTopicPartitionOffsets toStreamOffsets( const TypeOffsets& offsets );
+	static bool                        isAnyNewer( const PartitionOffsets& current, const PartitionOffsets& incoming );
+	static void                        advance( PartitionOffsets& current, const PartitionOffsets& incoming );
+	static bool                        hasGap( const PartitionOffsets& current, const PartitionOffsets& prev );
 
 private:
 	std::shared_ptr<Market>            m_mkt;
@@ -79,16 +200,76 @@ private:
 	std::shared_ptr<IMessagingService> m_msgSvc;
 	MarketName                         m_mktName;
 	TIDSet                             m_mktSrcTIDSet;
-	TIDSet                             m_msgTIDSet;
+	CompiledTIDSet                     m_mktSrcFilter; // What a resync reloads, for erasing whatever the reload no longer has
+	CompiledTIDSet                     m_msgFilter;
 	std::string                        m_desc;
 
 	std::atomic<State>                 m_state;
-	MktEntity2OffsetsMap               m_offsets;
+	TypeOffsets                        m_offsets;
+	TypeOffsets                        m_batchOffsets;     // Scratch for the batch being applied, only touched on the apply thread
+	TypeOffsets                        m_batchPrevOffsets; // Likewise for the batch's prevOffsets
 
 	std::shared_ptr<Serialiser>        m_serialiser;
+	MarketUpdateDecoder                m_updateDecoder; // Only touched on the messaging thread
 	std::unique_ptr<ISubscription>     m_msgSub;
 	std::vector<MarketUpdateBatch>     m_bufferedUpdates;
 	std::mutex                         m_bufferedUpdatesMutex;
+
+	// Decouples the messaging thread from Market::update - a single apply thread drains and group commits everything pending
+	BoundedQueue<MarketUpdateBatch>    m_applyQueue;
+	std::thread                        m_applyThread;
+
+	std::atomic<uint64_t>              m_batchesReceived = 0;
+	uint64_t                           m_batchesApplied  = 0;
+	bool                               m_applyLoopExited = false;
+	mutable std::mutex                 m_appliedMutex;
+	std::condition_variable            m_appliedCV;
+
+	std::atomic<size_t>                m_maxQueueDepth   = 0;
+	std::atomic<uint64_t>              m_marketUpdates   = 0;
+	std::atomic<uint64_t>              m_recordsReceived = 0;
+	std::atomic<uint64_t>              m_recordsApplied  = 0;
+
+	bool                               m_parallelTypeLoads;
+	BaselineLoadStats                  m_baselineLoadStats;
+
+	// Periodic saves are taken on the apply thread, where the market and m_offsets are consistent, and written out on their own thread
+	struct CacheSave
+	{
+		std::shared_ptr<const MarketSnapshot> snapshot;
+		StreamTopicPartitionOffsets           offsets;
+	};
+
+	std::unique_ptr<MarketSnapshotCache>   m_snapshotCache;
+	std::chrono::seconds                   m_snapshotCacheInterval;
+	std::chrono::steady_clock::time_point  m_lastCacheSave;
+	BoundedQueue<CacheSave>                m_cacheSaveQueue { 1 };
+	std::thread                            m_cacheSaveThread;
+
+	// Resync state per type is only touched on the apply thread (or by start() before going LIVE). The loads run on their own tasks and hand back results under m_resyncMutex
+	struct TypeResync
+	{
+		bool                           active = false;
+		std::vector<MarketUpdateBatch> heldBack;
+	};
+
+	std::array<TypeResync, NUM_TYPES>      m_resyncs;
+	std::vector<std::future<void>>         m_resyncTasks;
+	std::vector<ResyncResult>              m_resyncResults;
+	std::mutex                             m_resyncMutex;
+	std::condition_variable                m_resyncCV;             // Cuts short a resync's backoff when stopping
+	bool                                   m_stopping     = false;
+	bool                                   m_wakeOnResync = false; // Set once LIVE, when the apply thread takes over from start()
+	BackoffPolicy::Spec                    m_resyncBackoff;
+	std::atomic<uint64_t>                  m_gapsDetected   = 0;
+	std::atomic<uint64_t>                  m_resyncsDone    = 0;
+	std::atomic<uint64_t>                  m_resyncFailures = 0;
+	std::atomic<size_t>                    m_resyncsActive  = 0;
+
+	// Types a batch was dropped for while the apply queue was full, or a delta encoded record was dropped for having no base - set on the
+	// messaging thread, resynced by the apply thread
+	std::array<std::atomic<bool>, NUM_TYPES> m_droppedTypes {};
+	std::atomic<uint64_t>                    m_batchesDropped = 0;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <ARQUtils/hashers.h>
+#include <ARQUtils/logger.h>
+#include <ARQMarket/market.h>
+#include <ARQMarket/tid.h>
+
+#include <ankerl/unordered_dense.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief A bump applied to every decimal member of a record, e.g. each of an FX rate's mid, bid and ask.
+ */
+struct MarketShift
+{
+	enum class Kind : uint8_t
+	{
+		ABSOLUTE, // Adds amount to each member
+		RELATIVE  // Scales each member by ( 1 + amount )
+	};
+
+	Kind   kind   = Kind::ABSOLUTE;
+	double amount = 0.0;
+
+	template<c_MktData T>
+	void apply( T& data ) const
+	{
+		Traits<T>::visitDecimals( data, [this] ( double& value ) { value = kind == Kind::ABSOLUTE ? value + amount : value * ( 1.0 + amount ); } );
+	}
+};
+
+/**
+ * @brief The definition of a what-if market - records to replace and shifts to apply on top of some base snapshot.
+ */
+struct MarketScenario
+{
+	struct Bump
+	{
+		TID         tid;   // A TID without an id shifts every instrument of its type in parallel
+		MarketShift shift;
+	};
+
+	std::string       name;
+	RecordCollection  overrides; // Replace the base's records - inactive records erase them
+	std::vector<Bump> bumps;     // Applied in order, after the overrides
+};
+
+template<typename T>
+class MarketOverlayImpl;
+
+/**
+ * @brief A scenario market layered over an immutable base snapshot, with the same get interface as the snapshot.
+ *
+ * Only the records a scenario touches are stored - everything else is read straight from the base, so any number of overlays
+ * can share one base and each costs just its deltas. Parallel shifts are applied lazily, to each base record on its first lookup.
+ * Build an overlay up on one thread, after which it's safe to read from many.
+ */
+template<c_MktData... Entities>
+class MarketOverlayImpl<EntityRecordList<Record<Entities>...>>
+{
+public:
+	using Snapshot = MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>;
+
+public:
+	explicit MarketOverlayImpl( std::shared_ptr<const Snapshot> base )
+		: m_base( std::move( base ) )
+		, m_layers( std::make_unique<std::tuple<Layer<Entities>...>>() )
+	{}
+
+	MarketOverlayImpl( std::shared_ptr<const Snapshot> base, const MarketScenario& scenario )
+		: MarketOverlayImpl( std::move( base ) )
+	{
+		apply( scenario );
+	}
+
+	/**
+	 * @brief Builds one overlay per scenario, all sharing the same base.
+	 */
+	[[nodiscard]] static std::vector<MarketOverlayImpl> build( const std::shared_ptr<const Snapshot>& base, const std::span<const MarketScenario> scenarios )
+	{
+		std::vector<MarketOverlayImpl> overlays;
+		overlays.reserve( scenarios.size() );
+		for( const MarketScenario& scenario : scenarios )
+			overlays.emplace_back( base, scenario );
+
+		return overlays;
+	}
+
+	template<c_MktData Entity>
+	OptConstRef<Record<Entity>> const get( const std::string_view id ) const
+	{
+		return find<Entity>( id ).get();
+	}
+
+	/**
+	 * @brief As get, but shares ownership of the record so it can outlive this overlay.
+	 */
+	template<c_MktData Entity>
+	[[nodiscard]] std::shared_ptr<const Record<Entity>> getShared( const std::string_view id ) const
+	{
+		return find<Entity>( id );
+	}
+
+	template<c_MktData Entity>
+	[[nodiscard]] size_t size() const
+	{
+		size_t size = m_base->template size<Entity>();
+		for( const auto& [id, rcdPtr] : layer<Entity>().overrides )
+		{
+			const bool inBase = m_base->template get<Entity>( id );
+			if( rcdPtr && !inBase )
+				++size;
+			else if( !rcdPtr && inBase )
+				--size;
+		}
+
+		return size;
+	}
+
+	/**
+	 * @brief Calls func( const Record<Entity>& ) for every Entity record in this overlay, in no particular order.
+	 */
+	template<c_MktData Entity, typename F>
+	void forEach( F&& func ) const
+	{
+		const Layer<Entity>& lyr = layer<Entity>();
+
+		m_base->template forEach<Entity>( [&lyr, &func] ( const Record<Entity>& rcd )
+		{
+			if( lyr.overrides.contains( rcd.header.id ) )
+				return;
+
+			if( lyr.parallelShifts.empty() )
+				func( rcd );
+			else
+				func( shifted( lyr, rcd ) );
+		} );
+
+		for( const auto& [id, rcdPtr] : lyr.overrides )
+		{
+			if( rcdPtr )
+				func( *rcdPtr );
+		}
+	}
+
+	/**
+	 * @brief Replaces the base's record with the same id, or erases it if the record is inactive.
+	 */
+	template<c_MktData Entity>
+	void set( Record<Entity> rcd )
+	{
+		std::string id = rcd.header.id;
+		layer<Entity>().overrides.insert_or_assign( std::move( id ), rcd.header.isActive ? std::make_shared<const Record<Entity>>( std::move( rcd ) ) : nullptr );
+	}
+
+	template<c_MktData Entity>
+	void erase( const std::string_view id )
+	{
+		layer<Entity>().overrides.insert_or_assign( std::string( id ), nullptr );
+	}
+
+	/**
+	 * @brief Shifts a single instrument's record, including any shifts already applied to it.
+	 * @return false if there is no such record to shift.
+	 */
+	template<c_MktData Entity>
+	bool shift( const std::string_view id, const MarketShift& mktShift )
+	{
+		const auto rcdPtr = find<Entity>( id );
+		if( !rcdPtr )
+			return false;
+
+		auto shiftedPtr = std::make_shared<Record<Entity>>( *rcdPtr );
+		mktShift.apply( shiftedPtr->data );
+		layer<Entity>().overrides.insert_or_assign( std::string( id ), std::move( shiftedPtr ) );
+		return true;
+	}
+
+	/**
+	 * @brief Shifts every Entity record in parallel. Overridden records are shifted now, all others on lookup.
+	 */
+	template<c_MktData Entity>
+	void shiftAll( const MarketShift& mktShift )
+	{
+		Layer<Entity>& lyr = layer<Entity>();
+		for( auto& [id, rcdPtr] : lyr.overrides )
+		{
+			if( !rcdPtr )
+				continue;
+
+			auto shiftedPtr = std::make_shared<Record<Entity>>( *rcdPtr );
+			mktShift.apply( shiftedPtr->data );
+			rcdPtr = std::move( shiftedPtr );
+		}
+
+		lyr.parallelShifts.push_back( mktShift );
+		lyr.shifted.clear(); // Built under the previous shifts
+	}
+
+	/**
+	 * @brief Shifts the instrument a TID names, or every instrument of its type if it has no id.
+	 * @return false if there is no such record to shift.
+	 */
+	bool shift( const TID& tid, const MarketShift& mktShift )
+	{
+		auto shiftType = [this, &tid, &mktShift] <c_MktData T> ()
+		{
+			if( tid.id )
+				return shift<T>( *tid.id, mktShift );
+
+			shiftAll<T>( mktShift );
+			return true;
+		};
+
+		bool found = false;
+		( ( Traits<Entities>::typeEnum() == tid.type && ( found = shiftType.template operator()<Entities>(), true ) ) || ... );
+		return found;
+	}
+
+	/**
+	 * @brief Applies a scenario's overrides and then its bumps on top of whatever this overlay already holds.
+	 */
+	void apply( const MarketScenario& scenario )
+	{
+		scenario.overrides.visitVectors( [this] <c_MktData T> ( const std::vector<Record<T>>& records )
+		{
+			for( const Record<T>& rcd : records )
+				set<T>( rcd );
+		} );
+
+		for( const MarketScenario::Bump& bump : scenario.bumps )
+		{
+			if( !shift( bump.tid, bump.shift ) )
+				Log( Module::MKT ).warn( "MarketOverlay: Scenario [{}] shifts id [{}] which is not in the base market - ignoring", scenario.name, bump.tid.id.value_or( "" ) );
+		}
+	}
+
+	[[nodiscard]] const std::shared_ptr<const Snapshot>& base() const noexcept { return m_base; }
+	[[nodiscard]] Time::DateTime                         asofTs() const { return m_base->asofTs(); }
+
+	/**
+	 * @brief The number of records this overlay replaces or erases - what it costs over its base.
+	 */
+	[[nodiscard]] size_t numOverrides() const
+	{
+		return ( layer<Entities>().overrides.size() + ... );
+	}
+
+private:
+	template<c_MktData Entity>
+	using RecordPtrMap = ankerl::unordered_dense::map<std::string, std::shared_ptr<const Record<Entity>>, AnkerlTransparentStringHash, std::equal_to<>>;
+
+	template<c_MktData Entity>
+	struct Layer
+	{
+		RecordPtrMap<Entity>         overrides;      // A nullptr marks an erased id
+		std::vector<MarketShift>     parallelShifts; // Applied to every base record without an override
+		mutable RecordPtrMap<Entity> shifted;        // Base records with parallelShifts applied, built on first lookup
+		mutable std::mutex           shiftedMutex;
+	};
+
+	template<c_MktData Entity>
+	[[nodiscard]] Layer<Entity>& layer() const { return std::get<Layer<Entity>>( *m_layers ); }
+
+	template<c_MktData Entity>
+	static Record<Entity> shifted( const Layer<Entity>& lyr, const Record<Entity>& rcd )
+	{
+		Record<Entity> shiftedRcd = rcd;
+		for( const MarketShift& mktShift : lyr.parallelShifts )
+			mktShift.apply( shiftedRcd.data );
+
+		return shiftedRcd;
+	}
+
+	template<c_MktData Entity>
+	std::shared_ptr<const Record<Entity>> find( const std::string_view id ) const
+	{
+		const Layer<Entity>& lyr = layer<Entity>();
+		if( const auto it = lyr.overrides.find( id ); it != lyr.overrides.end() )
+			return it->second;
+
+		auto baseRcdPtr = m_base->template getShared<Entity>( id );
+		if( !baseRcdPtr || lyr.parallelShifts.empty() )
+			return baseRcdPtr;
+
+		// Records in the cache are never replaced once the overlay is built, so references handed out by get stay valid
+		std::lock_guard<std::mutex> lock( lyr.shiftedMutex );
+		auto [it, inserted] = lyr.shifted.try_emplace( std::string( id ) );
+		if( inserted )
+			it->second = std::make_shared<const Record<Entity>>( shifted( lyr, *baseRcdPtr ) );
+
+		return it->second;
+	}
+
+private:
+	std::shared_ptr<const Snapshot>                 m_base;
+	std::unique_ptr<std::tuple<Layer<Entities>...>> m_layers; // Behind a pointer so overlays stay movable despite the mutexes
+};
+
+using MarketOverlay = MarketOverlayImpl<AllEntityRecords>;
+
+}
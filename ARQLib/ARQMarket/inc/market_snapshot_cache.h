@@ -0,0 +1,64 @@
+#pragma once
+#include <ARQMarket/dll.h>
+
+#include <ARQCore/serialiser.h>
+#include <ARQCore/streaming_service.h>
+#include <ARQMarket/market.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief A single file holding the latest snapshot of a market along with the stream offsets it reflects, so a restarting
+ *        process can warm start from local disk rather than reloading everything from the market source.
+ *
+ * Saves write the whole snapshot to a temporary file which is then renamed over the cache, so a reader never sees a partial write.
+ * Loads memory map the file and decode records straight out of the mapping. The file is ignored, rather than loaded, if its
+ * header doesn't match this build's format and entity schema, if it was saved under a different key, or if its checksum fails.
+ */
+class MarketSnapshotCache
+{
+public:
+	struct Contents
+	{
+		RecordCollection            records;
+		StreamTopicPartitionOffsets offsets;
+		Time::DateTime              savedTs;
+	};
+
+public:
+	/**
+	 * @param path The cache file.
+	 * @param key Identifies what the cached market holds (e.g. its name and filters) - a file saved under another key is ignored.
+	 * @param serialiser Used to encode records - defaults to the Protobuf serialiser.
+	 */
+	ARQMarket_API MarketSnapshotCache( const std::filesystem::path& path, const std::string_view key, std::shared_ptr<Serialiser> serialiser = nullptr );
+
+	/**
+	 * @brief Replaces the cache file with the given snapshot and offsets.
+	 */
+	ARQMarket_API void save( const MarketSnapshot& snapshot, const StreamTopicPartitionOffsets& offsets ) const;
+
+	/**
+	 * @return The cached records and offsets, or nullopt if there is no usable cache file - the reason is logged.
+	 */
+	[[nodiscard]] ARQMarket_API std::optional<Contents> load() const;
+
+	[[nodiscard]] const std::filesystem::path& path() const { return m_path; }
+
+	static constexpr uint32_t FORMAT_VERSION = 1;
+
+private:
+	std::filesystem::path       m_path;
+	std::string                 m_key;
+	uint64_t                    m_keyHash;
+	std::shared_ptr<Serialiser> m_serialiser;
+};
+
+}
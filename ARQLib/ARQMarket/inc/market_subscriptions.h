@@ -0,0 +1,393 @@
+#pragma once
+
+#include <ARQUtils/error.h>
+#include <ARQUtils/logger.h>
+#include <ARQMarket/market_change_set.h>
+#include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/tid.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace ARQ::MD
+{
+
+template<typename T>
+class MarketSnapshotImpl;
+
+template<typename T>
+struct MarketChangeEventImpl;
+
+/**
+ * @brief A change to a single subscribed id, delivered to MarketImpl::subscribe callbacks.
+ */
+template<c_MktData... Entities>
+struct MarketChangeEventImpl<EntityRecordList<Record<Entities>...>>
+{
+	using RecordPtr = std::variant<std::shared_ptr<const Record<Entities>>...>;
+
+	/// The entity type and id that changed
+	TID       tid;
+	/// The new record (shared with the snapshot it came from), or a null pointer of the matching record type if the id was erased
+	RecordPtr record;
+	/// The version of the snapshot the change was taken from
+	uint64_t  version;
+
+	template<c_MktData Entity>
+	[[nodiscard]] const std::shared_ptr<const Record<Entity>>& get() const { return std::get<std::shared_ptr<const Record<Entity>>>( record ); }
+};
+
+using MarketChangeEvent = MarketChangeEventImpl<AllEntityRecords>;
+
+struct MarketSubStats
+{
+	/// Events passed to the callback
+	uint64_t deliveredEvents;
+	/// Market versions that were never individually dispatched because the dispatcher was behind - their changes were conflated into later events
+	uint64_t conflatedVersions;
+	/// Callbacks that threw
+	uint64_t callbackErrors;
+};
+
+class MarketSubscription
+{
+public:
+	virtual ~MarketSubscription() = default;
+
+	/**
+	 * @brief Stops further callbacks. If a callback is currently running on the dispatcher this waits for it to finish,
+	 *        unless called from within the callback itself.
+	 */
+	virtual void                         unsubscribe()    = 0;
+	[[nodiscard]] virtual MarketSubStats getStats() const = 0;
+};
+
+template<typename T>
+class MarketChangeDispatcherImpl;
+
+/**
+ * @brief Fans changes out from a market to its subscribers on a small fixed pool of threads, so that subscriber callbacks never hold up
+ *        market updates.
+ *
+ * The market just hands each new snapshot over, which is parked in every subscriber's mailbox (latest snapshot wins) and queues the
+ * subscriber for the pool if it isn't already queued or being served. A pool thread then diffs the mailbox snapshot against the last
+ * one the subscriber was given - each pair of versions is diffed once and shared by every subscriber needing it - and delivers the
+ * matching changes. A slow subscriber therefore sees the latest value per id rather than every intermediate one, and only occupies
+ * one pool thread while its callback runs.
+ */
+template<c_MktData... Entities>
+class MarketChangeDispatcherImpl<EntityRecordList<Record<Entities>...>>
+{
+public:
+	using Snapshot = MarketSnapshotImpl<EntityRecordList<Record<Entities>...>>;
+	using Event    = MarketChangeEventImpl<EntityRecordList<Record<Entities>...>>;
+	using Callback = std::function<void( const Event& )>;
+
+	static constexpr size_t DEFAULT_NUM_THREADS = 2;
+
+public:
+	explicit MarketChangeDispatcherImpl( std::shared_ptr<const Snapshot> initial, const size_t numThreads = DEFAULT_NUM_THREADS )
+		: m_latest( std::move( initial ) )
+		, m_pool( std::make_shared<Pool>() )
+	{
+		for( size_t i = 0; i < std::max<size_t>( numThreads, 1 ); ++i )
+			m_threads.emplace_back( [pool = m_pool] () { pool->run(); } ); // Threads share ownership of the pool in case they are detached below
+	}
+
+	~MarketChangeDispatcherImpl()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_pool->mutex );
+			m_pool->running = false;
+		}
+		m_pool->readyCV.notify_all();
+
+		for( std::thread& thread : m_threads )
+		{
+			if( thread.get_id() == std::this_thread::get_id() )
+				thread.detach(); // Destroyed from within a callback - the thread exits once it returns
+			else
+				thread.join();
+		}
+	}
+
+	MarketChangeDispatcherImpl( const MarketChangeDispatcherImpl& )            = delete;
+	MarketChangeDispatcherImpl& operator=( const MarketChangeDispatcherImpl& ) = delete;
+
+	/**
+	 * @brief Subscribes to changes made after the last snapshot handed to notify (or the initial one).
+	 */
+	[[nodiscard]] std::unique_ptr<MarketSubscription> subscribe( const TIDSet& tids, Callback callback )
+	{
+		std::lock_guard<std::mutex> lock( m_entriesMutex );
+
+		auto entry = std::make_shared<Entry>( tids, std::move( callback ), m_latest );
+		m_entries.push_back( entry );
+
+		return std::make_unique<Subscription>( std::move( entry ) );
+	}
+
+	/**
+	 * @brief Hands over a newly published snapshot - O(subscribers) and never waits on them.
+	 */
+	void notify( std::shared_ptr<const Snapshot> snapshot )
+	{
+		std::lock_guard<std::mutex> lock( m_entriesMutex );
+
+		std::erase_if( m_entries, [] ( const std::shared_ptr<Entry>& entry ) { return !entry->active; } );
+		for( const auto& entry : m_entries )
+		{
+			if( entry->post( snapshot ) )
+				m_pool->schedule( entry );
+		}
+
+		m_latest = std::move( snapshot );
+	}
+
+private:
+	using ChangeSet = typename Snapshot::ChangeSet;
+
+	struct Pool;
+
+	struct Entry
+	{
+		Entry( const TIDSet& tids, Callback&& callback, std::shared_ptr<const Snapshot> initial )
+			: interest( tids )
+			, callback( std::move( callback ) )
+			, lastDispatched( std::move( initial ) )
+		{}
+
+		/**
+		 * @brief Replaces the mailbox snapshot.
+		 * @return True if the entry now needs queueing for the pool, false if it is already queued or being served.
+		 */
+		[[nodiscard]] bool post( std::shared_ptr<const Snapshot> snapshot )
+		{
+			std::lock_guard<std::mutex> lock( mailboxMutex );
+			pending = std::move( snapshot );
+			if( scheduled )
+				return false;
+
+			scheduled = true;
+			return true;
+		}
+
+		[[nodiscard]] std::shared_ptr<const Snapshot> takePending()
+		{
+			std::lock_guard<std::mutex> lock( mailboxMutex );
+			return std::move( pending );
+		}
+
+		/**
+		 * @brief Called by the pool once it is done serving the entry.
+		 * @return True if another snapshot arrived in the meantime and the entry should be queued again.
+		 */
+		[[nodiscard]] bool reschedule()
+		{
+			std::lock_guard<std::mutex> lock( mailboxMutex );
+			scheduled = pending && active;
+			return scheduled;
+		}
+
+		void dispatch( Pool& pool, const std::shared_ptr<const Snapshot>& latest )
+		{
+			const auto     changeSet = pool.diff( *lastDispatched, *latest );
+			const uint64_t conflated = latest->version() - lastDispatched->version() - 1;
+			lastDispatched = latest;
+
+			if( conflated )
+				conflatedVersions.fetch_add( conflated, std::memory_order_relaxed );
+
+			changeSet->visit( [&] <c_MktData T> ( const EntityChanges<T>& changes )
+			{
+				auto emit = [&] ( const std::string& id, std::shared_ptr<const Record<T>> rcdPtr )
+				{
+					if( interest.matches( Traits<T>::typeEnum(), id ) )
+						deliver( Event( TID( Traits<T>::typeEnum(), id ), std::move( rcdPtr ), latest->version() ) );
+				};
+
+				for( const std::string& id : changes.inserted )
+					emit( id, latest->template getShared<T>( id ) );
+				for( const std::string& id : changes.updated )
+					emit( id, latest->template getShared<T>( id ) );
+				for( const std::string& id : changes.erased )
+					emit( id, nullptr );
+			} );
+		}
+
+		void deliver( const Event& event )
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			if( !active )
+				return;
+
+			ARQ_DO_IN_TRY( arqExc, errMsg )
+				callback( event );
+				deliveredEvents.fetch_add( 1, std::memory_order_relaxed );
+				return;
+			ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+			callbackErrors.fetch_add( 1, std::memory_order_relaxed );
+			if( arqExc.what().size() )
+				Log( Module::MKT ).error( arqExc, "MarketChangeDispatcher: Subscriber callback threw an ARQException for TID [{}:{}]", Enum::enum_name( event.tid.type ), event.tid.id.value_or( "" ) );
+			else if( errMsg.size() )
+				Log( Module::MKT ).error( "MarketChangeDispatcher: Subscriber callback threw for TID [{}:{}]: {}", Enum::enum_name( event.tid.type ), event.tid.id.value_or( "" ), errMsg );
+		}
+
+		CompiledTIDSet                  interest;
+		Callback                        callback;
+
+		// Held while the callback runs so that unsubscribe can wait for an in-flight callback
+		std::mutex                      mutex;
+		std::atomic<bool>               active = true;
+		// The pool thread currently serving the entry, if any
+		std::atomic<std::thread::id>    servingThread;
+
+		// Only touched by the pool thread serving the entry - at most one at a time
+		std::shared_ptr<const Snapshot> lastDispatched;
+
+		// Mailbox - the latest snapshot not yet taken by the pool
+		std::mutex                      mailboxMutex;
+		std::shared_ptr<const Snapshot> pending;
+		bool                            scheduled = false;
+
+		std::atomic<uint64_t>           deliveredEvents   = 0;
+		std::atomic<uint64_t>           conflatedVersions = 0;
+		std::atomic<uint64_t>           callbackErrors    = 0;
+	};
+
+	struct Pool
+	{
+		void schedule( std::shared_ptr<Entry> entry )
+		{
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+				ready.push_back( std::move( entry ) );
+			}
+			readyCV.notify_one();
+		}
+
+		void run()
+		{
+			while( true )
+			{
+				std::shared_ptr<Entry> entry;
+				{
+					std::unique_lock<std::mutex> lock( mutex );
+					readyCV.wait( lock, [this] () { return !running || ready.size(); } );
+					if( !running )
+						return;
+
+					entry = std::move( ready.front() );
+					ready.pop_front();
+				}
+
+				entry->servingThread = std::this_thread::get_id();
+				if( const auto latest = entry->takePending(); latest && entry->active )
+					entry->dispatch( *this, latest );
+				entry->servingThread = std::thread::id();
+
+				// Back of the queue, so subscribers with a steady stream of changes take turns
+				if( entry->reschedule() )
+					schedule( std::move( entry ) );
+			}
+		}
+
+		/**
+		 * @brief The changes between two snapshots, computed by whichever subscriber asks first and shared with the rest.
+		 */
+		[[nodiscard]] std::shared_ptr<const ChangeSet> diff( const Snapshot& older, const Snapshot& newer )
+		{
+			std::promise<std::shared_ptr<const ChangeSet>> promise;
+			SharedDiff                                     result;
+			bool                                           compute = false;
+			{
+				std::lock_guard<std::mutex> lock( diffsMutex );
+
+				auto [it, inserted] = diffs.try_emplace( std::make_pair( older.version(), newer.version() ) );
+				if( inserted )
+				{
+					it->second = promise.get_future().share();
+					compute    = true;
+
+					// Subscribers all converge on the newest snapshot, so diffs into older ones are rarely asked for again - the odd
+					// straggler just recomputes its own
+					std::erase_if( diffs, [&newer] ( const auto& diff ) { return diff.first.second < newer.version(); } );
+				}
+				result = it->second;
+			}
+
+			if( compute )
+				promise.set_value( std::make_shared<const ChangeSet>( Snapshot::diff( older, newer ) ) );
+
+			return result.get();
+		}
+
+		std::mutex                         mutex;
+		std::condition_variable            readyCV;
+		std::deque<std::shared_ptr<Entry>> ready;
+		bool                               running = true;
+
+		using SharedDiff = std::shared_future<std::shared_ptr<const ChangeSet>>;
+
+		std::mutex                                         diffsMutex;
+		std::map<std::pair<uint64_t, uint64_t>, SharedDiff> diffs; // By (older, newer) version
+	};
+
+	class Subscription : public MarketSubscription
+	{
+	public:
+		explicit Subscription( std::shared_ptr<Entry> entry )
+			: m_entry( std::move( entry ) )
+		{}
+
+		~Subscription() override { unsubscribe(); }
+
+		void unsubscribe() override
+		{
+			if( std::this_thread::get_id() == m_entry->servingThread.load() )
+				m_entry->active = false; // Called from within a callback - we already hold the lock
+			else
+			{
+				std::lock_guard<std::mutex> lock( m_entry->mutex );
+				m_entry->active = false;
+			}
+		}
+
+		[[nodiscard]] MarketSubStats getStats() const override
+		{
+			return MarketSubStats {
+				.deliveredEvents   = m_entry->deliveredEvents.load( std::memory_order_relaxed ),
+				.conflatedVersions = m_entry->conflatedVersions.load( std::memory_order_relaxed ),
+				.callbackErrors    = m_entry->callbackErrors.load( std::memory_order_relaxed )
+			};
+		}
+
+	private:
+		std::shared_ptr<Entry> m_entry;
+	};
+
+private:
+	std::shared_ptr<const Snapshot>     m_latest; // The last snapshot handed over - new subscribers see changes from here on
+	std::vector<std::shared_ptr<Entry>> m_entries;
+	std::mutex                          m_entriesMutex;
+
+	std::shared_ptr<Pool>               m_pool;
+	std::vector<std::thread>            m_threads;
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <ARQMarket/dll.h>
+
+#include <ARQUtils/hashers.h>
+#include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/mktdata_live_store.h>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief Holds market update batches back for a short window, keeping only the newest record (by asofTs) for each market, type and id,
+ *        so that a burst of ticks on an instrument goes on as one record.
+ *
+ * No record is held for longer than the window - it opens with the first record added and everything held is taken together once it
+ * has passed. It also closes early once it holds maxRecords distinct records. The offsets of everything added are merged, so the
+ * batches taken move each partition on as far as the batches that went into them did.
+ */
+class MarketUpdateConflator
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Config
+	{
+		std::chrono::milliseconds window     = std::chrono::milliseconds( 100 ); /// The longest any record is held for
+		size_t                    maxRecords = 0;                                /// Close the window early once it holds this many records - 0 for no limit
+	};
+
+	struct Stats
+	{
+		uint64_t received  = 0;
+		uint64_t forwarded = 0; /// Taken on to the sinks
+		uint64_t conflated = 0; /// Dropped for a newer record with the same id in the same window
+	};
+
+public:
+	ARQMarket_API explicit MarketUpdateConflator( const Config& config );
+
+	/**
+	 * @brief Adds the batches' records to the window, moving out of them.
+	 */
+	ARQMarket_API void add( std::unordered_map<std::string, MarketUpdateBatch>&& updateBatches, const Clock::time_point now = Clock::now() );
+
+	/**
+	 * @brief Whether the window has closed, so what's held should be taken.
+	 */
+	[[nodiscard]] ARQMarket_API bool due( const Clock::time_point now = Clock::now() ) const;
+
+	/**
+	 * @brief When the window closes on time, or nullopt if nothing is held.
+	 */
+	[[nodiscard]] ARQMarket_API std::optional<Clock::time_point> deadline() const;
+
+	/**
+	 * @brief Takes everything held, by market, leaving the conflator empty for the next window.
+	 */
+	[[nodiscard]] ARQMarket_API std::unordered_map<std::string, MarketUpdateBatch> take();
+
+	[[nodiscard]] bool  empty()    const noexcept { return m_numHeld == 0; }
+	[[nodiscard]] Stats getStats() const noexcept { return m_stats; }
+
+private:
+	using IdIndex = std::unordered_map<std::string, size_t, TransparentStringHash, std::equal_to<>>;
+
+	struct HeldMarket
+	{
+		MarketUpdateBatch                 batch;
+		std::unordered_map<Type, IdIndex> indexes; /// Where each id's record is in the batch, per type
+	};
+
+private:
+	Config                                      m_config;
+
+	std::unordered_map<std::string, HeldMarket> m_held;
+	size_t                                      m_numHeld = 0;
+	Clock::time_point                           m_windowStart;
+
+	Stats                                       m_stats;
+};
+
+}
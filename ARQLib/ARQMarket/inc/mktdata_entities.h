@@ -18,6 +18,7 @@
 #include <array>
 #include <utility>
 #include <optional>
+#include <vector>
 
 namespace ARQ::MD
 {
@@ -88,6 +89,10 @@ struct RecordMessage
     std::string mktName;
 };
 
+/// Columnar (structure of arrays) form of a set of records - specialised for each MD entity
+template<c_MktData T>
+struct Columns {};
+
 /// The enumeration of all Market Data entity types
 enum class Type
 {
@@ -150,6 +155,47 @@ public:
             .isOptional = false
         }    
     };
+
+    /// Calls func( double& ) on every decimal member that holds a value, e.g. to apply a market shift
+    template<typename F>
+    static void visitDecimals( FXRate& obj, F&& func )
+    {
+        func( obj.mid );
+        func( obj.bid );
+        func( obj.ask );
+    }
+};
+
+/// Columnar form of FXRate records - one contiguous array per numeric member, each indexed in step with the id column
+template<>
+struct Columns<FXRate>
+{
+    /// Record ids
+    std::vector<std::string> id;
+    /// The mid-market rate.
+    std::vector<double> mid;
+    /// The price at which a market maker is willing to buy.
+    std::vector<double> bid;
+    /// The price at which a market maker is willing to sell.
+    std::vector<double> ask;
+
+    [[nodiscard]] size_t size() const noexcept { return id.size(); }
+
+    void reserve( const size_t n )
+    {
+        id.reserve( n );
+        mid.reserve( n );
+        bid.reserve( n );
+        ask.reserve( n );
+    }
+
+    void push_back( const Record<FXRate>& rcd )
+    {
+        id.push_back( rcd.header.id );
+        mid.push_back( rcd.data.mid );
+        bid.push_back( rcd.data.bid );
+        ask.push_back( rcd.data.ask );
+    }
 };
 
 
@@ -229,6 +275,71 @@ public:
             .isOptional = true
         }    
     };
+
+    /// Calls func( double& ) on every decimal member that holds a value, e.g. to apply a market shift
+    template<typename F>
+    static void visitDecimals( EQPrice& obj, F&& func )
+    {
+        func( obj.last );
+        func( obj.bid );
+        func( obj.ask );
+        func( obj.open );
+        func( obj.close );
+        if( obj.vwap )
+            func( *obj.vwap );
+    }
+};
+
+/// Columnar form of EQPrice records - one contiguous array per numeric member, each indexed in step with the id column
+template<>
+struct Columns<EQPrice>
+{
+    /// Record ids
+    std::vector<std::string> id;
+    /// The price of the last executed trade.
+    std::vector<double> last;
+    /// The highest price a buyer is willing to pay.
+    std::vector<double> bid;
+    /// The lowest price a seller is willing to accept.
+    std::vector<double> ask;
+    /// The opening price for the current trading session.
+    std::vector<double> open;
+    /// The closing price from the previous trading session.
+    std::vector<double> close;
+    /// The cumulative volume for the current trading session.
+    std::vector<int64_t> volume;
+    /// The volume-weighted average price for the current trading session, if available. Unset values are stored as double{} - see vwapIsSet.
+    std::vector<double> vwap;
+    /// Whether each vwap value is set
+    std::vector<uint8_t> vwapIsSet;
+
+    [[nodiscard]] size_t size() const noexcept { return id.size(); }
+
+    void reserve( const size_t n )
+    {
+        id.reserve( n );
+        last.reserve( n );
+        bid.reserve( n );
+        ask.reserve( n );
+        open.reserve( n );
+        close.reserve( n );
+        volume.reserve( n );
+        vwap.reserve( n );
+        vwapIsSet.reserve( n );
+    }
+
+    void push_back( const Record<EQPrice>& rcd )
+    {
+        id.push_back( rcd.header.id );
+        last.push_back( rcd.data.last );
+        bid.push_back( rcd.data.bid );
+        ask.push_back( rcd.data.ask );
+        open.push_back( rcd.data.open );
+        close.push_back( rcd.data.close );
+        volume.push_back( rcd.data.volume );
+        vwap.push_back( rcd.data.vwap.value_or( double{} ) );
+        vwapIsSet.push_back( rcd.data.vwap.has_value() );
+    }
 };
 
 
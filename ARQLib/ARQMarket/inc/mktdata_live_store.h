@@ -1,15 +1,20 @@
 #pragma once
 #include <ARQMarket/dll.h>
 
+#include <ARQUtils/error.h>
 #include <ARQUtils/global_accessor.h>
 #include <ARQUtils/hashers.h>
+#include <ARQUtils/instr.h>
 #include <ARQCore/streaming_service.h>
 #include <ARQMarket/market.h>
 
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace ARQ::MD
 {
@@ -19,14 +24,60 @@ struct MarketUpdateBatch
 	MarketName                  marketName;
 	RecordCollection            records;
 	StreamTopicPartitionOffsets offsets;
+	StreamTopicPartitionOffsets prevOffsets; /// Offsets of the previous batch published for this market, on the partitions in this batch - lets a consumer spot batches it missed
+
+	/// The partition of its type's update topic each record was read from, in the same order as records - lets a store guard each record
+	/// by its own partition's offset. Not published, and NO_PARTITION, or no entry for the type, where it isn't known
+	std::unordered_map<Type, std::vector<int32_t>> recordPartitions;
+
+	static constexpr int32_t NO_PARTITION = -1;
+};
+
+struct LiveMarketStoreStats
+{
+	Instr::Histogram::Snapshot inFlight; /// Batches sent together in each round trip to the store
+	Instr::Histogram::Snapshot rttUs;    /// Time for each round trip, in microseconds
+	size_t                     queued  = 0; /// Batches waiting to be sent
+	uint64_t                   applied = 0;
+	uint64_t                   failed  = 0;
+	uint64_t                   skipped = 0; /// Batches that had already been applied, so changed nothing
 };
 
+using LiveMarketStoreApplyCallbackFunc = std::function<void( const std::optional<ARQException>& error )>;
+
 class ILiveMarketStore
 {
 public:
 	virtual ~ILiveMarketStore() = default;
 
 	virtual void apply( const MarketUpdateBatch& updateBatch ) = 0;
+
+	/**
+	 * @brief Queues the batch to be applied without waiting on it. Batches are applied in the order they were queued.
+	 * The default just applies the batch there and then.
+	 * @param onApplied Called once the batch has been applied, or has failed to be - possibly on a thread of the store's.
+	 * @throws ARQException If the batch can't be queued.
+	 */
+	virtual void applyAsync( const MarketUpdateBatch& updateBatch, const LiveMarketStoreApplyCallbackFunc& onApplied )
+	{
+		std::optional<ARQException> error;
+		try
+		{
+			apply( updateBatch );
+		}
+		catch( const ARQException& e )
+		{
+			error = e;
+		}
+		onApplied( error );
+	}
+
+	/**
+	 * @brief Blocks until every batch queued by applyAsync() has been applied or failed.
+	 */
+	virtual void flush() {}
+
+	[[nodiscard]] virtual LiveMarketStoreStats getStats() const { return {}; }
 };
 
 using LiveMarketStoreCreateFunc = std::add_pointer<ILiveMarketStore*( const std::string_view dsh )>::type;
@@ -35,12 +86,21 @@ class LiveMarketStoreFactory : public GlobalAccessor<LiveMarketStoreFactory, "Li
 {
 public:
 	[[nodiscard]] ARQMarket_API std::shared_ptr<ILiveMarketStore> create( const std::string_view dsh );
+	/**
+	 * @brief Creates a store that isn't shared with anyone else asking for the dsh, so has its own connections to the backend.
+	 * A custom store added for the dsh is still returned as is.
+	 */
+	[[nodiscard]] ARQMarket_API std::shared_ptr<ILiveMarketStore> createUnshared( const std::string_view dsh );
 
 	ARQMarket_API void addCustomStore( const std::string_view dsh, const std::shared_ptr<ILiveMarketStore>& store );
 	ARQMarket_API void delCustomStore( const std::string_view dsh );
 
+private:
+	std::shared_ptr<ILiveMarketStore> iCreate( const std::string_view dsh );
+
 private:
 	std::unordered_map<std::string, std::shared_ptr<ILiveMarketStore>, TransparentStringHash, std::equal_to<>> m_stores;
+	std::unordered_map<std::string, std::shared_ptr<ILiveMarketStore>, TransparentStringHash, std::equal_to<>> m_customStores;
 	std::mutex m_storesMutex;
 };
 
@@ -9,8 +9,13 @@
 #include <ARQMarket/mktdata_topics.h>
 #include <ARQMarket/market.h>
 
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <span>
 #include <string>
 #include <shared_mutex>
+#include <vector>
 
 namespace ARQ::MD
 {
@@ -20,13 +25,25 @@ struct RecordMessageTraits
 {
 	static std::string_view type() noexcept
 	{
-		static const std::string_view typeStr = std::format( "MD::RecordMessage<{}>", Traits<T>::name() );
+		static const std::string typeStr = std::format( "MD::RecordMessage<{}>", Traits<T>::name() );
 		return typeStr;
 	}
 };
 
 using PublisherErrorCallback = std::function<void( const StreamProducerMessageMetadata& messageMetadata, StreamError error )>;
 
+struct PublishBatchResult
+{
+	size_t                     numMessages = 0;
+	size_t                     numFailed   = 0;
+	std::optional<StreamError> firstError;
+
+	[[nodiscard]] bool ok() const { return numFailed == 0; }
+};
+
+// Called once per batch, on the producer's delivery thread, after every message in the batch has been delivered or has failed
+using PublisherBatchCallback = std::function<void( const PublishBatchResult& result )>;
+
 class Publisher
 {
 public:
@@ -39,34 +56,114 @@ public:
 
 public:
 	Publisher() = default;
+	ARQMarket_API ~Publisher();
+
+	Publisher( const Publisher& )            = delete;
+	Publisher& operator=( const Publisher& ) = delete;
 
 	ARQMarket_API void init( const Config& config );
 
 	ARQMarket_API void registerOnErrorCallback( const PublisherErrorCallback& callback );
 
 	template<c_MktData T>
-	void publish( const MarketName& mktName, Record<T> record, const std::optional<PublisherErrorCallback>& errorCallback = std::nullopt )
+	void publish( const MarketName& mktName, const Record<T>& record, const std::optional<PublisherErrorCallback>& errorCallback = std::nullopt )
 	{
-		// Inject metadata into the record header
-		record.header.lastUpdatedTs = Time::DateTime::nowUTC();
-		if( record.header.lastUpdatedBy.empty() )
-			record.header.lastUpdatedBy = m_config.updatedByStr;
-
-		RecordMessage<T> msg = {
-			.record  = record,
-			.mktName = mktName.str()
-		};
-
-		Buffer      buf = m_config.serialiser->serialise( msg );
-		std::string key = std::format( "{0}|{1}#{2}", mktName.str(), Traits<T>::type(), record.header.id );
+		publishBatch<T>( mktName, std::span<const Record<T>>( &record, 1 ), PublisherBatchCallback(), errorCallback );
+	}
 
-		publishImpl( std::move( buf ), std::move( key ), Topics<T>::updateTopic(), RecordMessageTraits<T>::type(), errorCallback );
+	/**
+	 * @brief Publishes a batch of records.
+	 * Payloads and keys are written into a per-batch arena that is recycled once the batch has been delivered, and each batch binds
+	 * its delivery callback once, so once warmed up the publisher itself allocates nothing per batch. The producer may still allocate
+	 * per message - the Kafka one wraps each delivery callback and copies the headers into every record it sends.
+	 * @param onDelivered Called once when every message in the batch has been delivered or has failed.
+	 * @param errorCallback Called for each message that fails, as with publish.
+	 */
+	template<c_MktData T>
+	void publishBatch( const MarketName& mktName, std::span<const Record<T>> records, const PublisherBatchCallback& onDelivered = PublisherBatchCallback(), const std::optional<PublisherErrorCallback>& errorCallback = std::nullopt )
+	{
+		if( records.empty() )
+		{
+			if( onDelivered )
+				onDelivered( PublishBatchResult() );
+			return;
+		}
+
+		// Reused across calls on this thread - copy assigning each record in reuses the message's string buffers once they've grown to fit,
+		// where moving it in would hand the message the record's buffers and free its own
+		thread_local RecordMessage<T> msg;
+
+		std::lock_guard<std::mutex> lock( m_publishMutex );
+
+		PublishBatch& batch = acquireBatch( records.size(), onDelivered, errorCallback );
+
+		const Time::DateTime   now        = Time::DateTime::nowUTC();
+		const std::string_view mktNameStr = cachedMktNameStr( mktName );
+		msg.mktName.assign( mktNameStr );
+
+		try
+		{
+			for( const Record<T>& record : records )
+			{
+				// Inject metadata into the record header
+				msg.record = record;
+				msg.record.header.lastUpdatedTs = now;
+				if( msg.record.header.lastUpdatedBy.empty() )
+					msg.record.header.lastUpdatedBy.assign( m_config.updatedByStr );
+
+				PublishBatch::Slice& slice = batch.slices.emplace_back();
+				slice.payloadOffset = batch.payloads.size();
+				slice.payloadSize   = m_config.serialiser->serialiseAppend( msg, batch.payloads );
+				slice.keyOffset     = batch.keys.size();
+				std::format_to( std::back_inserter( batch.keys ), "{0}|{1}#{2}", mktNameStr, Traits<T>::type(), msg.record.header.id );
+				slice.keySize       = batch.keys.size() - slice.keyOffset;
+			}
+		}
+		catch( ... )
+		{
+			// Nothing has been sent yet, so the batch can go straight back on the free list
+			releaseBatch( batch );
+			throw;
+		}
+
+		sendBatch( batch, Topics<T>::updateTopic(), RecordMessageTraits<T>::type() );
 	}
 
 	void flush() { m_streamProducer->flush(); }
 
 private:
-	ARQMarket_API void publishImpl( Buffer&& buf, const std::string key, const std::string_view topic, const std::string_view payloadType, const std::optional<PublisherErrorCallback>& errorCallback = std::nullopt );
+	struct PublishBatch
+	{
+		struct Slice
+		{
+			size_t payloadOffset;
+			size_t payloadSize;
+			size_t keyOffset;
+			size_t keySize;
+		};
+
+		std::vector<uint8_t> payloads;
+		std::string          keys;
+		std::vector<Slice>   slices;
+
+		PublisherBatchCallback                onDelivered;
+		std::optional<PublisherErrorCallback> errorCallback;
+		StreamProducerDeliveryCallbackFunc    deliveryCallback; // Bound to this batch once, when it is first created
+
+		std::atomic<size_t>        pending   = 0;
+		std::atomic<size_t>        numFailed = 0;
+		std::optional<StreamError> firstError;
+		std::mutex                 firstErrorMut;
+	};
+
+private:
+	ARQMarket_API PublishBatch&    acquireBatch( const size_t numMessages, const PublisherBatchCallback& onDelivered, const std::optional<PublisherErrorCallback>& errorCallback );
+	ARQMarket_API std::string_view cachedMktNameStr( const MarketName& mktName );
+	ARQMarket_API void             sendBatch( PublishBatch& batch, const std::string_view topic, const std::string_view payloadType );
+	ARQMarket_API void             releaseBatch( PublishBatch& batch );
+
+	void onMessageDelivered( PublishBatch& batch, const StreamProducerMessageMetadata& messageMetadata, const std::optional<StreamError>& error );
+	void completeMessages( PublishBatch& batch, const size_t numMessages );
 
 	void handlePublishError( const StreamProducerMessageMetadata& messageMetadata, StreamError error, const std::optional<PublisherErrorCallback>& errorCallback );
 
@@ -77,6 +174,17 @@ private:
 
 	 std::vector<PublisherErrorCallback> m_globalErrorCallbacks;
 	 std::shared_mutex                   m_globalErrorCallbacksMut;
+
+	 // Guards the scratch state below while a batch is built and sent
+	 std::mutex            m_publishMutex;
+	 StreamProducerMessage m_scratchMsg;
+	 MarketName            m_lastMktName;
+	 std::string           m_lastMktNameStr;
+
+	 // Batches are only freed with the publisher - delivered ones go back on the free list with their buffers intact
+	 std::vector<std::unique_ptr<PublishBatch>> m_batches;
+	 std::vector<PublishBatch*>                 m_freeBatches;
+	 std::mutex                                 m_batchesMut;
 };
 
 }
@@ -15,11 +15,21 @@
 namespace ARQ::MD
 {
 
+struct MarketSourceStats
+{
+	uint64_t cacheHits          = 0; /// Records served from an in process read cache, for sources that have one
+	uint64_t cacheMisses        = 0;
+	uint64_t cacheInvalidations = 0;
+	uint64_t cacheEvictions     = 0; /// Cached entries dropped to keep the cache within its size bound
+};
+
 class IMarketSource
 {
 public:
 	virtual RecordCollection load( const std::string_view marketName, const TIDSet& filter = ARQ::MD::TIDSet{} ) = 0;
 	virtual void             save( const std::string_view marketName, const RecordCollection& records )          = 0;
+
+	virtual MarketSourceStats getStats() const { return {}; }
 };
 
 using MarketSourceCreateFunc = std::add_pointer<IMarketSource* ( const std::string_view dsh )>::type;
@@ -0,0 +1,179 @@
+#pragma once
+#include <ARQMarket/dll.h>
+
+#include <ARQUtils/hashers.h>
+#include <ARQCore/messaging_service_interface.h>
+#include <ARQCore/serialiser.h>
+#include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/mktdata_live_store.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ARQ::MD
+{
+
+/**
+ * @brief A market update batch, or one chunk of it, as published to the messaging service when it's chunked or delta encoded.
+ *
+ * Sequence numbers run per publisher and market, one for every message, so a subscriber can tell when it has missed one. Every chunk
+ * carries the batch's offsets.
+ */
+struct MarketUpdateMessage
+{
+	MarketUpdateBatch     batch;
+	std::string           publisherID;
+	uint64_t              seq       = 0;
+	uint32_t              chunkIdx  = 0;
+	uint32_t              numChunks = 1;
+	std::vector<uint64_t> deltaMasks; /// Empty unless delta encoded - then one for each record, in RecordCollection order, with a bit set for each decimal (in Traits<T>::visitDecimals order) left out as unchanged since the publisher's last record for the id
+
+	static constexpr std::string_view TYPE_HEADER = "ARQ_Type"; /// Set to TYPE on a published MarketUpdateMessage - a plain MarketUpdateBatch has no type header
+	static constexpr std::string_view TYPE        = "MD::MarketUpdateMessage";
+};
+
+/**
+ * @brief Splits market update batches that are too big for one message into chunks and, optionally, delta encodes them - decimals
+ *        unchanged since the last record published for an id are sent as zero (which protobuf leaves off the wire) and flagged in the
+ *        record's delta mask.
+ *
+ * Subscribers that predate chunking and delta encoding only understand a plain MarketUpdateBatch, so that's what goes out for a batch
+ * that fits in one message when delta encoding is off. Anything else is a MarketUpdateMessage, marked as such by the ARQ_Type header.
+ *
+ * Delta bases are dropped every fullRecordInterval, sending every record in full again, so a subscriber that joins late, or loses its
+ * bases to a missed message, has every id again within the interval of it next ticking.
+ */
+class MarketUpdateEncoder
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t DEFAULT_MAX_MESSAGE_BYTES = 900 * 1024; // Below NATS' default max payload of 1MB, with room to spare for headers
+
+	struct Config
+	{
+		size_t                    maxMessageBytes    = DEFAULT_MAX_MESSAGE_BYTES; /// Batches bigger than this when serialised are split into chunks
+		bool                      deltaEncode        = false;                     /// Every subscriber must understand MarketUpdateMessage before this is turned on
+		std::chrono::milliseconds fullRecordInterval = std::chrono::seconds( 5 ); /// How often every record is sent in full again when delta encoding
+	};
+
+	struct Stats
+	{
+		uint64_t batches         = 0;
+		uint64_t messages        = 0;
+		uint64_t chunkedBatches  = 0;
+		uint64_t deltaRecords    = 0; /// Records sent with at least one decimal left out
+		uint64_t decimalsLeftOut = 0;
+	};
+
+public:
+	ARQMarket_API MarketUpdateEncoder( const Config& config, std::shared_ptr<Serialiser> serialiser, std::string publisherID );
+
+	/**
+	 * @brief Encodes a batch into the messages to publish for it, in order.
+	 * Subscribers' delta bases follow every message returned, so each must be published (or retried until it is) before the next
+	 * batch is encoded. A message given up on is seen by subscribers as a sequence gap, and they drop their delta bases.
+	 */
+	[[nodiscard]] ARQMarket_API std::vector<Message> encode( const MarketUpdateBatch& batch, const Clock::time_point now = Clock::now() );
+
+	[[nodiscard]] const std::string& publisherID() const noexcept { return m_publisherID; }
+	[[nodiscard]] Stats              getStats()    const noexcept { return m_stats; }
+
+private:
+	using IdIndex = std::unordered_map<std::string, size_t, TransparentStringHash, std::equal_to<>>;
+
+	struct PublishedMarket
+	{
+		uint64_t                          seq = 0;
+		RecordCollection                  bases;   /// The last record published for each id, as subscribers will have decoded it
+		std::unordered_map<Type, IdIndex> indexes; /// Where each id's base is, per type
+		Clock::time_point                 basesSince;
+	};
+
+	std::vector<uint64_t> deltaEncode( PublishedMarket& published, MarketUpdateBatch& batch, const Clock::time_point now );
+
+private:
+	Config                                           m_config;
+	std::shared_ptr<Serialiser>                      m_serialiser;
+	std::string                                      m_publisherID;
+
+	std::unordered_map<std::string, PublishedMarket> m_published;
+
+	Stats                                            m_stats;
+};
+
+/**
+ * @brief Decodes what a MarketUpdateEncoder publishes for a market - reassembling chunked batches and filling delta encoded records in
+ *        from the last record decoded for their id. Plain MarketUpdateBatch messages, with no ARQ_Type header, pass straight through.
+ *
+ * A missed message from a publisher drops its delta bases and any batch it was part way through. The batch's offsets never arrive, so
+ * the gap shows up in the next batch's prevOffsets as well. Until an id is sent in full again, delta encoded records for it can't be
+ * decoded and are dropped - decode() reports their types, as the subscriber no longer has the latest values for them.
+ */
+class MarketUpdateDecoder
+{
+public:
+	struct Stats
+	{
+		uint64_t messages     = 0; /// Chunked or delta encoded messages - plain batches aren't counted
+		uint64_t reassembled  = 0; /// Batches put back together from more than one chunk
+		uint64_t seqGaps      = 0; /// Times a publisher's sequence skipped ahead
+		uint64_t duplicates   = 0; /// Messages with a sequence number already seen, which are ignored
+		uint64_t deltaRecords = 0; /// Records filled in from their delta base
+		uint64_t deltaMisses  = 0; /// Delta encoded records dropped for having no base to fill them in from
+	};
+
+public:
+	ARQMarket_API explicit MarketUpdateDecoder( std::shared_ptr<Serialiser> serialiser );
+
+	/**
+	 * @brief Decodes a message - giving the batch once it's whole, or nullopt while chunks of it are still to come or if nothing in the
+	 *        message can be used. Not thread safe - messages must be decoded in the order they arrived.
+	 * @param deltaMissTypes If given, set to the types of any delta encoded records dropped from the message for having no base to fill
+	 *        them in from - whether or not a batch is given back.
+	 * @throws ARQException if the message can't be deserialised.
+	 */
+	[[nodiscard]] ARQMarket_API std::optional<MarketUpdateBatch> decode( const Message& msg, std::vector<Type>* deltaMissTypes = nullptr );
+
+	[[nodiscard]] ARQMarket_API Stats getStats() const;
+
+	/**
+	 * @brief Whether a message is a MarketUpdateMessage rather than a plain MarketUpdateBatch.
+	 */
+	[[nodiscard]] ARQMarket_API static bool isUpdateMessage( const Message& msg );
+
+private:
+	using IdIndex = std::unordered_map<std::string, size_t, TransparentStringHash, std::equal_to<>>;
+
+	struct Publisher
+	{
+		uint64_t                          lastSeq = 0;
+		std::optional<MarketUpdateBatch>  partial;   /// The chunks of a batch received so far
+		RecordCollection                  bases;     /// The last record decoded for each id
+		std::unordered_map<Type, IdIndex> indexes;
+	};
+
+	void deltaDecode( Publisher& publisher, MarketUpdateMessage& updateMsg, std::vector<Type>* deltaMissTypes );
+
+private:
+	std::shared_ptr<Serialiser>                m_serialiser;
+	std::unordered_map<std::string, Publisher> m_publishers;
+
+	std::atomic<uint64_t>                      m_numMessages     = 0;
+	std::atomic<uint64_t>                      m_numReassembled  = 0;
+	std::atomic<uint64_t>                      m_numSeqGaps      = 0;
+	std::atomic<uint64_t>                      m_numDuplicates   = 0;
+	std::atomic<uint64_t>                      m_numDeltaRecords = 0;
+	std::atomic<uint64_t>                      m_numDeltaMisses  = 0;
+};
+
+}
+
+ARQ_REG_TYPE( ARQ::MD::MarketUpdateMessage )
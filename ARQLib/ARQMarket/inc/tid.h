@@ -1,9 +1,13 @@
 #pragma once
 #include <ARQMarket/dll.h>
 
+#include <ARQUtils/hashers.h>
 #include <ARQMarket/mktdata_entities.h>
 
+#include <ankerl/unordered_dense.h>
+
 #include <optional>
+#include <string_view>
 #include <vector>
 #include <variant>
 
@@ -62,4 +66,48 @@ private:
     mutable bool             m_dirty = false;
 };
 
+/**
+ * @brief A read-only, pre-hashed form of a TIDSet for filtering on hot paths.
+ *
+ * Built once up front so that matches() is a single hash lookup regardless of how many ids the set holds, and
+ * getIDsForType() no longer needs to consolidate the underlying TIDSet.
+ */
+class CompiledTIDSet
+{
+public:
+    CompiledTIDSet() = default;
+    ARQMarket_API explicit CompiledTIDSet( const TIDSet& tidSet );
+
+    [[nodiscard]] bool matches( const Type type, const std::string_view id ) const
+    {
+        const auto it = m_filters.find( type );
+        return it != m_filters.end() && ( it->second.all || it->second.ids.contains( id ) );
+    }
+
+    [[nodiscard]] bool matchesAll( const Type type ) const
+    {
+        const auto it = m_filters.find( type );
+        return it != m_filters.end() && it->second.all;
+    }
+
+    [[nodiscard]] bool matchesNone( const Type type ) const { return !m_filters.contains( type ); }
+
+    /**
+     * @brief Same result as TIDSet::getIDsForType. Any ids returned view into this CompiledTIDSet so are only valid for as long as it lives.
+     */
+    [[nodiscard]] ARQMarket_API TIDSet::IDs getIDsForType( const Type type ) const;
+
+    [[nodiscard]] bool empty() const { return m_filters.empty(); }
+
+private:
+    struct TypeFilter
+    {
+        bool                                                                                    all = false;
+        ankerl::unordered_dense::set<std::string, AnkerlTransparentStringHash, std::equal_to<>> ids;
+    };
+
+private:
+    ankerl::unordered_dense::map<Type, TypeFilter> m_filters;
+};
+
 }
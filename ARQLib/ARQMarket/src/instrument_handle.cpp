@@ -0,0 +1,14 @@
+#include <ARQMarket/instrument_handle.h>
+
+#include <atomic>
+
+namespace ARQ::MD
+{
+
+uint32_t nextInstrumentSymbolTableID()
+{
+	static std::atomic<uint32_t> nextID = 0;
+	return nextID.fetch_add( 1, std::memory_order_relaxed );
+}
+
+}
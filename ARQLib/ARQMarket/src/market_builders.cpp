@@ -1,5 +1,11 @@
 #include <ARQMarket/market_builders.h>
 
+#include <ARQUtils/logger.h>
+#include <ARQUtils/instr.h>
+
+#include <algorithm>
+#include <future>
+
 namespace ARQ::MD
 {
 
@@ -12,6 +18,28 @@ LiveMarketBuilder& LiveMarketBuilder::withMessagingFeed( const std::string_view
     return *this;
 }
 
+LiveMarketBuilder& LiveMarketBuilder::withMarkets( const std::vector<MarketName>& mktNames )
+{
+    m_extraMktNames.insert( m_extraMktNames.end(), mktNames.begin(), mktNames.end() );
+
+    return *this;
+}
+
+LiveMarketBuilder& LiveMarketBuilder::withParallelTypeLoads( const bool parallelTypeLoads )
+{
+    m_parallelTypeLoads = parallelTypeLoads;
+
+    return *this;
+}
+
+LiveMarketBuilder& LiveMarketBuilder::withSnapshotCache( const std::filesystem::path& dir, const std::chrono::seconds saveInterval )
+{
+    m_snapshotCacheDir      = dir;
+    m_snapshotCacheInterval = saveInterval;
+
+    return *this;
+}
+
 std::pair<std::shared_ptr<Market>, std::shared_ptr<LiveMarketUpdater>> LiveMarketBuilder::build()
 {
     if( m_msgSvcDSH.empty() )
@@ -19,19 +47,95 @@ std::pair<std::shared_ptr<Market>, std::shared_ptr<LiveMarketUpdater>> LiveMarke
     if( !m_mktSrcMktName.isSet() && !m_msgMktName.isSet() )
         throw ARQException( "Cannot build live market with no mkt name specified - if fromSource() has not been called then mktName must be provided in withMessagingService() call" );
 
+    LiveMarketHandle handle = buildOne( m_mktSrcMktName.isSet() ? m_mktSrcMktName : m_msgMktName );
+    return std::make_pair( std::move( handle.mkt ), std::move( handle.updater ) );
+}
+
+std::vector<LiveMarketHandle> LiveMarketBuilder::buildAndStartAll()
+{
+    if( m_msgSvcDSH.empty() )
+        throw ARQException( "Cannot build live markets without specifying a messaging feed" );
+
+    std::vector<MarketName> mktNames;
+    if( m_mktSrcMktName.isSet() )
+        mktNames.push_back( m_mktSrcMktName );
+    else if( m_msgMktName.isSet() )
+        mktNames.push_back( m_msgMktName );
+    for( const MarketName& mktName : m_extraMktNames )
+    {
+        if( std::find( mktNames.begin(), mktNames.end(), mktName ) == mktNames.end() )
+            mktNames.push_back( mktName );
+    }
+
+    if( mktNames.empty() )
+        throw ARQException( "Cannot build live markets with no mkt names specified - provide them in fromSource(), withMessagingFeed() or withMarkets()" );
+
+    std::vector<LiveMarketHandle> handles;
+    handles.reserve( mktNames.size() );
+    for( const MarketName& mktName : mktNames )
+        handles.push_back( buildOne( mktName ) );
+
+    // Start every updater on its own thread - each blocks on its baseline load
+    Instr::Timer tmTotal;
+
+    std::vector<std::future<void>> starts;
+    starts.reserve( handles.size() );
+    for( const LiveMarketHandle& handle : handles )
+        starts.push_back( std::async( std::launch::async, [&updater = *handle.updater] () { updater.start(); } ) );
+
+    std::string failures;
+    size_t      numFailed = 0;
+    for( size_t i = 0; i < starts.size(); ++i )
+    {
+        ARQ_DO_IN_TRY( arqExc, errMsg )
+            starts[i].get();
+        ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+        if( arqExc.what().size() )
+            errMsg = arqExc.what();
+        if( errMsg.size() )
+        {
+            Log( Module::MKT ).error( "LiveMarketBuilder: Failed to start Mkt [{}]: {}", handles[i].mktName.str(), errMsg );
+            failures += std::format( "{}[{}]: {}", failures.empty() ? "" : ", ", handles[i].mktName.str(), errMsg );
+            ++numFailed;
+        }
+    }
+
+    if( numFailed )
+    {
+        for( const LiveMarketHandle& handle : handles )
+            handle.updater->stop();
+
+        throw ARQException( std::format( "LiveMarketBuilder: Failed to start {} live market(s) - {}", numFailed, failures ) );
+    }
+
+    const auto toMs = [] ( const std::chrono::nanoseconds ns ) { return std::chrono::duration<double, std::milli>( ns ).count(); };
+
+    const auto slowest = std::ranges::max_element( handles, {}, [] ( const LiveMarketHandle& handle ) { return handle.updater->getBaselineLoadStats().total; } );
+    Log( Module::MKT ).info( "LiveMarketBuilder: Started {} live market(s) in {:.1f}ms - slowest was Mkt [{}] at {:.1f}ms",
+        handles.size(), toMs( tmTotal.duration() ), slowest->mktName.str(), toMs( slowest->updater->getBaselineLoadStats().total ) );
+
+    return handles;
+}
+
+LiveMarketHandle LiveMarketBuilder::buildOne( const MarketName& mktName ) const
+{
     // Just make a blank market; LiveMarketUpdater handles population of data
     auto mkt = std::make_shared<Market>();
 
     auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
-        .mkt          = mkt,
-        .mktSrcDSH    = m_mktSrcDSH,
-        .msgSvcDSH    = m_msgSvcDSH,
-        .mktName      = m_mktSrcMktName.isSet() ? m_mktSrcMktName : m_msgMktName,
-        .mktSrcTIDSet = m_mktSrcTIDSet,
-        .msgTIDSet    = m_msgTIDSet
+        .mkt                   = mkt,
+        .mktSrcDSH             = m_mktSrcDSH,
+        .msgSvcDSH             = m_msgSvcDSH,
+        .mktName               = mktName,
+        .mktSrcTIDSet          = m_mktSrcTIDSet,
+        .msgTIDSet             = m_msgTIDSet,
+        .parallelTypeLoads     = m_parallelTypeLoads,
+        .snapshotCachePath     = m_snapshotCacheDir.empty() ? std::filesystem::path() : m_snapshotCacheDir / ( mktName.str() + ".mktcache" ),
+        .snapshotCacheInterval = m_snapshotCacheInterval
     } );
 
-    return std::make_pair( std::move( mkt ), std::move( updater ) );
+    return LiveMarketHandle{ mktName, std::move( mkt ), std::move( updater ) };
 }
 
 }
\ No newline at end of file
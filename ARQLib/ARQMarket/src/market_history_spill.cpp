@@ -0,0 +1,281 @@
+#include <ARQMarket/market_history_spill.h>
+
+#include <ARQUtils/logger.h>
+
+namespace ARQ::MD
+{
+
+namespace
+{
+
+// Frame layout (host byte order):
+//   u32 magic | u8 kind | u64 version | i64 asofTs (us since epoch) | u32 numEntries
+// followed by numEntries entries of:
+//   u8 type | u8 op | u32 size | size bytes (the serialised record for an upsert, or the id for an erase)
+
+constexpr uint32_t FRAME_MAGIC = 0x4C505341; // "ASPL"
+
+enum class FrameKind : uint8_t
+{
+	DELTA,
+	FULL
+};
+
+enum class EntryOp : uint8_t
+{
+	UPSERT,
+	ERASE
+};
+
+template<typename T>
+void writePod( std::ofstream& ofs, const T& value )
+{
+	ofs.write( reinterpret_cast<const char*>( &value ), sizeof( T ) );
+}
+
+template<typename T>
+bool readPod( std::ifstream& ifs, T& value )
+{
+	return static_cast<bool>( ifs.read( reinterpret_cast<char*>( &value ), sizeof( T ) ) );
+}
+
+void writeEntry( std::ofstream& ofs, const Type type, const EntryOp op, const void* data, const uint32_t size )
+{
+	writePod( ofs, static_cast<uint8_t>( type ) );
+	writePod( ofs, static_cast<uint8_t>( op ) );
+	writePod( ofs, size );
+	ofs.write( reinterpret_cast<const char*>( data ), size );
+}
+
+}
+
+MarketSnapshotSpillLog::MarketSnapshotSpillLog( const std::filesystem::path& path, std::shared_ptr<Serialiser> serialiser, const size_t queueCapacity )
+	: m_path( path )
+	, m_ofs( path, std::ios::binary | std::ios::app )
+	, m_serialiser( serialiser ? std::move( serialiser ) : SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf ) )
+	, m_queue( queueCapacity )
+{
+	if( !m_ofs.is_open() )
+		throw ARQException( std::format( "MarketSnapshotSpillLog: Failed to open spill log file {}", m_path.string() ) );
+
+	m_writeThread = std::thread( &MarketSnapshotSpillLog::runWriteLoop, this );
+}
+
+MarketSnapshotSpillLog::~MarketSnapshotSpillLog()
+{
+	// Anything already queued is still written before the write thread exits
+	m_queue.close();
+	if( m_writeThread.joinable() )
+		m_writeThread.join();
+}
+
+void MarketSnapshotSpillLog::append( std::shared_ptr<const MarketSnapshot> snapshot )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_writtenMutex );
+		++m_appended;
+	}
+
+	// Called from Market::update under its writer lock, so never wait on the write thread. A dropped snapshot breaks the run of
+	// versions, so the next one written is a full frame
+	if( m_queue.tryPush( std::move( snapshot ) ) )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_writtenMutex );
+		--m_appended;
+	}
+
+	// Closed means we're shutting down - only count what was lost to a full queue
+	if( m_queue.isClosed() )
+		return;
+
+	const uint64_t numDropped = m_dropped.fetch_add( 1, std::memory_order_relaxed ) + 1;
+	if( ( numDropped & ( numDropped - 1 ) ) == 0 ) // Log on powers of two so a sustained backlog doesn't flood the log
+		Log( Module::MKT ).warn( "MarketSnapshotSpillLog: Write queue full for {} - dropped {} snapshot(s) so far", m_path.string(), numDropped );
+}
+
+void MarketSnapshotSpillLog::flush()
+{
+	std::unique_lock<std::mutex> lock( m_writtenMutex );
+	const uint64_t target = m_appended;
+	m_writtenCV.wait( lock, [this, target] () { return m_written >= target; } );
+}
+
+MarketSnapshotSpillLog::Stats MarketSnapshotSpillLog::getStats() const
+{
+	Stats stats { .written = 0, .dropped = m_dropped.load( std::memory_order_relaxed ) };
+	{
+		std::lock_guard<std::mutex> lock( m_writtenMutex );
+		stats.written = m_written;
+	}
+	return stats;
+}
+
+void MarketSnapshotSpillLog::runWriteLoop()
+{
+	std::vector<std::shared_ptr<const MarketSnapshot>> pending;
+	while( m_queue.popAll( pending ) )
+	{
+		for( const auto& snapshot : pending )
+		{
+			ARQ_DO_IN_TRY( arqExc, errMsg )
+				write( *snapshot );
+			ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+			if( arqExc.what().size() )
+				Log( Module::MKT ).error( arqExc, "MarketSnapshotSpillLog: Exception writing snapshot version {} to {}", snapshot->version(), m_path.string() );
+			else if( errMsg.size() )
+				Log( Module::MKT ).error( "MarketSnapshotSpillLog: Error writing snapshot version {} to {}: {}", snapshot->version(), m_path.string(), errMsg );
+		}
+
+		m_ofs.flush();
+
+		{
+			std::lock_guard<std::mutex> lock( m_writtenMutex );
+			m_written += pending.size();
+		}
+		m_writtenCV.notify_all();
+
+		pending.clear();
+	}
+}
+
+void MarketSnapshotSpillLog::write( const MarketSnapshot& snapshot )
+{
+	// A delta only replays correctly on top of the version before it - otherwise write the whole snapshot
+	const FrameKind kind = m_hasWritten && snapshot.version() == m_lastWrittenVersion + 1 ? FrameKind::DELTA : FrameKind::FULL;
+
+	// Encode first so a serialisation failure doesn't leave a partial frame in the log
+	struct Entry
+	{
+		Type    type;
+		EntryOp op;
+		Buffer  data;
+	};
+	std::vector<Entry> entries;
+
+	auto addUpsert = [this, &entries] <c_MktData T> ( const Record<T>& rcd )
+	{
+		entries.push_back( Entry{ Traits<T>::typeEnum(), EntryOp::UPSERT, m_serialiser->serialise( rcd ) } );
+	};
+
+	snapshot.changes().visit( [&] <c_MktData T> ( const EntityChanges<T>& changes )
+	{
+		if( kind == FrameKind::FULL )
+		{
+			snapshot.template forEach<T>( addUpsert );
+			return;
+		}
+
+		for( const auto* ids : { &changes.inserted, &changes.updated } )
+		{
+			for( const std::string& id : *ids )
+			{
+				if( const auto rcd = snapshot.template get<T>( id ) )
+					addUpsert( *rcd );
+			}
+		}
+
+		for( const std::string& id : changes.erased )
+			entries.push_back( Entry{ Traits<T>::typeEnum(), EntryOp::ERASE, Buffer( id.data(), id.size() ) } );
+	} );
+
+	writePod( m_ofs, FRAME_MAGIC );
+	writePod( m_ofs, static_cast<uint8_t>( kind ) );
+	writePod( m_ofs, snapshot.version() );
+	writePod( m_ofs, static_cast<int64_t>( snapshot.asofTs().microsecondsSinceEpoch() ) );
+	writePod( m_ofs, static_cast<uint32_t>( entries.size() ) );
+	for( const Entry& entry : entries )
+		writeEntry( m_ofs, entry.type, entry.op, entry.data.data.get(), static_cast<uint32_t>( entry.data.size ) );
+
+	if( !m_ofs )
+		throw ARQException( std::format( "MarketSnapshotSpillLog: Failed writing to spill log file {}", m_path.string() ) );
+
+	m_lastWrittenVersion = snapshot.version();
+	m_hasWritten         = true;
+}
+
+std::shared_ptr<const MarketSnapshot> MarketSnapshotSpillLog::load( const std::filesystem::path& path, const Time::DateTime asofTs, std::shared_ptr<Serialiser> serialiser )
+{
+	std::ifstream ifs( path, std::ios::binary );
+	if( !ifs.is_open() )
+		throw ARQException( std::format( "MarketSnapshotSpillLog: Failed to open spill log file {}", path.string() ) );
+
+	if( !serialiser )
+		serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
+
+	// Each frame is replayed as an update to a scratch market - a full frame starts a fresh one
+	auto market      = std::make_unique<Market>();
+	bool replayedAny = false;
+
+	uint32_t magic;
+	while( readPod( ifs, magic ) )
+	{
+		uint8_t  kind;
+		uint64_t version;
+		int64_t  frameTsUs;
+		uint32_t numEntries;
+		if( magic != FRAME_MAGIC || !readPod( ifs, kind ) || !readPod( ifs, version ) || !readPod( ifs, frameTsUs ) || !readPod( ifs, numEntries ) )
+		{
+			Log( Module::MKT ).warn( "MarketSnapshotSpillLog: Corrupt or truncated frame header in spill log file {} - replayed up to it", path.string() );
+			break;
+		}
+
+		// Snapshot asofTs never goes backwards, so every frame from here on is too new
+		const Time::DateTime frameTs { Time::Microseconds( frameTsUs ) };
+		if( frameTs > asofTs )
+			break;
+
+		RecordCollection frameRecords;
+		bool             frameOK = true;
+		for( uint32_t i = 0; i < numEntries; ++i )
+		{
+			uint8_t  type;
+			uint8_t  op;
+			uint32_t size;
+			if( !readPod( ifs, type ) || !readPod( ifs, op ) || !readPod( ifs, size ) )
+			{
+				frameOK = false;
+				break;
+			}
+
+			Buffer data( size );
+			if( size && !ifs.read( reinterpret_cast<char*>( data.data.get() ), size ) )
+			{
+				frameOK = false;
+				break;
+			}
+
+			dispatch( static_cast<Type>( type ), [&] <c_MktData T> ()
+			{
+				if( static_cast<EntryOp>( op ) == EntryOp::ERASE )
+				{
+					Record<T> rcd {};
+					rcd.header.id       = std::string( reinterpret_cast<const char*>( data.data.get() ), data.size );
+					rcd.header.asofTs   = frameTs;
+					rcd.header.isActive = false;
+					frameRecords.get<Record<T>>().push_back( std::move( rcd ) );
+				}
+				else
+					frameRecords.get<Record<T>>().push_back( serialiser->deserialise<Record<T>>( BufferView( data.data.get(), data.size ) ) );
+			} );
+		}
+
+		if( !frameOK )
+		{
+			Log( Module::MKT ).warn( "MarketSnapshotSpillLog: Truncated frame for version {} in spill log file {} - replayed up to it", version, path.string() );
+			break;
+		}
+
+		if( static_cast<FrameKind>( kind ) == FrameKind::FULL )
+			market = std::make_unique<Market>();
+
+		market->update( std::move( frameRecords ) );
+		replayedAny = true;
+	}
+
+	return replayedAny ? market->snapshot() : nullptr;
+}
+
+}
@@ -1,51 +1,391 @@
 #include <ARQMarket/market_live.h>
 
 #include <ARQUtils/logger.h>
+#include <ARQUtils/instr.h>
+#include <ARQUtils/enum.h>
 #include <ARQMarket/mktdata_topics.h>
 
+#include <ankerl/unordered_dense.h>
+
+#include <algorithm>
+#include <future>
+
 namespace ARQ::MD
 {
 
+namespace
+{
+
+// Every update topic resolved to its entity type up front, rather than working it out from the topic string on every batch
+const ankerl::unordered_dense::map<std::string_view, Type>& topicTypes()
+{
+	static const ankerl::unordered_dense::map<std::string_view, Type> table = [] ()
+	{
+		ankerl::unordered_dense::map<std::string_view, Type> table;
+		RecordCollection().visitVectors( [&table] <c_MktData T> ( const std::vector<Record<T>>& )
+		{
+			table.emplace( Topics<T>::updateTopic(), Traits<T>::typeEnum() );
+		} );
+		return table;
+	}();
+	return table;
+}
+
+std::string tidSetKey( const TIDSet& tidSet )
+{
+	std::string key;
+	for( const TID& tid : tidSet.getAll() )
+		key += std::format( "{}#{};", Enum::enum_name( tid.type ), tid.id.value_or( "*" ) );
+	return key;
+}
+
+}
+
+LiveMarketUpdater::~LiveMarketUpdater()
+{
+	stop();
+}
+
 void LiveMarketUpdater::start()
 {
+	Instr::Timer tmTotal;
+
 	const bool hasBaseline = m_mktSrcDSH.size();
-	m_state = hasBaseline ? State::BUFFERING : State::LIVE;
+
+	// A second start() would replace threads that are still running
+	State expected = State::INIT;
+	if( !m_state.compare_exchange_strong( expected, hasBaseline ? State::BUFFERING : State::LIVE ) )
+		throw ARQException( std::format( "LiveMarketUpdater: start() called more than once for Mkt [{}]", m_mktName.str() ) );
+
+	m_applyThread = std::thread( &LiveMarketUpdater::runApplyLoop, this );
+	if( m_snapshotCache && m_snapshotCacheInterval.count() > 0 )
+	{
+		m_lastCacheSave   = std::chrono::steady_clock::now();
+		m_cacheSaveThread = std::thread( &LiveMarketUpdater::runCacheSaveLoop, this );
+	}
 
 	const std::string mktNameStr = m_mktName.str();
 	m_msgSub = m_msgSvc->subscribe( std::string( SUB_TOPIC_PFX ) + mktNameStr, shared_from_this() );
 
 	if( hasBaseline )
 	{
-		auto offsetSrc = StreamOffsetSourceFactory::inst().create( m_mktSrcDSH );
-		auto mktSrc    = MarketSourceFactory::inst().create( m_mktSrcDSH );
+		auto records = loadBaseline( mktNameStr );
 
-		// Load baseline market along with its offsets
-
-		auto offsets = offsetSrc->getOffsets( std::format( "{}:{}", MARKETS_KEY_NAMESPACE, mktNameStr ) );
-		if( offsets )
-			m_offsets = convertOffsets( std::move( *offsets ) );
-		auto records = mktSrc->load( mktNameStr, m_mktSrcTIDSet );
+		Instr::Timer tmApply;
+		m_baselineLoadStats.numRecords = records.size();
 		m_mkt->update( std::move( records ) );
 
 		// Grab lock to prevent new updates being buffered
-		// Iterate through buffered updates and apply to the market
-		// Then set state to LIVE so that new updates are applied directly to the market
+		// Group commit the buffered updates to the market
+		// Then set state to LIVE so that new updates are queued for the apply thread
 		{
 			std::lock_guard<std::mutex> lg( m_bufferedUpdatesMutex );
-			for( auto& updateBatch : m_bufferedUpdates )
-				applyUpdate( std::move( updateBatch ) );
+			const size_t numBuffered = m_bufferedUpdates.size();
+			if( numBuffered )
+				applyUpdates( std::move( m_bufferedUpdates ) );
 
 			m_bufferedUpdates.clear();
-			
+			markApplied( numBuffered );
+
 			m_state = State::LIVE;
 		}
+
+		// Resyncs started while reconciling are only handed to the apply thread from here on, as until now the market was being updated on this one
+		bool wake;
+		{
+			std::lock_guard<std::mutex> lock( m_resyncMutex );
+			m_wakeOnResync = true;
+			wake           = m_resyncResults.size();
+		}
+		if( wake )
+			wakeApplyThread();
+
+		m_baselineLoadStats.apply = tmApply.duration();
+		m_baselineLoadStats.total = tmTotal.duration();
+
+		const auto toMs = [] ( const std::chrono::nanoseconds ns ) { return std::chrono::duration<double, std::milli>( ns ).count(); };
+
+		Log( Module::MKT ).info( "LiveMarketUpdater: Loaded baseline of {} records ({} from the snapshot cache) for Mkt [{}] in {:.1f}ms (offsets: {:.1f}ms, cache: {:.1f}ms, records: {:.1f}ms, apply: {:.1f}ms)",
+			m_baselineLoadStats.numRecords, m_baselineLoadStats.numCachedRecords, mktNameStr, toMs( m_baselineLoadStats.total ), toMs( m_baselineLoadStats.offsets ),
+			toMs( m_baselineLoadStats.cache ), toMs( m_baselineLoadStats.records ), toMs( m_baselineLoadStats.apply ) );
+		for( const BaselineLoadStats::TypeLoad& typeLoad : m_baselineLoadStats.types )
+			Log( Module::MKT ).info( "LiveMarketUpdater: Loaded {} {} records for Mkt [{}] in {:.1f}ms", typeLoad.numRecords, Enum::enum_name( typeLoad.type ), mktNameStr, toMs( typeLoad.duration ) );
+	}
+}
+
+RecordCollection LiveMarketUpdater::loadBaseline( const std::string& mktNameStr )
+{
+	auto offsetSrc = StreamOffsetSourceFactory::inst().create( m_mktSrcDSH );
+	auto mktSrc    = MarketSourceFactory::inst().create( m_mktSrcDSH );
+
+	// Read the snapshot cache, if there is one, on its own thread while the offsets load. Problems with the file are logged and leave it unused
+	std::future<std::optional<MarketSnapshotCache::Contents>> cacheFuture;
+	if( m_snapshotCache )
+	{
+		cacheFuture = std::async( std::launch::async, [this] ()
+		{
+			Instr::Timer tm;
+			auto cached = m_snapshotCache->load();
+			m_baselineLoadStats.cache = tm.duration();
+			return cached;
+		} );
+	}
+
+	RecordCollection                           records;
+	std::optional<StreamTopicPartitionOffsets> offsets;
+	ARQ_DO_IN_TRY( arqExc, errMsg )
+		// Offsets first, so the records are at least as new as them - anything buffered past them is reconciled on top, and anything
+		// the records already cover is dropped as stale. Loading them alongside the records could pair old offsets with newer records
+		Instr::Timer tmOffsets;
+		offsets = offsetSrc->getOffsets( std::format( "{}:{}", MARKETS_KEY_NAMESPACE, mktNameStr ) );
+		m_baselineLoadStats.offsets = tmOffsets.duration();
+
+		std::optional<MarketSnapshotCache::Contents> cached;
+		if( cacheFuture.valid() )
+			cached = cacheFuture.get();
+
+		Instr::Timer tmRecords;
+		if( cached )
+			records = loadBaselineFromCache( *mktSrc, mktNameStr, std::move( *cached ), offsets );
+		else
+			records = m_parallelTypeLoads ? loadBaselineByType( *mktSrc, mktNameStr ) : mktSrc->load( mktNameStr, m_mktSrcTIDSet );
+		m_baselineLoadStats.records = tmRecords.duration();
+	ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+	// Always wait on the cache read before leaving, the task refers to members
+	if( cacheFuture.valid() )
+		cacheFuture.wait();
+
+	if( arqExc.what().size() )
+		throw arqExc;
+	if( errMsg.size() )
+		throw ARQException( std::format( "LiveMarketUpdater: Error loading baseline for Mkt [{}]: {}", mktNameStr, errMsg ) );
+
+	if( offsets )
+		resolveOffsets( *offsets, m_offsets );
+
+	return records;
+}
+
+RecordCollection LiveMarketUpdater::loadBaselineByType( IMarketSource& mktSrc, const std::string& mktNameStr, const std::unordered_set<Type>* onlyTypes )
+{
+	struct TypeLoad
+	{
+		std::future<RecordCollection> records;
+		std::chrono::nanoseconds      duration {};
+	};
+
+	// Each type is loaded on its own thread, and so over its own source connection - the baseline takes as long as the largest type rather than the sum of them
+	std::unordered_map<Type, TypeLoad> typeLoads;
+
+	RecordCollection records;
+	records.visitVectors( [this, &mktSrc, &mktNameStr, onlyTypes, &typeLoads] <c_MktData T> ( std::vector<Record<T>>& )
+	{
+		constexpr Type type = Traits<T>::typeEnum();
+		if( onlyTypes && !onlyTypes->contains( type ) )
+			return;
+
+		// Narrowed here rather than on the loading thread as TIDSet consolidates lazily
+		TIDSet typeFilter;
+		if( !narrowFilter( type, typeFilter ) )
+			return;
+
+		TypeLoad& typeLoad = typeLoads[type];
+		typeLoad.records = std::async( std::launch::async, [&mktSrc, &mktNameStr, &typeLoad, typeFilter = std::move( typeFilter )] ()
+		{
+			Instr::Timer tm;
+			RecordCollection loaded = mktSrc.load( mktNameStr, typeFilter );
+			typeLoad.duration = tm.duration();
+			return loaded;
+		} );
+	} );
+
+	// Wait on every type before rethrowing anything, the loads refer to locals here
+	for( auto& [_, typeLoad] : typeLoads )
+		typeLoad.records.wait();
+
+	records.visitVectors( [this, &typeLoads] <c_MktData T> ( std::vector<Record<T>>& vector )
+	{
+		const auto it = typeLoads.find( Traits<T>::typeEnum() );
+		if( it == typeLoads.end() )
+			return;
+
+		// Only take this type out of the load, in case the source returns more than it was asked for
+		vector = std::move( it->second.records.get().template get<Record<T>>() );
+		m_baselineLoadStats.types.push_back( BaselineLoadStats::TypeLoad{ Traits<T>::typeEnum(), it->second.duration, vector.size() } );
+	} );
+
+	return records;
+}
+
+bool LiveMarketUpdater::narrowFilter( const Type type, TIDSet& filter ) const
+{
+	// Adds the part of the market source filter covering just this type - false if it excludes the type altogether
+	const TIDSet::IDs idSpec = m_mktSrcTIDSet.empty() ? TIDSet::All{} : m_mktSrcTIDSet.getIDsForType( type );
+	if( std::holds_alternative<TIDSet::None>( idSpec ) )
+		return false;
+	else if( std::holds_alternative<TIDSet::All>( idSpec ) )
+		filter.insert( TID( type ) );
+	else if( const TIDSet::IDList* list = std::get_if<TIDSet::IDList>( &idSpec ) )
+	{
+		for( const std::string_view id : *list )
+			filter.insert( TID( type, std::string( id ) ) );
+	}
+
+	return true;
+}
+
+RecordCollection LiveMarketUpdater::loadBaselineFromCache( IMarketSource& mktSrc, const std::string& mktNameStr, MarketSnapshotCache::Contents&& cached, std::optional<StreamTopicPartitionOffsets>& offsets )
+{
+	const auto loadAll = [this, &mktSrc, &mktNameStr] ()
+	{
+		return m_parallelTypeLoads ? loadBaselineByType( mktSrc, mktNameStr ) : mktSrc.load( mktNameStr, m_mktSrcTIDSet );
+	};
+
+	// Without the source's offsets there's no telling what has changed since the cache was saved
+	if( !offsets )
+	{
+		Log( Module::MKT ).warn( "LiveMarketUpdater: No offsets in the market source for Mkt [{}] - not using the snapshot cache", mktNameStr );
+		return loadAll();
+	}
+
+	TypeOffsets srcOffsets;
+	TypeOffsets cachedOffsets;
+	resolveOffsets( *offsets, srcOffsets );
+	resolveOffsets( cached.offsets, cachedOffsets );
+
+	// The source only tracks offsets per entity type, so a type is reloaded whole if the source has moved on past the cache on any of its partitions.
+	// A type the cache has no offsets for can't be vouched for either
+	std::unordered_set<Type> staleTypes;
+	size_t                   numTypes = 0;
+	cached.records.visitVectors( [&srcOffsets, &cachedOffsets, &staleTypes, &numTypes] <c_MktData T> ( std::vector<Record<T>>& )
+	{
+		constexpr Type type = Traits<T>::typeEnum();
+		++numTypes;
+
+		const PartitionOffsets& typeCachedOffsets = cachedOffsets[static_cast<size_t>( type )];
+		if( typeCachedOffsets.empty() || isAnyNewer( typeCachedOffsets, srcOffsets[static_cast<size_t>( type )] ) )
+			staleTypes.insert( type );
+	} );
+
+	if( staleTypes.size() == numTypes )
+	{
+		Log( Module::MKT ).info( "LiveMarketUpdater: Snapshot cache for Mkt [{}] saved at {} is behind the market source for every type - loading in full", mktNameStr, cached.savedTs );
+		return loadAll();
 	}
+
+	RecordCollection records;
+	if( staleTypes.size() )
+		records = loadBaselineByType( mktSrc, mktNameStr, &staleTypes );
+
+	// Everything else comes from the cache, resuming from the cache's offsets - these are at or past the source's
+	cached.records.visitVectors( [this, &records, &cached, &staleTypes, &offsets] <c_MktData T> ( std::vector<Record<T>>& cachedRecords )
+	{
+		constexpr Type type = Traits<T>::typeEnum();
+		if( staleTypes.contains( type ) )
+			return;
+
+		m_baselineLoadStats.numCachedRecords += cachedRecords.size();
+		records.get<Record<T>>() = std::move( cachedRecords );
+
+		const std::string_view topic = getUpdateTopic( type );
+		for( const auto& [tp, offset] : cached.offsets )
+		{
+			if( tp.first == topic )
+				( *offsets )[tp] = offset;
+		}
+	} );
+
+	Log( Module::MKT ).info( "LiveMarketUpdater: Warm started Mkt [{}] from the snapshot cache saved at {} - {} records from the cache, {} type(s) reloaded from the market source",
+		mktNameStr, cached.savedTs, m_baselineLoadStats.numCachedRecords, staleTypes.size() );
+
+	return records;
+}
+
+std::unique_ptr<MarketSnapshotCache> LiveMarketUpdater::makeSnapshotCache( const Params& params, const std::shared_ptr<Serialiser>& serialiser )
+{
+	if( params.snapshotCachePath.empty() )
+		return nullptr;
+
+	// A cache saved with other filters holds a different set of records, so the filters are part of the key
+	const std::string key = std::format( "{}|{}|{}", params.mktName.str(), tidSetKey( params.mktSrcTIDSet ), tidSetKey( params.msgTIDSet ) );
+	return std::make_unique<MarketSnapshotCache>( params.snapshotCachePath, key, serialiser );
 }
 
 void LiveMarketUpdater::stop()
 {
 	if( m_msgSub )
 		m_msgSub->unsubscribe();
+
+	// Anything already queued is still applied before the apply thread exits
+	m_applyQueue.close();
+	bool applyStopped = false;
+	if( m_applyThread.joinable() )
+	{
+		if( m_applyThread.get_id() != std::this_thread::get_id() )
+		{
+			m_applyThread.join();
+			applyStopped = true;
+		}
+		else
+			m_applyThread.detach();
+	}
+
+	// Any resync still running gives up at its next retry - whatever it loads is never applied now
+	{
+		std::lock_guard<std::mutex> lock( m_resyncMutex );
+		m_stopping = true;
+	}
+	m_resyncCV.notify_all();
+	for( std::future<void>& task : m_resyncTasks )
+		task.wait();
+	m_resyncTasks.clear();
+
+	m_cacheSaveQueue.close();
+	if( m_cacheSaveThread.joinable() )
+		m_cacheSaveThread.join();
+
+	// Save a final snapshot - with the apply thread gone the market and m_offsets can't move underneath it.
+	// Only once LIVE, as a baseline that never finished loading would be saved as if it were complete
+	if( applyStopped && m_snapshotCache && m_state == State::LIVE )
+		saveSnapshotCache( *m_mkt->snapshot(), toStreamOffsets( m_offsets ) );
+}
+
+void LiveMarketUpdater::flush()
+{
+	const uint64_t target = m_batchesReceived.load();
+
+	std::unique_lock<std::mutex> lock( m_appliedMutex );
+	m_appliedCV.wait( lock, [this, target] () { return m_batchesApplied >= target || m_applyLoopExited; } );
+}
+
+LiveMarketUpdater::Stats LiveMarketUpdater::getStats() const
+{
+	Stats stats {
+		.queueDepth      = m_applyQueue.size(),
+		.maxQueueDepth   = m_maxQueueDepth.load( std::memory_order_relaxed ),
+		.batchesReceived = m_batchesReceived.load( std::memory_order_relaxed ),
+		.batchesDropped  = m_batchesDropped.load( std::memory_order_relaxed ),
+		.batchesApplied  = 0,
+		.marketUpdates   = m_marketUpdates.load( std::memory_order_relaxed ),
+		.recordsReceived = m_recordsReceived.load( std::memory_order_relaxed ),
+		.recordsApplied  = m_recordsApplied.load( std::memory_order_relaxed ),
+		.gapsDetected    = m_gapsDetected.load( std::memory_order_relaxed ),
+		.resyncs         = m_resyncsDone.load( std::memory_order_relaxed ),
+		.resyncFailures  = m_resyncFailures.load( std::memory_order_relaxed ),
+		.resyncsActive   = m_resyncsActive.load( std::memory_order_relaxed )
+	};
+
+	const MarketUpdateDecoder::Stats decoderStats = m_updateDecoder.getStats();
+	stats.seqGaps     = decoderStats.seqGaps;
+	stats.deltaMisses = decoderStats.deltaMisses;
+
+	{
+		std::lock_guard<std::mutex> lock( m_appliedMutex );
+		stats.batchesApplied = m_batchesApplied;
+	}
+
+	return stats;
 }
 
 void LiveMarketUpdater::onMsg( Message&& msg )
@@ -53,7 +393,22 @@ void LiveMarketUpdater::onMsg( Message&& msg )
 	MarketUpdateBatch batch;
 	try
 	{
-		batch = m_serialiser->deserialise<MarketUpdateBatch>( msg.data );
+		// Chunks are put back together, and delta encoded records filled in, before anything else sees them
+		std::vector<Type> deltaMissTypes;
+		std::optional<MarketUpdateBatch> decoded = m_updateDecoder.decode( msg, &deltaMissTypes );
+
+		// A delta encoded record with no base was dropped while its batch's offsets still move on, so its type is resynced as for a
+		// dropped batch - flagged before the batch is queued so the apply thread starts the resync ahead of applying it
+		if( deltaMissTypes.size() && m_mktSrcDSH.size() )
+		{
+			for( const Type type : deltaMissTypes )
+				m_droppedTypes[static_cast<size_t>( type )].store( true, std::memory_order_relaxed );
+		}
+
+		if( !decoded )
+			return;
+
+		batch = std::move( *decoded );
 	}
 	catch( const ARQException& e )
 	{
@@ -61,91 +416,564 @@ void LiveMarketUpdater::onMsg( Message&& msg )
 		return;
 	}
 
-	switch( m_state )
+	m_recordsReceived.fetch_add( batch.records.size(), std::memory_order_relaxed );
+
+	if( m_state == State::BUFFERING )
 	{
-		case State::BUFFERING:
+		std::lock_guard<std::mutex> lg( m_bufferedUpdatesMutex );
+		// Re-check under the lock - start() may have just finished reconciling and gone LIVE
+		if( m_state == State::BUFFERING )
 		{
-			std::lock_guard<std::mutex> lg( m_bufferedUpdatesMutex );
+			m_batchesReceived.fetch_add( 1 );
 			m_bufferedUpdates.emplace_back( std::move( batch ) );
-			break;
+			return;
+		}
+	}
+
+	if( m_state != State::LIVE )
+		return;
+
+	// Count before pushing so a concurrent flush() never misses a batch the apply thread may already be processing
+	m_batchesReceived.fetch_add( 1 );
+	if( !m_applyQueue.tryPush( std::move( batch ) ) )
+	{
+		if( m_applyQueue.isClosed() )
+		{
+			markApplied( 1 ); // Queue closed - we're stopping so the batch is dropped
+			return;
 		}
-		case State::LIVE:
-			applyUpdate( std::move( batch ) );
-			break;
-		default:
-			break;
+
+		// Queue full - rather than hold up the messaging thread the batch is dropped and its types resynced, as for any other gap.
+		// Without a market source to resync from there's no recovering a dropped batch, so wait for room instead
+		if( m_mktSrcDSH.size() )
+		{
+			dropBatch( batch );
+			markApplied( 1 );
+			return;
+		}
+
+		if( !m_applyQueue.push( std::move( batch ) ) )
+		{
+			markApplied( 1 );
+			return;
+		}
+	}
+
+	const size_t depth   = m_applyQueue.size();
+	size_t       prevMax = m_maxQueueDepth.load( std::memory_order_relaxed );
+	while( depth > prevMax && !m_maxQueueDepth.compare_exchange_weak( prevMax, depth, std::memory_order_relaxed ) );
+}
+
+void LiveMarketUpdater::runApplyLoop()
+{
+	std::vector<MarketUpdateBatch> pending;
+	while( m_applyQueue.popAll( pending ) )
+	{
+		const size_t numBatches = pending.size();
+
+		ARQ_DO_IN_TRY( arqExc, errMsg )
+			applyCompletedResyncs( pending );
+			resyncDroppedTypes();
+			applyUpdates( std::move( pending ) );
+		ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+		if( arqExc.what().size() )
+			Log( Module::MKT ).error( arqExc, "LiveMarketUpdater: Exception applying {} update batch(es) to Mkt [{}]", numBatches, m_mktName.str() );
+		else if( errMsg.size() )
+			Log( Module::MKT ).error( "LiveMarketUpdater: Error applying {} update batch(es) to Mkt [{}]: {}", numBatches, m_mktName.str(), errMsg );
+
+		pending.clear();
+		markApplied( numBatches );
+
+		maybeQueueCacheSave();
+	}
+
+	// Wake any flush() waiting on batches that will now never be applied
+	{
+		std::lock_guard<std::mutex> lock( m_appliedMutex );
+		m_applyLoopExited = true;
+	}
+	m_appliedCV.notify_all();
+}
+
+void LiveMarketUpdater::dropBatch( const MarketUpdateBatch& batch )
+{
+	batch.records.visitVectors( [this] <c_MktData T> ( const std::vector<Record<T>>& records )
+	{
+		if( records.size() )
+			m_droppedTypes[static_cast<size_t>( Traits<T>::typeEnum() )].store( true, std::memory_order_relaxed );
+	} );
+
+	// Types with offsets but no records left after conflation still moved on in the stream
+	for( const auto& [tp, _] : batch.offsets )
+	{
+		if( const auto it = topicTypes().find( tp.first ); it != topicTypes().end() )
+			m_droppedTypes[static_cast<size_t>( it->second )].store( true, std::memory_order_relaxed );
+	}
+
+	const uint64_t numDropped = m_batchesDropped.fetch_add( 1, std::memory_order_relaxed ) + 1;
+	if( ( numDropped & ( numDropped - 1 ) ) == 0 ) // Log on powers of two so a sustained overflow doesn't flood the log
+		Log( Module::MKT ).warn( "LiveMarketUpdater: Apply queue full for Mkt [{}] - dropped {} update batch(es) so far, resyncing the types they covered", m_mktName.str(), numDropped );
+}
+
+void LiveMarketUpdater::maybeQueueCacheSave()
+{
+	if( !m_cacheSaveThread.joinable() )
+		return;
+
+	const auto now = std::chrono::steady_clock::now();
+	if( now - m_lastCacheSave < m_snapshotCacheInterval )
+		return;
+
+	// If the last save is still being written this one is skipped, and tried again after the next apply
+	if( m_cacheSaveQueue.tryPush( CacheSave{ m_mkt->snapshot(), toStreamOffsets( m_offsets ) } ) )
+		m_lastCacheSave = now;
+}
+
+void LiveMarketUpdater::runCacheSaveLoop()
+{
+	std::vector<CacheSave> pending;
+	while( m_cacheSaveQueue.popAll( pending ) )
+	{
+		saveSnapshotCache( *pending.back().snapshot, pending.back().offsets );
+		pending.clear();
 	}
 }
 
-void LiveMarketUpdater::applyUpdate( MarketUpdateBatch&& updateBatch )
+void LiveMarketUpdater::saveSnapshotCache( const MarketSnapshot& snapshot, const StreamTopicPartitionOffsets& offsets ) const
+{
+	Instr::Timer tm;
+
+	ARQ_DO_IN_TRY( arqExc, errMsg )
+		m_snapshotCache->save( snapshot, offsets );
+	ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+	if( arqExc.what().size() )
+		Log( Module::MKT ).error( arqExc, "LiveMarketUpdater: Exception saving snapshot cache for Mkt [{}] to {}", m_mktName.str(), m_snapshotCache->path().string() );
+	else if( errMsg.size() )
+		Log( Module::MKT ).error( "LiveMarketUpdater: Error saving snapshot cache for Mkt [{}] to {}: {}", m_mktName.str(), m_snapshotCache->path().string(), errMsg );
+	else
+		Log( Module::MKT ).info( "LiveMarketUpdater: Saved snapshot version {} of Mkt [{}] to the snapshot cache in {:.1f}ms",
+			snapshot.version(), m_mktName.str(), std::chrono::duration<double, std::milli>( tm.duration() ).count() );
+}
+
+void LiveMarketUpdater::markApplied( const size_t numBatches )
 {
-	MktEntity2OffsetsMap offsetUpdates;
-	MktEntity2OffsetsMap batchOffsets = convertOffsets( std::move( updateBatch.offsets ) );
-	updateBatch.records.visitVectors( [this, &batchOffsets, &offsetUpdates] <c_MktData T> ( std::vector<Record<T>>& newRecords )
 	{
-		// Drop records if offsets are old
-		StreamTopicPartitionOffsets& tpOffsetsInBatch = batchOffsets[Traits<T>::typeEnum()];
-		if( auto it = m_offsets.find( Traits<T>::typeEnum() ); it != m_offsets.end() )
+		std::lock_guard<std::mutex> lock( m_appliedMutex );
+		m_batchesApplied += numBatches;
+	}
+	m_appliedCV.notify_all();
+}
+
+void LiveMarketUpdater::applyUpdates( std::vector<MarketUpdateBatch>&& updateBatches )
+{
+	// Group commit - every batch is filtered in stream order then merged into a single Market::update.
+	// Within the merged batch the latest record per id wins, mirroring what applying the batches one by one would leave behind
+	RecordCollection  merged;
+	bool              anyAccepted = false;
+	std::vector<Type> gapTypes;
+
+	// Only with a market source to resync from - otherwise the gap is carried on past as before
+	const bool detectGaps = m_mktSrcDSH.size();
+
+	for( MarketUpdateBatch& updateBatch : updateBatches )
+	{
+		// Nothing in it - e.g. a resync waking the apply thread
+		if( updateBatch.records.empty() && updateBatch.offsets.empty() )
+			continue;
+
+		resolveOffsets( updateBatch.offsets, m_batchOffsets );
+		resolveOffsets( updateBatch.prevOffsets, m_batchPrevOffsets );
+
+		// Keeps just this type's slice of the batch for when its resync completes
+		const auto holdBack = [this, &updateBatch] <c_MktData T> ( std::vector<Record<T>>& newRecords )
 		{
-			if( !isOffsetsNewer( it->second, tpOffsetsInBatch ) )
+			constexpr std::string_view topic = Topics<T>::updateTopic();
+
+			MarketUpdateBatch slice;
+			for( const auto& [tp, offset] : updateBatch.offsets )
 			{
-				newRecords.clear();
+				if( tp.first == topic )
+					slice.offsets.emplace( tp, offset );
+			}
+			if( newRecords.empty() && slice.offsets.empty() )
 				return;
+
+			for( const auto& [tp, offset] : updateBatch.prevOffsets )
+			{
+				if( tp.first == topic )
+					slice.prevOffsets.emplace( tp, offset );
+			}
+			slice.marketName = updateBatch.marketName;
+			slice.records.get<Record<T>>() = std::move( newRecords );
+			m_resyncs[static_cast<size_t>( Traits<T>::typeEnum() )].heldBack.push_back( std::move( slice ) );
+		};
+
+		updateBatch.records.visitVectors( [this, &merged, &anyAccepted, &gapTypes, detectGaps, &holdBack] <c_MktData T> ( std::vector<Record<T>>& newRecords )
+		{
+			constexpr size_t typeIdx = static_cast<size_t>( Traits<T>::typeEnum() );
+
+			// Held back until the type's resync completes, then replayed on top of it
+			TypeResync& resync = m_resyncs[typeIdx];
+			if( resync.active )
+			{
+				holdBack( newRecords );
+				return;
+			}
+
+			// Drop records if offsets are old
+			PartitionOffsets&       currentOffsets = m_offsets[typeIdx];
+			const PartitionOffsets& batchOffsets   = m_batchOffsets[typeIdx];
+			if( !currentOffsets.empty() && !isAnyNewer( currentOffsets, batchOffsets ) )
+				return;
+
+			// A batch before this one never arrived - resync the type rather than apply on top of the hole
+			if( detectGaps && hasGap( currentOffsets, m_batchPrevOffsets[typeIdx] ) )
+			{
+				resync.active = true;
+				gapTypes.push_back( Traits<T>::typeEnum() );
+				holdBack( newRecords );
+				return;
+			}
+
+			// Filter update by TIDSet
+			if( !m_msgFilter.empty() && newRecords.size() )
+			{
+				constexpr Type type = Traits<T>::typeEnum();
+
+				if( m_msgFilter.matchesNone( type ) )
+					newRecords.clear();
+				else if( !m_msgFilter.matchesAll( type ) )
+				{
+					std::erase_if( newRecords, [this] ( const Record<T>& rec )
+					{
+						return !m_msgFilter.matches( type, rec.header.id );
+					} );
+				}
+			}
+
+			anyAccepted = true;
+			advance( currentOffsets, batchOffsets );
+
+			std::vector<Record<T>>& mergedRecords = merged.get<Record<T>>();
+			if( mergedRecords.empty() )
+				mergedRecords = std::move( newRecords );
+			else
+				mergedRecords.insert( mergedRecords.end(), std::make_move_iterator( newRecords.begin() ), std::make_move_iterator( newRecords.end() ) );
+		} );
+	}
+
+	if( gapTypes.size() )
+		startResync( std::move( gapTypes ) );
+
+	if( !anyAccepted )
+		return;
+
+	// Conflate - keep the latest record per id. Equal timestamps are won by the later record, as Market::update would do
+	if( updateBatches.size() > 1 )
+	{
+		merged.visitVectors( [] <c_MktData T> ( std::vector<Record<T>>& records )
+		{
+			if( records.size() < 2 )
+				return;
+
+			ankerl::unordered_dense::map<std::string_view, size_t> latestIdx;
+			latestIdx.reserve( records.size() );
+			for( size_t i = 0; i < records.size(); ++i )
+			{
+				const auto [it, inserted] = latestIdx.try_emplace( records[i].header.id, i );
+				if( !inserted && records[i].header.asofTs >= records[it->second].header.asofTs )
+					it->second = i;
+			}
+
+			if( latestIdx.size() == records.size() )
+				return;
+
+			std::vector<bool> keep( records.size(), false );
+			for( const auto& [_, idx] : latestIdx )
+				keep[idx] = true;
+
+			// Compact in place, preserving stream order of the survivors
+			size_t out = 0;
+			for( size_t i = 0; i < records.size(); ++i )
+			{
+				if( !keep[i] )
+					continue;
+
+				if( out != i )
+					records[out] = std::move( records[i] );
+				++out;
 			}
+			records.erase( records.begin() + out, records.end() );
+		} );
+	}
+
+	m_recordsApplied.fetch_add( merged.size(), std::memory_order_relaxed );
+	m_marketUpdates.fetch_add( 1, std::memory_order_relaxed );
+	m_mkt->update( std::move( merged ) );
+}
+
+void LiveMarketUpdater::startResync( std::vector<Type>&& types )
+{
+	std::string typeNames;
+	for( const Type type : types )
+		typeNames += std::string( typeNames.empty() ? "" : ", " ) + std::string( Enum::enum_name( type ) );
+
+	m_gapsDetected.fetch_add( types.size(), std::memory_order_relaxed );
+	m_resyncsActive.fetch_add( types.size(), std::memory_order_relaxed );
+	Log( Module::MKT ).warn( "LiveMarketUpdater: Missed an update batch for {} in Mkt [{}] - resyncing from the market source", typeNames, m_mktName.str() );
+
+	// Narrowed here rather than on the resync task as TIDSet consolidates lazily
+	TIDSet filter;
+	for( const Type type : types )
+		std::ignore = narrowFilter( type, filter );
+
+	std::erase_if( m_resyncTasks, [] ( const std::future<void>& task ) { return task.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready; } );
+	m_resyncTasks.push_back( std::async( std::launch::async, [this, types = std::move( types ), filter = std::move( filter )] () mutable
+	{
+		ResyncResult result = loadResync( std::move( types ), filter );
+		bool wake;
+		{
+			std::lock_guard<std::mutex> lock( m_resyncMutex );
+			m_resyncResults.push_back( std::move( result ) );
+			wake = m_wakeOnResync;
 		}
 
-		// Filter update by TIDSet
-		if( !m_msgTIDSet.empty() && newRecords.size() )
+		if( wake )
+			wakeApplyThread();
+	} ) );
+}
+
+void LiveMarketUpdater::resyncDroppedTypes()
+{
+	// A type already resyncing keeps its flag until that resync completes - its load may have been read before the dropped batch was stored
+	std::vector<Type> types;
+	for( size_t typeIdx = 0; typeIdx < NUM_TYPES; ++typeIdx )
+	{
+		if( m_resyncs[typeIdx].active || !m_droppedTypes[typeIdx].exchange( false, std::memory_order_relaxed ) )
+			continue;
+
+		m_resyncs[typeIdx].active = true;
+		types.push_back( static_cast<Type>( typeIdx ) );
+	}
+
+	if( types.size() )
+		startResync( std::move( types ) );
+}
+
+void LiveMarketUpdater::wakeApplyThread()
+{
+	// An empty batch, so a resync result is picked up even if no more updates arrive.
+	// Counted as received first, as onMsg() does, so a concurrent flush() waits for it
+	m_batchesReceived.fetch_add( 1 );
+	if( !m_applyQueue.push( MarketUpdateBatch() ) )
+		markApplied( 1 );
+}
+
+LiveMarketUpdater::ResyncResult LiveMarketUpdater::loadResync( std::vector<Type>&& types, const TIDSet& filter )
+{
+	ResyncResult  result { .types = std::move( types ) };
+	BackoffPolicy backoff( m_resyncBackoff );
+	while( true )
+	{
+		ARQ_DO_IN_TRY( arqExc, errMsg )
+			// Offsets first, so the records are at least as new as them - anything held back past them is replayed on top
+			result.offsets = StreamOffsetSourceFactory::inst().create( m_mktSrcDSH )->getOffsets( std::format( "{}:{}", MARKETS_KEY_NAMESPACE, m_mktName.str() ) );
+			if( !filter.empty() )
+				result.records = MarketSourceFactory::inst().create( m_mktSrcDSH )->load( m_mktName.str(), filter );
+		ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+		result.error = arqExc.what().size() ? std::string( arqExc.what() ) : errMsg;
+		if( result.error.empty() )
+			return result;
+
+		const std::optional<BackoffPolicy::Duration> delay = backoff.nextDelay();
+		if( !delay )
+			return result;
+
+		Log( Module::MKT ).warn( "LiveMarketUpdater: Failed to resync Mkt [{}] - trying again in {}ms ({}): {}", m_mktName.str(), delay->count(), backoff.attemptStr(), result.error );
+
+		std::unique_lock<std::mutex> lock( m_resyncMutex );
+		if( m_resyncCV.wait_for( lock, *delay, [this] () { return m_stopping; } ) )
+			return result;
+	}
+}
+
+void LiveMarketUpdater::applyCompletedResyncs( std::vector<MarketUpdateBatch>& pending )
+{
+	std::vector<ResyncResult> results;
+	{
+		std::lock_guard<std::mutex> lock( m_resyncMutex );
+		results.swap( m_resyncResults );
+	}
+
+	std::vector<MarketUpdateBatch> replay;
+	for( ResyncResult& result : results )
+	{
+		if( result.error.empty() )
 		{
-			auto allowedIDs = m_msgTIDSet.getIDsForType( Traits<T>::typeEnum() );
+			TypeOffsets srcOffsets;
+			if( result.offsets )
+				resolveOffsets( *result.offsets, srcOffsets );
 
-			if( std::holds_alternative<TIDSet::None>( allowedIDs ) )
-				newRecords.clear();
-			else if( auto* listPtr = std::get_if<TIDSet::IDList>( &allowedIDs ) )
+			// Only take the resynced types out of the load, in case the source returns more than it was asked for
+			const auto       snapshot  = m_mkt->snapshot();
+			size_t           numErased = 0;
+			RecordCollection records;
+			records.visitVectors( [&result, &srcOffsets, &snapshot, &numErased, this] <c_MktData T> ( std::vector<Record<T>>& typeRecords )
 			{
-				std::erase_if( newRecords, [&listPtr] ( const Record<T>& rec )
+				constexpr Type   type    = Traits<T>::typeEnum();
+				constexpr size_t typeIdx = static_cast<size_t>( type );
+				if( std::ranges::find( result.types, type ) == result.types.end() )
+					return;
+
+				typeRecords = std::move( result.records.template get<Record<T>>() );
+
+				// The source drops inactive records rather than keeping them, so an id deleted during the gap is just missing from the reload -
+				// erase what the market still holds for it. Only once the source has caught up with everything applied to the type, as until then
+				// a missing id may be one it hasn't seen yet
+				PartitionOffsets& currentOffsets = m_offsets[typeIdx];
+				if( !isAnyNewer( srcOffsets[typeIdx], currentOffsets ) )
 				{
-					return std::find( listPtr->begin(), listPtr->end(), rec.header.id ) == listPtr->end();
-				} );
+					ankerl::unordered_dense::set<std::string_view> reloadedIDs;
+					reloadedIDs.reserve( typeRecords.size() );
+					for( const Record<T>& rcd : typeRecords )
+						reloadedIDs.insert( rcd.header.id );
+
+					std::vector<Record<T>> erases;
+					snapshot->template forEach<T>( [this, &reloadedIDs, &erases] ( const Record<T>& rcd )
+					{
+						if( reloadedIDs.contains( rcd.header.id ) || ( !m_mktSrcFilter.empty() && !m_mktSrcFilter.matches( type, rcd.header.id ) ) )
+							return;
+
+						Record<T>& erase = erases.emplace_back();
+						erase.header.id       = rcd.header.id;
+						erase.header.asofTs   = rcd.header.asofTs; // Not older than the record, so the market applies it
+						erase.header.isActive = false;
+					} );
+
+					numErased += erases.size();
+					typeRecords.insert( typeRecords.end(), std::make_move_iterator( erases.begin() ), std::make_move_iterator( erases.end() ) );
+				}
+
+				// Each partition only moves forward - anything already applied past the source stays applied
+				advance( currentOffsets, srcOffsets[typeIdx] );
+			} );
+
+			Log( Module::MKT ).info( "LiveMarketUpdater: Resynced {} records for {} type(s) in Mkt [{}] from the market source, erasing {} no longer in it",
+				records.size() - numErased, result.types.size(), m_mktName.str(), numErased );
+
+			m_recordsApplied.fetch_add( records.size(), std::memory_order_relaxed );
+			m_marketUpdates.fetch_add( 1, std::memory_order_relaxed );
+			m_resyncsDone.fetch_add( result.types.size(), std::memory_order_relaxed );
+			m_mkt->update( std::move( records ) );
+		}
+		else
+		{
+			// Carry on from the live stream over the gap, rather than resync again straight away on the batch that found it
+			Log( Module::MKT ).error( "LiveMarketUpdater: Giving up resyncing {} type(s) in Mkt [{}] - carrying on from the live stream: {}", result.types.size(), m_mktName.str(), result.error );
+			m_resyncFailures.fetch_add( result.types.size(), std::memory_order_relaxed );
+
+			for( const Type type : result.types )
+			{
+				for( const MarketUpdateBatch& heldBack : m_resyncs[static_cast<size_t>( type )].heldBack )
+				{
+					resolveOffsets( heldBack.prevOffsets, m_batchPrevOffsets );
+					advance( m_offsets[static_cast<size_t>( type )], m_batchPrevOffsets[static_cast<size_t>( type )] );
+				}
 			}
 		}
 
-		offsetUpdates[Traits<T>::typeEnum()] = std::move( tpOffsetsInBatch );
-	} );
+		for( const Type type : result.types )
+		{
+			TypeResync& resync = m_resyncs[static_cast<size_t>( type )];
+			resync.active = false;
+			replay.insert( replay.end(), std::make_move_iterator( resync.heldBack.begin() ), std::make_move_iterator( resync.heldBack.end() ) );
+			resync.heldBack.clear();
+		}
+		m_resyncsActive.fetch_sub( result.types.size(), std::memory_order_relaxed );
+	}
+
+	// Replayed ahead of anything newer - the usual offset checks drop whatever the resync already covers
+	if( replay.size() )
+		pending.insert( pending.begin(), std::make_move_iterator( replay.begin() ), std::make_move_iterator( replay.end() ) );
+}
 
-	// Update mkt state and offsets
-	if( offsetUpdates.size() )
+void LiveMarketUpdater::resolveOffsets( const StreamTopicPartitionOffsets& tpOffsets, TypeOffsets& out )
+{
+	// Cleared rather than reset so the arrays keep their capacity from one batch to the next
+	for( PartitionOffsets& partitionOffsets : out )
+		partitionOffsets.clear();
+
+	for( const auto& [tp, offset] : tpOffsets )
 	{
-		m_mkt->update( std::move( updateBatch.records ) );
-		for( auto& [k, v] : offsetUpdates )
-			m_offsets.insert_or_assign( k, std::move( v ) );
+		const auto it = topicTypes().find( tp.first );
+		if( it == topicTypes().end() )
+			throw ARQException( std::format( "LiveMarketUpdater: Offsets given for unknown update topic [{}]", tp.first ) );
+
+		PartitionOffsets& partitionOffsets = out[static_cast<size_t>( it->second )];
+		const size_t      partition        = static_cast<size_t>( tp.second );
+		if( partition >= partitionOffsets.size() )
+			partitionOffsets.resize( partition + 1, NO_OFFSET );
+
+		partitionOffsets[partition] = offset;
 	}
 }
 
-LiveMarketUpdater::MktEntity2OffsetsMap LiveMarketUpdater::convertOffsets( StreamTopicPartitionOffsets&& tpOffsets ) const
+StreamTopicPartitionOffsets LiveMarketUpdater::toStreamOffsets( const TypeOffsets& offsets )
 {
-	LiveMarketUpdater::MktEntity2OffsetsMap map;
+	StreamTopicPartitionOffsets tpOffsets;
+	for( size_t typeIdx = 0; typeIdx < offsets.size(); ++typeIdx )
+	{
+		const PartitionOffsets& partitionOffsets = offsets[typeIdx];
+		for( size_t partition = 0; partition < partitionOffsets.size(); ++partition )
+		{
+			if( partitionOffsets[partition] != NO_OFFSET )
+				tpOffsets.emplace( StreamTopicPartition( std::string( getUpdateTopic( static_cast<Type>( typeIdx ) ) ), static_cast<int32_t>( partition ) ), partitionOffsets[partition] );
+		}
+	}
+	return tpOffsets;
+}
 
-	for( auto& [tp, offset] : tpOffsets )
+bool LiveMarketUpdater::isAnyNewer( const PartitionOffsets& current, const PartitionOffsets& incoming )
+{
+	// True if incoming has AT LEAST ONE partition past current - partitions current hasn't seen count as newer
+	for( size_t partition = 0; partition < incoming.size(); ++partition )
 	{
-		const auto mktEntityType = getTypeFromUpdateTopic( tp.first );
-		StreamTopicPartitionOffsets& innerMap = map[mktEntityType];
-		innerMap.emplace( tp, offset );
+		if( incoming[partition] == NO_OFFSET )
+			continue;
+
+		if( partition >= current.size() || incoming[partition] > current[partition] )
+			return true;
 	}
 
-	return map;
+	return false;
 }
 
-bool LiveMarketUpdater::isOffsetsNewer( const StreamTopicPartitionOffsets& lhs, const StreamTopicPartitionOffsets& rhs ) const
+bool LiveMarketUpdater::hasGap( const PartitionOffsets& current, const PartitionOffsets& prev )
 {
-	// If the rhs contains AT LEAST ONE offset that is newer than lhs, return true
-	for( const auto& [tp, offset] : rhs )
+	// The batch before this one, on any of its partitions, ends past what has been applied - or on a partition with nothing applied yet
+	for( size_t partition = 0; partition < prev.size(); ++partition )
 	{
-		if( const auto it = lhs.find( tp ); it == lhs.end() || offset > it->second )
+		if( prev[partition] == NO_OFFSET )
+			continue;
+
+		if( partition >= current.size() || current[partition] == NO_OFFSET || prev[partition] > current[partition] )
 			return true;
 	}
 
 	return false;
 }
 
+void LiveMarketUpdater::advance( PartitionOffsets& current, const PartitionOffsets& incoming )
+{
+	// Each partition only moves forward - a batch that advances one partition may trail on another
+	if( incoming.size() > current.size() )
+		current.resize( incoming.size(), NO_OFFSET );
+
+	for( size_t partition = 0; partition < incoming.size(); ++partition )
+		current[partition] = std::max( current[partition], incoming[partition] );
+}
+
 }
\ No newline at end of file
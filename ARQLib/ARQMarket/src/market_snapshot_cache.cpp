@@ -0,0 +1,259 @@
+#include <ARQMarket/market_snapshot_cache.h>
+
+#include <ARQUtils/logger.h>
+#include <ARQUtils/os.h>
+#include <ARQUtils/str.h>
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace ARQ::MD
+{
+
+namespace
+{
+
+// File layout (host byte order):
+//   FileHeader
+// followed by a payload of numOffsets offsets:
+//   u32 topicSize | topicSize bytes | i32 partition | i64 offset
+// then numEntries records:
+//   u8 type | u32 size | size bytes (the serialised record)
+// The header's checksum is an FNV-1a hash of the payload.
+
+constexpr uint32_t FILE_MAGIC = 0x43534D41; // "AMSC"
+
+struct FileHeader
+{
+	uint32_t magic;
+	uint32_t formatVersion;
+	uint64_t schemaHash;
+	uint64_t keyHash;
+	int64_t  savedTsUs;
+	uint64_t payloadSize;
+	uint64_t checksum;
+	uint32_t numOffsets;
+	uint32_t numEntries;
+};
+static_assert( std::is_trivially_copyable_v<FileHeader> );
+
+// Entity types are written as their enum values - a build with the types added, removed or reordered can't read the file
+uint64_t schemaHash()
+{
+	static const uint64_t hash = [] ()
+	{
+		std::string typeNames;
+		RecordCollection().visitVectors( [&typeNames] <c_MktData T> ( const std::vector<Record<T>>& )
+		{
+			typeNames += std::format( "{}={};", Traits<T>::type(), static_cast<int32_t>( Traits<T>::typeEnum() ) );
+		} );
+		return Str::constexprHash( typeNames );
+	}();
+	return hash;
+}
+
+uint64_t checksum( const uint8_t* data, const size_t size )
+{
+	return Str::constexprHash( std::string_view( reinterpret_cast<const char*>( data ), size ) );
+}
+
+template<typename T>
+void appendPod( std::vector<uint8_t>& out, const T& value )
+{
+	const auto* bytes = reinterpret_cast<const uint8_t*>( &value );
+	out.insert( out.end(), bytes, bytes + sizeof( T ) );
+}
+
+// Bounds checked reads out of the mapped payload
+class PayloadReader
+{
+public:
+	PayloadReader( const uint8_t* data, const size_t size )
+		: m_data( data )
+		, m_size( size )
+	{}
+
+	template<typename T>
+	bool readPod( T& value )
+	{
+		if( m_size - m_pos < sizeof( T ) )
+			return false;
+
+		std::memcpy( &value, m_data + m_pos, sizeof( T ) );
+		m_pos += sizeof( T );
+		return true;
+	}
+
+	bool readBytes( const size_t size, BufferView& view )
+	{
+		if( m_size - m_pos < size )
+			return false;
+
+		view = BufferView( m_data + m_pos, size );
+		m_pos += size;
+		return true;
+	}
+
+private:
+	const uint8_t* m_data;
+	size_t         m_size;
+	size_t         m_pos = 0;
+};
+
+}
+
+MarketSnapshotCache::MarketSnapshotCache( const std::filesystem::path& path, const std::string_view key, std::shared_ptr<Serialiser> serialiser )
+	: m_path( path )
+	, m_key( key )
+	, m_keyHash( Str::constexprHash( key ) )
+	, m_serialiser( serialiser ? std::move( serialiser ) : SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf ) )
+{
+}
+
+void MarketSnapshotCache::save( const MarketSnapshot& snapshot, const StreamTopicPartitionOffsets& offsets ) const
+{
+	std::vector<uint8_t> payload;
+
+	for( const auto& [tp, offset] : offsets )
+	{
+		appendPod( payload, static_cast<uint32_t>( tp.first.size() ) );
+		payload.insert( payload.end(), tp.first.begin(), tp.first.end() );
+		appendPod( payload, static_cast<int32_t>( tp.second ) );
+		appendPod( payload, static_cast<int64_t>( offset ) );
+	}
+
+	uint32_t numEntries = 0;
+	RecordCollection().visitVectors( [this, &snapshot, &payload, &numEntries] <c_MktData T> ( const std::vector<Record<T>>& )
+	{
+		snapshot.template forEach<T>( [this, &payload, &numEntries] ( const Record<T>& rcd )
+		{
+			appendPod( payload, static_cast<uint8_t>( Traits<T>::typeEnum() ) );
+
+			// Leave room for the size and fill it in once the record has been encoded straight into the payload
+			const size_t sizePos = payload.size();
+			appendPod( payload, uint32_t( 0 ) );
+			const uint32_t size = static_cast<uint32_t>( m_serialiser->serialiseAppend( rcd, payload ) );
+			std::memcpy( payload.data() + sizePos, &size, sizeof( size ) );
+
+			++numEntries;
+		} );
+	} );
+
+	const FileHeader header {
+		.magic         = FILE_MAGIC,
+		.formatVersion = FORMAT_VERSION,
+		.schemaHash    = schemaHash(),
+		.keyHash       = m_keyHash,
+		.savedTsUs     = static_cast<int64_t>( Time::DateTime::nowUTC().microsecondsSinceEpoch() ),
+		.payloadSize   = payload.size(),
+		.checksum      = checksum( payload.data(), payload.size() ),
+		.numOffsets    = static_cast<uint32_t>( offsets.size() ),
+		.numEntries    = numEntries
+	};
+
+	// Write alongside then rename over the cache, so a crash mid-save leaves the previous cache intact
+	std::filesystem::path tmpPath = m_path;
+	tmpPath += ".tmp";
+	{
+		std::ofstream ofs( tmpPath, std::ios::binary | std::ios::trunc );
+		if( !ofs.is_open() )
+			throw ARQException( std::format( "MarketSnapshotCache: Failed to open snapshot cache file {}", tmpPath.string() ) );
+
+		ofs.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+		ofs.write( reinterpret_cast<const char*>( payload.data() ), payload.size() );
+		ofs.flush();
+		if( !ofs )
+			throw ARQException( std::format( "MarketSnapshotCache: Failed writing to snapshot cache file {}", tmpPath.string() ) );
+	}
+
+	std::filesystem::rename( tmpPath, m_path );
+}
+
+std::optional<MarketSnapshotCache::Contents> MarketSnapshotCache::load() const
+{
+	if( !std::filesystem::exists( m_path ) )
+	{
+		Log( Module::MKT ).info( "MarketSnapshotCache: No snapshot cache file at {}", m_path.string() );
+		return std::nullopt;
+	}
+
+	const auto ignore = [this] ( const std::string_view reason ) -> std::optional<Contents>
+	{
+		Log( Module::MKT ).warn( "MarketSnapshotCache: Ignoring snapshot cache file {} for [{}]: {}", m_path.string(), m_key, reason );
+		return std::nullopt;
+	};
+
+	OS::MappedFile file;
+	ARQ_DO_IN_TRY( arqExc, errMsg )
+		file = OS::MappedFile( m_path );
+	ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+	if( arqExc.what().size() )
+		return ignore( arqExc.what() );
+	if( errMsg.size() )
+		return ignore( errMsg );
+
+	FileHeader header;
+	if( file.size() < sizeof( header ) )
+		return ignore( "truncated header" );
+
+	std::memcpy( &header, file.data(), sizeof( header ) );
+	if( header.magic != FILE_MAGIC )
+		return ignore( "not a snapshot cache file" );
+	if( header.formatVersion != FORMAT_VERSION )
+		return ignore( std::format( "format version {} but expected {}", header.formatVersion, FORMAT_VERSION ) );
+	if( header.schemaHash != schemaHash() )
+		return ignore( "saved with a different set of entity types" );
+	if( header.keyHash != m_keyHash )
+		return ignore( "saved for a different market or filter" );
+	if( header.payloadSize != file.size() - sizeof( header ) )
+		return ignore( "truncated payload" );
+
+	const uint8_t* const payload = file.data() + sizeof( header );
+	if( header.checksum != checksum( payload, header.payloadSize ) )
+		return ignore( "checksum mismatch" );
+
+	Contents      contents;
+	PayloadReader reader( payload, header.payloadSize );
+
+	contents.savedTs = Time::DateTime( Time::Microseconds( header.savedTsUs ) );
+
+	for( uint32_t i = 0; i < header.numOffsets; ++i )
+	{
+		uint32_t   topicSize;
+		BufferView topic;
+		int32_t    partition;
+		int64_t    offset;
+		if( !reader.readPod( topicSize ) || !reader.readBytes( topicSize, topic ) || !reader.readPod( partition ) || !reader.readPod( offset ) )
+			return ignore( "corrupt offsets" );
+
+		contents.offsets.emplace( StreamTopicPartition( std::string( reinterpret_cast<const char*>( topic.data ), topic.size ), partition ), offset );
+	}
+
+	// Records are decoded straight out of the mapping, without copying them out first
+	ARQ_DO_IN_TRY( decodeExc, decodeErrMsg )
+		for( uint32_t i = 0; i < header.numEntries; ++i )
+		{
+			uint8_t    type;
+			uint32_t   size;
+			BufferView data;
+			if( !reader.readPod( type ) || !reader.readPod( size ) || !reader.readBytes( size, data ) )
+				throw ARQException( "corrupt record entry" );
+
+			dispatch( static_cast<Type>( type ), [&] <c_MktData T> ()
+			{
+				contents.records.get<Record<T>>().push_back( m_serialiser->deserialise<Record<T>>( data ) );
+			} );
+		}
+	ARQ_END_TRY_AND_CATCH( decodeExc, decodeErrMsg );
+
+	if( decodeExc.what().size() )
+		return ignore( decodeExc.what() );
+	if( decodeErrMsg.size() )
+		return ignore( decodeErrMsg );
+
+	return contents;
+}
+
+}
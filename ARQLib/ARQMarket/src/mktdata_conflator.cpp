@@ -0,0 +1,109 @@
+#include <ARQMarket/mktdata_conflator.h>
+
+namespace ARQ::MD
+{
+
+MarketUpdateConflator::MarketUpdateConflator( const Config& config )
+	: m_config( config )
+{
+}
+
+void MarketUpdateConflator::add( std::unordered_map<std::string, MarketUpdateBatch>&& updateBatches, const Clock::time_point now )
+{
+	for( auto& [mktName, updateBatch] : updateBatches )
+	{
+		if( updateBatch.records.empty() )
+			continue;
+
+		if( empty() )
+			m_windowStart = now;
+
+		HeldMarket& held = m_held[mktName];
+		if( !held.batch.marketName.isSet() )
+			held.batch.marketName = updateBatch.marketName;
+
+		updateBatch.records.visitVectors( [this, &held, &updateBatch] <c_MktData T> ( std::vector<Record<T>>& records )
+		{
+			if( records.empty() )
+				return;
+
+			constexpr Type type = Traits<T>::typeEnum();
+
+			std::vector<Record<T>>& heldRecords    = held.batch.records.template get<Record<T>>();
+			std::vector<int32_t>&   heldPartitions = held.batch.recordPartitions[type];
+			IdIndex&                index          = held.indexes[type];
+
+			// Each held record keeps the partition of whichever record it ended up as
+			const auto                  partitionsIt = updateBatch.recordPartitions.find( type );
+			const std::vector<int32_t>* partitions   = partitionsIt != updateBatch.recordPartitions.end() && partitionsIt->second.size() == records.size() ? &partitionsIt->second : nullptr;
+
+			for( size_t i = 0; i < records.size(); ++i )
+			{
+				++m_stats.received;
+
+				Record<T>&    record    = records[i];
+				const int32_t partition = partitions ? ( *partitions )[i] : MarketUpdateBatch::NO_PARTITION;
+
+				const auto [it, inserted] = index.try_emplace( record.header.id, heldRecords.size() );
+				if( inserted )
+				{
+					heldRecords.push_back( std::move( record ) );
+					heldPartitions.push_back( partition );
+					++m_numHeld;
+					continue;
+				}
+
+				// Ties go to the later record, as the sinks would have left it
+				++m_stats.conflated;
+				Record<T>& heldRecord = heldRecords[it->second];
+				if( record.header.asofTs >= heldRecord.header.asofTs )
+				{
+					heldRecord                 = std::move( record );
+					heldPartitions[it->second] = partition;
+				}
+			}
+		} );
+
+		for( const auto& [tp, offset] : updateBatch.offsets )
+		{
+			int64_t& heldOffset = held.batch.offsets.try_emplace( tp, offset ).first->second;
+			heldOffset = std::max( heldOffset, offset );
+		}
+
+		// The earliest is kept, as the previous batch is the one before the first that went into the window
+		for( const auto& [tp, offset] : updateBatch.prevOffsets )
+			held.batch.prevOffsets.try_emplace( tp, offset );
+	}
+}
+
+bool MarketUpdateConflator::due( const Clock::time_point now ) const
+{
+	if( empty() )
+		return false;
+
+	return now >= m_windowStart + m_config.window || ( m_config.maxRecords && m_numHeld >= m_config.maxRecords );
+}
+
+std::optional<MarketUpdateConflator::Clock::time_point> MarketUpdateConflator::deadline() const
+{
+	if( empty() )
+		return std::nullopt;
+
+	return m_windowStart + m_config.window;
+}
+
+std::unordered_map<std::string, MarketUpdateBatch> MarketUpdateConflator::take()
+{
+	std::unordered_map<std::string, MarketUpdateBatch> updateBatches;
+	updateBatches.reserve( m_held.size() );
+	for( auto& [mktName, held] : m_held )
+		updateBatches.emplace( mktName, std::move( held.batch ) );
+
+	m_stats.forwarded += m_numHeld;
+	m_held.clear();
+	m_numHeld = 0;
+
+	return updateBatches;
+}
+
+}
@@ -10,24 +10,40 @@ std::shared_ptr<ILiveMarketStore> LiveMarketStoreFactory::create( const std::str
 {
 	std::lock_guard<std::mutex> lg( m_storesMutex );
 
+	if( const auto it = m_customStores.find( dsh ); it != m_customStores.end() )
+		return it->second;
+
 	if( const auto it = m_stores.find( dsh ); it != m_stores.end() )
 		return it->second;
 
+	return m_stores.emplace( dsh, iCreate( dsh ) ).first->second;
+}
+
+std::shared_ptr<ILiveMarketStore> LiveMarketStoreFactory::createUnshared( const std::string_view dsh )
+{
+	std::lock_guard<std::mutex> lg( m_storesMutex );
+
+	if( const auto it = m_customStores.find( dsh ); it != m_customStores.end() )
+		return it->second;
+
+	return iCreate( dsh );
+}
+
+std::shared_ptr<ILiveMarketStore> LiveMarketStoreFactory::iCreate( const std::string_view dsh )
+{
 	const DataSourceConfig& dsc         = DataSourceConfigManager::inst().get( dsh );
 	const std::string_view  dynaLibName = dataSourceTypeToDynaLibName( dsc.type );
 	const OS::DynaLib&      lib         = DynaLibCache::inst().get( dynaLibName );
 
 	const auto createFunc = lib.getFunc<LiveMarketStoreCreateFunc>( "createLiveMarketStore" );
-	auto newStore = std::shared_ptr<ILiveMarketStore>( createFunc( dsh ) );
-
-	return m_stores.emplace( dsh, std::move( newStore ) ).first->second;
+	return std::shared_ptr<ILiveMarketStore>( createFunc( dsh ) );
 }
 
 void LiveMarketStoreFactory::addCustomStore( const std::string_view dsh, const std::shared_ptr<ILiveMarketStore>& store )
 {
 	std::lock_guard<std::mutex> lg( m_storesMutex );
 
-	if( !m_stores.emplace( dsh, store ).second )
+	if( m_stores.contains( dsh ) || !m_customStores.emplace( dsh, store ).second )
 		throw ARQException( std::format( "MD::LiveMarketStoreFactory: Cannot add custom store with dsh={} as it already exists", dsh ) );
 }
 
@@ -35,8 +51,8 @@ void LiveMarketStoreFactory::delCustomStore( const std::string_view dsh )
 {
 	std::lock_guard<std::mutex> lg( m_storesMutex );
 
-	if( const auto it = m_stores.find( dsh ); it != m_stores.end() )
-		m_stores.erase( it );
+	if( const auto it = m_customStores.find( dsh ); it != m_customStores.end() )
+		m_customStores.erase( it );
 	else
 		throw ARQException( std::format( "MD::LiveMarketStoreFactory: Cannot find custom store with dsh={} to delete", dsh ) );
 }
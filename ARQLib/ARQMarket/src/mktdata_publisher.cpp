@@ -5,6 +5,13 @@
 namespace ARQ::MD
 {
 
+Publisher::~Publisher()
+{
+	// Outstanding batches are referenced by the producer's delivery callbacks, so let those drain before they go
+	if( m_streamProducer )
+		m_streamProducer->flush();
+}
+
 void Publisher::init( const Config& config )
 {
 	m_config         = config;
@@ -17,19 +24,148 @@ void Publisher::registerOnErrorCallback( const PublisherErrorCallback& callback
 	m_globalErrorCallbacks.push_back( callback );
 }
 
-void Publisher::publishImpl( Buffer&& buf, const std::string key, const std::string_view topic, const std::string_view payloadType, const std::optional<PublisherErrorCallback>& errorCallback )
+Publisher::PublishBatch& Publisher::acquireBatch( const size_t numMessages, const PublisherBatchCallback& onDelivered, const std::optional<PublisherErrorCallback>& errorCallback )
 {
-	StreamProducerMessage msg;
-	msg.topic               = topic;
-	msg.data                = SharedBuffer( std::move( buf ) ); // Get kafka to own the buffer
-	msg.key                 = key;
-	msg.headers["ARQ_Type"] = payloadType;
+	PublishBatch* batch = nullptr;
+	{
+		std::lock_guard<std::mutex> lock( m_batchesMut );
+		if( !m_freeBatches.empty() )
+		{
+			batch = m_freeBatches.back();
+			m_freeBatches.pop_back();
+		}
+		else
+		{
+			batch = m_batches.emplace_back( std::make_unique<PublishBatch>() ).get();
+			batch->deliveryCallback = [this, batch] ( const StreamProducerMessageMetadata& messageMetadata, std::optional<StreamError> error )
+			{
+				onMessageDelivered( *batch, messageMetadata, error );
+			};
+		}
+	}
+
+	// Clearing keeps the capacity, so a recycled batch only allocates if this one is bigger than any it has held before
+	batch->payloads.clear();
+	batch->keys.clear();
+	batch->slices.clear();
+	batch->slices.reserve( numMessages );
 
-	m_streamProducer->send( msg, [this, errorCallback] ( const StreamProducerMessageMetadata& messageMetadata, std::optional<StreamError> error )
+	batch->onDelivered   = onDelivered;
+	batch->errorCallback = errorCallback;
+	batch->pending       = numMessages;
+	batch->numFailed     = 0;
+	batch->firstError.reset();
+
+	return *batch;
+}
+
+std::string_view Publisher::cachedMktNameStr( const MarketName& mktName )
+{
+	if( m_lastMktNameStr.empty() || !( mktName == m_lastMktName ) )
 	{
-		if( error )
-			handlePublishError( messageMetadata, *error, errorCallback );
-	} );
+		m_lastMktName    = mktName;
+		m_lastMktNameStr = mktName.str();
+	}
+
+	return m_lastMktNameStr;
+}
+
+void Publisher::sendBatch( PublishBatch& batch, const std::string_view topic, const std::string_view payloadType )
+{
+	StreamProducerMessage& msg = m_scratchMsg;
+	msg.topic.assign( topic );
+	if( !msg.key )
+		msg.key.emplace();
+	msg.headers["ARQ_Type"].assign( payloadType );
+
+	const size_t numMessages = batch.slices.size();
+	size_t       numSent     = 0;
+
+	ARQ_DO_IN_TRY( arqExc, errMsg )
+		for( const PublishBatch::Slice& slice : batch.slices )
+		{
+			// The batch owns the payload until the last delivery callback fires, so kafka doesn't need to copy it
+			msg.data = BufferView( batch.payloads.data() + slice.payloadOffset, slice.payloadSize );
+			msg.key->assign( batch.keys, slice.keyOffset, slice.keySize );
+
+			m_streamProducer->send( msg, batch.deliveryCallback );
+			++numSent;
+		}
+	ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+	if( numSent == numMessages )
+		return;
+
+	// Whatever didn't make it onto the producer's queue will never get a delivery callback - count it as failed here
+	const size_t numUnsent = numMessages - numSent;
+	if( arqExc.what().size() )
+		errMsg = arqExc.what();
+
+	Log( Module::MKT ).error( "MD::Publisher: Failed to send {0} of {1} messages to topic {2}: {3}", numUnsent, numMessages, topic, errMsg );
+
+	batch.numFailed.fetch_add( numUnsent, std::memory_order_relaxed );
+	{
+		std::lock_guard<std::mutex> lock( batch.firstErrorMut );
+		if( !batch.firstError )
+		{
+			batch.firstError = StreamError{
+				.code               = -1,
+				.message            = errMsg,
+				.isFatal            = false,
+				.isRetriable        = std::nullopt,
+				.transRequiresAbort = false
+			};
+		}
+	}
+	completeMessages( batch, numUnsent );
+
+	throw ARQException( std::format( "MD::Publisher: Failed to send {0} of {1} messages to topic {2}: {3}", numUnsent, numMessages, topic, errMsg ) );
+}
+
+void Publisher::releaseBatch( PublishBatch& batch )
+{
+	batch.onDelivered   = nullptr;
+	batch.errorCallback = std::nullopt;
+
+	std::lock_guard<std::mutex> lock( m_batchesMut );
+	m_freeBatches.push_back( &batch );
+}
+
+void Publisher::onMessageDelivered( PublishBatch& batch, const StreamProducerMessageMetadata& messageMetadata, const std::optional<StreamError>& error )
+{
+	if( error )
+	{
+		batch.numFailed.fetch_add( 1, std::memory_order_relaxed );
+		{
+			std::lock_guard<std::mutex> lock( batch.firstErrorMut );
+			if( !batch.firstError )
+				batch.firstError = *error;
+		}
+		handlePublishError( messageMetadata, *error, batch.errorCallback );
+	}
+
+	completeMessages( batch, 1 );
+}
+
+void Publisher::completeMessages( PublishBatch& batch, const size_t numMessages )
+{
+	if( numMessages == 0 || batch.pending.fetch_sub( numMessages, std::memory_order_acq_rel ) != numMessages )
+		return;
+
+	// Last one out reports on the whole batch and hands it back for reuse
+	if( batch.onDelivered )
+	{
+		PublishBatchResult result;
+		result.numMessages = batch.slices.size();
+		result.numFailed   = batch.numFailed.load( std::memory_order_relaxed );
+		{
+			std::lock_guard<std::mutex> lock( batch.firstErrorMut );
+			result.firstError = std::move( batch.firstError );
+		}
+		batch.onDelivered( result );
+	}
+
+	releaseBatch( batch );
 }
 
 void Publisher::handlePublishError( const StreamProducerMessageMetadata& messageMetadata, StreamError error, const std::optional<PublisherErrorCallback>& errorCallback )
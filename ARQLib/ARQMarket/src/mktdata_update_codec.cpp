@@ -0,0 +1,409 @@
+#include <ARQMarket/mktdata_update_codec.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace ARQ::MD
+{
+
+namespace
+{
+
+// One bit for each in a delta mask - records with more than this are always sent in full
+constexpr size_t MAX_DELTA_DECIMALS = 64;
+
+// The decimals set on a record, in Traits<T>::visitDecimals order
+struct Decimals
+{
+	std::array<double*, MAX_DELTA_DECIMALS> ptrs;
+	size_t                                  size = 0;
+	bool                                    fits = true;
+};
+
+template<c_MktData T>
+Decimals decimalsOf( T& data )
+{
+	Decimals decimals;
+	Traits<T>::visitDecimals( data, [&decimals] ( double& val )
+	{
+		if( decimals.size == MAX_DELTA_DECIMALS )
+			decimals.fits = false;
+		else
+			decimals.ptrs[decimals.size++] = &val;
+	} );
+	return decimals;
+}
+
+// Whether two records have the same decimals set, so the bits of a delta mask mean the same decimals on both
+template<c_MktData T>
+bool sameDecimals( const Decimals& lhs, const T& lhsData, const Decimals& rhs, const T& rhsData )
+{
+	if( !lhs.fits || !rhs.fits || lhs.size != rhs.size )
+		return false;
+
+	const auto offsetOf = [] ( const double* const val, const T& data )
+	{
+		return reinterpret_cast<const char*>( val ) - reinterpret_cast<const char*>( &data );
+	};
+
+	for( size_t i = 0; i < lhs.size; ++i )
+	{
+		if( offsetOf( lhs.ptrs[i], lhsData ) != offsetOf( rhs.ptrs[i], rhsData ) )
+			return false;
+	}
+	return true;
+}
+
+// The delta mask flagging the decimals unchanged from the base - 0, to send the record in full, if the two don't have the same decimals set
+template<c_MktData T>
+uint64_t unchangedMask( T& data, T& base )
+{
+	const Decimals decimals     = decimalsOf( data );
+	const Decimals baseDecimals = decimalsOf( base );
+	if( !sameDecimals( decimals, data, baseDecimals, base ) )
+		return 0;
+
+	// Bitwise, so a NaN that stays a NaN is unchanged and a sign flip on zero isn't
+	uint64_t deltaMask = 0;
+	for( size_t i = 0; i < decimals.size; ++i )
+	{
+		if( std::bit_cast<uint64_t>( *decimals.ptrs[i] ) == std::bit_cast<uint64_t>( *baseDecimals.ptrs[i] ) )
+			deltaMask |= uint64_t( 1 ) << i;
+	}
+	return deltaMask;
+}
+
+template<c_MktData T>
+void leaveOut( T& data, const uint64_t deltaMask )
+{
+	const Decimals decimals = decimalsOf( data );
+	for( size_t i = 0; i < decimals.size; ++i )
+	{
+		if( deltaMask & ( uint64_t( 1 ) << i ) )
+			*decimals.ptrs[i] = 0.0;
+	}
+}
+
+// Fills in the decimals left out of a record from its base - false if it can't be, as the two don't have the same decimals set
+template<c_MktData T>
+bool fillIn( T& data, T& base, const uint64_t deltaMask )
+{
+	const Decimals decimals     = decimalsOf( data );
+	const Decimals baseDecimals = decimalsOf( base );
+	if( !sameDecimals( decimals, data, baseDecimals, base ) )
+		return false;
+	if( decimals.size < MAX_DELTA_DECIMALS && ( deltaMask >> decimals.size ) )
+		return false;
+
+	for( size_t i = 0; i < decimals.size; ++i )
+	{
+		if( deltaMask & ( uint64_t( 1 ) << i ) )
+			*decimals.ptrs[i] = *baseDecimals.ptrs[i];
+	}
+	return true;
+}
+
+// Splits the batch's records, with their delta masks, into numChunks runs of about the same number of records
+std::vector<MarketUpdateMessage> split( const MarketUpdateBatch& batch, const std::vector<uint64_t>& deltaMasks, const size_t numChunks )
+{
+	std::vector<MarketUpdateMessage> chunks( numChunks );
+	for( size_t i = 0; i < numChunks; ++i )
+	{
+		MarketUpdateMessage& chunk = chunks[i];
+		chunk.batch.marketName  = batch.marketName;
+		chunk.batch.offsets     = batch.offsets;
+		chunk.batch.prevOffsets = batch.prevOffsets;
+		chunk.chunkIdx          = static_cast<uint32_t>( i );
+		chunk.numChunks         = static_cast<uint32_t>( numChunks );
+	}
+
+	const size_t numRecords = batch.records.size();
+	size_t       recordIdx  = 0;
+	batch.records.visitVectors( [&] <c_MktData T> ( const std::vector<Record<T>>& records )
+	{
+		for( const Record<T>& record : records )
+		{
+			MarketUpdateMessage& chunk = chunks[recordIdx * numChunks / numRecords];
+			chunk.batch.records.template get<Record<T>>().push_back( record );
+			if( deltaMasks.size() )
+				chunk.deltaMasks.push_back( deltaMasks[recordIdx] );
+			++recordIdx;
+		}
+	} );
+
+	return chunks;
+}
+
+}
+
+// ---------------------------- MarketUpdateEncoder ----------------------------
+
+MarketUpdateEncoder::MarketUpdateEncoder( const Config& config, std::shared_ptr<Serialiser> serialiser, std::string publisherID )
+	: m_config( config )
+	, m_serialiser( std::move( serialiser ) )
+	, m_publisherID( std::move( publisherID ) )
+{
+}
+
+std::vector<Message> MarketUpdateEncoder::encode( const MarketUpdateBatch& batch, const Clock::time_point now )
+{
+	++m_stats.batches;
+
+	std::vector<Message> msgs;
+	size_t               numChunks = 1;
+	if( !m_config.deltaEncode )
+	{
+		// As it always was, so subscribers that only understand a plain MarketUpdateBatch carry on working
+		Buffer data = m_serialiser->serialise( batch );
+		if( data.size <= m_config.maxMessageBytes )
+		{
+			++m_stats.messages;
+			msgs.push_back( Message{ .data = std::move( data ) } );
+			return msgs;
+		}
+
+		numChunks = data.size / m_config.maxMessageBytes + 1;
+	}
+
+	PublishedMarket& published = m_published[batch.marketName.str()];
+
+	MarketUpdateBatch           wireBatch  = batch;
+	const std::vector<uint64_t> deltaMasks = m_config.deltaEncode ? deltaEncode( published, wireBatch, now ) : std::vector<uint64_t>();
+
+	// Chunks are halved in size until they all fit
+	const size_t numRecords = wireBatch.records.size();
+	while( true )
+	{
+		numChunks = std::min( numChunks, std::max<size_t>( numRecords, 1 ) );
+
+		msgs.clear();
+		bool fits = true;
+		for( MarketUpdateMessage& chunk : split( wireBatch, deltaMasks, numChunks ) )
+		{
+			chunk.publisherID = m_publisherID;
+			chunk.seq         = published.seq + 1 + chunk.chunkIdx;
+
+			Message msg{
+				.data = m_serialiser->serialise( chunk )
+			};
+			if( msg.data.size > m_config.maxMessageBytes )
+			{
+				fits = false;
+				break;
+			}
+
+			msg.headers[std::string( MarketUpdateMessage::TYPE_HEADER )].emplace_back( MarketUpdateMessage::TYPE );
+			msgs.push_back( std::move( msg ) );
+		}
+
+		if( fits )
+			break;
+
+		if( numChunks >= numRecords )
+			throw ARQException( std::format( "Cannot encode market update batch for market [{}] - a single record is bigger than the max message size of {} bytes", batch.marketName.str(), m_config.maxMessageBytes ) );
+
+		numChunks *= 2;
+	}
+
+	published.seq    += msgs.size();
+	m_stats.messages += msgs.size();
+	if( msgs.size() > 1 )
+		++m_stats.chunkedBatches;
+
+	return msgs;
+}
+
+std::vector<uint64_t> MarketUpdateEncoder::deltaEncode( PublishedMarket& published, MarketUpdateBatch& batch, const Clock::time_point now )
+{
+	// Every id goes out in full again
+	if( now - published.basesSince >= m_config.fullRecordInterval )
+	{
+		published.bases.clear();
+		published.indexes.clear();
+		published.basesSince = now;
+	}
+
+	std::vector<uint64_t> deltaMasks;
+	deltaMasks.reserve( batch.records.size() );
+
+	batch.records.visitVectors( [this, &published, &deltaMasks] <c_MktData T> ( std::vector<Record<T>>& records )
+	{
+		if( records.empty() )
+			return;
+
+		std::vector<Record<T>>& bases = published.bases.template get<Record<T>>();
+		IdIndex&                index = published.indexes[Traits<T>::typeEnum()];
+
+		for( Record<T>& record : records )
+		{
+			const auto [it, inserted] = index.try_emplace( record.header.id, bases.size() );
+			if( inserted )
+			{
+				bases.push_back( record );
+				deltaMasks.push_back( 0 );
+				continue;
+			}
+
+			Record<T>&     base      = bases[it->second];
+			const uint64_t deltaMask = unchangedMask( record.data, base.data );
+			base = record;
+			leaveOut( record.data, deltaMask );
+
+			deltaMasks.push_back( deltaMask );
+			if( deltaMask )
+			{
+				++m_stats.deltaRecords;
+				m_stats.decimalsLeftOut += std::popcount( deltaMask );
+			}
+		}
+	} );
+
+	return deltaMasks;
+}
+
+// ---------------------------- MarketUpdateDecoder ----------------------------
+
+MarketUpdateDecoder::MarketUpdateDecoder( std::shared_ptr<Serialiser> serialiser )
+	: m_serialiser( std::move( serialiser ) )
+{
+}
+
+bool MarketUpdateDecoder::isUpdateMessage( const Message& msg )
+{
+	const auto it = msg.headers.find( std::string( MarketUpdateMessage::TYPE_HEADER ) );
+	return it != msg.headers.end() && std::ranges::find( it->second, MarketUpdateMessage::TYPE ) != it->second.end();
+}
+
+std::optional<MarketUpdateBatch> MarketUpdateDecoder::decode( const Message& msg, std::vector<Type>* deltaMissTypes )
+{
+	if( deltaMissTypes )
+		deltaMissTypes->clear();
+
+	if( !isUpdateMessage( msg ) )
+		return m_serialiser->deserialise<MarketUpdateBatch>( msg.data );
+
+	MarketUpdateMessage updateMsg = m_serialiser->deserialise<MarketUpdateMessage>( msg.data );
+	m_numMessages.fetch_add( 1, std::memory_order_relaxed );
+
+	Publisher& publisher = m_publishers[updateMsg.publisherID];
+	if( publisher.lastSeq )
+	{
+		if( updateMsg.seq <= publisher.lastSeq )
+		{
+			m_numDuplicates.fetch_add( 1, std::memory_order_relaxed );
+			return std::nullopt;
+		}
+
+		// What was missed may have moved the publisher's delta bases on, and may have been part of the batch being put back together
+		if( updateMsg.seq != publisher.lastSeq + 1 )
+		{
+			m_numSeqGaps.fetch_add( 1, std::memory_order_relaxed );
+			publisher.partial.reset();
+			publisher.bases.clear();
+			publisher.indexes.clear();
+		}
+	}
+	publisher.lastSeq = updateMsg.seq;
+
+	// Before anything is dropped, so the bases keep up with the publisher's
+	deltaDecode( publisher, updateMsg, deltaMissTypes );
+
+	if( updateMsg.numChunks <= 1 )
+		return std::move( updateMsg.batch );
+
+	if( updateMsg.chunkIdx == 0 )
+		publisher.partial = std::move( updateMsg.batch );
+	else if( !publisher.partial )
+		return std::nullopt; // Joined part way through the batch
+	else
+	{
+		publisher.partial->records.visitVectors( [&updateMsg] <c_MktData T> ( std::vector<Record<T>>& records )
+		{
+			std::vector<Record<T>>& chunkRecords = updateMsg.batch.records.template get<Record<T>>();
+			records.insert( records.end(), std::make_move_iterator( chunkRecords.begin() ), std::make_move_iterator( chunkRecords.end() ) );
+		} );
+	}
+
+	if( updateMsg.chunkIdx + 1 < updateMsg.numChunks )
+		return std::nullopt;
+
+	m_numReassembled.fetch_add( 1, std::memory_order_relaxed );
+
+	std::optional<MarketUpdateBatch> batch = std::move( publisher.partial );
+	publisher.partial.reset();
+	return batch;
+}
+
+void MarketUpdateDecoder::deltaDecode( Publisher& publisher, MarketUpdateMessage& updateMsg, std::vector<Type>* deltaMissTypes )
+{
+	if( updateMsg.deltaMasks.empty() )
+		return;
+
+	if( updateMsg.deltaMasks.size() != updateMsg.batch.records.size() )
+		throw ARQException( std::format( "MarketUpdateMessage from publisher [{}] has {} delta masks for {} records", updateMsg.publisherID, updateMsg.deltaMasks.size(), updateMsg.batch.records.size() ) );
+
+	size_t recordIdx = 0;
+	updateMsg.batch.records.visitVectors( [this, &publisher, &updateMsg, &recordIdx, deltaMissTypes] <c_MktData T> ( std::vector<Record<T>>& records )
+	{
+		if( records.empty() )
+			return;
+
+		std::vector<Record<T>>& bases = publisher.bases.template get<Record<T>>();
+		IdIndex&                index = publisher.indexes[Traits<T>::typeEnum()];
+
+		size_t numKept = 0;
+		for( size_t i = 0; i < records.size(); ++i, ++recordIdx )
+		{
+			Record<T>&     record    = records[i];
+			const uint64_t deltaMask = updateMsg.deltaMasks[recordIdx];
+
+			auto it = index.find( record.header.id );
+			if( deltaMask )
+			{
+				if( it == index.end() || !fillIn( record.data, bases[it->second].data, deltaMask ) )
+				{
+					// The base is no good for what follows either, so the id waits on being sent in full
+					if( it != index.end() )
+						index.erase( it );
+
+					m_numDeltaMisses.fetch_add( 1, std::memory_order_relaxed );
+					continue;
+				}
+
+				m_numDeltaRecords.fetch_add( 1, std::memory_order_relaxed );
+			}
+
+			if( it == index.end() )
+			{
+				index.emplace( record.header.id, bases.size() );
+				bases.push_back( record );
+			}
+			else
+				bases[it->second] = record;
+
+			if( numKept != i )
+				records[numKept] = std::move( record );
+			++numKept;
+		}
+
+		if( deltaMissTypes && numKept != records.size() )
+			deltaMissTypes->push_back( Traits<T>::typeEnum() );
+
+		records.resize( numKept );
+	} );
+}
+
+MarketUpdateDecoder::Stats MarketUpdateDecoder::getStats() const
+{
+	return Stats {
+		.messages     = m_numMessages.load( std::memory_order_relaxed ),
+		.reassembled  = m_numReassembled.load( std::memory_order_relaxed ),
+		.seqGaps      = m_numSeqGaps.load( std::memory_order_relaxed ),
+		.duplicates   = m_numDuplicates.load( std::memory_order_relaxed ),
+		.deltaRecords = m_numDeltaRecords.load( std::memory_order_relaxed ),
+		.deltaMisses  = m_numDeltaMisses.load( std::memory_order_relaxed )
+	};
+}
+
+}
@@ -128,4 +128,28 @@ void TIDSet::consolidate() const
     m_dirty = false;
 }
 
+CompiledTIDSet::CompiledTIDSet( const TIDSet& tidSet )
+{
+    // getAll() consolidates, so a type-level item has already absorbed any specific items of the same type
+    for( const TID& item : tidSet.getAll() )
+    {
+        TypeFilter& filter = m_filters[item.type];
+        if( !item.id.has_value() )
+            filter.all = true;
+        else
+            filter.ids.emplace( item.id.value() );
+    }
+}
+
+TIDSet::IDs CompiledTIDSet::getIDsForType( const Type type ) const
+{
+    const auto it = m_filters.find( type );
+    if( it == m_filters.end() )
+        return TIDSet::None{};
+    if( it->second.all )
+        return TIDSet::All{};
+
+    return TIDSet::IDList( it->second.ids.begin(), it->second.ids.end() );
+}
+
 }
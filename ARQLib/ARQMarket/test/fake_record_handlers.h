@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ARQCore/serialiser.h>
+#include <ARQUtils/buffer.h>
+#include <ARQMarket/mktdata_entities.h>
+
+#include <cstdint>
+#include <cstring>
+
+namespace ARQ::MD
+{
+
+// Minimal fixed layout encoding so the tests don't depend on the Protobuf serialisers - only the id, mid and asofTs survive, and
+// records always come back active
+class FakeFXRecordHandler : public ISerialisableType<Record<FXRate>>
+{
+public:
+    Buffer serialise( const Record<FXRate>& rec ) const override
+    {
+        const int64_t ts = rec.header.asofTs.microsecondsSinceEpoch();
+        Buffer buf( sizeof( ts ) + sizeof( rec.data.mid ) + rec.header.id.size() );
+        std::memcpy( buf.data.get(), &ts, sizeof( ts ) );
+        std::memcpy( buf.data.get() + sizeof( ts ), &rec.data.mid, sizeof( rec.data.mid ) );
+        std::memcpy( buf.data.get() + sizeof( ts ) + sizeof( rec.data.mid ), rec.header.id.data(), rec.header.id.size() );
+        return buf;
+    }
+
+    void deserialise( const BufferView buf, Record<FXRate>& rec ) const override
+    {
+        int64_t ts;
+        std::memcpy( &ts, buf.data, sizeof( ts ) );
+        std::memcpy( &rec.data.mid, buf.data + sizeof( ts ), sizeof( rec.data.mid ) );
+        rec.header.asofTs   = Time::DateTime( Time::Microseconds( ts ) );
+        rec.header.isActive = true;
+        rec.header.id.assign( reinterpret_cast<const char*>( buf.data ) + sizeof( ts ) + sizeof( rec.data.mid ), buf.size - sizeof( ts ) - sizeof( rec.data.mid ) );
+    }
+};
+
+}
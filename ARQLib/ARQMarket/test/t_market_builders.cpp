@@ -2,6 +2,11 @@
 #include <gtest/gtest.h>
 
 #include <ARQCore/messaging_service.h>
+#include <ARQCore/stream_offset_source.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 using namespace ARQ;
 using namespace ARQ::MD;
@@ -15,8 +20,7 @@ namespace
 {
 
 // A lightweight mock to satisfy the MessagingServiceFactory.
-// Because we never call updater->start() in these tests, 
-// these methods are never actually invoked.
+// Only the buildAndStartAll() tests start an updater, and they only need subscribe() to not throw.
 class MockMessagingService : public IMessagingService
 {
 public:
@@ -35,6 +39,55 @@ public:
     }
 };
 
+// Holds every load until the expected number are in flight at once, so a serial startup would time out rather than pass
+class ConcurrentMarketSource : public IMarketSource
+{
+public:
+    explicit ConcurrentMarketSource( const int expectedLoads )
+        : m_expectedLoads( expectedLoads )
+    {}
+
+    RecordCollection load( const std::string_view marketName, const TIDSet& ) override
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            ++m_inFlight;
+            maxInFlight = std::max( maxInFlight, m_inFlight );
+            m_cv.notify_all();
+            m_cv.wait_for( lock, std::chrono::seconds( 5 ), [this] () { return m_inFlight >= m_expectedLoads; } );
+        }
+
+        if( marketName == failMarket )
+            throw ARQException( "Source unavailable" );
+
+        Record<FXRate> rec {};
+        rec.header.id       = std::string( marketName );
+        rec.header.isActive = true;
+
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( rec );
+        return records;
+    }
+
+    void save( const std::string_view, const RecordCollection& ) override {}
+
+    int         maxInFlight = 0;
+    std::string failMarket;
+
+private:
+    const int               m_expectedLoads;
+    int                     m_inFlight = 0;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+};
+
+class EmptyOffsetSource : public IStreamOffsetSource
+{
+public:
+    void                                       saveOffsets( const std::string_view, const StreamTopicPartitionOffsets& ) override {}
+    std::optional<StreamTopicPartitionOffsets> getOffsets( const std::string_view ) override { return std::nullopt; }
+};
+
 }
 
 class LiveMarketBuilderTest : public ::testing::Test
@@ -145,4 +198,64 @@ TEST_F( LiveMarketBuilderTest, BuildSucceedsIfMarketNameProvidedOnlyInMessagingF
         builder.withMessagingFeed( "MOCK_NATS_SVC", TIDSet(), MarketName( "PROD_FX" ) )
                .build();
     } );
-}
\ No newline at end of file
+}
+
+TEST_F( LiveMarketBuilderTest, BuildAndStartAllLoadsMarketsConcurrently )
+{
+    auto source = std::make_shared<ConcurrentMarketSource>( 3 );
+    MarketSourceFactory::inst().addCustomSource( "MOCK_MULTI_SRC", source );
+    StreamOffsetSourceFactory::inst().addCustomSource( "MOCK_MULTI_SRC", std::make_shared<EmptyOffsetSource>() );
+
+    const MarketName eod1( "EOD", Date( Year( 2026 ), Month( 5 ), Day( 14 ) ) );
+    const MarketName eod2( "EOD", Date( Year( 2026 ), Month( 5 ), Day( 15 ) ) );
+
+    LiveMarketBuilder builder;
+    const auto markets = builder
+        .fromSource( "MOCK_MULTI_SRC", MarketName( "LIVE" ) )
+        .withMessagingFeed( "MOCK_NATS_SVC" )
+        .withMarkets( { eod1, eod2 } )
+        .buildAndStartAll();
+
+    // Every load was in flight at the same time
+    EXPECT_EQ( source->maxInFlight, 3 );
+
+    ASSERT_EQ( markets.size(), 3 );
+    EXPECT_EQ( markets[0].mktName, MarketName( "LIVE" ) );
+    EXPECT_EQ( markets[1].mktName, eod1 );
+    EXPECT_EQ( markets[2].mktName, eod2 );
+    for( const LiveMarketHandle& handle : markets )
+    {
+        EXPECT_EQ( handle.updater->market(), handle.mkt );
+        EXPECT_TRUE( handle.mkt->snapshot()->get<FXRate>( handle.mktName.str() ) );
+        EXPECT_EQ( handle.updater->getBaselineLoadStats().numRecords, 1 );
+    }
+
+    MarketSourceFactory::inst().delCustomSource( "MOCK_MULTI_SRC" );
+    StreamOffsetSourceFactory::inst().delCustomSource( "MOCK_MULTI_SRC" );
+}
+
+TEST_F( LiveMarketBuilderTest, BuildAndStartAllThrowsIfAnyMarketFails )
+{
+    auto source = std::make_shared<ConcurrentMarketSource>( 2 );
+    source->failMarket = MarketName( "BROKEN" ).str();
+    MarketSourceFactory::inst().addCustomSource( "MOCK_MULTI_SRC", source );
+    StreamOffsetSourceFactory::inst().addCustomSource( "MOCK_MULTI_SRC", std::make_shared<EmptyOffsetSource>() );
+
+    LiveMarketBuilder builder;
+    builder.fromSource( "MOCK_MULTI_SRC", MarketName( "LIVE" ) )
+           .withMessagingFeed( "MOCK_NATS_SVC" )
+           .withMarkets( { MarketName( "BROKEN" ) } );
+
+    EXPECT_THROW( builder.buildAndStartAll(), ARQException );
+
+    MarketSourceFactory::inst().delCustomSource( "MOCK_MULTI_SRC" );
+    StreamOffsetSourceFactory::inst().delCustomSource( "MOCK_MULTI_SRC" );
+}
+
+TEST_F( LiveMarketBuilderTest, BuildAndStartAllThrowsIfNoMarketsSpecified )
+{
+    LiveMarketBuilder builder;
+    builder.withMessagingFeed( "MOCK_NATS_SVC" );
+
+    EXPECT_THROW( builder.buildAndStartAll(), ARQException );
+}
@@ -0,0 +1,174 @@
+#include <ARQMarket/market_history_spill.h>
+#include <gtest/gtest.h>
+
+#include "fake_record_handlers.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::Time;
+
+namespace
+{
+
+Record<FXRate> makeFXRecord( std::string id, double mid, uint64_t ts, bool active = true )
+{
+    Record<FXRate> rec;
+    rec.header.id = std::move( id );
+    rec.header.asofTs = DateTime( Microseconds( ts ) );
+    rec.header.isActive = active;
+    rec.data.mid = mid;
+    return rec;
+}
+
+}
+
+class MarketSnapshotSpillLogTest : public ::testing::Test
+{
+protected:
+    std::filesystem::path       path;
+    std::shared_ptr<Serialiser> serialiser;
+
+    void SetUp() override
+    {
+        path = std::filesystem::temp_directory_path() / std::format( "arq_spill_{}.log", ::testing::UnitTest::GetInstance()->current_test_info()->name() );
+        std::filesystem::remove( path );
+
+        serialiser = std::make_shared<Serialiser>();
+        serialiser->registerHandler<Record<FXRate>>( std::make_unique<FakeFXRecordHandler>() );
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove( path );
+    }
+
+    static void tick( Market& market, std::vector<Record<FXRate>> records )
+    {
+        RecordCollection rc;
+        rc.get<Record<FXRate>>() = std::move( records );
+        market.update( std::move( rc ) );
+    }
+
+    std::shared_ptr<const MarketSnapshot> loadAt( const uint64_t ts ) const
+    {
+        return MarketSnapshotSpillLog::load( path, DateTime( Microseconds( ts ) ), serialiser );
+    }
+};
+
+TEST_F( MarketSnapshotSpillLogTest, EvictedSnapshotsCanBeReplayedAsOfAnyTime )
+{
+    {
+        MarketSnapshotSpillLog spillLog( path, serialiser );
+        Market                 market( MarketHistoryParams{ .maxSnapshots = 2 }, spillLog.evictCallback() );
+
+        tick( market, { makeFXRecord( "EUR/USD", 1.08, 100 ), makeFXRecord( "GBP/USD", 1.29, 100 ) } );
+        tick( market, { makeFXRecord( "EUR/USD", 1.09, 200 ) } );
+        tick( market, { makeFXRecord( "GBP/USD", 0.0, 300, false ) } );
+        tick( market, { makeFXRecord( "EUR/USD", 1.10, 400 ) } );
+        tick( market, { makeFXRecord( "EUR/USD", 1.11, 500 ) } );
+
+        // Versions 0 to 3 have fallen out of the in-memory history
+        EXPECT_EQ( market.snapshotAt( DateTime( Microseconds( 250 ) ) ), nullptr );
+        spillLog.flush();
+    }
+
+    const auto at100 = loadAt( 150 );
+    ASSERT_NE( at100, nullptr );
+    EXPECT_DOUBLE_EQ( at100->get<FXRate>( "EUR/USD" )->data.mid, 1.08 );
+    EXPECT_DOUBLE_EQ( at100->get<FXRate>( "GBP/USD" )->data.mid, 1.29 );
+
+    const auto at200 = loadAt( 299 );
+    ASSERT_NE( at200, nullptr );
+    EXPECT_DOUBLE_EQ( at200->get<FXRate>( "EUR/USD" )->data.mid, 1.09 );
+    EXPECT_TRUE( at200->get<FXRate>( "GBP/USD" ) );
+
+    // Erases are replayed too, and nothing past the last spilled version is known
+    const auto at300 = loadAt( 1000 );
+    ASSERT_NE( at300, nullptr );
+    EXPECT_DOUBLE_EQ( at300->get<FXRate>( "EUR/USD" )->data.mid, 1.09 );
+    EXPECT_FALSE( at300->get<FXRate>( "GBP/USD" ) );
+}
+
+TEST_F( MarketSnapshotSpillLogTest, NonConsecutiveSnapshotsAreWrittenInFull )
+{
+    Market market;
+    tick( market, { makeFXRecord( "EUR/USD", 1.08, 100 ), makeFXRecord( "GBP/USD", 1.29, 100 ) } );
+    tick( market, { makeFXRecord( "EUR/USD", 1.09, 200 ) } );
+    const auto v2 = market.snapshot();
+    tick( market, { makeFXRecord( "USD/JPY", 151.2, 300 ) } );
+    tick( market, { makeFXRecord( "GBP/USD", 1.30, 400 ) } );
+    const auto v4 = market.snapshot();
+
+    {
+        MarketSnapshotSpillLog spillLog( path, serialiser );
+        spillLog.append( v2 ); // First write - must carry every record, not just v2's change to EUR/USD
+        spillLog.append( v4 ); // Skips v3 - must carry USD/JPY
+        spillLog.flush();
+    }
+
+    const auto at200 = loadAt( 200 );
+    ASSERT_NE( at200, nullptr );
+    EXPECT_DOUBLE_EQ( at200->get<FXRate>( "GBP/USD" )->data.mid, 1.29 );
+    EXPECT_EQ( at200->size<FXRate>(), 2 );
+
+    const auto at400 = loadAt( 400 );
+    ASSERT_NE( at400, nullptr );
+    EXPECT_EQ( at400->size<FXRate>(), 3 );
+    EXPECT_DOUBLE_EQ( at400->get<FXRate>( "USD/JPY" )->data.mid, 151.2 );
+    EXPECT_DOUBLE_EQ( at400->get<FXRate>( "GBP/USD" )->data.mid, 1.30 );
+}
+
+TEST_F( MarketSnapshotSpillLogTest, SnapshotsDroppedOnAFullQueueLeaveTheLogReplayable )
+{
+    constexpr int numTicks = 500;
+    MarketSnapshotSpillLog::Stats stats;
+    {
+        // A queue of one, fed as fast as the market can update, so some evictions find it full
+        MarketSnapshotSpillLog spillLog( path, serialiser, 1 );
+        Market                 market( MarketHistoryParams{ .maxSnapshots = 1 }, spillLog.evictCallback() );
+
+        for( int i = 1; i <= numTicks; ++i )
+            tick( market, { makeFXRecord( "COUNT", i, i ), makeFXRecord( "ID" + std::to_string( i ), i, i ) } );
+
+        spillLog.flush();
+        stats = spillLog.getStats();
+    }
+
+    // Every version but the one still in memory - counting the empty initial one - was either written or dropped
+    EXPECT_EQ( stats.written + stats.dropped, numTicks );
+
+    // Whichever was written last, it replays with every record up to it - a dropped version never leaves a delta without its base
+    const auto latest = loadAt( numTicks );
+    ASSERT_NE( latest, nullptr );
+    const int lastWritten = static_cast<int>( latest->get<FXRate>( "COUNT" )->data.mid );
+    EXPECT_EQ( latest->size<FXRate>(), static_cast<size_t>( lastWritten + 1 ) );
+    EXPECT_TRUE( latest->get<FXRate>( "ID" + std::to_string( lastWritten ) ) );
+}
+
+TEST_F( MarketSnapshotSpillLogTest, TruncatedLogReplaysUpToLastCompleteFrame )
+{
+    Market market;
+    tick( market, { makeFXRecord( "EUR/USD", 1.08, 100 ) } );
+    const auto v1 = market.snapshot();
+    tick( market, { makeFXRecord( "EUR/USD", 1.09, 200 ) } );
+    const auto v2 = market.snapshot();
+
+    {
+        MarketSnapshotSpillLog spillLog( path, serialiser );
+        spillLog.append( v1 );
+        spillLog.append( v2 );
+        spillLog.flush();
+    }
+
+    // Chop the last few bytes off, as if the process died mid-write
+    std::filesystem::resize_file( path, std::filesystem::file_size( path ) - 3 );
+
+    const auto snap = loadAt( 1000 );
+    ASSERT_NE( snap, nullptr );
+    EXPECT_DOUBLE_EQ( snap->get<FXRate>( "EUR/USD" )->data.mid, 1.08 );
+
+    EXPECT_EQ( loadAt( 50 ), nullptr );
+}
@@ -1,6 +1,13 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <ARQMarket/market_live.h>
+#include <ARQMarket/mktdata_topics.h>
+
+#include "fake_record_handlers.h"
+
+#include <filesystem>
+#include <future>
+#include <thread>
 
 using namespace ARQ;
 using namespace ARQ::MD;
@@ -75,6 +82,39 @@ public:
     MOCK_METHOD( void, deserialise, ( const BufferView, MarketUpdateBatch& ), ( const, override ) );
 };
 
+// Hands back whatever update message the test has set up, as the mock batch handler does for plain batches
+class FakeUpdateMessageHandler : public ISerialisableType<MarketUpdateMessage>
+{
+public:
+    explicit FakeUpdateMessageHandler( const MarketUpdateMessage& next ) : m_next( next ) {}
+
+    Buffer serialise( const MarketUpdateMessage& ) const override { return Buffer( 0 ); }
+    void   deserialise( const BufferView, MarketUpdateMessage& objOut ) const override { objOut = m_next; }
+
+private:
+    const MarketUpdateMessage& m_next;
+};
+
+class FakeEQRecordHandler : public ISerialisableType<Record<EQPrice>>
+{
+public:
+    Buffer serialise( const Record<EQPrice>& rec ) const override { return Buffer( rec.header.id.data(), rec.header.id.size() ); }
+
+    void deserialise( const BufferView buf, Record<EQPrice>& rec ) const override
+    {
+        rec.header.id.assign( reinterpret_cast<const char*>( buf.data ), buf.size );
+        rec.header.isActive = true;
+    }
+};
+
+Record<EQPrice> makeEQRecord( std::string id )
+{
+    Record<EQPrice> rec {};
+    rec.header.id       = std::move( id );
+    rec.header.isActive = true;
+    return rec;
+}
+
 }
 
 // ---------------------------------------------------------
@@ -95,6 +135,7 @@ protected:
 
     // Helper state to control the mock handler's behavior
     MarketUpdateBatch                             nextBatchToReturn;
+    MarketUpdateMessage                           nextUpdateMsgToReturn;
     bool                                          shouldThrowDuringDeserialise = false;
 
     // Capture the handler so we can simulate incoming network messages
@@ -133,6 +174,7 @@ protected:
             } ) );
 
             realSerialiser->registerHandler<MarketUpdateBatch>( std::move( handlerMock ) );
+            realSerialiser->registerHandler<MarketUpdateMessage>( std::make_unique<FakeUpdateMessageHandler>( nextUpdateMsgToReturn ) );
 
             // --- Factory Injection ---
             MessagingServiceFactory::inst().addCustomService( "MOCK_NATS", mockMsgSvc );
@@ -187,6 +229,16 @@ TEST_F( LiveMarketUpdaterTest, StartsInLiveModeWithoutBaseline )
     ASSERT_NE( activeHandler, nullptr ); // Verifies it connected
 }
 
+TEST_F( LiveMarketUpdaterTest, ThrowsIfStartedTwice )
+{
+    auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+        market, "", "MOCK_NATS", MarketName( "PROD_FX" ), TIDSet(), TIDSet()
+    } );
+    updater->start();
+
+    EXPECT_THROW( updater->start(), ARQException );
+}
+
 TEST_F( LiveMarketUpdaterTest, FiltersByMsgTIDSetInLiveMode )
 {
     // Setup TIDSet to only allow GBP
@@ -203,8 +255,9 @@ TEST_F( LiveMarketUpdaterTest, FiltersByMsgTIDSetInLiveMode )
     this->nextBatchToReturn.records.get<Record<FXRate>>().push_back( makeFXRecord( "GBP", 1.29, 100 ) );
     this->nextBatchToReturn.offsets.emplace( std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 10 );
 
-    // Fire the NATS message
+    // Fire the NATS message and wait for the apply thread
     activeHandler->onMsg( Message{} );
+    updater->flush();
 
     // Assert: GBP was applied, EUR was filtered out
     auto snap = market->snapshot();
@@ -224,6 +277,7 @@ TEST_F( LiveMarketUpdaterTest, RejectsStaleOffsets )
     this->nextBatchToReturn.offsets.emplace( std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 100 );
     this->nextBatchToReturn.records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.08, 100 ) );
     activeHandler->onMsg( Message{} );
+    updater->flush();
 
     EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.08 );
 
@@ -233,11 +287,42 @@ TEST_F( LiveMarketUpdaterTest, RejectsStaleOffsets )
     this->nextBatchToReturn.records.get<Record<FXRate>>().clear();
     this->nextBatchToReturn.records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 9.99, 200 ) );
     activeHandler->onMsg( Message{} );
+    updater->flush();
 
     // 3. Assert: The stale batch was completely ignored
     EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.08 );
 }
 
+TEST_F( LiveMarketUpdaterTest, TracksOffsetsPerPartition )
+{
+    auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+        market, "", "MOCK_NATS", MarketName( "PROD_FX" ), TIDSet(), TIDSet()
+    } );
+    updater->start();
+
+    const auto send = [this, &updater] ( const StreamTopicPartitionOffsets& offsets, const double mid, const uint64_t ts )
+    {
+        this->nextBatchToReturn.offsets = offsets;
+        this->nextBatchToReturn.records.get<Record<FXRate>>() = { makeFXRecord( "EUR", mid, ts ) };
+        activeHandler->onMsg( Message{} );
+        updater->flush();
+    };
+
+    send( { { std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 100 }, { std::make_pair( "ARQ.MktData.Updates.FXR", 1 ), 200 } }, 1.08, 100 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.08 );
+
+    // Only partition 1 - partition 0 must still be remembered at 100 afterwards
+    send( { { std::make_pair( "ARQ.MktData.Updates.FXR", 1 ), 201 } }, 1.09, 200 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.09 );
+
+    send( { { std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 50 } }, 9.99, 300 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.09 );
+
+    // A partition not seen before is always newer
+    send( { { std::make_pair( "ARQ.MktData.Updates.FXR", 3 ), 0 } }, 1.10, 400 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.10 );
+}
+
 TEST_F( LiveMarketUpdaterTest, BuffersAndReconcilesDuringStartup )
 {
     auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
@@ -273,6 +358,75 @@ TEST_F( LiveMarketUpdaterTest, BuffersAndReconcilesDuringStartup )
     EXPECT_DOUBLE_EQ( snap->get<FXRate>( "EUR" )->data.mid, 1.08 );
 }
 
+TEST_F( LiveMarketUpdaterTest, LoadsOffsetsBeforeTheBaselineRecords )
+{
+    auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+        market, "MOCK_DB", "MOCK_NATS", MarketName( "PROD_FX" ), TIDSet(), TIDSet()
+    } );
+
+    // Offsets read after the records could claim updates the records never saw
+    std::atomic<bool> offsetsLoaded = false;
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Invoke( [&offsetsLoaded] ( const std::string_view ) -> std::optional<StreamTopicPartitionOffsets>
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+        offsetsLoaded = true;
+        return StreamTopicPartitionOffsets{ { std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 100 } };
+    } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [&offsetsLoaded] ( const std::string_view, const TIDSet& )
+    {
+        EXPECT_TRUE( offsetsLoaded );
+        return RecordCollection();
+    } ) );
+
+    updater->start();
+}
+
+TEST_F( LiveMarketUpdaterTest, GroupCommitsAndConflatesBufferedBatches )
+{
+    auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+        market, "MOCK_DB", "MOCK_NATS", MarketName( "PROD_FX" ), TIDSet(), TIDSet()
+    } );
+
+    StreamTopicPartitionOffsets baselineOffsets;
+    baselineOffsets.emplace( std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 100 );
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( baselineOffsets ) );
+
+    RecordCollection baselineRecords;
+    baselineRecords.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.05, 50 ) );
+
+    // Buffer three batches for the same id while the baseline is loading
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [&] ( const std::string_view, const TIDSet& )
+    {
+        for( int i = 1; i <= 3; ++i )
+        {
+            this->nextBatchToReturn.offsets.clear();
+            this->nextBatchToReturn.offsets.emplace( std::make_pair( "ARQ.MktData.Updates.FXR", 0 ), 100 + i );
+            this->nextBatchToReturn.records.get<Record<FXRate>>().clear();
+            this->nextBatchToReturn.records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.05 + 0.01 * i, 100 + i ) );
+
+            activeHandler->onMsg( Message{} );
+        }
+
+        return baselineRecords;
+    } ) );
+
+    updater->start();
+    updater->flush();
+
+    // The latest buffered price wins
+    auto snap = market->snapshot();
+    ASSERT_TRUE( snap->get<FXRate>( "EUR" ) );
+    EXPECT_DOUBLE_EQ( snap->get<FXRate>( "EUR" )->data.mid, 1.08 );
+
+    // All three batches went into a single market update, with the superseded records conflated away
+    const auto stats = updater->getStats();
+    EXPECT_EQ( stats.batchesReceived, 3 );
+    EXPECT_EQ( stats.batchesApplied, 3 );
+    EXPECT_EQ( stats.marketUpdates, 1 );
+    EXPECT_EQ( stats.recordsReceived, 3 );
+    EXPECT_EQ( stats.recordsApplied, 1 );
+}
+
 TEST_F( LiveMarketUpdaterTest, HandlesDeserialisationFailureGracefully )
 {
     auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
@@ -292,4 +446,476 @@ TEST_F( LiveMarketUpdaterTest, HandlesDeserialisationFailureGracefully )
 
     // Assert: Market remains completely untouched
     EXPECT_FALSE( market->snapshot()->get<FXRate>( "EUR" ) );
-}
\ No newline at end of file
+}
+
+TEST_F( LiveMarketUpdaterTest, LoadsBaselineOncePerTypeWhenSplitByType )
+{
+    auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+        .mkt               = market,
+        .mktSrcDSH         = "MOCK_DB",
+        .msgSvcDSH         = "MOCK_NATS",
+        .mktName           = MarketName( "PROD_FX" ),
+        .mktSrcTIDSet      = TIDSet(),
+        .msgTIDSet         = TIDSet(),
+        .parallelTypeLoads = true
+    } );
+
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( std::nullopt ) );
+
+    // Every load hands back both types, so this also checks only the requested type is taken from each
+    std::atomic<int> numLoads = 0;
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillRepeatedly( Invoke( [&numLoads] ( const std::string_view, const TIDSet& filter )
+    {
+        ++numLoads;
+        EXPECT_EQ( filter.getAll().size(), 1 );
+
+        Record<EQPrice> eqp {};
+        eqp.header.id       = "VOD.L";
+        eqp.header.isActive = true;
+
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.05, 50 ) );
+        records.get<Record<EQPrice>>().push_back( eqp );
+        return records;
+    } ) );
+
+    updater->start();
+
+    const auto& stats = updater->getBaselineLoadStats();
+    EXPECT_EQ( numLoads, static_cast<int>( stats.types.size() ) );
+    EXPECT_EQ( stats.types.size(), 2 );
+    EXPECT_EQ( stats.numRecords, 2 );
+
+    auto snap = market->snapshot();
+    EXPECT_TRUE( snap->get<FXRate>( "EUR" ) );
+    EXPECT_TRUE( snap->get<EQPrice>( "VOD.L" ) );
+}
+
+TEST_F( LiveMarketUpdaterTest, SplitByTypeSkipsTypesOutsideTheFilter )
+{
+    TIDSet srcFilter;
+    srcFilter.insert( TID( Type::FXR, "EUR" ) );
+
+    auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+        .mkt               = market,
+        .mktSrcDSH         = "MOCK_DB",
+        .msgSvcDSH         = "MOCK_NATS",
+        .mktName           = MarketName( "PROD_FX" ),
+        .mktSrcTIDSet      = srcFilter,
+        .msgTIDSet         = TIDSet(),
+        .parallelTypeLoads = true
+    } );
+
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& filter )
+    {
+        EXPECT_TRUE( filter.contains( TID( Type::FXR, "EUR" ) ) );
+        EXPECT_TRUE( std::holds_alternative<TIDSet::None>( filter.getIDsForType( Type::EQP ) ) );
+
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.05, 50 ) );
+        return records;
+    } ) );
+
+    updater->start();
+
+    ASSERT_EQ( updater->getBaselineLoadStats().types.size(), 1 );
+    EXPECT_EQ( updater->getBaselineLoadStats().types[0].type, Type::FXR );
+    EXPECT_TRUE( market->snapshot()->get<FXRate>( "EUR" ) );
+}
+
+class LiveMarketUpdaterResyncTest : public LiveMarketUpdaterTest
+{
+protected:
+    StreamTopicPartition fxTP = StreamTopicPartition( "ARQ.MktData.Updates.FXR", 0 );
+    StreamTopicPartition eqTP = StreamTopicPartition( "ARQ.MktData.Updates.EQP", 0 );
+
+    std::shared_ptr<LiveMarketUpdater> startUpdater( const BackoffPolicy::Spec& resyncBackoff = {}, const size_t applyQueueCapacity = LiveMarketUpdater::DEFAULT_APPLY_QUEUE_CAPACITY )
+    {
+        auto updater = LiveMarketUpdater::create( LiveMarketUpdater::Params{
+            .mkt                = market,
+            .mktSrcDSH          = "MOCK_DB",
+            .msgSvcDSH          = "MOCK_NATS",
+            .mktName            = MarketName( "PROD_FX" ),
+            .mktSrcTIDSet       = TIDSet(),
+            .msgTIDSet          = TIDSet(),
+            .applyQueueCapacity = applyQueueCapacity,
+            .resyncBackoff      = resyncBackoff
+        } );
+
+        // Baseline of FX at offset 100 and EQ at 10
+        EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 100 }, { eqTP, 10 } } ) );
+        EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& )
+        {
+            RecordCollection records;
+            records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.05, 50 ) );
+            records.get<Record<EQPrice>>().push_back( makeEQRecord( "VOD.L" ) );
+            return records;
+        } ) );
+
+        updater->start();
+        ::testing::Mock::VerifyAndClearExpectations( mockOffsetSrc.get() );
+        ::testing::Mock::VerifyAndClearExpectations( mockMarketSrc.get() );
+        return updater;
+    }
+
+    template<c_MktData T>
+    void send( LiveMarketUpdater& updater, const StreamTopicPartition& tp, const int64_t prevOffset, const int64_t offset, Record<T> record )
+    {
+        MarketUpdateBatch batch;
+        batch.records.get<Record<T>>().push_back( std::move( record ) );
+        batch.offsets.emplace( tp, offset );
+        batch.prevOffsets.emplace( tp, prevOffset );
+        nextBatchToReturn = batch;
+        activeHandler->onMsg( Message{} );
+        updater.flush();
+    }
+
+    // The resync hands its result back from another thread, so poll for it before flushing what it replays
+    template<typename Pred>
+    static void waitFor( LiveMarketUpdater& updater, Pred pred )
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+        while( !pred( updater.getStats() ) && std::chrono::steady_clock::now() < deadline )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        updater.flush();
+    }
+};
+
+TEST_F( LiveMarketUpdaterResyncTest, NoResyncWithoutAGap )
+{
+    auto updater = startUpdater();
+
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).Times( 0 );
+    send( *updater, fxTP, 100, 105, makeFXRecord( "EUR", 1.10, 100 ) );
+    send( *updater, fxTP, 105, 107, makeFXRecord( "EUR", 1.11, 200 ) );
+
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.11 );
+    EXPECT_EQ( updater->getStats().gapsDetected, 0 );
+}
+
+TEST_F( LiveMarketUpdaterResyncTest, ResyncsOnlyTheTypeWithAGap )
+{
+    auto updater = startUpdater();
+
+    // Hold the resync's load open so updates can be sent while it's in flight
+    std::promise<void> releaseLoad;
+    std::shared_future<void> released = releaseLoad.get_future().share();
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 104 }, { eqTP, 10 } } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [released] ( const std::string_view, const TIDSet& filter )
+    {
+        EXPECT_TRUE( std::holds_alternative<TIDSet::All>( filter.getIDsForType( Type::FXR ) ) );
+        EXPECT_TRUE( std::holds_alternative<TIDSet::None>( filter.getIDsForType( Type::EQP ) ) );
+        released.wait();
+
+        // Anything else the source hands back is ignored
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.20, 150 ) );
+        records.get<Record<EQPrice>>().push_back( makeEQRecord( "BARC.L" ) );
+        return records;
+    } ) );
+
+    // The batch ending at 103 was missed
+    send( *updater, fxTP, 103, 105, makeFXRecord( "EUR", 1.30, 200 ) );
+    EXPECT_EQ( updater->getStats().gapsDetected, 1 );
+    EXPECT_EQ( updater->getStats().resyncsActive, 1 );
+
+    // FX is held back until the resync completes, EQ carries on
+    send( *updater, fxTP, 105, 106, makeFXRecord( "EUR", 1.40, 300 ) );
+    send( *updater, eqTP, 10, 11, makeEQRecord( "HSBA.L" ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.05 );
+    EXPECT_TRUE( market->snapshot()->get<EQPrice>( "HSBA.L" ) );
+
+    releaseLoad.set_value();
+    waitFor( *updater, [] ( const LiveMarketUpdater::Stats& stats ) { return stats.resyncs == 1; } );
+
+    // The held back updates are replayed on top of the resynced records
+    const auto stats = updater->getStats();
+    EXPECT_EQ( stats.resyncsActive, 0 );
+    EXPECT_EQ( stats.resyncFailures, 0 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.40 );
+    EXPECT_FALSE( market->snapshot()->get<EQPrice>( "BARC.L" ) );
+    EXPECT_TRUE( market->snapshot()->get<EQPrice>( "HSBA.L" ) );
+
+    // And FX carries on from there
+    send( *updater, fxTP, 106, 108, makeFXRecord( "EUR", 1.50, 400 ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.50 );
+    EXPECT_EQ( updater->getStats().gapsDetected, 1 );
+}
+
+TEST_F( LiveMarketUpdaterResyncTest, ResyncErasesIdsDeletedDuringTheGap )
+{
+    auto updater = startUpdater();
+    send( *updater, fxTP, 100, 102, makeFXRecord( "GBP", 1.25, 100 ) );
+    ASSERT_TRUE( market->snapshot()->get<FXRate>( "GBP" ) );
+
+    // The missed batch ending at 103 deleted GBP, so the source no longer has it
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 105 }, { eqTP, 10 } } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& )
+    {
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.30, 200 ) );
+        return records;
+    } ) );
+
+    send( *updater, fxTP, 103, 105, makeFXRecord( "EUR", 1.30, 200 ) );
+    waitFor( *updater, [] ( const LiveMarketUpdater::Stats& stats ) { return stats.resyncs == 1; } );
+
+    EXPECT_FALSE( market->snapshot()->get<FXRate>( "GBP" ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.30 );
+    EXPECT_TRUE( market->snapshot()->get<EQPrice>( "VOD.L" ) );
+
+    send( *updater, fxTP, 105, 106, makeFXRecord( "EUR", 1.40, 300 ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.40 );
+    EXPECT_EQ( updater->getStats().gapsDetected, 1 );
+}
+
+TEST_F( LiveMarketUpdaterResyncTest, KeepsAppliedOffsetsTheSourceHasNotReached )
+{
+    auto updater = startUpdater();
+    const StreamTopicPartition fxTP1( "ARQ.MktData.Updates.FXR", 1 );
+    send( *updater, fxTP, 100, 102, makeFXRecord( "GBP", 1.25, 100 ) );
+
+    // The source has the gap on partition 1 but is still behind what was applied on partition 0, so GBP - which it hasn't seen yet - stays
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 101 }, { fxTP1, 5 }, { eqTP, 10 } } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& )
+    {
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.30, 200 ) );
+        return records;
+    } ) );
+
+    send( *updater, fxTP1, 3, 5, makeFXRecord( "EUR", 1.30, 200 ) );
+    waitFor( *updater, [] ( const LiveMarketUpdater::Stats& stats ) { return stats.resyncs == 1; } );
+
+    EXPECT_TRUE( market->snapshot()->get<FXRate>( "GBP" ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.30 );
+
+    // Partition 0 didn't go back to the source's offset, so a replay of what was applied on it is still stale
+    send( *updater, fxTP, 100, 102, makeFXRecord( "GBP", 1.10, 400 ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "GBP" )->data.mid, 1.25 );
+    EXPECT_EQ( updater->getStats().gapsDetected, 1 );
+}
+
+TEST_F( LiveMarketUpdaterResyncTest, ResyncsTypesWithDeltaRecordsMissingTheirBase )
+{
+    auto updater = startUpdater();
+
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 101 }, { eqTP, 10 } } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& filter )
+    {
+        EXPECT_TRUE( std::holds_alternative<TIDSet::None>( filter.getIDsForType( Type::EQP ) ) );
+
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.20, 150 ) );
+        return records;
+    } ) );
+
+    // Delta encoded against a base this subscriber never had - the record is dropped but its offsets still move FX on
+    nextUpdateMsgToReturn.publisherID = "pub";
+    nextUpdateMsgToReturn.seq         = 1;
+    nextUpdateMsgToReturn.deltaMasks  = { 1 };
+    nextUpdateMsgToReturn.batch.records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 0.0, 150 ) );
+    nextUpdateMsgToReturn.batch.offsets.emplace( fxTP, 101 );
+    nextUpdateMsgToReturn.batch.prevOffsets.emplace( fxTP, 100 );
+
+    Message msg;
+    msg.headers[std::string( MarketUpdateMessage::TYPE_HEADER )] = { std::string( MarketUpdateMessage::TYPE ) };
+    activeHandler->onMsg( std::move( msg ) );
+    updater->flush();
+    waitFor( *updater, [] ( const LiveMarketUpdater::Stats& stats ) { return stats.resyncs == 1; } );
+
+    const auto stats = updater->getStats();
+    EXPECT_EQ( stats.deltaMisses, 1 );
+    EXPECT_EQ( stats.gapsDetected, 1 ); // Counted as a missed update, as for a dropped batch
+    EXPECT_EQ( stats.resyncsActive, 0 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.20 );
+}
+
+TEST_F( LiveMarketUpdaterResyncTest, CarriesOnFromTheStreamWhenResyncFails )
+{
+    auto updater = startUpdater( { .initial = std::chrono::milliseconds( 1 ), .multiplier = 1, .maxDelay = std::chrono::milliseconds( 1 ), .maxAttempts = 2 } );
+
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).Times( 3 ).WillRepeatedly( Return( StreamTopicPartitionOffsets{ { fxTP, 104 } } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).Times( 3 ).WillRepeatedly( Invoke( [] ( const std::string_view, const TIDSet& ) -> RecordCollection
+    {
+        throw ARQException( "Source down" );
+    } ) );
+
+    send( *updater, fxTP, 103, 105, makeFXRecord( "EUR", 1.30, 200 ) );
+    waitFor( *updater, [] ( const LiveMarketUpdater::Stats& stats ) { return stats.resyncFailures == 1; } );
+
+    EXPECT_EQ( updater->getStats().resyncsActive, 0 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.30 );
+
+    // Past the gap, so the next batch is applied as normal
+    send( *updater, fxTP, 105, 106, makeFXRecord( "EUR", 1.40, 300 ) );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.40 );
+    EXPECT_EQ( updater->getStats().gapsDetected, 1 );
+}
+
+TEST_F( LiveMarketUpdaterResyncTest, ResyncsInsteadOfBlockingWhenTheApplyQueueIsFull )
+{
+    auto updater = startUpdater( {}, 1 );
+
+    // Whatever is dropped, the source ends up with the last update
+    constexpr int64_t numBatches = 2000;
+    ON_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillByDefault( Return( StreamTopicPartitionOffsets{ { fxTP, 100 + numBatches }, { eqTP, 10 } } ) );
+    ON_CALL( *mockMarketSrc, load( _, _ ) ).WillByDefault( Invoke( [] ( const std::string_view, const TIDSet& )
+    {
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 2.0, 100 + numBatches ) );
+        return records;
+    } ) );
+
+    // Sent as fast as possible, without waiting on the apply thread, so a queue of one overflows
+    for( int64_t i = 1; i <= numBatches; ++i )
+    {
+        nextBatchToReturn = MarketUpdateBatch();
+        nextBatchToReturn.records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", i == numBatches ? 2.0 : 1.0, 100 + i ) );
+        nextBatchToReturn.offsets.emplace( fxTP, 100 + i );
+        nextBatchToReturn.prevOffsets.emplace( fxTP, 100 + i - 1 );
+        activeHandler->onMsg( Message{} );
+    }
+    updater->flush();
+    waitFor( *updater, [] ( const LiveMarketUpdater::Stats& stats ) { return stats.resyncsActive == 0; } );
+
+    const auto stats = updater->getStats();
+    EXPECT_GE( stats.batchesReceived, numBatches ); // Plus a wake up per resync
+    if( stats.batchesDropped )
+        EXPECT_GE( stats.resyncs, 1 );
+    EXPECT_EQ( stats.resyncsActive, 0 );
+    EXPECT_DOUBLE_EQ( market->snapshot()->get<FXRate>( "EUR" )->data.mid, 2.0 );
+}
+
+class LiveMarketUpdaterCacheTest : public LiveMarketUpdaterTest
+{
+protected:
+    std::filesystem::path cachePath;
+    StreamTopicPartition  fxTP;
+    StreamTopicPartition  eqTP;
+
+    void SetUp() override
+    {
+        LiveMarketUpdaterTest::SetUp();
+
+        auto serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
+        serialiser->registerHandler<Record<FXRate>>( std::make_unique<FakeFXRecordHandler>() );
+        serialiser->registerHandler<Record<EQPrice>>( std::make_unique<FakeEQRecordHandler>() );
+
+        cachePath = std::filesystem::temp_directory_path() / std::format( "arq_live_{}.mktcache", ::testing::UnitTest::GetInstance()->current_test_info()->name() );
+        std::filesystem::remove( cachePath );
+
+        fxTP = StreamTopicPartition( std::string( getUpdateTopic( Type::FXR ) ), 0 );
+        eqTP = StreamTopicPartition( std::string( getUpdateTopic( Type::EQP ) ), 0 );
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove( cachePath );
+        LiveMarketUpdaterTest::TearDown();
+    }
+
+    std::shared_ptr<LiveMarketUpdater> makeUpdater( const std::shared_ptr<Market>& mkt ) const
+    {
+        return LiveMarketUpdater::create( LiveMarketUpdater::Params{
+            .mkt               = mkt,
+            .mktSrcDSH         = "MOCK_DB",
+            .msgSvcDSH         = "MOCK_NATS",
+            .mktName           = MarketName( "PROD_FX" ),
+            .mktSrcTIDSet      = TIDSet(),
+            .msgTIDSet         = TIDSet(),
+            .snapshotCachePath = cachePath
+        } );
+    }
+
+    // Cold start with FX at offset 10 and EQ at 5, then stop so the market is saved to the cache
+    void coldStartAndSave()
+    {
+        EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 10 }, { eqTP, 5 } } ) );
+        EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& )
+        {
+            RecordCollection records;
+            records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 1.05, 50 ) );
+            records.get<Record<EQPrice>>().push_back( makeEQRecord( "VOD.L" ) );
+            return records;
+        } ) );
+
+        auto updater = makeUpdater( market );
+        updater->start();
+        updater->stop();
+
+        EXPECT_EQ( updater->getBaselineLoadStats().numCachedRecords, 0 );
+        ASSERT_TRUE( std::filesystem::exists( cachePath ) );
+        ::testing::Mock::VerifyAndClearExpectations( mockOffsetSrc.get() );
+        ::testing::Mock::VerifyAndClearExpectations( mockMarketSrc.get() );
+    }
+};
+
+TEST_F( LiveMarketUpdaterCacheTest, WarmStartOnlyReloadsTypesThatMovedOn )
+{
+    coldStartAndSave();
+
+    // FX hasn't moved on in the source so comes from the cache, EQ has so is reloaded on its own
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( StreamTopicPartitionOffsets{ { fxTP, 10 }, { eqTP, 7 } } ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& filter )
+    {
+        EXPECT_TRUE( std::holds_alternative<TIDSet::None>( filter.getIDsForType( Type::FXR ) ) );
+        EXPECT_TRUE( std::holds_alternative<TIDSet::All>( filter.getIDsForType( Type::EQP ) ) );
+
+        RecordCollection records;
+        records.get<Record<EQPrice>>().push_back( makeEQRecord( "BARC.L" ) );
+        return records;
+    } ) );
+
+    auto warmMarket = std::make_shared<Market>();
+    auto updater    = makeUpdater( warmMarket );
+    updater->start();
+
+    const auto& stats = updater->getBaselineLoadStats();
+    EXPECT_EQ( stats.numCachedRecords, 1 );
+    ASSERT_EQ( stats.types.size(), 1 );
+    EXPECT_EQ( stats.types[0].type, Type::EQP );
+
+    auto snap = warmMarket->snapshot();
+    ASSERT_TRUE( snap->get<FXRate>( "EUR" ) );
+    EXPECT_DOUBLE_EQ( snap->get<FXRate>( "EUR" )->data.mid, 1.05 );
+    EXPECT_TRUE( snap->get<EQPrice>( "BARC.L" ) );
+    EXPECT_FALSE( snap->get<EQPrice>( "VOD.L" ) );
+
+    // Resumed from the cached FX offsets, so a replayed update is still dropped as stale
+    MarketUpdateBatch batch;
+    batch.records.get<Record<FXRate>>().push_back( makeFXRecord( "EUR", 9.99, 60 ) );
+    batch.offsets.emplace( fxTP, 10 );
+    nextBatchToReturn = batch;
+    activeHandler->onMsg( Message{} );
+    updater->flush();
+    EXPECT_DOUBLE_EQ( warmMarket->snapshot()->get<FXRate>( "EUR" )->data.mid, 1.05 );
+
+    updater->stop();
+}
+
+TEST_F( LiveMarketUpdaterCacheTest, FullLoadWithoutSourceOffsets )
+{
+    coldStartAndSave();
+
+    // Nothing to check the cache against, so it isn't used
+    EXPECT_CALL( *mockOffsetSrc, getOffsets( _ ) ).WillOnce( Return( std::nullopt ) );
+    EXPECT_CALL( *mockMarketSrc, load( _, _ ) ).WillOnce( Invoke( [] ( const std::string_view, const TIDSet& filter )
+    {
+        EXPECT_TRUE( filter.empty() );
+
+        RecordCollection records;
+        records.get<Record<FXRate>>().push_back( makeFXRecord( "GBP", 1.25, 50 ) );
+        return records;
+    } ) );
+
+    auto warmMarket = std::make_shared<Market>();
+    auto updater    = makeUpdater( warmMarket );
+    updater->start();
+
+    EXPECT_EQ( updater->getBaselineLoadStats().numCachedRecords, 0 );
+    EXPECT_TRUE( warmMarket->snapshot()->get<FXRate>( "GBP" ) );
+    EXPECT_FALSE( warmMarket->snapshot()->get<FXRate>( "EUR" ) );
+
+    updater->stop();
+}
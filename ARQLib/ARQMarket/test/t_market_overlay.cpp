@@ -0,0 +1,117 @@
+#include <ARQMarket/market_overlay.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::Time;
+
+namespace
+{
+
+Record<FXRate> makeFXRecord( std::string id, double mid, uint64_t ts = 100, bool active = true )
+{
+    Record<FXRate> rec;
+    rec.header.id = std::move( id );
+    rec.header.asofTs = DateTime( Microseconds( ts ) );
+    rec.header.isActive = active;
+    rec.data.mid = mid;
+    return rec;
+}
+
+}
+
+class MarketOverlayTest : public ::testing::Test
+{
+protected:
+    std::shared_ptr<const MarketSnapshot> base;
+
+    void SetUp() override
+    {
+        Market market;
+        RecordCollection rc;
+        rc.get<Record<FXRate>>() = { makeFXRecord( "EUR/USD", 1.10 ), makeFXRecord( "GBP/USD", 1.25 ), makeFXRecord( "USD/JPY", 150.0 ) };
+        market.update( std::move( rc ) );
+        base = market.snapshot();
+    }
+};
+
+TEST_F( MarketOverlayTest, UntouchedRecordsAreReadFromTheBase )
+{
+    MarketOverlay overlay( base );
+    overlay.set<FXRate>( makeFXRecord( "EUR/USD", 1.20 ) );
+
+    EXPECT_DOUBLE_EQ( overlay.get<FXRate>( "EUR/USD" )->data.mid, 1.20 );
+    EXPECT_DOUBLE_EQ( base->get<FXRate>( "EUR/USD" )->data.mid, 1.10 );
+
+    // Not copied - the very same record as the base holds
+    EXPECT_EQ( &*overlay.get<FXRate>( "GBP/USD" ), &*base->get<FXRate>( "GBP/USD" ) );
+    EXPECT_EQ( overlay.numOverrides(), 1 );
+}
+
+TEST_F( MarketOverlayTest, OverridesCanInsertAndErase )
+{
+    MarketOverlay overlay( base );
+    overlay.set<FXRate>( makeFXRecord( "AUD/USD", 0.66 ) );
+    overlay.set<FXRate>( makeFXRecord( "GBP/USD", 0.0, 100, false ) );
+    overlay.erase<FXRate>( "USD/JPY" );
+
+    EXPECT_DOUBLE_EQ( overlay.get<FXRate>( "AUD/USD" )->data.mid, 0.66 );
+    EXPECT_FALSE( overlay.get<FXRate>( "GBP/USD" ) );
+    EXPECT_FALSE( overlay.get<FXRate>( "USD/JPY" ) );
+    EXPECT_EQ( overlay.size<FXRate>(), 2 );
+
+    std::vector<std::string> ids;
+    overlay.forEach<FXRate>( [&ids] ( const Record<FXRate>& rcd ) { ids.push_back( rcd.header.id ); } );
+    std::ranges::sort( ids );
+    EXPECT_EQ( ids, ( std::vector<std::string>{ "AUD/USD", "EUR/USD" } ) );
+}
+
+TEST_F( MarketOverlayTest, ShiftsApplyInOrder )
+{
+    MarketOverlay overlay( base );
+
+    EXPECT_TRUE( overlay.shift( TID( Type::FXR, "EUR/USD" ), MarketShift{ MarketShift::Kind::ABSOLUTE, 0.01 } ) );
+    EXPECT_TRUE( overlay.shift( TID( Type::FXR ), MarketShift{ MarketShift::Kind::RELATIVE, 0.10 } ) );
+    EXPECT_FALSE( overlay.shift( TID( Type::FXR, "NZD/USD" ), MarketShift{ MarketShift::Kind::ABSOLUTE, 0.01 } ) );
+
+    EXPECT_DOUBLE_EQ( overlay.get<FXRate>( "EUR/USD" )->data.mid, ( 1.10 + 0.01 ) * 1.10 );
+    EXPECT_DOUBLE_EQ( overlay.get<FXRate>( "USD/JPY" )->data.mid, 150.0 * 1.10 );
+    EXPECT_FALSE( overlay.get<FXRate>( "NZD/USD" ) );
+
+    // Lookups of a parallel shifted record keep returning the same record
+    EXPECT_EQ( &*overlay.get<FXRate>( "USD/JPY" ), &*overlay.get<FXRate>( "USD/JPY" ) );
+
+    double total = 0.0;
+    overlay.forEach<FXRate>( [&total] ( const Record<FXRate>& rcd ) { total += rcd.data.mid; } );
+    EXPECT_DOUBLE_EQ( total, ( 1.11 + 1.25 + 150.0 ) * 1.10 );
+
+    // The base is untouched
+    EXPECT_DOUBLE_EQ( base->get<FXRate>( "USD/JPY" )->data.mid, 150.0 );
+}
+
+TEST_F( MarketOverlayTest, BuildsOneOverlayPerScenarioOverASharedBase )
+{
+    std::vector<MarketScenario> scenarios( 3 );
+    for( size_t i = 0; i < scenarios.size(); ++i )
+    {
+        scenarios[i].name = "FX up " + std::to_string( i );
+        scenarios[i].bumps.push_back( { TID( Type::FXR ), MarketShift{ MarketShift::Kind::ABSOLUTE, static_cast<double>( i ) } } );
+    }
+    scenarios[2].overrides.get<Record<FXRate>>().push_back( makeFXRecord( "EUR/USD", 2.0 ) );
+
+    const auto overlays = MarketOverlay::build( base, scenarios );
+    ASSERT_EQ( overlays.size(), 3 );
+
+    for( const MarketOverlay& overlay : overlays )
+        EXPECT_EQ( overlay.base(), base );
+
+    EXPECT_DOUBLE_EQ( overlays[0].get<FXRate>( "GBP/USD" )->data.mid, 1.25 );
+    EXPECT_DOUBLE_EQ( overlays[1].get<FXRate>( "GBP/USD" )->data.mid, 2.25 );
+    EXPECT_DOUBLE_EQ( overlays[2].get<FXRate>( "GBP/USD" )->data.mid, 3.25 );
+
+    // Overrides go in before the bumps
+    EXPECT_DOUBLE_EQ( overlays[2].get<FXRate>( "EUR/USD" )->data.mid, 4.0 );
+    EXPECT_EQ( overlays[2].numOverrides(), 1 );
+}
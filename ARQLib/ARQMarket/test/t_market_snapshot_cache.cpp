@@ -0,0 +1,130 @@
+#include <ARQMarket/market_snapshot_cache.h>
+#include <gtest/gtest.h>
+
+#include "fake_record_handlers.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::Time;
+
+namespace
+{
+
+Record<FXRate> makeFXRecord( std::string id, double mid, uint64_t ts )
+{
+    Record<FXRate> rec;
+    rec.header.id = std::move( id );
+    rec.header.asofTs = DateTime( Microseconds( ts ) );
+    rec.header.isActive = true;
+    rec.data.mid = mid;
+    return rec;
+}
+
+}
+
+class MarketSnapshotCacheTest : public ::testing::Test
+{
+protected:
+    std::filesystem::path       path;
+    std::shared_ptr<Serialiser> serialiser;
+    Market                      market;
+    StreamTopicPartitionOffsets offsets;
+
+    void SetUp() override
+    {
+        path = std::filesystem::temp_directory_path() / std::format( "arq_snapshot_cache_{}.bin", ::testing::UnitTest::GetInstance()->current_test_info()->name() );
+        std::filesystem::remove( path );
+
+        serialiser = std::make_shared<Serialiser>();
+        serialiser->registerHandler<Record<FXRate>>( std::make_unique<FakeFXRecordHandler>() );
+
+        RecordCollection rc;
+        rc.get<Record<FXRate>>() = { makeFXRecord( "EUR", 1.05, 100 ), makeFXRecord( "GBP", 1.25, 200 ) };
+        market.update( std::move( rc ) );
+
+        offsets = { { StreamTopicPartition( "ARQ.MktData.Updates.FXR", 0 ), 42 }, { StreamTopicPartition( "ARQ.MktData.Updates.FXR", 1 ), 7 } };
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove( path );
+    }
+
+    void corruptByteAt( const std::streamoff pos ) const
+    {
+        std::fstream fs( path, std::ios::binary | std::ios::in | std::ios::out );
+        fs.seekg( pos );
+        char c;
+        fs.get( c );
+        fs.seekp( pos );
+        fs.put( static_cast<char>( c ^ 0xFF ) );
+    }
+};
+
+TEST_F( MarketSnapshotCacheTest, RoundTripsRecordsAndOffsets )
+{
+    MarketSnapshotCache cache( path, "LIVE", serialiser );
+    cache.save( *market.snapshot(), offsets );
+
+    const auto contents = cache.load();
+    ASSERT_TRUE( contents.has_value() );
+    EXPECT_EQ( contents->offsets, offsets );
+
+    const auto& fxRecords = contents->records.get<Record<FXRate>>();
+    ASSERT_EQ( fxRecords.size(), 2 );
+
+    Market reloaded;
+    reloaded.update( RecordCollection( contents->records ) );
+    ASSERT_TRUE( reloaded.snapshot()->get<FXRate>( "GBP" ) );
+    EXPECT_DOUBLE_EQ( reloaded.snapshot()->get<FXRate>( "GBP" )->data.mid, 1.25 );
+    EXPECT_EQ( reloaded.snapshot()->get<FXRate>( "EUR" )->header.asofTs, DateTime( Microseconds( 100 ) ) );
+}
+
+TEST_F( MarketSnapshotCacheTest, SaveReplacesThePreviousCache )
+{
+    MarketSnapshotCache cache( path, "LIVE", serialiser );
+    cache.save( *market.snapshot(), offsets );
+
+    RecordCollection rc;
+    rc.get<Record<FXRate>>() = { makeFXRecord( "JPY", 150.0, 300 ) };
+    market.update( std::move( rc ) );
+    offsets[StreamTopicPartition( "ARQ.MktData.Updates.FXR", 0 )] = 43;
+    cache.save( *market.snapshot(), offsets );
+
+    const auto contents = cache.load();
+    ASSERT_TRUE( contents.has_value() );
+    EXPECT_EQ( contents->records.get<Record<FXRate>>().size(), 3 );
+    EXPECT_EQ( contents->offsets, offsets );
+}
+
+TEST_F( MarketSnapshotCacheTest, MissingFileIsIgnored )
+{
+    MarketSnapshotCache cache( path, "LIVE", serialiser );
+    EXPECT_FALSE( cache.load().has_value() );
+}
+
+TEST_F( MarketSnapshotCacheTest, FileForAnotherKeyIsIgnored )
+{
+    MarketSnapshotCache( path, "LIVE", serialiser ).save( *market.snapshot(), offsets );
+    EXPECT_FALSE( MarketSnapshotCache( path, "EOD_20250101", serialiser ).load().has_value() );
+}
+
+TEST_F( MarketSnapshotCacheTest, CorruptOrTruncatedFileIsIgnored )
+{
+    MarketSnapshotCache cache( path, "LIVE", serialiser );
+
+    cache.save( *market.snapshot(), offsets );
+    corruptByteAt( static_cast<std::streamoff>( std::filesystem::file_size( path ) - 1 ) ); // In a record, caught by the checksum
+    EXPECT_FALSE( cache.load().has_value() );
+
+    cache.save( *market.snapshot(), offsets );
+    corruptByteAt( 4 ); // The format version
+    EXPECT_FALSE( cache.load().has_value() );
+
+    cache.save( *market.snapshot(), offsets );
+    std::filesystem::resize_file( path, std::filesystem::file_size( path ) - 1 );
+    EXPECT_FALSE( cache.load().has_value() );
+}
@@ -0,0 +1,145 @@
+#include <ARQMarket/mktdata_conflator.h>
+#include <gtest/gtest.h>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::Time;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const StreamTopicPartition TP0 = { "ARQ.MktData.Updates.FXR", 0 };
+const StreamTopicPartition TP1 = { "ARQ.MktData.Updates.FXR", 1 };
+
+Record<FXRate> makeFXRecord( std::string id, double mid, uint64_t ts, bool active = true )
+{
+    Record<FXRate> rec;
+    rec.header.id = std::move( id );
+    rec.header.asofTs = DateTime( Microseconds( ts ) );
+    rec.header.isActive = active;
+    rec.data.mid = mid;
+    return rec;
+}
+
+std::unordered_map<std::string, MarketUpdateBatch> makeBatches( const std::string& mktName, std::vector<Record<FXRate>> records, StreamTopicPartitionOffsets offsets )
+{
+    std::unordered_map<std::string, MarketUpdateBatch> batches;
+    MarketUpdateBatch& batch = batches[mktName];
+    batch.marketName = MarketName( mktName );
+    batch.records.get<Record<FXRate>>() = std::move( records );
+    batch.offsets = std::move( offsets );
+    return batches;
+}
+
+}
+
+TEST( MarketUpdateConflatorTest, KeepsNewestRecordPerId )
+{
+    MarketUpdateConflator conflator( { .window = 100ms } );
+    const auto now = MarketUpdateConflator::Clock::now();
+
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.1, 10 ), makeFXRecord( "GBPUSD", 1.3, 10 ) }, { { TP0, 5 } } ), now );
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.2, 20 ), makeFXRecord( "EURUSD", 1.0, 15 ) }, { { TP0, 7 }, { TP1, 2 } } ), now );
+
+    auto batches = conflator.take();
+    ASSERT_EQ( batches.size(), 1u );
+
+    const MarketUpdateBatch& batch = batches.at( "LIVE" );
+    const auto& records = batch.records.get<Record<FXRate>>();
+    ASSERT_EQ( records.size(), 2u );
+    EXPECT_EQ( records[0].header.id, "EURUSD" );
+    EXPECT_EQ( records[0].data.mid, 1.2 ); // The older record that came after it is dropped
+    EXPECT_EQ( records[1].header.id, "GBPUSD" );
+
+    EXPECT_EQ( batch.marketName, MarketName( "LIVE" ) );
+    EXPECT_EQ( batch.offsets.at( TP0 ), 7 );
+    EXPECT_EQ( batch.offsets.at( TP1 ), 2 );
+
+    const MarketUpdateConflator::Stats stats = conflator.getStats();
+    EXPECT_EQ( stats.received, 4u );
+    EXPECT_EQ( stats.forwarded, 2u );
+    EXPECT_EQ( stats.conflated, 2u );
+}
+
+TEST( MarketUpdateConflatorTest, LaterRecordWinsTiesIncludingDeletes )
+{
+    MarketUpdateConflator conflator( { .window = 100ms } );
+
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.1, 10 ), makeFXRecord( "EURUSD", 0, 10, false ) }, { { TP0, 1 } } ) );
+
+    auto batches = conflator.take();
+    const auto& records = batches.at( "LIVE" ).records.get<Record<FXRate>>();
+    ASSERT_EQ( records.size(), 1u );
+    EXPECT_FALSE( records[0].header.isActive );
+}
+
+TEST( MarketUpdateConflatorTest, HeldRecordsKeepThePartitionTheyWereReadFrom )
+{
+    MarketUpdateConflator conflator( { .window = 100ms } );
+
+    auto first = makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.1, 10 ), makeFXRecord( "GBPUSD", 1.3, 10 ) }, { { TP0, 5 } } );
+    first.at( "LIVE" ).recordPartitions[Type::FXR] = { 0, 0 };
+    conflator.add( std::move( first ) );
+
+    auto second = makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.2, 20 ), makeFXRecord( "GBPUSD", 1.0, 5 ) }, { { TP1, 2 } } );
+    second.at( "LIVE" ).recordPartitions[Type::FXR] = { 1, 1 };
+    conflator.add( std::move( second ) );
+
+    // Records whose partition isn't known
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "USDJPY", 151.2, 10 ) }, { { TP0, 6 } } ) );
+
+    auto batches = conflator.take();
+    const std::vector<int32_t> expected{ 1, 0, MarketUpdateBatch::NO_PARTITION };
+    EXPECT_EQ( batches.at( "LIVE" ).recordPartitions.at( Type::FXR ), expected );
+}
+
+TEST( MarketUpdateConflatorTest, KeysByMarket )
+{
+    MarketUpdateConflator conflator( { .window = 100ms } );
+
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.1, 10 ) }, { { TP0, 1 } } ) );
+    conflator.add( makeBatches( "EOD", { makeFXRecord( "EURUSD", 1.2, 20 ) }, { { TP1, 1 } } ) );
+
+    auto batches = conflator.take();
+    ASSERT_EQ( batches.size(), 2u );
+    EXPECT_EQ( batches.at( "LIVE" ).records.get<Record<FXRate>>().at( 0 ).data.mid, 1.1 );
+    EXPECT_EQ( batches.at( "EOD" ).records.get<Record<FXRate>>().at( 0 ).data.mid, 1.2 );
+    EXPECT_FALSE( batches.at( "LIVE" ).offsets.contains( TP1 ) );
+}
+
+TEST( MarketUpdateConflatorTest, WindowClosesOnTimeFromFirstRecord )
+{
+    MarketUpdateConflator conflator( { .window = 100ms } );
+    const auto start = MarketUpdateConflator::Clock::now();
+
+    EXPECT_FALSE( conflator.due( start + 1h ) );
+    EXPECT_FALSE( conflator.deadline().has_value() );
+
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.1, 10 ) }, { { TP0, 1 } } ), start );
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "GBPUSD", 1.3, 10 ) }, { { TP0, 2 } } ), start + 60ms );
+
+    EXPECT_EQ( conflator.deadline(), start + 100ms );
+    EXPECT_FALSE( conflator.due( start + 99ms ) );
+    EXPECT_TRUE( conflator.due( start + 100ms ) );
+
+    // The next window opens with the next record added
+    (void)conflator.take();
+    EXPECT_TRUE( conflator.empty() );
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.2, 20 ) }, { { TP0, 3 } } ), start + 150ms );
+    EXPECT_FALSE( conflator.due( start + 200ms ) );
+    EXPECT_TRUE( conflator.due( start + 250ms ) );
+}
+
+TEST( MarketUpdateConflatorTest, WindowClosesEarlyAtMaxRecords )
+{
+    MarketUpdateConflator conflator( { .window = 1h, .maxRecords = 2 } );
+    const auto now = MarketUpdateConflator::Clock::now();
+
+    // Conflated records don't count towards the limit
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "EURUSD", 1.1, 10 ), makeFXRecord( "EURUSD", 1.2, 20 ) }, { { TP0, 2 } } ), now );
+    EXPECT_FALSE( conflator.due( now ) );
+
+    conflator.add( makeBatches( "LIVE", { makeFXRecord( "GBPUSD", 1.3, 10 ) }, { { TP0, 3 } } ), now );
+    EXPECT_TRUE( conflator.due( now ) );
+}
@@ -0,0 +1,328 @@
+#include <gtest/gtest.h>
+#include <ARQMarket/mktdata_publisher.h>
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::Time;
+
+// ---------------------------------------------------------
+// Allocation counting - replaces the global operator new for the whole test binary, but only counts on a thread that asks it to
+// ---------------------------------------------------------
+
+namespace
+{
+
+thread_local bool   t_countAllocs = false;
+thread_local size_t t_numAllocs   = 0;
+
+}
+
+void* operator new( const size_t size )
+{
+    if( t_countAllocs )
+        ++t_numAllocs;
+
+    if( void* const ptr = std::malloc( size ? size : 1 ) )
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete( void* const ptr ) noexcept { std::free( ptr ); }
+void operator delete( void* const ptr, const size_t ) noexcept { std::free( ptr ); }
+
+// ---------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------
+
+namespace
+{
+
+Record<FXRate> makeFXRecord( std::string id, double mid )
+{
+    Record<FXRate> rec;
+    rec.header.id       = std::move( id );
+    rec.header.isActive = true;
+    rec.data.mid        = mid;
+    return rec;
+}
+
+// Holds on to everything it is sent, and only delivers when the test says so
+class FakeStreamProducer : public IStreamProducer
+{
+public:
+    struct Sent
+    {
+        std::string                        topic;
+        std::string                        key;
+        std::string                        type;
+        BufferView                         data;
+        StreamProducerDeliveryCallbackFunc callback;
+    };
+
+    void send( const StreamProducerMessage& msg, const StreamProducerDeliveryCallbackFunc& callback ) override
+    {
+        if( failAfter && sent.size() >= *failAfter )
+            throw ARQException( "Local queue full" );
+
+        ASSERT_TRUE( std::holds_alternative<BufferView>( msg.data ) );
+        sent.push_back( Sent{ msg.topic, msg.key.value_or( "" ), msg.headers.at( "ARQ_Type" ), std::get<BufferView>( msg.data ), callback } );
+    }
+
+    void deliverAll( const std::optional<StreamError>& error = std::nullopt )
+    {
+        std::vector<Sent> toDeliver = std::exchange( sent, {} );
+        for( const Sent& msg : toDeliver )
+        {
+            StreamProducerMessageMetadata metadata;
+            metadata.topic = msg.topic;
+            msg.callback( metadata, error );
+        }
+    }
+
+    void flush( const std::chrono::milliseconds ) override { deliverAll(); }
+
+    void initTransactions( const std::chrono::milliseconds ) override {}
+    void beginTransaction() override {}
+    void commitTransaction( const std::chrono::milliseconds ) override {}
+    void abortTransaction( const std::chrono::milliseconds ) override {}
+    void sendOffsetsToTransaction( const std::map<StreamTopicPartition, int64_t>&, const StreamGroupMetadata&, const std::chrono::milliseconds ) override {}
+
+    std::vector<Sent>     sent;
+    std::optional<size_t> failAfter;
+};
+
+// Writes the record's id and mid, so the tests can check what landed in each payload
+class FakeRecordMessageSerialiser : public ISerialisableType<RecordMessage<FXRate>>
+{
+public:
+    Buffer serialise( const RecordMessage<FXRate>& msg ) const override
+    {
+        const std::string str = msg.record.header.id + "=" + std::to_string( msg.record.data.mid ) + "@" + msg.record.header.lastUpdatedBy;
+        Buffer buf( str.size() );
+        std::memcpy( buf.getDataPtr(), str.data(), str.size() );
+        return buf;
+    }
+
+    // Writes the same as serialise, straight into out - so a warmed up publisher's arena is all it needs
+    size_t serialiseAppend( const RecordMessage<FXRate>& msg, std::vector<uint8_t>& out ) const override
+    {
+        const size_t start = out.size();
+        const auto   append = [&out] ( const std::string_view str ) { out.insert( out.end(), str.begin(), str.end() ); };
+
+        char midBuf[32];
+        const auto [midEnd, ec] = std::to_chars( midBuf, midBuf + sizeof( midBuf ), msg.record.data.mid, std::chars_format::fixed, 6 );
+
+        append( msg.record.header.id );
+        append( "=" );
+        append( std::string_view( midBuf, midEnd ) );
+        append( "@" );
+        append( msg.record.header.lastUpdatedBy );
+        return out.size() - start;
+    }
+
+    void deserialise( const BufferView, RecordMessage<FXRate>& ) const override {}
+};
+
+// Keeps nothing but the callback, so sending allocates nothing once its queue has grown
+class CallbackOnlyStreamProducer : public IStreamProducer
+{
+public:
+    void send( const StreamProducerMessage&, const StreamProducerDeliveryCallbackFunc& callback ) override
+    {
+        // The publisher's per-batch callback, which lives as long as the publisher
+        pending.push_back( &callback );
+    }
+
+    void deliverAll()
+    {
+        for( const StreamProducerDeliveryCallbackFunc* callback : pending )
+            ( *callback )( metadata, std::nullopt );
+        pending.clear();
+    }
+
+    void flush( const std::chrono::milliseconds ) override { deliverAll(); }
+
+    void initTransactions( const std::chrono::milliseconds ) override {}
+    void beginTransaction() override {}
+    void commitTransaction( const std::chrono::milliseconds ) override {}
+    void abortTransaction( const std::chrono::milliseconds ) override {}
+    void sendOffsetsToTransaction( const std::map<StreamTopicPartition, int64_t>&, const StreamGroupMetadata&, const std::chrono::milliseconds ) override {}
+
+    std::vector<const StreamProducerDeliveryCallbackFunc*> pending;
+    StreamProducerMessageMetadata                          metadata;
+};
+
+std::string payloadStr( const FakeStreamProducer::Sent& msg )
+{
+    return std::string( reinterpret_cast<const char*>( msg.data.data ), msg.data.size );
+}
+
+}
+
+// ---------------------------------------------------------
+// Tests
+// ---------------------------------------------------------
+
+class MDPublisherTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        producer = std::make_shared<FakeStreamProducer>();
+        StreamingServiceFactory::inst().addCustomStreamProducer( "FAKE_STREAM", producer );
+
+        auto serialiser = std::make_shared<Serialiser>();
+        serialiser->registerHandler<RecordMessage<FXRate>>( std::make_unique<FakeRecordMessageSerialiser>() );
+        SerialiserFactory::inst().addCustomSerialiser( SerialiserFactory::SerialiserImpl::Protobuf, serialiser );
+
+        Publisher::Config config;
+        config.streamingServiceDSH = "FAKE_STREAM";
+        config.updatedByStr        = "Tester";
+
+        publisher = std::make_unique<Publisher>();
+        publisher->init( config );
+    }
+
+    void TearDown() override
+    {
+        publisher.reset();
+        SerialiserFactory::inst().delCustomSerialiser( SerialiserFactory::SerialiserImpl::Protobuf );
+        StreamingServiceFactory::inst().delCustomStreamProducer( "FAKE_STREAM" );
+    }
+
+    std::shared_ptr<FakeStreamProducer> producer;
+    std::unique_ptr<Publisher>          publisher;
+};
+
+TEST_F( MDPublisherTest, PublishBatchSendsEveryRecord )
+{
+    std::vector<Record<FXRate>> records = { makeFXRecord( "GBP", 1.25 ), makeFXRecord( "EUR", 1.1 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records );
+
+    ASSERT_EQ( producer->sent.size(), 2 );
+    EXPECT_EQ( producer->sent[0].topic, Topics<FXRate>::updateTopic() );
+    EXPECT_EQ( producer->sent[0].type, RecordMessageTraits<FXRate>::type() );
+    EXPECT_EQ( producer->sent[0].key, std::format( "{0}|{1}#{2}", MarketName::LIVE.str(), Traits<FXRate>::type(), "GBP" ) );
+    EXPECT_EQ( producer->sent[1].key, std::format( "{0}|{1}#{2}", MarketName::LIVE.str(), Traits<FXRate>::type(), "EUR" ) );
+    EXPECT_EQ( payloadStr( producer->sent[0] ), "GBP=" + std::to_string( 1.25 ) + "@Tester" );
+    EXPECT_EQ( payloadStr( producer->sent[1] ), "EUR=" + std::to_string( 1.1 ) + "@Tester" );
+}
+
+TEST_F( MDPublisherTest, BatchCallbackFiresOnceAfterLastDelivery )
+{
+    std::vector<PublishBatchResult> results;
+    const auto onDelivered = [&results] ( const PublishBatchResult& result ) { results.push_back( result ); };
+
+    std::vector<Record<FXRate>> records = { makeFXRecord( "GBP", 1.25 ), makeFXRecord( "EUR", 1.1 ), makeFXRecord( "JPY", 150.0 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records, onDelivered );
+    EXPECT_TRUE( results.empty() );
+
+    producer->deliverAll();
+    ASSERT_EQ( results.size(), 1 );
+    EXPECT_EQ( results[0].numMessages, 3 );
+    EXPECT_TRUE( results[0].ok() );
+}
+
+TEST_F( MDPublisherTest, FailedDeliveriesAreReported )
+{
+    std::vector<PublishBatchResult> results;
+    size_t                          numErrors = 0;
+
+    std::vector<Record<FXRate>> records = { makeFXRecord( "GBP", 1.25 ), makeFXRecord( "EUR", 1.1 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records,
+        [&results] ( const PublishBatchResult& result ) { results.push_back( result ); },
+        [&numErrors] ( const StreamProducerMessageMetadata&, StreamError ) { ++numErrors; } );
+
+    producer->deliverAll( StreamError{ .code = 1, .message = "Broker down", .isFatal = false, .isRetriable = true, .transRequiresAbort = false } );
+
+    EXPECT_EQ( numErrors, 2 );
+    ASSERT_EQ( results.size(), 1 );
+    EXPECT_EQ( results[0].numFailed, 2 );
+    ASSERT_TRUE( results[0].firstError.has_value() );
+    EXPECT_EQ( results[0].firstError->message, "Broker down" );
+}
+
+TEST_F( MDPublisherTest, UnsentMessagesCountAsFailed )
+{
+    std::vector<PublishBatchResult> results;
+    producer->failAfter = 1;
+
+    std::vector<Record<FXRate>> records = { makeFXRecord( "GBP", 1.25 ), makeFXRecord( "EUR", 1.1 ), makeFXRecord( "JPY", 150.0 ) };
+    EXPECT_ANY_THROW( publisher->publishBatch<FXRate>( MarketName::LIVE, records, [&results] ( const PublishBatchResult& result ) { results.push_back( result ); } ) );
+    EXPECT_TRUE( results.empty() );
+
+    producer->deliverAll();
+    ASSERT_EQ( results.size(), 1 );
+    EXPECT_EQ( results[0].numMessages, 3 );
+    EXPECT_EQ( results[0].numFailed, 2 );
+}
+
+TEST_F( MDPublisherTest, DeliveredBatchesAreReused )
+{
+    std::vector<Record<FXRate>> records = { makeFXRecord( "GBP", 1.25 ), makeFXRecord( "EUR", 1.1 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records );
+    const uint8_t* const firstPayloads = producer->sent[0].data.data;
+    producer->deliverAll();
+
+    records = { makeFXRecord( "GBP", 1.26 ), makeFXRecord( "EUR", 1.2 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records );
+    ASSERT_EQ( producer->sent.size(), 2 );
+    EXPECT_EQ( producer->sent[0].data.data, firstPayloads );
+    EXPECT_EQ( payloadStr( producer->sent[1] ), "EUR=" + std::to_string( 1.2 ) + "@Tester" );
+}
+
+TEST_F( MDPublisherTest, InFlightBatchesAreNotReused )
+{
+    std::vector<Record<FXRate>> records = { makeFXRecord( "GBP", 1.25 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records );
+
+    records = { makeFXRecord( "EUR", 1.1 ) };
+    publisher->publishBatch<FXRate>( MarketName::LIVE, records );
+
+    ASSERT_EQ( producer->sent.size(), 2 );
+    EXPECT_EQ( payloadStr( producer->sent[0] ), "GBP=" + std::to_string( 1.25 ) + "@Tester" );
+    EXPECT_EQ( payloadStr( producer->sent[1] ), "EUR=" + std::to_string( 1.1 ) + "@Tester" );
+}
+
+TEST_F( MDPublisherTest, WarmedUpPublishBatchAllocatesNothing )
+{
+    auto callbackOnly = std::make_shared<CallbackOnlyStreamProducer>();
+    StreamingServiceFactory::inst().addCustomStreamProducer( "CALLBACK_ONLY_STREAM", callbackOnly );
+
+    Publisher::Config config;
+    config.streamingServiceDSH = "CALLBACK_ONLY_STREAM";
+    config.updatedByStr        = "Tester";
+
+    Publisher lean;
+    lean.init( config );
+
+    std::vector<Record<FXRate>> records;
+    for( int32_t i = 0; i < 100; ++i )
+        records.push_back( makeFXRecord( "CCY" + std::to_string( i ) + "/USD", 1.0 + i ) );
+
+    size_t numDelivered = 0;
+    const PublisherBatchCallback onDelivered = [&numDelivered] ( const PublishBatchResult& ) { ++numDelivered; };
+
+    // First batches grow the arena, the thread's scratch message and the producer's queue
+    for( int32_t i = 0; i < 3; ++i )
+    {
+        lean.publishBatch<FXRate>( MarketName::LIVE, records, onDelivered );
+        callbackOnly->deliverAll();
+    }
+
+    t_numAllocs   = 0;
+    t_countAllocs = true;
+    lean.publishBatch<FXRate>( MarketName::LIVE, records, onDelivered );
+    callbackOnly->deliverAll();
+    t_countAllocs = false;
+
+    EXPECT_EQ( t_numAllocs, 0 );
+    EXPECT_EQ( numDelivered, 4 );
+
+    StreamingServiceFactory::inst().delCustomStreamProducer( "CALLBACK_ONLY_STREAM" );
+}
@@ -0,0 +1,259 @@
+#include <ARQMarket/mktdata_update_codec.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace ARQ;
+using namespace ARQ::MD;
+using namespace ARQ::Time;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const StreamTopicPartition TP0 = { "ARQ.MktData.Updates.FXR", 0 };
+
+// Keeps what's serialised to hand back on deserialise. The buffer is sized as protobuf would roughly have it - a decimal left as zero
+// takes no space
+template<typename T>
+class FakeHandler : public ISerialisableType<T>
+{
+public:
+    explicit FakeHandler( std::shared_ptr<std::vector<T>> store ) : m_store( std::move( store ) ) {}
+
+    Buffer serialise( const T& obj ) const override
+    {
+        const MarketUpdateBatch& batch = batchOf( obj );
+
+        size_t size = 32;
+        batch.records.visitVectors( [&size] <c_MktData E> ( const std::vector<Record<E>>& records )
+        {
+            for( Record<E> record : records )
+            {
+                size += 16 + record.header.id.size();
+                Traits<E>::visitDecimals( record.data, [&size] ( double& val ) { size += val != 0.0 ? 9 : 0; } );
+            }
+        } );
+
+        Buffer buf( size );
+        const size_t idx = m_store->size();
+        std::memcpy( buf.data.get(), &idx, sizeof( idx ) );
+        m_store->push_back( obj );
+        return buf;
+    }
+
+    void deserialise( const BufferView buf, T& objOut ) const override
+    {
+        size_t idx;
+        std::memcpy( &idx, buf.data, sizeof( idx ) );
+        objOut = m_store->at( idx );
+    }
+
+private:
+    static const MarketUpdateBatch& batchOf( const MarketUpdateBatch& batch )     { return batch; }
+    static const MarketUpdateBatch& batchOf( const MarketUpdateMessage& updateMsg ) { return updateMsg.batch; }
+
+private:
+    std::shared_ptr<std::vector<T>> m_store;
+};
+
+std::shared_ptr<Serialiser> makeSerialiser()
+{
+    auto serialiser = std::make_shared<Serialiser>();
+    serialiser->registerHandler<MarketUpdateBatch>( std::make_unique<FakeHandler<MarketUpdateBatch>>( std::make_shared<std::vector<MarketUpdateBatch>>() ) );
+    serialiser->registerHandler<MarketUpdateMessage>( std::make_unique<FakeHandler<MarketUpdateMessage>>( std::make_shared<std::vector<MarketUpdateMessage>>() ) );
+    return serialiser;
+}
+
+Record<FXRate> makeFXRecord( std::string id, double mid, double bid, double ask )
+{
+    Record<FXRate> rec;
+    rec.header.id = std::move( id );
+    rec.data.mid = mid;
+    rec.data.bid = bid;
+    rec.data.ask = ask;
+    return rec;
+}
+
+MarketUpdateBatch makeBatch( std::vector<Record<FXRate>> records, int64_t offset )
+{
+    MarketUpdateBatch batch;
+    batch.marketName = MarketName( "LIVE" );
+    batch.records.get<Record<FXRate>>() = std::move( records );
+    batch.offsets = { { TP0, offset } };
+    batch.prevOffsets = { { TP0, offset - 1 } };
+    return batch;
+}
+
+// Decodes each message in turn, expecting a whole batch only from the last
+MarketUpdateBatch decodeAll( MarketUpdateDecoder& decoder, const std::vector<Message>& msgs )
+{
+    for( size_t i = 0; i + 1 < msgs.size(); ++i )
+        EXPECT_FALSE( decoder.decode( msgs[i] ) );
+
+    std::optional<MarketUpdateBatch> batch = decoder.decode( msgs.back() );
+    if( !batch )
+        throw std::runtime_error( "Batch not decoded from its last message" );
+    return std::move( *batch );
+}
+
+}
+
+TEST( MarketUpdateCodecTest, PlainBatchWhenItFitsAndNotDeltaEncoding )
+{
+    auto serialiser = makeSerialiser();
+    MarketUpdateEncoder encoder( {}, serialiser, "pub" );
+    MarketUpdateDecoder decoder( serialiser );
+
+    const std::vector<Message> msgs = encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.1, 1.0, 1.2 ) }, 5 ) );
+    ASSERT_EQ( msgs.size(), 1u );
+    EXPECT_TRUE( msgs[0].headers.empty() ); // Understood by subscribers that predate MarketUpdateMessage
+    EXPECT_FALSE( MarketUpdateDecoder::isUpdateMessage( msgs[0] ) );
+
+    const MarketUpdateBatch batch = decodeAll( decoder, msgs );
+    ASSERT_EQ( batch.records.get<Record<FXRate>>().size(), 1u );
+    EXPECT_EQ( batch.records.get<Record<FXRate>>()[0].data.mid, 1.1 );
+    EXPECT_EQ( batch.offsets.at( TP0 ), 5 );
+    EXPECT_EQ( decoder.getStats().messages, 0u );
+}
+
+TEST( MarketUpdateCodecTest, ChunksBatchesTooBigForOneMessage )
+{
+    auto serialiser = makeSerialiser();
+    MarketUpdateEncoder encoder( { .maxMessageBytes = 512 }, serialiser, "pub" );
+    MarketUpdateDecoder decoder( serialiser );
+
+    std::vector<Record<FXRate>> records;
+    for( int i = 0; i < 50; ++i )
+        records.push_back( makeFXRecord( "CCY" + std::to_string( i ), 1.0 + i, 1.0, 2.0 ) );
+
+    const std::vector<Message> msgs = encoder.encode( makeBatch( records, 9 ) );
+    ASSERT_GT( msgs.size(), 1u );
+    for( const Message& msg : msgs )
+    {
+        EXPECT_LE( msg.data.size, 512u );
+        EXPECT_TRUE( MarketUpdateDecoder::isUpdateMessage( msg ) );
+    }
+
+    const MarketUpdateBatch batch = decodeAll( decoder, msgs );
+    const auto& decoded = batch.records.get<Record<FXRate>>();
+    ASSERT_EQ( decoded.size(), records.size() );
+    for( size_t i = 0; i < records.size(); ++i )
+    {
+        EXPECT_EQ( decoded[i].header.id, records[i].header.id );
+        EXPECT_EQ( decoded[i].data.mid, records[i].data.mid );
+    }
+    EXPECT_EQ( batch.offsets.at( TP0 ), 9 );
+    EXPECT_EQ( batch.prevOffsets.at( TP0 ), 8 );
+
+    EXPECT_EQ( encoder.getStats().chunkedBatches, 1u );
+    EXPECT_EQ( decoder.getStats().reassembled, 1u );
+}
+
+TEST( MarketUpdateCodecTest, DeltaEncodesUnchangedDecimals )
+{
+    auto serialiser = makeSerialiser();
+    MarketUpdateEncoder encoder( { .deltaEncode = true }, serialiser, "pub" );
+    MarketUpdateDecoder decoder( serialiser );
+
+    const std::vector<Message> first = encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.1, 1.0, 1.2 ) }, 1 ) );
+    const std::vector<Message> second = encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.15, 1.0, 1.2 ) }, 2 ) );
+    ASSERT_EQ( second.size(), 1u );
+    EXPECT_LT( second[0].data.size, first[0].data.size ); // Only the mid goes on the wire
+
+    decodeAll( decoder, first );
+    const MarketUpdateBatch batch = decodeAll( decoder, second );
+    const auto& decoded = batch.records.get<Record<FXRate>>();
+    ASSERT_EQ( decoded.size(), 1u );
+    EXPECT_EQ( decoded[0].data.mid, 1.15 );
+    EXPECT_EQ( decoded[0].data.bid, 1.0 );
+    EXPECT_EQ( decoded[0].data.ask, 1.2 );
+
+    EXPECT_EQ( encoder.getStats().deltaRecords, 1u );
+    EXPECT_EQ( encoder.getStats().decimalsLeftOut, 2u );
+    EXPECT_EQ( decoder.getStats().deltaRecords, 1u );
+}
+
+TEST( MarketUpdateCodecTest, RecordsWithDifferentDecimalsSetAreSentInFull )
+{
+    auto serialiser = makeSerialiser();
+    MarketUpdateEncoder encoder( { .deltaEncode = true }, serialiser, "pub" );
+    MarketUpdateDecoder decoder( serialiser );
+
+    const auto makeEQBatch = [] ( std::optional<double> vwap, int64_t offset )
+    {
+        MarketUpdateBatch batch = makeBatch( {}, offset );
+        Record<EQPrice> rec;
+        rec.header.id = "AAPL";
+        rec.data.last = 175.0;
+        rec.data.bid = 174.9;
+        rec.data.vwap = vwap;
+        batch.records.get<Record<EQPrice>>().push_back( rec );
+        return batch;
+    };
+
+    decodeAll( decoder, encoder.encode( makeEQBatch( std::nullopt, 1 ) ) );
+    const MarketUpdateBatch batch = decodeAll( decoder, encoder.encode( makeEQBatch( 175.2, 2 ) ) );
+
+    const auto& decoded = batch.records.get<Record<EQPrice>>();
+    ASSERT_EQ( decoded.size(), 1u );
+    EXPECT_EQ( decoded[0].data.last, 175.0 );
+    EXPECT_EQ( decoded[0].data.vwap, 175.2 );
+    EXPECT_EQ( encoder.getStats().deltaRecords, 0u );
+}
+
+TEST( MarketUpdateCodecTest, MissedMessageDropsDeltaBasesUntilSentInFull )
+{
+    auto serialiser = makeSerialiser();
+    MarketUpdateEncoder encoder( { .deltaEncode = true, .fullRecordInterval = 1s }, serialiser, "pub" );
+    MarketUpdateDecoder decoder( serialiser );
+    const auto now = MarketUpdateEncoder::Clock::now();
+
+    decodeAll( decoder, encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.1, 1.0, 1.2 ) }, 1 ), now ) );
+    const std::vector<Message> missed = encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.2, 1.1, 1.3 ) }, 2 ), now );
+    const std::vector<Message> delta  = encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.25, 1.1, 1.3 ) }, 3 ), now );
+
+    // Decoded against the base from before the missed message, the bid and ask would be wrong - so the record is dropped, and its type
+    // reported for the subscriber to resync
+    std::vector<Type> deltaMissTypes;
+    ASSERT_EQ( delta.size(), 1u );
+    const std::optional<MarketUpdateBatch> dropped = decoder.decode( delta[0], &deltaMissTypes );
+    ASSERT_TRUE( dropped );
+    EXPECT_TRUE( dropped->records.get<Record<FXRate>>().empty() );
+    EXPECT_EQ( dropped->offsets.at( TP0 ), 3 );
+    EXPECT_EQ( deltaMissTypes, std::vector<Type>{ Type::FXR } );
+    EXPECT_EQ( decoder.getStats().seqGaps, 1u );
+    EXPECT_EQ( decoder.getStats().deltaMisses, 1u );
+
+    // Arriving late, it's ignored
+    EXPECT_FALSE( decoder.decode( missed[0] ) );
+    EXPECT_EQ( decoder.getStats().duplicates, 1u );
+
+    const std::vector<Message> fullMsgs = encoder.encode( makeBatch( { makeFXRecord( "EURUSD", 1.3, 1.1, 1.3 ) }, 4 ), now + 1s );
+    ASSERT_EQ( fullMsgs.size(), 1u );
+    const std::optional<MarketUpdateBatch> full = decoder.decode( fullMsgs[0], &deltaMissTypes );
+    ASSERT_TRUE( full );
+    EXPECT_TRUE( deltaMissTypes.empty() );
+    const auto& decoded = full->records.get<Record<FXRate>>();
+    ASSERT_EQ( decoded.size(), 1u );
+    EXPECT_EQ( decoded[0].data.mid, 1.3 );
+    EXPECT_EQ( decoded[0].data.bid, 1.1 );
+    EXPECT_EQ( decoded[0].data.ask, 1.3 );
+}
+
+TEST( MarketUpdateCodecTest, PublishersAreDecodedApart )
+{
+    auto serialiser = makeSerialiser();
+    MarketUpdateEncoder encoderA( { .deltaEncode = true }, serialiser, "pubA" );
+    MarketUpdateEncoder encoderB( { .deltaEncode = true }, serialiser, "pubB" );
+    MarketUpdateDecoder decoder( serialiser );
+
+    decodeAll( decoder, encoderA.encode( makeBatch( { makeFXRecord( "EURUSD", 1.1, 1.0, 1.2 ) }, 1 ) ) );
+    decodeAll( decoder, encoderB.encode( makeBatch( { makeFXRecord( "EURUSD", 2.1, 2.0, 2.2 ) }, 2 ) ) );
+    const MarketUpdateBatch batch = decodeAll( decoder, encoderA.encode( makeBatch( { makeFXRecord( "EURUSD", 1.15, 1.0, 1.2 ) }, 3 ) ) );
+
+    const auto& decoded = batch.records.get<Record<FXRate>>();
+    ASSERT_EQ( decoded.size(), 1u );
+    EXPECT_EQ( decoded[0].data.bid, 1.0 );
+    EXPECT_EQ( decoder.getStats().seqGaps, 0u );
+}
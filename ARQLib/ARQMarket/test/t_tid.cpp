@@ -1,6 +1,8 @@
 #include <ARQMarket/tid.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 using namespace ARQ;
 using namespace ARQ::MD;
 
@@ -267,3 +269,72 @@ TEST( TIDSetTest, GetIDsForType_TypeIsolation )
     auto emptyResult = set.getIDsForType( Type::_NOTSET_ );
     EXPECT_TRUE( std::holds_alternative<TIDSet::None>( emptyResult ) );
 }
+
+
+// ============================================================================
+// COMPILED TIDSET TESTS
+// ============================================================================
+
+TEST( CompiledTIDSetTest, EmptySetMatchesNothing )
+{
+    CompiledTIDSet compiled( TIDSet{} );
+
+    EXPECT_TRUE( compiled.empty() );
+    EXPECT_FALSE( compiled.matches( Type::FXR, "EURUSD" ) );
+    EXPECT_TRUE( compiled.matchesNone( Type::FXR ) );
+    EXPECT_TRUE( std::holds_alternative<TIDSet::None>( compiled.getIDsForType( Type::FXR ) ) );
+}
+
+TEST( CompiledTIDSetTest, MatchesSpecificIDs )
+{
+    TIDSet set;
+    set.insert( TID( Type::FXR, "EURUSD" ) );
+    set.insert( TID( Type::FXR, "GBPUSD" ) );
+    set.insert( TID( Type::FXR, "EURUSD" ) ); // Duplicate
+
+    CompiledTIDSet compiled( set );
+
+    EXPECT_TRUE( compiled.matches( Type::FXR, "EURUSD" ) );
+    EXPECT_TRUE( compiled.matches( Type::FXR, "GBPUSD" ) );
+    EXPECT_FALSE( compiled.matches( Type::FXR, "JPYUSD" ) );
+    EXPECT_FALSE( compiled.matches( Type::EQP, "EURUSD" ) ); // Same id, different type
+    EXPECT_FALSE( compiled.matchesAll( Type::FXR ) );
+    EXPECT_TRUE( compiled.matchesNone( Type::EQP ) );
+
+    auto ids = compiled.getIDsForType( Type::FXR );
+    ASSERT_TRUE( std::holds_alternative<TIDSet::IDList>( ids ) );
+    auto& list = std::get<TIDSet::IDList>( ids );
+    std::sort( list.begin(), list.end() );
+    EXPECT_EQ( list, ( TIDSet::IDList{ "EURUSD", "GBPUSD" } ) );
+}
+
+TEST( CompiledTIDSetTest, WildcardMatchesEveryIDOfItsType )
+{
+    TIDSet set;
+    set.insert( TID( Type::FXR, "EURUSD" ) );
+    set.insert( TID( Type::FXR ) );
+    set.insert( TID( Type::EQP, "AAPL" ) );
+
+    CompiledTIDSet compiled( set );
+
+    EXPECT_TRUE( compiled.matchesAll( Type::FXR ) );
+    EXPECT_TRUE( compiled.matches( Type::FXR, "RANDOM_UNSEEN_TICKER" ) );
+    EXPECT_TRUE( compiled.matches( Type::EQP, "AAPL" ) );
+    EXPECT_FALSE( compiled.matches( Type::EQP, "MSFT" ) );
+    EXPECT_TRUE( std::holds_alternative<TIDSet::All>( compiled.getIDsForType( Type::FXR ) ) );
+}
+
+TEST( CompiledTIDSetTest, AgreesWithTIDSetForLargeSets )
+{
+    TIDSet set;
+    for( int i = 0; i < 5000; i += 2 )
+        set.insert( TID( Type::EQP, "SYM" + std::to_string( i ) ) );
+
+    CompiledTIDSet compiled( set );
+
+    for( int i = 0; i < 5000; ++i )
+    {
+        const std::string id = "SYM" + std::to_string( i );
+        EXPECT_EQ( compiled.matches( Type::EQP, id ), set.contains( TID( Type::EQP, id ) ) ) << id;
+    }
+}
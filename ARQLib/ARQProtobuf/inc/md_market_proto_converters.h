@@ -16,4 +16,12 @@ ARQProtobuf_API void toProto( ARQ::MD::MarketUpdateBatch&& arqObj, MarketUpdateB
 [[nodiscard]] ARQProtobuf_API ARQ::MD::MarketUpdateBatch fromProto( const MarketUpdateBatch& protoObj );
 [[nodiscard]] ARQProtobuf_API ARQ::MD::MarketUpdateBatch fromProto( MarketUpdateBatch&& protoObj );
 
+// --- Converters for MarketUpdateMessage ---
+
+ARQProtobuf_API void toProto( const ARQ::MD::MarketUpdateMessage& arqObj, MarketUpdateMessage* const protoObj );
+ARQProtobuf_API void toProto( ARQ::MD::MarketUpdateMessage&& arqObj, MarketUpdateMessage* const protoObj );
+
+[[nodiscard]] ARQProtobuf_API ARQ::MD::MarketUpdateMessage fromProto( const MarketUpdateMessage& protoObj );
+[[nodiscard]] ARQProtobuf_API ARQ::MD::MarketUpdateMessage fromProto( MarketUpdateMessage&& protoObj );
+
 }
\ No newline at end of file
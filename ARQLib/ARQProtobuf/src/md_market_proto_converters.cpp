@@ -16,6 +16,9 @@ void toProto( const ARQ::MD::MarketUpdateBatch& arqObj, MarketUpdateBatch* const
 	StreamTopicPartitionOffsets* const protoOffsets = protoObj->mutable_offsets();
 	ARQ::Proto::toProto( arqObj.offsets, protoOffsets );
 
+	StreamTopicPartitionOffsets* const protoPrevOffsets = protoObj->mutable_prev_offsets();
+	ARQ::Proto::toProto( arqObj.prevOffsets, protoPrevOffsets );
+
 	protoObj->set_mkt_name( arqObj.marketName.str() );
 }
 
@@ -27,6 +30,9 @@ void toProto( ARQ::MD::MarketUpdateBatch&& arqObj, MarketUpdateBatch* const prot
 	StreamTopicPartitionOffsets* const protoOffsets = protoObj->mutable_offsets();
 	ARQ::Proto::toProto( std::move( arqObj.offsets ), protoOffsets );
 
+	StreamTopicPartitionOffsets* const protoPrevOffsets = protoObj->mutable_prev_offsets();
+	ARQ::Proto::toProto( std::move( arqObj.prevOffsets ), protoPrevOffsets );
+
 	protoObj->set_mkt_name( std::move( arqObj.marketName.str() ) );
 }
 
@@ -34,9 +40,10 @@ ARQ::MD::MarketUpdateBatch fromProto( const MarketUpdateBatch& protoObj )
 {
 	ARQ::MD::MarketUpdateBatch objOut;
 
-	objOut.records    = fromProto( protoObj.records() );
-	objOut.offsets    = ARQ::Proto::fromProto( protoObj.offsets() );
-	objOut.marketName = ARQ::MD::MarketName::fromStr( protoObj.mkt_name() );
+	objOut.records     = fromProto( protoObj.records() );
+	objOut.offsets     = ARQ::Proto::fromProto( protoObj.offsets() );
+	objOut.prevOffsets = ARQ::Proto::fromProto( protoObj.prev_offsets() );
+	objOut.marketName  = ARQ::MD::MarketName::fromStr( protoObj.mkt_name() );
 
 	return objOut;
 }
@@ -45,9 +52,62 @@ ARQ::MD::MarketUpdateBatch fromProto( MarketUpdateBatch&& protoObj )
 {
 	ARQ::MD::MarketUpdateBatch objOut;
 
-	objOut.records    = fromProto( std::move( *protoObj.mutable_records() ) );
-	objOut.offsets    = ARQ::Proto::fromProto( std::move( *protoObj.mutable_offsets() ) );
-	objOut.marketName = ARQ::MD::MarketName::fromStr( std::move( *protoObj.mutable_mkt_name() ) );
+	objOut.records     = fromProto( std::move( *protoObj.mutable_records() ) );
+	objOut.offsets     = ARQ::Proto::fromProto( std::move( *protoObj.mutable_offsets() ) );
+	objOut.prevOffsets = ARQ::Proto::fromProto( std::move( *protoObj.mutable_prev_offsets() ) );
+	objOut.marketName  = ARQ::MD::MarketName::fromStr( std::move( *protoObj.mutable_mkt_name() ) );
+
+	return objOut;
+}
+
+// --- Converters for MarketUpdateMessage ---
+
+void toProto( const ARQ::MD::MarketUpdateMessage& arqObj, MarketUpdateMessage* const protoObj )
+{
+	toProto( arqObj.batch, protoObj->mutable_batch() );
+
+	protoObj->set_publisher_id( arqObj.publisherID );
+	protoObj->set_seq( arqObj.seq );
+	protoObj->set_chunk_idx( arqObj.chunkIdx );
+	protoObj->set_num_chunks( arqObj.numChunks );
+	protoObj->mutable_delta_masks()->Add( arqObj.deltaMasks.begin(), arqObj.deltaMasks.end() );
+}
+
+void toProto( ARQ::MD::MarketUpdateMessage&& arqObj, MarketUpdateMessage* const protoObj )
+{
+	toProto( std::move( arqObj.batch ), protoObj->mutable_batch() );
+
+	protoObj->set_publisher_id( std::move( arqObj.publisherID ) );
+	protoObj->set_seq( arqObj.seq );
+	protoObj->set_chunk_idx( arqObj.chunkIdx );
+	protoObj->set_num_chunks( arqObj.numChunks );
+	protoObj->mutable_delta_masks()->Add( arqObj.deltaMasks.begin(), arqObj.deltaMasks.end() );
+}
+
+ARQ::MD::MarketUpdateMessage fromProto( const MarketUpdateMessage& protoObj )
+{
+	ARQ::MD::MarketUpdateMessage objOut;
+
+	objOut.batch       = fromProto( protoObj.batch() );
+	objOut.publisherID = protoObj.publisher_id();
+	objOut.seq         = protoObj.seq();
+	objOut.chunkIdx    = protoObj.chunk_idx();
+	objOut.numChunks   = protoObj.num_chunks();
+	objOut.deltaMasks.assign( protoObj.delta_masks().begin(), protoObj.delta_masks().end() );
+
+	return objOut;
+}
+
+ARQ::MD::MarketUpdateMessage fromProto( MarketUpdateMessage&& protoObj )
+{
+	ARQ::MD::MarketUpdateMessage objOut;
+
+	objOut.batch       = fromProto( std::move( *protoObj.mutable_batch() ) );
+	objOut.publisherID = std::move( *protoObj.mutable_publisher_id() );
+	objOut.seq         = protoObj.seq();
+	objOut.chunkIdx    = protoObj.chunk_idx();
+	objOut.numChunks   = protoObj.num_chunks();
+	objOut.deltaMasks.assign( protoObj.delta_masks().begin(), protoObj.delta_masks().end() );
 
 	return objOut;
 }
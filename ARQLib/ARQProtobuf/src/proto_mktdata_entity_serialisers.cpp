@@ -50,6 +50,21 @@ Buffer ProtobufTypeSerialiser_MDRecordMessage<T>::serialise( const ARQ::MD::Reco
 	return serialiseToBuffer( protoObj );
 }
 
+template<ARQ::MD::c_MktData T>
+size_t ProtobufTypeSerialiser_MDRecordMessage<T>::serialiseAppend( const ARQ::MD::RecordMessage<T>& obj, std::vector<uint8_t>& out ) const
+{
+	// Publishers call this once per tick, so keep hold of the proto object - Clear() leaves its strings and sub-messages allocated for the next one
+	thread_local typename ProtoTraits<T>::RecordMessageProto protoObj;
+	protoObj.Clear();
+	toProto<T>( obj, &protoObj );
+
+	const size_t offset = out.size();
+	const size_t size   = protoObj.ByteSizeLong();
+	out.resize( offset + size );
+	protoObj.SerializeWithCachedSizesToArray( out.data() + offset );
+	return size;
+}
+
 template<ARQ::MD::c_MktData T>
 void ProtobufTypeSerialiser_MDRecordMessage<T>::deserialise( const BufferView buf, ARQ::MD::RecordMessage<T>& objOut ) const
 {
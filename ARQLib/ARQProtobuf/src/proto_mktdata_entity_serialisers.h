@@ -21,8 +21,9 @@ template<ARQ::MD::c_MktData T>
 class ProtobufTypeSerialiser_MDRecordMessage : public ISerialisableType<ARQ::MD::RecordMessage<T>>
 {
 public:
-	ARQProtobuf_API Buffer serialise( const ARQ::MD::RecordMessage<T>& obj )                      const override;
-	ARQProtobuf_API void   deserialise( const BufferView buf, ARQ::MD::RecordMessage<T>& objOut ) const override;
+	ARQProtobuf_API Buffer serialise( const ARQ::MD::RecordMessage<T>& obj )                                  const override;
+	ARQProtobuf_API void   deserialise( const BufferView buf, ARQ::MD::RecordMessage<T>& objOut )             const override;
+	ARQProtobuf_API size_t serialiseAppend( const ARQ::MD::RecordMessage<T>& obj, std::vector<uint8_t>& out ) const override;
 };
 
 }
\ No newline at end of file
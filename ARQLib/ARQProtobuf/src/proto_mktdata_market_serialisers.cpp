@@ -10,6 +10,7 @@ namespace ARQ::Proto::MD
 void registerMktDataMarketSerialisers( Serialiser& serialiser )
 {
 	serialiser.registerHandler<ARQ::MD::MarketUpdateBatch>( std::make_unique<ProtobufTypeSerialiser_MarketUpdateBatch>() );
+	serialiser.registerHandler<ARQ::MD::MarketUpdateMessage>( std::make_unique<ProtobufTypeSerialiser_MarketUpdateMessage>() );
 }
 
 Buffer ProtobufTypeSerialiser_MarketUpdateBatch::serialise( const ARQ::MD::MarketUpdateBatch& obj ) const
@@ -28,4 +29,20 @@ void ProtobufTypeSerialiser_MarketUpdateBatch::deserialise( const BufferView buf
 	objOut = fromProto( protoObj );
 }
 
+Buffer ProtobufTypeSerialiser_MarketUpdateMessage::serialise( const ARQ::MD::MarketUpdateMessage& obj ) const
+{
+	MarketUpdateMessage protoObj;
+	toProto( obj, &protoObj );
+	return serialiseToBuffer( protoObj );
+}
+
+void ProtobufTypeSerialiser_MarketUpdateMessage::deserialise( const BufferView buf, ARQ::MD::MarketUpdateMessage& objOut ) const
+{
+	MarketUpdateMessage protoObj;
+	if( !protoObj.ParseFromArray( buf.data, buf.size ) )
+		throw ARQException( std::format( "Cannot deserialise buffer into MarketUpdateMessage object" ) );
+
+	objOut = fromProto( std::move( protoObj ) );
+}
+
 }
@@ -16,4 +16,11 @@ public:
 	ARQProtobuf_API void   deserialise( const BufferView buf, ARQ::MD::MarketUpdateBatch& objOut ) const override;
 };
 
+class ProtobufTypeSerialiser_MarketUpdateMessage : public ISerialisableType<ARQ::MD::MarketUpdateMessage>
+{
+public:
+	ARQProtobuf_API Buffer serialise( const ARQ::MD::MarketUpdateMessage& obj )                      const override;
+	ARQProtobuf_API void   deserialise( const BufferView buf, ARQ::MD::MarketUpdateMessage& objOut ) const override;
+};
+
 }
\ No newline at end of file
@@ -34,6 +34,7 @@ protected:
         // 3. Add Offsets 
         cppBatch.offsets[ARQ::StreamTopicPartition{ "NYSE.Equities", 0 }] = 10045;
         cppBatch.offsets[ARQ::StreamTopicPartition{ "NYSE.Equities", 1 }] = 20089;
+        cppBatch.prevOffsets[ARQ::StreamTopicPartition{ "NYSE.Equities", 0 }] = 10040;
 
         return cppBatch;
     }
@@ -60,6 +61,7 @@ TEST_F( MktDataBatchConvertersTest, MarketUpdateBatch_LValue_Conversions )
 
     // Verify Offsets map size (assuming Protobuf map semantics)
     EXPECT_EQ( protoBatch.offsets().offsets().size(), 2 );
+    EXPECT_EQ( protoBatch.prev_offsets().offsets().size(), 1 );
 
     // --- Proto to C++ (LValue) ---
     ARQ::MD::MarketUpdateBatch parsedBatch = fromProto( protoBatch );
@@ -74,6 +76,8 @@ TEST_F( MktDataBatchConvertersTest, MarketUpdateBatch_LValue_Conversions )
     EXPECT_DOUBLE_EQ( parsedBatch.records.get<ARQ::MD::Record<ARQ::MD::EQPrice>>()[0].data.last, 175.50 );
 
     EXPECT_EQ( parsedBatch.offsets.size(), 2 );
+    ASSERT_EQ( parsedBatch.prevOffsets.size(), 1 );
+    EXPECT_EQ( ( parsedBatch.prevOffsets.at( ARQ::StreamTopicPartition{ "NYSE.Equities", 0 } ) ), 10040 );
 }
 
 TEST_F( MktDataBatchConvertersTest, MarketUpdateBatch_RValue_Conversions )
@@ -101,4 +105,39 @@ TEST_F( MktDataBatchConvertersTest, MarketUpdateBatch_RValue_Conversions )
     EXPECT_DOUBLE_EQ( parsedBatchMove.records.get<ARQ::MD::Record<ARQ::MD::EQPrice>>()[0].data.close, 173.50 );
 
     EXPECT_EQ( parsedBatchMove.offsets.size(), 2 );
-}
\ No newline at end of file
+    EXPECT_EQ( parsedBatchMove.prevOffsets.size(), 1 );
+}
+
+TEST_F( MktDataBatchConvertersTest, MarketUpdateMessage_Conversions )
+{
+    ARQ::MD::MarketUpdateMessage cppMsg;
+    cppMsg.batch       = createPopulatedBatch();
+    cppMsg.publisherID = "MktDataLiveProjector-123-0";
+    cppMsg.seq         = 42;
+    cppMsg.chunkIdx    = 1;
+    cppMsg.numChunks   = 3;
+    cppMsg.deltaMasks  = { 0, 6 };
+
+    ARQ::Proto::MD::MarketUpdateMessage protoMsg;
+    toProto( cppMsg, &protoMsg );
+
+    EXPECT_EQ( protoMsg.batch().mkt_name(), "NYSE" );
+    EXPECT_EQ( protoMsg.publisher_id(), "MktDataLiveProjector-123-0" );
+    EXPECT_EQ( protoMsg.seq(), 42u );
+    EXPECT_EQ( protoMsg.chunk_idx(), 1u );
+    EXPECT_EQ( protoMsg.num_chunks(), 3u );
+    ASSERT_EQ( protoMsg.delta_masks_size(), 2 );
+    EXPECT_EQ( protoMsg.delta_masks( 1 ), 6u );
+
+    ARQ::MD::MarketUpdateMessage parsedMsg = fromProto( std::move( protoMsg ) );
+
+    EXPECT_EQ( parsedMsg.batch.marketName.str(), "NYSE" );
+    ASSERT_EQ( parsedMsg.batch.records.get<ARQ::MD::Record<ARQ::MD::FXRate>>().size(), 1 );
+    EXPECT_DOUBLE_EQ( parsedMsg.batch.records.get<ARQ::MD::Record<ARQ::MD::FXRate>>()[0].data.bid, 1.249 );
+    EXPECT_EQ( parsedMsg.batch.offsets.size(), 2 );
+    EXPECT_EQ( parsedMsg.publisherID, "MktDataLiveProjector-123-0" );
+    EXPECT_EQ( parsedMsg.seq, 42u );
+    EXPECT_EQ( parsedMsg.chunkIdx, 1u );
+    EXPECT_EQ( parsedMsg.numChunks, 3u );
+    EXPECT_EQ( parsedMsg.deltaMasks, ( std::vector<uint64_t>{ 0, 6 } ) );
+}
@@ -28,13 +28,7 @@ std::unique_ptr<sw::redis::Redis> RedisConnPool::getConn( const std::string_view
 	{
 		Log( Module::CLICKHOUSE ).info( "Creating new Redis connection for dsh [{}]", dsh );
 
-		const DataSourceConfig config = DataSourceConfigManager::inst().get( dsh );
-		const DataSourceConfig::ConnProps connProps = config.connPropsMap.at( "Main" );
-		sw::redis::ConnectionOptions opts;
-		opts.host = connProps.hostname;
-		opts.port = connProps.port;
-
-		auto newConn = std::make_unique<sw::redis::Redis>( opts );
+		auto newConn = std::make_unique<sw::redis::Redis>( connectionOptions( dsh ) );
 		return newConn;
 	}
 	catch( const std::exception& e )
@@ -47,6 +41,17 @@ std::unique_ptr<sw::redis::Redis> RedisConnPool::getConn( const std::string_view
 	}
 }
 
+sw::redis::ConnectionOptions RedisConnPool::connectionOptions( const std::string_view dsh )
+{
+	const DataSourceConfig& config = DataSourceConfigManager::inst().get( dsh );
+	const DataSourceConfig::ConnProps& connProps = config.connPropsMap.at( "Main" );
+
+	sw::redis::ConnectionOptions opts;
+	opts.host = connProps.hostname;
+	opts.port = connProps.port;
+	return opts;
+}
+
 void RedisConnPool::retConn( const std::string_view dsh, std::unique_ptr<sw::redis::Redis> conn )
 {
 	if( conn )
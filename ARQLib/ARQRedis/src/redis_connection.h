@@ -21,6 +21,9 @@ public:
 
 	void closeAll();
 
+	// The options pooled connections are made with - for callers making a connection of their own
+	[[nodiscard]] static sw::redis::ConnectionOptions connectionOptions( const std::string_view dsh );
+
 private:
 	RedisConnPool() = default;
 
@@ -12,6 +12,11 @@ inline std::string market( const std::string_view marketName )
 	return std::format( "ARQ:Markets:{}", marketName );
 }
 
+inline std::string marketEntities( const std::string_view marketName, const std::string_view entityType )
+{
+	return std::format( "{}:{}", market( marketName ), entityType );
+}
+
 inline std::string streamOffsets( const std::string_view key )
 {
 	return std::format( "ARQ:StreamOffsets:{}", key );
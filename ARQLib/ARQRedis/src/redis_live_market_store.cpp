@@ -1,24 +1,94 @@
 #include "redis_live_market_store.h"
 
 #include "redis_connection.h"
-#include "redis_keys.h"
 #include "redis_mktdata_common.h"
 
 #include <ARQUtils/error.h>
 #include <ARQUtils/instr.h>
 #include <ARQUtils/logger.h>
 
+#include <algorithm>
+
 namespace ARQ::Redis::MD
 {
 
 namespace
 {
 
-void validateTransactionReplies( sw::redis::QueuedReplies& replies )
+// See LiveMarketScriptArgs for the layout of KEYS and ARGV. An offset only moves forward, and an entity hash's records from a partition are
+// only written if that partition's offset did. Returns how many offsets moved forward - 0 if the batch had already been applied
+constexpr std::string_view APPLY_SCRIPT = R"lua(
+local CHUNK = 1000
+local function callChunked( cmd, key, first, last )
+	for i = first, last, CHUNK do
+		redis.call( cmd, key, unpack( ARGV, i, math.min( i + CHUNK - 1, last ) ) )
+	end
+end
+
+local numOffsets  = tonumber( ARGV[1] )
+local advanced    = {}
+local numAdvanced = 0
+local pos         = 2
+for i = 1, numOffsets do
+	local current = redis.call( 'HGET', KEYS[1], ARGV[pos] )
+	if not current or tonumber( ARGV[pos + 1] ) > tonumber( current ) then
+		redis.call( 'HSET', KEYS[1], ARGV[pos], ARGV[pos + 1] )
+		advanced[i] = true
+		numAdvanced = numAdvanced + 1
+	end
+	pos = pos + 2
+end
+
+for k = 2, #KEYS do
+	local numGuards, numSets, numDels = tonumber( ARGV[pos] ), tonumber( ARGV[pos + 1] ), tonumber( ARGV[pos + 2] )
+	pos = pos + 3
+
+	local write = numGuards == 0
+	for g = 1, numGuards do
+		write = write or advanced[tonumber( ARGV[pos] )] == true
+		pos = pos + 1
+	end
+
+	if write and numSets > 0 then
+		callChunked( 'HSET', KEYS[k], pos, pos + 2 * numSets - 1 )
+	end
+	pos = pos + 2 * numSets
+
+	if write and numDels > 0 then
+		callChunked( 'HDEL', KEYS[k], pos, pos + numDels - 1 )
+	end
+	pos = pos + numDels
+end
+
+return numAdvanced
+)lua";
+
+// Redis's script cache is emptied by a restart, failover or SCRIPT FLUSH
+bool isNoScriptError( const std::string_view errMsg )
 {
-	// redis++ commands may have errors but these are only thrown as exceptions when they are accessed
-	for( size_t i = 0; i < replies.size(); ++i )
-		static_cast<void>( replies.get( i ) );
+	return errMsg.find( "NOSCRIPT" ) != std::string_view::npos;
+}
+
+struct ScriptReply
+{
+	std::optional<std::string> error;
+	bool                       skipped = false;
+};
+
+ScriptReply scriptReply( sw::redis::QueuedReplies& replies, const size_t idx )
+{
+	try
+	{
+		const redisReply& reply = replies.get( idx );
+		if( reply.type == REDIS_REPLY_ERROR )
+			return { .error = std::string( reply.str, reply.len ) };
+
+		return { .skipped = reply.type == REDIS_REPLY_INTEGER && reply.integer == 0 };
+	}
+	catch( const sw::redis::ReplyError& e )
+	{
+		return { .error = e.what() };
+	}
 }
 
 }
@@ -28,44 +98,86 @@ ARQ::MD::ILiveMarketStore* createLiveMarketStore( const std::string_view dsh )
 	return new RedisLiveMarketStore( dsh );
 }
 
-void RedisLiveMarketStore::apply( const ARQ::MD::MarketUpdateBatch& updateBatch )
+RedisLiveMarketStore::~RedisLiveMarketStore()
 {
-	Instr::Timer tmTotal;
-	Instr::Timer tmPrep;
+	m_queue.close();
+	if( m_writer.joinable() )
+		m_writer.join();
+}
 
-	const std::string marketName = updateBatch.marketName.str();
-	if( marketName.empty() )
+RedisLiveMarketStore::Transaction RedisLiveMarketStore::prepare( const ARQ::MD::MarketUpdateBatch& updateBatch ) const
+{
+	Transaction tx;
+	tx.marketName = updateBatch.marketName.str();
+	if( tx.marketName.empty() )
 		throw ARQException( "RedisLiveMarketStore: Cannot apply a live market batch without a market name" );
 	if( updateBatch.offsets.empty() )
-		throw ARQException( std::format( "RedisLiveMarketStore: Cannot apply live market batch [{}] without source offsets", marketName ) );
+		throw ARQException( std::format( "RedisLiveMarketStore: Cannot apply live market batch [{}] without source offsets", tx.marketName ) );
+
+	tx.scriptArgs = prepareLiveMarketScriptArgs( tx.marketName, prepareLiveMarketUpdates( tx.marketName, updateBatch, *m_serialiser ), updateBatch.offsets );
+	return tx;
+}
+
+std::string RedisLiveMarketStore::applyScriptSha( sw::redis::Redis& redis, const bool reload )
+{
+	std::lock_guard<std::mutex> lock( m_scriptMutex );
+	if( reload || m_scriptSha.empty() )
+	{
+		m_scriptSha = redis.script_load( APPLY_SCRIPT );
+		Log( Module::REDIS ).debug( "RedisLiveMarketStore: Loaded live market apply script [{}]", m_scriptSha );
+	}
+	return m_scriptSha;
+}
+
+long long RedisLiveMarketStore::evalApplyScript( sw::redis::Redis& redis, const LiveMarketScriptArgs& scriptArgs )
+{
+	const auto evalsha = [&redis, &scriptArgs] ( const std::string& sha )
+	{
+		return redis.evalsha<long long>( sha, scriptArgs.keys.begin(), scriptArgs.keys.end(), scriptArgs.args.begin(), scriptArgs.args.end() );
+	};
 
-	const RedisHashUpdates marketUpdates = prepareMarketUpdates( marketName, updateBatch.records, *m_serialiser );
-	const auto             offsetUpdates = prepareOffsetUpdates( updateBatch.offsets );
+	try
+	{
+		return evalsha( applyScriptSha( redis, false ) );
+	}
+	catch( const sw::redis::ReplyError& e )
+	{
+		if( !isNoScriptError( e.what() ) )
+			throw;
+	}
+
+	return evalsha( applyScriptSha( redis, true ) );
+}
+
+void RedisLiveMarketStore::apply( const ARQ::MD::MarketUpdateBatch& updateBatch )
+{
+	Instr::Timer tmTotal;
+	Instr::Timer tmPrep;
+
+	const Transaction prepared = prepare( updateBatch );
+	const std::string& marketName = prepared.marketName;
 
 	const auto prepTime = tmPrep.duration();
 
 	Instr::Timer tmConn;
 
 	RedisConn conn( m_dsh );
-	sw::redis::Redis& redis   = conn.client();
-	sw::redis::Transaction tx = redis.transaction( true, false );
+	sw::redis::Redis& redis = conn.client();
 
 	const auto connTime = tmConn.duration();
 
 	try
 	{
-		for( const auto& [hashKey, redisFields] : marketUpdates.sets )
-			tx.hset( hashKey, redisFields.begin(), redisFields.end() );
-		for( const auto& [hashKey, redisFields] : marketUpdates.dels )
-			tx.hdel( hashKey, redisFields.begin(), redisFields.end() );
-
-		const std::string offsetKey = Keys::liveMarketOffsets( marketName );
-		tx.hset( offsetKey, offsetUpdates.begin(), offsetUpdates.end() );
-
 		Instr::Timer tmNet;
-		auto replies = tx.exec();
-		validateTransactionReplies( replies );
-		Log( Module::REDIS ).debug( "Applied live market batch [{}] to Redis with {} objects and {} offsets atomically in total: {} (conn: {}, prep: {}, net: {})", marketName, updateBatch.records.size(), updateBatch.offsets.size(), tmTotal.duration(), connTime, prepTime, tmNet.duration() );
+		const long long numAdvanced = evalApplyScript( redis, prepared.scriptArgs );
+		if( numAdvanced == 0 )
+		{
+			m_numSkipped.fetch_add( 1, std::memory_order_relaxed );
+			Log( Module::REDIS ).debug( "Skipped live market batch [{}] as Redis already holds its offsets", marketName );
+			return;
+		}
+
+		Log( Module::REDIS ).debug( "Applied live market batch [{}] to Redis with {} objects and {} offsets ({} moved forward) atomically in total: {} (conn: {}, prep: {}, net: {})", marketName, updateBatch.records.size(), updateBatch.offsets.size(), numAdvanced, tmTotal.duration(), connTime, prepTime, tmNet.duration() );
 	}
 	catch( const std::exception& e )
 	{
@@ -73,4 +185,166 @@ void RedisLiveMarketStore::apply( const ARQ::MD::MarketUpdateBatch& updateBatch
 	}
 }
 
+void RedisLiveMarketStore::applyAsync( const ARQ::MD::MarketUpdateBatch& updateBatch, const ARQ::MD::LiveMarketStoreApplyCallbackFunc& onApplied )
+{
+	// Serialising the records happens here, on the caller's thread, overlapping whatever the writer has in flight
+	Transaction tx = prepare( updateBatch );
+	tx.onApplied   = onApplied;
+
+	std::call_once( m_writerStarted, [this] () { m_writer = std::thread( &RedisLiveMarketStore::runWriter, this ); } );
+
+	{
+		std::lock_guard<std::mutex> lock( m_stateMutex );
+		if( m_fatalError.size() )
+			throw ARQException( std::format( "RedisLiveMarketStore: Cannot queue live market batch [{}] as an earlier batch failed: {}", tx.marketName, m_fatalError ) );
+		++m_numQueued;
+	}
+
+	// Blocks while MAX_IN_FLIGHT batches are outstanding
+	if( !m_queue.push( std::move( tx ) ) )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_stateMutex );
+			++m_numDone;
+		}
+		m_doneCV.notify_all();
+		throw ARQException( "RedisLiveMarketStore: Cannot queue live market batch as the store is shutting down" );
+	}
+}
+
+void RedisLiveMarketStore::flush()
+{
+	std::unique_lock<std::mutex> lock( m_stateMutex );
+	m_doneCV.wait( lock, [this] () { return m_numDone >= m_numQueued; } );
+}
+
+ARQ::MD::LiveMarketStoreStats RedisLiveMarketStore::getStats() const
+{
+	return ARQ::MD::LiveMarketStoreStats {
+		.inFlight = m_inFlightHist.snapshot(),
+		.rttUs    = m_rttHist.snapshot(),
+		.queued   = m_queue.size(),
+		.applied  = m_numApplied.load( std::memory_order_relaxed ),
+		.failed   = m_numFailed.load( std::memory_order_relaxed ),
+		.skipped  = m_numSkipped.load( std::memory_order_relaxed )
+	};
+}
+
+void RedisLiveMarketStore::runWriter()
+{
+	std::vector<Transaction>                pending;
+	std::vector<std::optional<std::string>> errors;
+	while( m_queue.popAll( pending ) )
+	{
+		std::string fatalError;
+		{
+			std::lock_guard<std::mutex> lock( m_stateMutex );
+			fatalError = m_fatalError;
+		}
+
+		errors.assign( pending.size(), std::nullopt );
+		if( fatalError.empty() )
+			sendPipelined( pending, errors );
+		else
+			errors.assign( pending.size(), "Not sent as an earlier batch failed: " + fatalError );
+
+		for( size_t i = 0; i < pending.size(); ++i )
+		{
+			if( errors[i] )
+			{
+				m_numFailed.fetch_add( 1, std::memory_order_relaxed );
+				pending[i].onApplied( ARQException( std::format( "RedisLiveMarketStore: Error atomically applying live market batch [{}]: {}", pending[i].marketName, *errors[i] ) ) );
+			}
+			else
+			{
+				m_numApplied.fetch_add( 1, std::memory_order_relaxed );
+				pending[i].onApplied( std::nullopt );
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( m_stateMutex );
+			m_numDone += pending.size();
+		}
+		m_doneCV.notify_all();
+
+		pending.clear();
+	}
+}
+
+void RedisLiveMarketStore::sendPipelined( std::vector<Transaction>& transactions, std::vector<std::optional<std::string>>& errors )
+{
+	BackoffPolicy backoff( m_retryPolicy );
+	bool          reloadedScript = false;
+	while( true )
+	{
+		try
+		{
+			if( !m_writerPipe )
+			{
+				m_writerConn = RedisConnPool::inst().getConn( m_dsh );
+				m_writerPipe.emplace( m_writerConn->pipeline( false ) );
+			}
+			sw::redis::Pipeline& pipe = *m_writerPipe;
+
+			// Each batch is its own script call, so is still applied atomically - only its reply says whether it was
+			const std::string sha = applyScriptSha( *m_writerConn, false );
+			for( const Transaction& tx : transactions )
+				pipe.evalsha( sha, tx.scriptArgs.keys.begin(), tx.scriptArgs.keys.end(), tx.scriptArgs.args.begin(), tx.scriptArgs.args.end() );
+
+			Instr::Timer tmNet;
+			auto replies = pipe.exec();
+			m_rttHist.record( tmNet.duration<std::chrono::microseconds>() );
+			m_inFlightHist.record( transactions.size() );
+
+			std::vector<ScriptReply> scriptReplies;
+			scriptReplies.reserve( transactions.size() );
+			for( size_t i = 0; i < transactions.size(); ++i )
+				scriptReplies.push_back( scriptReply( replies, i ) );
+
+			// The batches after one that found the script missing may have been applied without it, so the whole round is sent again once
+			// it's reloaded - the script skips whatever has already landed
+			const bool noScript = std::ranges::any_of( scriptReplies, [] ( const ScriptReply& reply ) { return reply.error && isNoScriptError( *reply.error ); } );
+			if( noScript && !reloadedScript )
+			{
+				Log( Module::REDIS ).warn( "RedisLiveMarketStore: Live market apply script missing from Redis - reloading it and sending {} batches again", transactions.size() );
+				applyScriptSha( *m_writerConn, true );
+				reloadedScript = true;
+				continue;
+			}
+
+			for( size_t i = 0; i < transactions.size(); ++i )
+			{
+				errors[i] = std::move( scriptReplies[i].error );
+				if( scriptReplies[i].skipped )
+					m_numSkipped.fetch_add( 1, std::memory_order_relaxed );
+			}
+
+			Log( Module::REDIS ).debug( "Applied {} live market batches to Redis in one round trip of {}", transactions.size(), tmNet.duration() );
+			return;
+		}
+		catch( const std::exception& e )
+		{
+			// The connection is in an unknown state so is dropped. Nothing in the round trip can be assumed to have landed or not, so all of it
+			// is sent again - the script skips any batch whose offsets have already been written
+			m_writerPipe.reset();
+			m_writerConn.reset();
+
+			const auto delay = backoff.nextDelay();
+			if( !delay )
+			{
+				Log( Module::REDIS ).error( "RedisLiveMarketStore: Giving up sending {} live market batches to Redis: {}", transactions.size(), e.what() );
+
+				std::lock_guard<std::mutex> lock( m_stateMutex );
+				m_fatalError = e.what();
+				errors.assign( transactions.size(), m_fatalError );
+				return;
+			}
+
+			Log( Module::REDIS ).warn( "RedisLiveMarketStore: Error sending {} live market batches to Redis - trying again in {}ms ({}): {}", transactions.size(), delay->count(), backoff.attemptStr(), e.what() );
+			std::this_thread::sleep_for( *delay );
+		}
+	}
+}
+
 }
@@ -1,9 +1,20 @@
 #pragma once
 #include <ARQRedis/dll.h>
 
+#include <ARQUtils/backoff_policy.h>
+#include <ARQUtils/bounded_queue.h>
+#include <ARQUtils/instr.h>
 #include <ARQCore/serialiser.h>
 #include <ARQMarket/mktdata_live_store.h>
 
+#include "redis_mktdata_common.h"
+
+#include <sw/redis++/redis++.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace ARQ::Redis::MD
 {
 
@@ -18,11 +29,65 @@ public:
 		m_serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
 	}
 
+	~RedisLiveMarketStore();
+
 	void apply( const ARQ::MD::MarketUpdateBatch& updateBatch ) override;
 
+	// Batches are applied by a server side script that only writes the partitions whose offsets move forward, so replaying a batch
+	// that has already landed leaves the market as it is
+
+	// Pipelined mode - batches are queued for a writer thread that holds its own connection and sends everything queued as consecutive
+	// script calls in a single round trip. One connection keeps the batches, and so each market's updates, in order
+	void                          applyAsync( const ARQ::MD::MarketUpdateBatch& updateBatch, const ARQ::MD::LiveMarketStoreApplyCallbackFunc& onApplied ) override;
+	void                          flush()                                                                                                          override;
+	ARQ::MD::LiveMarketStoreStats getStats()                                                                                                 const override;
+
+	static constexpr size_t MAX_IN_FLIGHT = 64; /// Most batches queued or in a round trip before applyAsync() blocks
+
+private:
+	struct Transaction
+	{
+		std::string                               marketName;
+		LiveMarketScriptArgs                      scriptArgs;
+		ARQ::MD::LiveMarketStoreApplyCallbackFunc onApplied;
+	};
+
+	Transaction prepare( const ARQ::MD::MarketUpdateBatch& updateBatch ) const;
+
+	std::string applyScriptSha( sw::redis::Redis& redis, const bool reload );
+	long long   evalApplyScript( sw::redis::Redis& redis, const LiveMarketScriptArgs& scriptArgs );
+
+	void runWriter();
+	void sendPipelined( std::vector<Transaction>& transactions, std::vector<std::optional<std::string>>& errors );
+
 private:
-	std::string                 m_dsh;
-	std::shared_ptr<Serialiser> m_serialiser;
+	std::string                         m_dsh;
+	std::shared_ptr<Serialiser>         m_serialiser;
+
+	std::string                         m_scriptSha; /// The apply script as loaded into Redis's script cache
+	std::mutex                          m_scriptMutex;
+
+	std::once_flag                      m_writerStarted;
+	std::thread                         m_writer;
+	BoundedQueue<Transaction>           m_queue { MAX_IN_FLIGHT };
+	BackoffPolicy::Spec                 m_retryPolicy = { .initial = std::chrono::milliseconds( 100 ), .multiplier = 4, .maxDelay = std::chrono::seconds( 5 ), .maxAttempts = 5 };
+
+	// The writer's own connection, held for its life rather than checked out of the pool per batch - only touched on the writer thread
+	std::unique_ptr<sw::redis::Redis>   m_writerConn;
+	std::optional<sw::redis::Pipeline>  m_writerPipe;
+
+	// Once a round trip has failed for good nothing more is sent, as later batches would be applied out of order with it
+	std::string                         m_fatalError;
+	uint64_t                            m_numQueued = 0;
+	uint64_t                            m_numDone   = 0;
+	mutable std::mutex                  m_stateMutex;
+	std::condition_variable             m_doneCV;
+
+	Instr::Histogram                    m_inFlightHist;
+	Instr::Histogram                    m_rttHist;
+	std::atomic<uint64_t>               m_numApplied = 0;
+	std::atomic<uint64_t>               m_numFailed  = 0;
+	std::atomic<uint64_t>               m_numSkipped = 0;
 };
 
 }
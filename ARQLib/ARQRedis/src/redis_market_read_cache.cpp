@@ -0,0 +1,215 @@
+#include "redis_market_read_cache.h"
+
+#include "redis_connection.h"
+#include "redis_keys.h"
+
+#include <ARQUtils/backoff_policy.h>
+#include <ARQUtils/logger.h>
+#include <ARQMarket/market.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace ARQ::Redis::MD
+{
+
+namespace
+{
+
+// How often the listener looks up from waiting on notifications to see if it should stop
+constexpr std::chrono::milliseconds LISTENER_POLL_INTERVAL = std::chrono::milliseconds( 200 );
+
+// Keyspace notifications come on __keyspace@<db>__:<key>
+std::string_view keyFromChannel( const std::string_view channel )
+{
+	const size_t pos = channel.find( "__:" );
+	return pos == std::string_view::npos ? std::string_view() : channel.substr( pos + 3 );
+}
+
+}
+
+RedisMarketReadCache::RedisMarketReadCache( const std::string_view dsh, const size_t maxRecords )
+	: m_dsh( dsh )
+	, m_maxRecords( maxRecords )
+{
+}
+
+RedisMarketReadCache::~RedisMarketReadCache()
+{
+	m_stopping = true;
+	if( m_listener.joinable() )
+		m_listener.join();
+}
+
+void RedisMarketReadCache::startListener()
+{
+	if( !m_listener.joinable() )
+		m_listener = std::thread( &RedisMarketReadCache::runListener, this );
+}
+
+bool RedisMarketReadCache::isCacheable( const std::string_view marketName )
+{
+	static const std::string s_live = ARQ::MD::MarketName::LIVE.str();
+	return marketName != s_live;
+}
+
+RedisMarketReadCache::Stats RedisMarketReadCache::getStats() const
+{
+	Stats stats {
+		.hits          = m_numHits.load( std::memory_order_relaxed ),
+		.misses        = m_numMisses.load( std::memory_order_relaxed ),
+		.invalidations = m_numInvalidations.load( std::memory_order_relaxed ),
+		.evictions     = m_numEvictions.load( std::memory_order_relaxed )
+	};
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	stats.numRecords = m_numRecords;
+	stats.live       = m_live;
+	return stats;
+}
+
+void RedisMarketReadCache::invalidate( const std::string_view hashKey )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	// Kept even if nothing is cached for the hash, so tickets taken before now go stale
+	auto it = m_keys.find( hashKey );
+	if( it == m_keys.end() )
+		it = m_keys.emplace( std::string( hashKey ), KeyCache() ).first;
+
+	KeyCache& keyCache = it->second;
+	++keyCache.generation;
+	keyCache.records.reset();
+	m_numRecords        -= keyCache.numRecords;
+	keyCache.numRecords  = 0;
+
+	m_numInvalidations.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void RedisMarketReadCache::invalidateAll( const bool live )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_keys.clear();
+	m_numRecords = 0;
+	++m_epoch;
+	m_live = live;
+}
+
+void RedisMarketReadCache::evict( const std::string_view keep, const size_t numToFree )
+{
+	size_t numFreed = 0;
+	while( numFreed < numToFree )
+	{
+		// Few enough hashes (markets times types) that a scan for the oldest is cheaper than keeping them ordered
+		KeyCache* oldest = nullptr;
+		for( auto& [key, keyCache] : m_keys )
+		{
+			if( keyCache.numRecords && key != keep && ( !oldest || keyCache.lastUsed < oldest->lastUsed ) )
+				oldest = &keyCache;
+		}
+
+		if( !oldest )
+			return;
+
+		// The generation stays as it is - what was dropped is still current in Redis, so reads in flight may still cache it
+		numFreed           += oldest->numRecords;
+		m_numRecords       -= oldest->numRecords;
+		oldest->numRecords  = 0;
+		oldest->records.reset();
+
+		m_numEvictions.fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+
+bool RedisMarketReadCache::checkNotificationsEnabled( sw::redis::Redis& redis )
+{
+	std::vector<std::string> config;
+	try
+	{
+		config = redis.command<std::vector<std::string>>( "CONFIG", "GET", "notify-keyspace-events" );
+	}
+	catch( const sw::redis::ReplyError& e )
+	{
+		Log( Module::REDIS ).warn( "RedisMarketReadCache: Cannot check keyspace notifications are on for dsh [{}] - the read cache is off: {}", m_dsh, e.what() );
+		return false;
+	}
+
+	const std::string flags = config.size() == 2 ? config[1] : std::string();
+	const bool keyspace     = flags.find( 'K' ) != std::string::npos;
+	const bool allEvents    = flags.find( 'A' ) != std::string::npos;
+	const bool hashEvents   = allEvents || flags.find( 'h' ) != std::string::npos;
+	const bool delEvents    = allEvents || flags.find( 'g' ) != std::string::npos;
+	if( keyspace && hashEvents && delEvents )
+		return true;
+
+	Log( Module::REDIS ).warn( "RedisMarketReadCache: Keyspace notifications aren't on for hash and generic commands for dsh [{}] (notify-keyspace-events is [{}]) - the read cache is off", m_dsh, flags );
+	return false;
+}
+
+void RedisMarketReadCache::runListener()
+{
+	BackoffPolicy backoff( BackoffPolicy::Spec{ .initial = std::chrono::milliseconds( 100 ), .multiplier = 4, .maxDelay = std::chrono::seconds( 30 ), .maxAttempts = std::nullopt } );
+
+	while( !m_stopping )
+	{
+		try
+		{
+			// Its own connection rather than a pooled one - a subscribed connection can't run other commands, and the timeout lets it
+			// notice when to stop
+			sw::redis::ConnectionOptions opts = RedisConnPool::connectionOptions( m_dsh );
+			opts.socket_timeout = LISTENER_POLL_INTERVAL;
+			sw::redis::Redis redis( opts );
+
+			if( !checkNotificationsEnabled( redis ) )
+				return;
+
+			sw::redis::Subscriber sub = redis.subscriber();
+			// The pattern can't leave LIVE out, so its notifications are dropped here - nothing is cached for it anyway
+			const std::string livePrefix = Keys::market( ARQ::MD::MarketName::LIVE.str() ) + ":";
+			sub.on_pmessage( [this, &livePrefix] ( std::string, std::string channel, std::string )
+			{
+				const std::string_view hashKey = keyFromChannel( channel );
+				if( !hashKey.starts_with( livePrefix ) )
+					invalidate( hashKey );
+			} );
+			sub.on_meta( [this] ( sw::redis::Subscriber::MsgType type, sw::redis::OptionalString, long long )
+			{
+				// Anything read before now may have changed unseen, so the cache starts afresh
+				if( type == sw::redis::Subscriber::MsgType::PSUBSCRIBE )
+				{
+					invalidateAll( true );
+					Log( Module::REDIS ).info( "RedisMarketReadCache: Listening for changes to market hashes for dsh [{}] - the read cache is on", m_dsh );
+				}
+			} );
+			sub.psubscribe( std::format( "__keyspace@*__:{}:*", Keys::market( "*" ) ) );
+
+			while( !m_stopping )
+			{
+				try
+				{
+					sub.consume();
+					backoff.reset();
+				}
+				catch( const sw::redis::TimeoutError& )
+				{
+				}
+			}
+		}
+		catch( const std::exception& e )
+		{
+			// Changes may be missed until the subscription is back, so nothing can be served from the cache until then
+			invalidateAll( false );
+
+			const auto delay = backoff.nextDelay().value_or( std::chrono::milliseconds( 0 ) );
+			Log( Module::REDIS ).warn( "RedisMarketReadCache: Lost the subscription to market hash changes for dsh [{}] - the read cache is off until it's back, trying again in {}ms ({}): {}", m_dsh, delay.count(), backoff.attemptStr(), e.what() );
+
+			const auto retryAt = std::chrono::steady_clock::now() + delay;
+			while( !m_stopping && std::chrono::steady_clock::now() < retryAt )
+				std::this_thread::sleep_for( std::min<std::chrono::steady_clock::duration>( LISTENER_POLL_INTERVAL, retryAt - std::chrono::steady_clock::now() ) );
+		}
+	}
+
+	invalidateAll( false );
+}
+
+}
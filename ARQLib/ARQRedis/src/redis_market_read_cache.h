@@ -0,0 +1,205 @@
+#pragma once
+#include <ARQRedis/dll.h>
+
+#include <ARQUtils/hashers.h>
+#include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/tid.h>
+
+#include <sw/redis++/redis++.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ARQ::Redis::MD
+{
+
+/**
+ * @brief Decoded records read from Redis market hashes, kept in process until Redis says the hash has changed.
+ *
+ * Invalidation is server assisted - a dedicated connection subscribes to the keyspace notifications for the market hashes and any
+ * write to a hash drops everything cached for it. Notifications only name the key, not the fields written, so this only pays off
+ * for hashes that are written rarely, such as dated markets saved at end of day. The LIVE market's hashes change on every tick and would
+ * be dropped as fast as they were filled, so they are never cached (see isCacheable) and notifications for them are ignored.
+ *
+ * The cache only serves reads while the subscription is up. It needs keyspace notifications for hash and generic commands turned on
+ * (notify-keyspace-events including K with h and g, or KA) - a server wide setting, so every write on the server then publishes an
+ * event whether or not anyone is listening, which is why the cache is opt in via the read_cache option.
+ *
+ * A read takes a ticket for its hash before going to Redis and hands it back with what it read. If the hash was invalidated in
+ * between the ticket is stale and the records aren't cached, so a read that raced with a write can't leave stale records behind.
+ *
+ * At most maxRecords records are held (the read_cache_max_records option) - the hashes read least recently are dropped to make room.
+ */
+class RedisMarketReadCache
+{
+public:
+	struct Ticket
+	{
+		uint64_t epoch;
+		uint64_t generation;
+	};
+
+	struct Stats
+	{
+		uint64_t hits          = 0;
+		uint64_t misses        = 0;
+		uint64_t invalidations = 0;
+		uint64_t evictions     = 0; /// Hashes dropped to stay within maxRecords
+		size_t   numRecords    = 0;
+		bool     live          = false;
+	};
+
+public:
+	static constexpr size_t DEFAULT_MAX_RECORDS = 1'000'000;
+
+public:
+	ARQRedis_API explicit RedisMarketReadCache( const std::string_view dsh, const size_t maxRecords = DEFAULT_MAX_RECORDS );
+	ARQRedis_API ~RedisMarketReadCache();
+
+	RedisMarketReadCache( const RedisMarketReadCache& )            = delete;
+	RedisMarketReadCache& operator=( const RedisMarketReadCache& ) = delete;
+
+	/**
+	 * @brief Starts listening for changes to the market hashes - nothing is served from the cache until the subscription is up.
+	 */
+	ARQRedis_API void startListener();
+
+	/**
+	 * @brief Whether reads of a market are worth caching - everything but LIVE.
+	 */
+	[[nodiscard]] ARQRedis_API static bool isCacheable( const std::string_view marketName );
+
+	/**
+	 * @brief Drops everything cached for a hash and makes outstanding tickets for it stale. Called by the listener when the hash is written.
+	 */
+	ARQRedis_API void invalidate( const std::string_view hashKey );
+
+	/**
+	 * @brief Drops everything and makes all outstanding tickets stale.
+	 * @param live Whether the cache serves reads from now on - only while changes are being listened for.
+	 */
+	ARQRedis_API void invalidateAll( const bool live );
+
+	/**
+	 * @brief Appends the cached records for ids onto out, and the ids that aren't cached onto misses.
+	 * @return The ticket to cache what's read for the misses with, or nullopt if the cache isn't live (everything is a miss).
+	 */
+	template<ARQ::MD::c_MktData T>
+	std::optional<Ticket> lookup( const std::string& hashKey, const ARQ::MD::TIDSet::IDList& ids, std::vector<ARQ::MD::Record<T>>& out, ARQ::MD::TIDSet::IDList& misses )
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if( !m_live )
+		{
+			misses.insert( misses.end(), ids.begin(), ids.end() );
+			m_numMisses.fetch_add( ids.size(), std::memory_order_relaxed );
+			return std::nullopt;
+		}
+
+		KeyCache& keyCache = m_keys[hashKey];
+		keyCache.lastUsed = ++m_useCounter;
+		const CachedRecords<T>* records = static_cast<const CachedRecords<T>*>( keyCache.records.get() );
+
+		size_t numHits = 0;
+		for( const std::string_view id : ids )
+		{
+			if( records )
+			{
+				if( const auto it = records->find( id ); it != records->end() )
+				{
+					if( it->second ) // Otherwise cached as not in the hash
+						out.push_back( *it->second );
+					++numHits;
+					continue;
+				}
+			}
+			misses.push_back( id );
+		}
+
+		m_numHits.fetch_add( numHits, std::memory_order_relaxed );
+		m_numMisses.fetch_add( ids.size() - numHits, std::memory_order_relaxed );
+
+		return Ticket{ .epoch = m_epoch, .generation = keyCache.generation };
+	}
+
+	/**
+	 * @brief Caches what was read for a hash - nullopt for an id that isn't in it. Dropped if the hash has changed since the ticket was taken.
+	 */
+	template<ARQ::MD::c_MktData T>
+	void insert( const std::string& hashKey, const Ticket ticket, std::vector<std::pair<std::string_view, std::optional<ARQ::MD::Record<T>>>>&& read )
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		if( !m_live || ticket.epoch != m_epoch )
+			return;
+
+		KeyCache& keyCache = m_keys[hashKey];
+		if( ticket.generation != keyCache.generation )
+			return;
+
+		// Too big for the cache on its own - just not cached. Otherwise make room by dropping the hashes used least recently
+		if( keyCache.numRecords + read.size() > m_maxRecords )
+			return;
+		if( m_numRecords + read.size() > m_maxRecords )
+			evict( hashKey, m_numRecords + read.size() - m_maxRecords );
+
+		if( !keyCache.records )
+			keyCache.records = std::make_shared<CachedRecords<T>>();
+
+		CachedRecords<T>& records = *static_cast<CachedRecords<T>*>( keyCache.records.get() );
+		for( auto& [id, record] : read )
+			records.insert_or_assign( std::string( id ), std::move( record ) );
+
+		m_numRecords        += records.size() - keyCache.numRecords;
+		keyCache.numRecords  = records.size();
+	}
+
+	[[nodiscard]] ARQRedis_API Stats getStats() const;
+
+private:
+	template<ARQ::MD::c_MktData T>
+	using CachedRecords = std::unordered_map<std::string, std::optional<ARQ::MD::Record<T>>, TransparentStringHash, std::equal_to<>>;
+
+	struct KeyCache
+	{
+		uint64_t              generation = 0;
+		uint64_t              lastUsed   = 0;
+		size_t                numRecords = 0;
+		std::shared_ptr<void> records; /// CachedRecords<T> for the hash's type
+	};
+
+	void runListener();
+	bool checkNotificationsEnabled( sw::redis::Redis& redis );
+
+	// Drops whole hashes, least recently used first and never keep, until at least numToFree records have gone. Call with m_mutex held
+	ARQRedis_API void evict( const std::string_view keep, const size_t numToFree );
+
+private:
+	using KeyMap = std::unordered_map<std::string, KeyCache, TransparentStringHash, std::equal_to<>>;
+
+	std::string           m_dsh;
+	size_t                m_maxRecords;
+
+	KeyMap                m_keys;
+	uint64_t              m_epoch      = 0; /// Bumped whenever everything is dropped, which also forgets the keys' generations
+	bool                  m_live       = false;
+	size_t                m_numRecords = 0; /// Across all keys
+	uint64_t              m_useCounter = 0; /// Stamps KeyCache::lastUsed
+	mutable std::mutex    m_mutex;
+
+	std::atomic<bool>     m_stopping = false;
+	std::thread           m_listener;
+
+	std::atomic<uint64_t> m_numHits          = 0;
+	std::atomic<uint64_t> m_numMisses        = 0;
+	std::atomic<uint64_t> m_numInvalidations = 0;
+	std::atomic<uint64_t> m_numEvictions     = 0;
+};
+
+}
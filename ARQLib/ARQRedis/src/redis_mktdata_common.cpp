@@ -4,14 +4,33 @@
 
 #include <ARQUtils/buffer.h>
 #include <ARQUtils/error.h>
+#include <ARQMarket/mktdata_topics.h>
 
 namespace ARQ::Redis::MD
 {
 
+namespace
+{
+
+template<ARQ::MD::c_MktData T>
+std::string serialiseRecord( const std::string_view marketName, const ARQ::MD::Record<T>& record, const Serialiser& serialiser )
+{
+	try
+	{
+		Buffer buffer = serialiser.serialise( record );
+		return buffer.toString();
+	}
+	catch( const std::exception& e )
+	{
+		throw ARQException( std::format( "Redis market data: Error serialising {} [{}] for market [{}]: {}", ARQ::MD::Traits<T>::type(), record.header.id, marketName, e.what() ) );
+	}
+}
+
+}
+
 RedisHashUpdates prepareMarketUpdates( const std::string_view marketName, const ARQ::MD::RecordCollection& records, const Serialiser& serialiser )
 {
 	RedisHashUpdates updates;
-	const std::string marketKeyRoot = Keys::market( marketName );
 
 	records.visitVectors( [&] <ARQ::MD::c_MktData T> ( const std::vector<ARQ::MD::Record<T>>&vector )
 	{
@@ -26,17 +45,7 @@ RedisHashUpdates prepareMarketUpdates( const std::string_view marketName, const
 			std::optional<std::string>& fieldValue = fieldValues[record.header.id];
 
 			if( record.header.isActive )
-			{
-				try
-				{
-					Buffer buffer = serialiser.serialise( record );
-					fieldValue = std::move( buffer.toString() );
-				}
-				catch( const std::exception& e )
-				{
-					throw ARQException( std::format( "Redis market data: Error serialising {} [{}] for market [{}]: {}", ARQ::MD::Traits<T>::type(), record.header.id, marketName, e.what() ) );
-				}
-			}
+				fieldValue = serialiseRecord( marketName, record, serialiser );
 			else
 				fieldValue = std::nullopt; // Mark for deletion
 		}
@@ -54,7 +63,7 @@ RedisHashUpdates prepareMarketUpdates( const std::string_view marketName, const
 				redisFieldsToDel.emplace_back( std::move( fieldName ) );
 		}
 
-		const std::string key = std::format( "{}:{}", marketKeyRoot, ARQ::MD::Traits<T>::type() );
+		const std::string key = Keys::marketEntities( marketName, ARQ::MD::Traits<T>::type() );
 		if( redisFieldsToSet.size() )
 			updates.sets.emplace_back( key, std::move( redisFieldsToSet ) );
 		if( redisFieldsToDel.size() )
@@ -73,4 +82,134 @@ std::map<std::string, std::string> prepareOffsetUpdates( const StreamTopicPartit
 	return redisFields;
 }
 
+RedisPartitionedHashUpdates prepareLiveMarketUpdates( const std::string_view marketName, const ARQ::MD::MarketUpdateBatch& updateBatch, const Serialiser& serialiser )
+{
+	RedisPartitionedHashUpdates updates;
+
+	updateBatch.records.visitVectors( [&] <ARQ::MD::c_MktData T> ( const std::vector<ARQ::MD::Record<T>>& vector )
+	{
+		if( vector.empty() )
+			return;
+
+		const auto                  partitionsIt = updateBatch.recordPartitions.find( ARQ::MD::Traits<T>::typeEnum() );
+		const std::vector<int32_t>* partitions   = partitionsIt != updateBatch.recordPartitions.end() && partitionsIt->second.size() == vector.size() ? &partitionsIt->second : nullptr;
+
+		// Only an id's last record is written, under the partition it was read from
+		std::unordered_map<std::string_view, size_t> lastIdxs;
+		lastIdxs.reserve( vector.size() );
+		for( size_t i = 0; i < vector.size(); ++i )
+			lastIdxs[vector[i].header.id] = i;
+
+		std::map<int32_t, std::pair<RedisFields, RedisFieldNames>> partitionFields;
+		for( const auto& [id, idx] : lastIdxs )
+		{
+			const ARQ::MD::Record<T>& record = vector[idx];
+			auto& [redisFieldsToSet, redisFieldsToDel] = partitionFields[partitions ? ( *partitions )[idx] : ARQ::MD::MarketUpdateBatch::NO_PARTITION];
+
+			if( record.header.isActive )
+				redisFieldsToSet.emplace( record.header.id, serialiseRecord( marketName, record, serialiser ) );
+			else
+				redisFieldsToDel.emplace_back( record.header.id );
+		}
+
+		const std::string key = Keys::marketEntities( marketName, ARQ::MD::Traits<T>::type() );
+		for( auto& [partition, fields] : partitionFields )
+		{
+			auto& [redisFieldsToSet, redisFieldsToDel] = fields;
+
+			RedisHashUpdates& partitionUpdates = updates[partition];
+			if( redisFieldsToSet.size() )
+				partitionUpdates.sets.emplace_back( key, std::move( redisFieldsToSet ) );
+			if( redisFieldsToDel.size() )
+				partitionUpdates.dels.emplace_back( key, std::move( redisFieldsToDel ) );
+		}
+	} );
+
+	return updates;
+}
+
+LiveMarketScriptArgs prepareLiveMarketScriptArgs( const std::string_view marketName, const RedisPartitionedHashUpdates& updates, const StreamTopicPartitionOffsets& offsets )
+{
+	LiveMarketScriptArgs scriptArgs;
+	scriptArgs.keys.push_back( Keys::liveMarketOffsets( marketName ) );
+
+	// The script looks offsets up by index, so each topic remembers the index of each of its partitions
+	std::unordered_map<std::string_view, std::map<int32_t, size_t>> topicOffsetIdxs;
+	scriptArgs.args.push_back( std::to_string( offsets.size() ) );
+	for( const auto& [tp, offset] : offsets )
+	{
+		scriptArgs.args.push_back( std::format( "{}-{}", tp.first, tp.second ) );
+		scriptArgs.args.push_back( std::to_string( offset ) );
+		topicOffsetIdxs[tp.first][tp.second] = ( scriptArgs.args.size() - 1 ) / 2;
+	}
+
+	std::unordered_map<std::string, std::string_view> keyTopics;
+	ARQ::MD::RecordCollection().visitVectors( [&keyTopics, marketName] <ARQ::MD::c_MktData T> ( const std::vector<ARQ::MD::Record<T>>& )
+	{
+		keyTopics.emplace( Keys::marketEntities( marketName, ARQ::MD::Traits<T>::type() ), ARQ::MD::Topics<T>::updateTopic() );
+	} );
+
+	std::vector<size_t> guards;
+	for( const auto& [partition, partitionUpdates] : updates )
+	{
+		// A type's sets and deletions go against the same hash so are sent together
+		std::map<std::string_view, std::pair<const RedisFields*, const RedisFieldNames*>> hashUpdates;
+		for( const auto& [hashKey, redisFields] : partitionUpdates.sets )
+			hashUpdates[hashKey].first = &redisFields;
+		for( const auto& [hashKey, redisFields] : partitionUpdates.dels )
+			hashUpdates[hashKey].second = &redisFields;
+
+		for( const auto& [hashKey, fields] : hashUpdates )
+		{
+			const auto& [sets, dels] = fields;
+
+			// Guarded by the partition the records were read from, or by the whole topic where that isn't known. A hash with no offsets
+			// for its topic at all is written unconditionally
+			guards.clear();
+			const auto topicIt = keyTopics.find( std::string( hashKey ) );
+			const auto guardIt = topicIt != keyTopics.end() ? topicOffsetIdxs.find( topicIt->second ) : topicOffsetIdxs.end();
+			if( guardIt != topicOffsetIdxs.end() )
+			{
+				if( const auto partitionIt = guardIt->second.find( partition ); partitionIt != guardIt->second.end() )
+					guards.push_back( partitionIt->second );
+				else
+				{
+					for( const auto& [topicPartition, idx] : guardIt->second )
+						guards.push_back( idx );
+				}
+			}
+
+			scriptArgs.keys.emplace_back( hashKey );
+			scriptArgs.args.push_back( std::to_string( guards.size() ) );
+			scriptArgs.args.push_back( std::to_string( sets ? sets->size() : 0 ) );
+			scriptArgs.args.push_back( std::to_string( dels ? dels->size() : 0 ) );
+			for( const size_t idx : guards )
+				scriptArgs.args.push_back( std::to_string( idx ) );
+			if( sets )
+			{
+				for( const auto& [fieldName, fieldValue] : *sets )
+				{
+					scriptArgs.args.push_back( fieldName );
+					scriptArgs.args.push_back( fieldValue );
+				}
+			}
+			if( dels )
+				scriptArgs.args.insert( scriptArgs.args.end(), dels->begin(), dels->end() );
+		}
+	}
+
+	return scriptArgs;
+}
+
+size_t dedupeScannedRecords( ARQ::MD::RecordCollection& records, const std::set<ARQ::MD::Type>& multiReplyScans )
+{
+	size_t numDropped = 0;
+	records.visitVectors( [&multiReplyScans, &numDropped] <ARQ::MD::c_MktData T> ( std::vector<ARQ::MD::Record<T>>& vector )
+	{
+		if( multiReplyScans.contains( ARQ::MD::Traits<T>::typeEnum() ) )
+			numDropped += dedupeByID( vector );
+	} );
+	return numDropped;
+}
+
 }
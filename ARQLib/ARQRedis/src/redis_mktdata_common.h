@@ -5,9 +5,12 @@
 #include <ARQCore/serialiser.h>
 #include <ARQCore/streaming_service.h>
 #include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/mktdata_live_store.h>
 
 #include <map>
+#include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -26,7 +29,66 @@ struct RedisHashUpdates
 	RedisHashDels dels;
 };
 
+// Hash updates by the partition of their type's update topic the records were read from - MarketUpdateBatch::NO_PARTITION for records
+// whose partition isn't known
+using RedisPartitionedHashUpdates = std::map<int32_t, RedisHashUpdates>;
+
+// KEYS and ARGV for the live market apply script. KEYS[1] is the market's offsets hash and KEYS[2..] its entity hashes, once for each
+// partition with records in it. ARGV is laid out as
+//   numOffsets | numOffsets x ( offset field | offset )
+// followed by, for each entity hash in KEYS order,
+//   numGuards | numSets | numDels | numGuards x offset index (1 based) | numSets x ( field | value ) | numDels x field
+// A hash's guard is the offset of the partition its records were read from, or every offset of its type's update topic where that isn't
+// known - it is only written if one of them moves forward
+struct LiveMarketScriptArgs
+{
+	std::vector<std::string> keys;
+	std::vector<std::string> args;
+};
+
 ARQRedis_API RedisHashUpdates                   prepareMarketUpdates( const std::string_view marketName, const ARQ::MD::RecordCollection& records, const Serialiser& serialiser );
 ARQRedis_API std::map<std::string, std::string> prepareOffsetUpdates( const StreamTopicPartitionOffsets& offsets );
+ARQRedis_API RedisPartitionedHashUpdates        prepareLiveMarketUpdates( const std::string_view marketName, const ARQ::MD::MarketUpdateBatch& updateBatch, const Serialiser& serialiser );
+ARQRedis_API LiveMarketScriptArgs               prepareLiveMarketScriptArgs( const std::string_view marketName, const RedisPartitionedHashUpdates& updates, const StreamTopicPartitionOffsets& offsets );
+
+// Keeps one record per id - the newest, or the later of two as new as each other - in the order they came. Returns how many were dropped
+template<ARQ::MD::c_MktData T>
+size_t dedupeByID( std::vector<ARQ::MD::Record<T>>& records )
+{
+	// Every id's record is picked before any are moved, so the ids being looked up by stay put
+	std::unordered_map<std::string_view, size_t> newestIdxs;
+	newestIdxs.reserve( records.size() );
+	for( size_t i = 0; i < records.size(); ++i )
+	{
+		const auto [it, inserted] = newestIdxs.try_emplace( records[i].header.id, i );
+		if( !inserted && records[i].header.asofTs >= records[it->second].header.asofTs )
+			it->second = i;
+	}
+
+	if( newestIdxs.size() == records.size() )
+		return 0;
+
+	std::vector<bool> keep( records.size(), false );
+	for( const auto& [id, idx] : newestIdxs )
+		keep[idx] = true;
+
+	size_t numKept = 0;
+	for( size_t i = 0; i < records.size(); ++i )
+	{
+		if( !keep[i] )
+			continue;
+		if( numKept != i )
+			records[numKept] = std::move( records[i] );
+		++numKept;
+	}
+
+	const size_t numDropped = records.size() - numKept;
+	records.erase( records.begin() + numKept, records.end() );
+	return numDropped;
+}
+
+// A hash scan isn't a point in time view - a field can come back twice if the hash is resized between replies. Dedupes the types whose
+// scan took more than one reply by id, as dedupeByID. Returns how many records were dropped in all
+ARQRedis_API size_t dedupeScannedRecords( ARQ::MD::RecordCollection& records, const std::set<ARQ::MD::Type>& multiReplyScans );
 
 }
@@ -4,144 +4,298 @@
 #include "redis_keys.h"
 #include "redis_mktdata_common.h"
 
+#include <ARQUtils/bounded_queue.h>
 #include <ARQUtils/buffer.h>
 #include <ARQUtils/logger.h>
 #include <ARQUtils/instr.h>
+#include <ARQCore/data_source_config.h>
 
-#include <unordered_map>
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <optional>
+#include <set>
+#include <thread>
 
 using namespace ARQ::MD;
 
 namespace ARQ::Redis::MD
 {
 
+namespace
+{
+
+// Fields asked for by each HSCAN or HMGET. Replies are decoded as they arrive rather than once everything is in, so this and the queue
+// depth bound how much of the raw market is held in memory at once
+constexpr size_t LOAD_CHUNK_SIZE    = 1000;
+constexpr size_t MAX_DECODERS       = 4;
+constexpr size_t CHUNKS_PER_DECODER = 2;
+
+struct LoadChunk
+{
+	Type                                        type;
+	sw::redis::ReplyUPtr                        reply;
+	const redisReply*                           values;   /// Within reply - field value pairs from HSCAN, or just the values from HMGET
+	std::vector<std::string_view>               hmgetIDs; /// The fields asked for by HMGET, in the order their values come back
+	std::string                                 hashKey;
+	std::optional<RedisMarketReadCache::Ticket> cacheTicket; /// Set if what's read is to go in the read cache
+};
+
+void decodeChunk( const LoadChunk& chunk, const Serialiser& serialiser, const std::string_view marketName, RecordCollection& collection, RedisMarketReadCache* readCache )
+{
+	dispatch( chunk.type, [&] <c_MktData T> ()
+	{
+		std::vector<Record<T>>& vector = collection.get<Record<T>>();
+
+		// Records are decoded straight out of the reply's buffers
+		auto deserialiseAndPush = [&] ( const std::string_view id, const redisReply& value )
+		{
+			BufferView buffer( value.str, value.len );
+			ARQ_DO_IN_TRY( arqExc, errMsg );
+			{
+				vector.push_back( serialiser.deserialise<Record<T>>( buffer ) );
+			}
+			ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+			if( arqExc.what().size() )
+				Log( Module::REDIS ).error( arqExc, "RedisMarketSource: Exception deserialising {} [{}] for market [{}]", Traits<T>::type(), id, marketName );
+			else if( errMsg.size() )
+				Log( Module::REDIS ).error( "RedisMarketSource: Error deserialising {} [{}] for market [{}]: {}", Traits<T>::type(), id, marketName, errMsg );
+
+			return arqExc.what().empty() && errMsg.empty();
+		};
+
+		const redisReply& values = *chunk.values;
+		if( chunk.hmgetIDs.empty() )
+		{
+			vector.reserve( vector.size() + values.elements / 2 );
+			for( size_t i = 0; i + 1 < values.elements; i += 2 )
+				deserialiseAndPush( std::string_view( values.element[i]->str, values.element[i]->len ), *values.element[i + 1] );
+		}
+		else
+		{
+			// A record that fails to decode isn't cached, so is read again next time
+			std::vector<std::pair<std::string_view, std::optional<Record<T>>>> toCache;
+			if( chunk.cacheTicket )
+				toCache.reserve( values.elements );
+
+			vector.reserve( vector.size() + values.elements );
+			for( size_t i = 0; i < values.elements; ++i )
+			{
+				// Nil if the field didn't exist
+				if( values.element[i]->type == REDIS_REPLY_NIL )
+				{
+					if( chunk.cacheTicket )
+						toCache.emplace_back( chunk.hmgetIDs[i], std::nullopt );
+				}
+				else if( deserialiseAndPush( chunk.hmgetIDs[i], *values.element[i] ) && chunk.cacheTicket )
+					toCache.emplace_back( chunk.hmgetIDs[i], vector.back() );
+			}
+
+			if( chunk.cacheTicket )
+				readCache->insert<T>( chunk.hashKey, *chunk.cacheTicket, std::move( toCache ) );
+		}
+	} );
+}
+
+}
+
 IMarketSource* createMarketSource( const std::string_view dsh )
 {
 	return new RedisMarketSource( dsh );
 }
 
+RedisMarketSource::RedisMarketSource( const std::string_view dsh )
+	: m_dsh( dsh )
+{
+	m_serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
+
+	const DataSourceConfig& cfg = DataSourceConfigManager::inst().get( dsh );
+	if( cfg.isOptionSet( "read_cache" ) )
+	{
+		size_t maxRecords = RedisMarketReadCache::DEFAULT_MAX_RECORDS;
+		if( const auto it = cfg.options.find( "read_cache_max_records" ); it != cfg.options.end() )
+		{
+			const auto [end, ec] = std::from_chars( it->second.data(), it->second.data() + it->second.size(), maxRecords );
+			if( ec != std::errc() || end != it->second.data() + it->second.size() )
+				throw ARQException( std::format( "RedisMarketSource: Invalid read_cache_max_records [{}] for dsh [{}]", it->second, dsh ) );
+		}
+
+		m_readCache = std::make_unique<RedisMarketReadCache>( dsh, maxRecords );
+		m_readCache->startListener();
+	}
+}
+
+MarketSourceStats RedisMarketSource::getStats() const
+{
+	if( !m_readCache )
+		return {};
+
+	const RedisMarketReadCache::Stats cacheStats = m_readCache->getStats();
+	return MarketSourceStats {
+		.cacheHits          = cacheStats.hits,
+		.cacheMisses        = cacheStats.misses,
+		.cacheInvalidations = cacheStats.invalidations,
+		.cacheEvictions     = cacheStats.evictions
+	};
+}
+
 RecordCollection RedisMarketSource::load( const std::string_view marketName, const TIDSet& filter )
 {
 	Instr::Timer tmTotal;
 	Instr::Timer tmConn;
 
-	RecordCollection collection;
-
 	RedisConn conn( m_dsh );
-	sw::redis::Redis&   redis = conn.client();
-	sw::redis::Pipeline pl    = redis.pipeline( false ); // Don't create a new connection for the pipeline - take from conn pool
+	sw::redis::Redis& redis = conn.client();
 
 	const auto connTime = tmConn.duration();
 
-	// -----------------
-	// 1. Queue commands
-	// -----------------
+	const CompiledTIDSet compiledFilter( filter ); // Consolidated and hashed once rather than per type
 
-	Instr::Timer tmPrep;
-	const std::string marketKeyRoot = Keys::market( marketName );
+	// ----------------------------------------
+	// 1. Decoders, started with the first reply
+	// ----------------------------------------
 
+	// Each decoder fills its own collection, so they only meet at the queue. Not started until there's something to decode, so a load
+	// served entirely from the read cache doesn't start any
+	const size_t                  numDecoders = std::clamp<size_t>( std::thread::hardware_concurrency(), 1, MAX_DECODERS );
+	BoundedQueue<LoadChunk>       chunks( numDecoders * CHUNKS_PER_DECODER );
+	std::vector<RecordCollection> decoded( numDecoders );
+	std::vector<std::thread>      decoders;
+
+	const auto pushChunk = [&] ( LoadChunk&& chunk )
+	{
+		if( decoders.empty() )
+		{
+			decoders.reserve( numDecoders );
+			for( size_t i = 0; i < numDecoders; ++i )
+			{
+				decoders.emplace_back( [this, &chunks, &collection = decoded[i], marketName] ()
+				{
+					while( const std::optional<LoadChunk> chunk = chunks.pop() )
+						decodeChunk( *chunk, *m_serialiser, marketName, collection, m_readCache.get() );
+				} );
+			}
+		}
+
+		chunks.push( std::move( chunk ) );
+	};
+
+	// -------------------------------------------
+	// 2. Fetch each type a chunk at a time
+	// -------------------------------------------
+
+	// HSCAN rather than HGETALL so no one reply holds a whole type. Like any scan it isn't a point in time view - a field updated while the scan
+	// is running may come back with either value, and a field can come back twice if the hash is resized, so a type scanned in more than one
+	// reply is deduplicated once decoded
+	Instr::Timer     tmNet;
+	size_t           numReplies = 0;
+	std::set<Type>   multiReplyScans;
+	RecordCollection fromCache;
+	std::string      fetchError;
 	try
 	{
-		collection.visitVectors( [&] <c_MktData T> ( std::vector<Record<T>>&vector )
+		RecordCollection().visitVectors( [&] <c_MktData T> ( const std::vector<Record<T>>& )
 		{
-			const std::string hashKey = std::format( "{}:{}", marketKeyRoot, Traits<T>::type() );
+			const std::string hashKey = Keys::marketEntities( marketName, Traits<T>::type() );
 
-			TIDSet::IDs idSpec = filter.empty() ? TIDSet::All{} : filter.getIDsForType( Traits<T>::typeEnum() );
+			TIDSet::IDs idSpec = filter.empty() ? TIDSet::All{} : compiledFilter.getIDsForType( Traits<T>::typeEnum() );
 			if( std::holds_alternative<TIDSet::None>( idSpec ) )
-				return;                                          // filter explicitly specifies 'None' for this type, so skip entirely
-			else if( std::holds_alternative<TIDSet::All>( idSpec ) )
-				pl.hgetall( hashKey );                           // filter specifies 'all' for this type, so use hgetall
+				return; // filter explicitly specifies 'None' for this type, so skip entirely
+
+			if( std::holds_alternative<TIDSet::All>( idSpec ) )
+			{
+				const std::string count = std::to_string( LOAD_CHUNK_SIZE );
+				std::string       cursor = "0";
+				size_t            numScanReplies = 0;
+				do
+				{
+					sw::redis::ReplyUPtr reply = redis.command( "HSCAN", hashKey, cursor, "COUNT", count );
+					++numReplies;
+					if( ++numScanReplies == 2 )
+						multiReplyScans.insert( Traits<T>::typeEnum() );
+					if( !reply || reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || reply->element[1]->type != REDIS_REPLY_ARRAY )
+						throw ARQException( std::format( "Unexpected reply to HSCAN of [{}]", hashKey ) );
+
+					cursor.assign( reply->element[0]->str, reply->element[0]->len );
+
+					const redisReply* values = reply->element[1];
+					if( values->elements )
+						pushChunk( LoadChunk{ .type = Traits<T>::typeEnum(), .reply = std::move( reply ), .values = values } );
+				}
+				while( cursor != "0" );
+			}
 			else if( TIDSet::IDList* list = std::get_if<TIDSet::IDList>( &idSpec ) )
-				pl.hmget( hashKey, list->begin(), list->end() ); // filter specifies specific IDs, so only get those fields using hmget
+			{
+				// Only reads of specific ids are cached - only what's missing from the cache goes to Redis
+				std::optional<RedisMarketReadCache::Ticket> cacheTicket;
+				if( m_readCache && RedisMarketReadCache::isCacheable( marketName ) )
+				{
+					TIDSet::IDList misses;
+					cacheTicket = m_readCache->lookup<T>( hashKey, *list, fromCache.get<Record<T>>(), misses );
+					*list = std::move( misses );
+				}
+
+				std::vector<std::string_view> cmd;
+				for( size_t first = 0; first < list->size(); first += LOAD_CHUNK_SIZE )
+				{
+					const auto idsBegin = list->begin() + first;
+					const auto idsEnd   = list->begin() + std::min( first + LOAD_CHUNK_SIZE, list->size() );
+
+					cmd.assign( { "HMGET", hashKey } );
+					cmd.insert( cmd.end(), idsBegin, idsEnd );
+
+					sw::redis::ReplyUPtr reply = redis.command( cmd.begin(), cmd.end() );
+					++numReplies;
+					if( !reply || reply->type != REDIS_REPLY_ARRAY || reply->elements != static_cast<size_t>( idsEnd - idsBegin ) )
+						throw ARQException( std::format( "Unexpected reply to HMGET of [{}]", hashKey ) );
+
+					const redisReply* values = reply.get();
+					pushChunk( LoadChunk{ .type = Traits<T>::typeEnum(), .reply = std::move( reply ), .values = values, .hmgetIDs = { idsBegin, idsEnd }, .hashKey = hashKey, .cacheTicket = cacheTicket } );
+				}
+			}
 		} );
 	}
-	catch( const std::exception& e )
-	{
-		throw ARQException( std::format( "RedisMarketSource: Error queuing redis pipeline to load market [{}]: {}", marketName, e.what() ) );
-	}
-
-	const auto prepTime = tmPrep.duration();
-
-	// -------------------
-	// 2. Execute pipeline
-	// -------------------
-	sw::redis::QueuedReplies replies;
-
-	Instr::Timer tmNet;
-
-	try
+	catch( const ARQException& e )
 	{
-		replies = pl.exec();
+		fetchError = e.what();
 	}
 	catch( const std::exception& e )
 	{
-		throw ARQException( std::format( "RedisMarketSource: Error executing redis pipeline to load market [{}]: {}", marketName, e.what() ) );
+		fetchError = e.what();
 	}
 
 	const auto netTime = tmNet.duration();
 
-	// -------------------
-	// 2. Parse results
-	// -------------------
-
-	Instr::Timer tmParse;
+	// Let the decoders finish what's queued, even on an error, as they refer to locals here
+	chunks.close();
+	for( std::thread& decoder : decoders )
+		decoder.join();
 
-	size_t replyIndex = 0;
-	collection.visitVectors( [&] <c_MktData T> ( std::vector<Record<T>>& vector )
-	{
-		TIDSet::IDs idSpec = filter.empty() ? TIDSet::All{} : filter.getIDsForType( Traits<T>::typeEnum() );
+	if( fetchError.size() )
+		throw ARQException( std::format( "RedisMarketSource: Error loading market [{}]: {}", marketName, fetchError ) );
 
-		if( std::holds_alternative<TIDSet::None>( idSpec ) )
-			return; // We didn't queue a command for this type
+	// ------------------------------
+	// 3. Gather the decoded records
+	// ------------------------------
 
-		// Helper lambda
-
-		auto deserialiseAndPush = [&] ( const std::string_view id, const std::string_view serializedRecord )
-		{
-			BufferView buffer( reinterpret_cast<const uint8_t*>( serializedRecord.data() ), serializedRecord.size() );
-			ARQ_DO_IN_TRY( arqExc, errMsg );
-			{
-				auto record = m_serialiser->deserialise<Record<T>>( buffer );
-				vector.push_back( std::move( record ) );
-			}
-			ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
-
-			if( arqExc.what().size() )
-				Log( Module::REDIS ).error( arqExc, "RedisMarketSource: Exception deserialising {} [{}] for market [{}]", Traits<T>::type(), id, marketName );
-			else if( errMsg.size() )
-				Log( Module::REDIS ).error( "RedisMarketSource: Error deserialising {} [{}] for market [{}]: {}", Traits<T>::type(), id, marketName, errMsg );
-		};
-
-		// Parse based on the command queued
-
-		if( std::holds_alternative<TIDSet::All>( idSpec ) )
-		{
-			// HGETALL returns a dictionary
-			std::unordered_map<std::string, std::string> hashMap;
-			replies.get( replyIndex++, std::inserter( hashMap, hashMap.end() ) );
-
-			vector.reserve( hashMap.size() );
-			for( const auto& [id, serializedRecord] : hashMap )
-				deserialiseAndPush( id, serializedRecord );
-		}
-		else if( const auto* list = std::get_if<TIDSet::IDList>( &idSpec ) )
+	const size_t     numFromCache = fromCache.size();
+	RecordCollection collection   = std::move( fromCache );
+	for( RecordCollection& part : decoded )
+	{
+		part.visitVectors( [&collection] <c_MktData T> ( std::vector<Record<T>>& records )
 		{
-			// HMGET returns an array of Optionals (null if key didn't exist)
-			std::vector<sw::redis::OptionalString> optValues;
-			replies.get( replyIndex++, std::back_inserter( optValues ) );
-
-			vector.reserve( list->size() );
+			std::vector<Record<T>>& vector = collection.get<Record<T>>();
+			if( vector.empty() )
+				vector = std::move( records );
+			else
+				vector.insert( vector.end(), std::make_move_iterator( records.begin() ), std::make_move_iterator( records.end() ) );
+		} );
+	}
 
-			// We must zip the requested ID list with the returned optionals
-			for( size_t i = 0; i < list->size(); ++i )
-			{
-				if( optValues[i] )
-					deserialiseAndPush( ( *list )[i], *optValues[i] );
-			}
-		}
-	} );
+	const size_t numDuplicates = dedupeScannedRecords( collection, multiReplyScans );
 
-	Log( Module::REDIS ).debug( "Loaded market [{}] from Redis with {} objects in total: {} (conn: {}, prep: {}, net: {}, parse: {})", marketName, collection.size(), tmTotal.duration(), connTime, prepTime, netTime, tmParse.duration() );
+	Log( Module::REDIS ).debug( "Loaded market [{}] from Redis with {} objects ({} from the read cache, {} duplicates from the scan dropped) from {} replies across {} decoders in total: {} (conn: {}, net and decode: {})", marketName, collection.size(), numFromCache, numDuplicates, numReplies, decoders.size(), tmTotal.duration(), connTime, netTime );
 
 	return collection;
 }
@@ -4,6 +4,9 @@
 #include <ARQCore/serialiser.h>
 #include <ARQMarket/mktdata_source.h>
 
+#include "redis_market_read_cache.h"
+
+#include <memory>
 
 namespace ARQ::Redis::MD
 {
@@ -13,18 +16,16 @@ extern "C" ARQRedis_API ARQ::MD::IMarketSource* createMarketSource( const std::s
 class RedisMarketSource : public ARQ::MD::IMarketSource
 {
 public:
-	RedisMarketSource( const std::string_view dsh )
-		: m_dsh( dsh )
-	{
-		m_serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
-	}
+	RedisMarketSource( const std::string_view dsh );
 
-	ARQ::MD::RecordCollection load( const std::string_view marketName, const ARQ::MD::TIDSet& filter = ARQ::MD::TIDSet{} ) override;
-	void                      save( const std::string_view marketName, const ARQ::MD::RecordCollection& records )          override;
+	ARQ::MD::RecordCollection  load( const std::string_view marketName, const ARQ::MD::TIDSet& filter = ARQ::MD::TIDSet{} ) override;
+	void                       save( const std::string_view marketName, const ARQ::MD::RecordCollection& records )          override;
+	ARQ::MD::MarketSourceStats getStats()                                                                             const override;
 
 private:
-	std::string                  m_dsh;
-	std::shared_ptr<Serialiser>  m_serialiser;
+	std::string                           m_dsh;
+	std::shared_ptr<Serialiser>           m_serialiser;
+	std::unique_ptr<RedisMarketReadCache> m_readCache; /// Only with the read_cache option set for the dsh - caches reads of specific ids
 };
 
 
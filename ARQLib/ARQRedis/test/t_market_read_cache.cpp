@@ -0,0 +1,202 @@
+#include "redis_market_read_cache.h"
+
+#include <ARQMarket/market.h>
+#include <ARQMarket/mktdata_entities.h>
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace ARQ;
+
+namespace
+{
+
+using ReadCache = Redis::MD::RedisMarketReadCache;
+using FXRecords = std::vector<std::pair<std::string_view, std::optional<MD::Record<MD::FXRate>>>>;
+
+const std::string HASH_A = "ARQ:Markets:EOD|20240102:FXR";
+const std::string HASH_B = "ARQ:Markets:EOD|20240103:FXR";
+
+MD::Record<MD::FXRate> makeFXRecord( std::string id, const double mid )
+{
+	MD::Record<MD::FXRate> record;
+	record.header.id = std::move( id );
+	record.data.mid  = mid;
+	return record;
+}
+
+FXRecords makeRead( const std::vector<std::string_view>& ids )
+{
+	FXRecords read;
+	for( const std::string_view id : ids )
+		read.emplace_back( id, makeFXRecord( std::string( id ), 1.0 ) );
+	return read;
+}
+
+struct LookupResult
+{
+	std::optional<ReadCache::Ticket>    ticket;
+	std::vector<MD::Record<MD::FXRate>> hits;
+	MD::TIDSet::IDList                  misses;
+};
+
+LookupResult lookup( ReadCache& cache, const std::string& hashKey, const MD::TIDSet::IDList& ids )
+{
+	LookupResult result;
+	result.ticket = cache.lookup<MD::FXRate>( hashKey, ids, result.hits, result.misses );
+	return result;
+}
+
+}
+
+// The listener is never started, so these drive invalidation directly - invalidateAll( true ) stands in for the subscription coming up
+
+TEST( RedisMarketReadCacheTest, NotLive_EverythingMisses )
+{
+	ReadCache cache( "test" );
+
+	const LookupResult result = lookup( cache, HASH_A, { "EURUSD", "GBPUSD" } );
+	EXPECT_FALSE( result.ticket );
+	EXPECT_TRUE( result.hits.empty() );
+	EXPECT_EQ( result.misses, ( MD::TIDSet::IDList{ "EURUSD", "GBPUSD" } ) );
+	EXPECT_EQ( cache.getStats().misses, 2 );
+}
+
+TEST( RedisMarketReadCacheTest, CachesWhatWasRead_IncludingAbsentIDs )
+{
+	ReadCache cache( "test" );
+	cache.invalidateAll( true );
+
+	const LookupResult first = lookup( cache, HASH_A, { "EURUSD", "NOPE" } );
+	ASSERT_TRUE( first.ticket );
+	EXPECT_EQ( first.misses.size(), 2 );
+
+	FXRecords read = makeRead( { "EURUSD" } );
+	read.emplace_back( "NOPE", std::nullopt );
+	cache.insert<MD::FXRate>( HASH_A, *first.ticket, std::move( read ) );
+
+	// Both are hits - the absent one just adds nothing
+	const LookupResult second = lookup( cache, HASH_A, { "EURUSD", "NOPE", "GBPUSD" } );
+	ASSERT_EQ( second.hits.size(), 1 );
+	EXPECT_EQ( second.hits[0].header.id, "EURUSD" );
+	EXPECT_EQ( second.misses, ( MD::TIDSet::IDList{ "GBPUSD" } ) );
+
+	const ReadCache::Stats stats = cache.getStats();
+	EXPECT_EQ( stats.hits, 2 );
+	EXPECT_EQ( stats.misses, 3 );
+	EXPECT_EQ( stats.numRecords, 2 );
+}
+
+TEST( RedisMarketReadCacheTest, TicketTakenBeforeInvalidate_IsStale )
+{
+	ReadCache cache( "test" );
+	cache.invalidateAll( true );
+
+	// A write lands between the read's lookup and it handing back what it read
+	const LookupResult raced = lookup( cache, HASH_A, { "EURUSD" } );
+	ASSERT_TRUE( raced.ticket );
+	cache.invalidate( HASH_A );
+	cache.insert<MD::FXRate>( HASH_A, *raced.ticket, makeRead( { "EURUSD" } ) );
+
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD" } ).misses.size(), 1 );
+
+	// A ticket taken after the invalidation is good
+	const LookupResult retry = lookup( cache, HASH_A, { "EURUSD" } );
+	cache.insert<MD::FXRate>( HASH_A, *retry.ticket, makeRead( { "EURUSD" } ) );
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD" } ).hits.size(), 1 );
+}
+
+TEST( RedisMarketReadCacheTest, TicketTakenBeforeInvalidateAll_IsStale )
+{
+	ReadCache cache( "test" );
+	cache.invalidateAll( true );
+
+	const LookupResult raced = lookup( cache, HASH_A, { "EURUSD" } );
+	ASSERT_TRUE( raced.ticket );
+	cache.invalidateAll( true );
+	cache.insert<MD::FXRate>( HASH_A, *raced.ticket, makeRead( { "EURUSD" } ) );
+
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD" } ).misses.size(), 1 );
+}
+
+TEST( RedisMarketReadCacheTest, Invalidate_DropsOnlyThatHash )
+{
+	ReadCache cache( "test" );
+	cache.invalidateAll( true );
+
+	cache.insert<MD::FXRate>( HASH_A, *lookup( cache, HASH_A, {} ).ticket, makeRead( { "EURUSD" } ) );
+	cache.insert<MD::FXRate>( HASH_B, *lookup( cache, HASH_B, {} ).ticket, makeRead( { "EURUSD" } ) );
+
+	cache.invalidate( HASH_A );
+
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD" } ).misses.size(), 1 );
+	EXPECT_EQ( lookup( cache, HASH_B, { "EURUSD" } ).hits.size(), 1 );
+
+	const ReadCache::Stats stats = cache.getStats();
+	EXPECT_EQ( stats.invalidations, 1 );
+	EXPECT_EQ( stats.numRecords, 1 );
+}
+
+TEST( RedisMarketReadCacheTest, InvalidateAll_DropsEverything_AndCanTurnTheCacheOff )
+{
+	ReadCache cache( "test" );
+	cache.invalidateAll( true );
+
+	cache.insert<MD::FXRate>( HASH_A, *lookup( cache, HASH_A, {} ).ticket, makeRead( { "EURUSD" } ) );
+	cache.insert<MD::FXRate>( HASH_B, *lookup( cache, HASH_B, {} ).ticket, makeRead( { "EURUSD" } ) );
+
+	cache.invalidateAll( true );
+	EXPECT_EQ( cache.getStats().numRecords, 0 );
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD" } ).misses.size(), 1 );
+	EXPECT_EQ( lookup( cache, HASH_B, { "EURUSD" } ).misses.size(), 1 );
+
+	// Subscription lost - nothing is served or cached until it's back
+	const LookupResult beforeLoss = lookup( cache, HASH_A, {} );
+	cache.invalidateAll( false );
+	cache.insert<MD::FXRate>( HASH_A, *beforeLoss.ticket, makeRead( { "EURUSD" } ) );
+	EXPECT_FALSE( lookup( cache, HASH_A, { "EURUSD" } ).ticket );
+	EXPECT_FALSE( cache.getStats().live );
+}
+
+TEST( RedisMarketReadCacheTest, OverMaxRecords_EvictsLeastRecentlyUsedHash )
+{
+	const std::string hashC = "ARQ:Markets:EOD|20240104:FXR";
+
+	ReadCache cache( "test", 4 );
+	cache.invalidateAll( true );
+
+	cache.insert<MD::FXRate>( HASH_A, *lookup( cache, HASH_A, {} ).ticket, makeRead( { "EURUSD", "GBPUSD" } ) );
+	cache.insert<MD::FXRate>( HASH_B, *lookup( cache, HASH_B, {} ).ticket, makeRead( { "EURUSD", "GBPUSD" } ) );
+
+	// A is now the more recently used, so B makes way for C
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD" } ).hits.size(), 1 );
+	cache.insert<MD::FXRate>( hashC, *lookup( cache, hashC, {} ).ticket, makeRead( { "EURUSD" } ) );
+
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD", "GBPUSD" } ).hits.size(), 2 );
+	EXPECT_EQ( lookup( cache, HASH_B, { "EURUSD" } ).misses.size(), 1 );
+	EXPECT_EQ( lookup( cache, hashC, { "EURUSD" } ).hits.size(), 1 );
+
+	ReadCache::Stats stats = cache.getStats();
+	EXPECT_EQ( stats.evictions, 1 );
+	EXPECT_EQ( stats.numRecords, 3 );
+
+	// More than the whole cache holds - not cached, and nothing else is evicted for it
+	cache.insert<MD::FXRate>( HASH_B, *lookup( cache, HASH_B, {} ).ticket, makeRead( { "A", "B", "C", "D", "E" } ) );
+	EXPECT_EQ( lookup( cache, HASH_B, { "A" } ).misses.size(), 1 );
+	EXPECT_EQ( lookup( cache, HASH_A, { "EURUSD", "GBPUSD" } ).hits.size(), 2 );
+
+	stats = cache.getStats();
+	EXPECT_EQ( stats.evictions, 1 );
+	EXPECT_EQ( stats.numRecords, 3 );
+}
+
+TEST( RedisMarketReadCacheTest, OnlyLiveIsNotCacheable )
+{
+	EXPECT_FALSE( ReadCache::isCacheable( MD::MarketName::LIVE.str() ) );
+	EXPECT_TRUE( ReadCache::isCacheable( "EOD|20240102" ) );
+}
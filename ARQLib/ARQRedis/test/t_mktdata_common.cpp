@@ -13,6 +13,7 @@
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 using namespace ARQ;
 
@@ -206,3 +207,135 @@ TEST( RedisMktDataCommonTest, PrepareOffsetUpdatesProducesExpectedTopicPartition
 	EXPECT_EQ( fields.at( "ARQ.MktData.Updates.FXR-3" ), "97" );
 	EXPECT_EQ( fields.at( "ARQ.MktData.Updates.EQP-1" ), "1234" );
 }
+
+TEST( RedisMktDataCommonTest, PrepareLiveMarketScriptArgsGuardsHashesFromUnknownPartitionsWithTheirTopicsOffsets )
+{
+	Redis::MD::RedisHashUpdates updates;
+	updates.sets.emplace_back( "ARQ:Markets:LIVE:FXR", Redis::MD::RedisFields{ { "GBPUSD", "fx:GBPUSD" } } );
+	updates.dels.emplace_back( "ARQ:Markets:LIVE:FXR", Redis::MD::RedisFieldNames{ "EURUSD" } );
+	updates.sets.emplace_back( "ARQ:Markets:LIVE:EQP", Redis::MD::RedisFields{ { "AAPL", "eq:AAPL" } } );
+
+	const StreamTopicPartitionOffsets offsets{
+		{ StreamTopicPartition{ "ARQ.MktData.Updates.EQP", 1 }, 7 },
+		{ StreamTopicPartition{ "ARQ.MktData.Updates.FXR", 0 }, 42 },
+		{ StreamTopicPartition{ "ARQ.MktData.Updates.FXR", 3 }, 97 }
+	};
+
+	const Redis::MD::LiveMarketScriptArgs scriptArgs = Redis::MD::prepareLiveMarketScriptArgs( "LIVE", { { MD::MarketUpdateBatch::NO_PARTITION, updates } }, offsets );
+
+	const std::vector<std::string> expectedKeys{ "ARQ:StreamOffsets:Markets:LIVE", "ARQ:Markets:LIVE:EQP", "ARQ:Markets:LIVE:FXR" };
+	EXPECT_EQ( scriptArgs.keys, expectedKeys );
+
+	const std::vector<std::string> expectedArgs{
+		"3", "ARQ.MktData.Updates.EQP-1", "7", "ARQ.MktData.Updates.FXR-0", "42", "ARQ.MktData.Updates.FXR-3", "97",
+		"1", "1", "0", "1", "AAPL", "eq:AAPL",
+		"2", "1", "1", "2", "3", "GBPUSD", "fx:GBPUSD", "EURUSD"
+	};
+	EXPECT_EQ( scriptArgs.args, expectedArgs );
+}
+
+TEST( RedisMktDataCommonTest, PrepareLiveMarketScriptArgsLeavesHashesWithoutOffsetsUnguarded )
+{
+	Redis::MD::RedisHashUpdates updates;
+	updates.dels.emplace_back( "ARQ:Markets:LIVE:EQP", Redis::MD::RedisFieldNames{ "AAPL" } );
+
+	const StreamTopicPartitionOffsets offsets{ { StreamTopicPartition{ "ARQ.MktData.Updates.FXR", 0 }, 42 } };
+
+	const Redis::MD::LiveMarketScriptArgs scriptArgs = Redis::MD::prepareLiveMarketScriptArgs( "LIVE", { { MD::MarketUpdateBatch::NO_PARTITION, updates } }, offsets );
+
+	const std::vector<std::string> expectedArgs{ "1", "ARQ.MktData.Updates.FXR-0", "42", "0", "0", "1", "AAPL" };
+	EXPECT_EQ( scriptArgs.args, expectedArgs );
+}
+
+TEST( RedisMktDataCommonTest, PrepareLiveMarketUpdatesSplitsRecordsByTheirPartition )
+{
+	Serialiser serialiser;
+	registerFXSerialiser( serialiser );
+
+	MD::MarketUpdateBatch updateBatch;
+	auto& fxRecords = updateBatch.records.get<MD::Record<MD::FXRate>>();
+	fxRecords.push_back( makeFXRecord( "GBPUSD", true, "version-1" ) );
+	fxRecords.push_back( makeFXRecord( "EURUSD", false ) );
+	fxRecords.push_back( makeFXRecord( "GBPUSD", true, "version-2" ) );
+	updateBatch.recordPartitions[MD::Type::FXR] = { 0, 0, 3 };
+
+	const Redis::MD::RedisPartitionedHashUpdates updates = Redis::MD::prepareLiveMarketUpdates( "LIVE", updateBatch, serialiser );
+	ASSERT_EQ( updates.size(), 2 );
+
+	// An id's last record goes under the partition it was read from
+	EXPECT_TRUE( updates.at( 0 ).sets.empty() );
+	EXPECT_EQ( fieldsToDeleteForKey( updates.at( 0 ), "ARQ:Markets:LIVE:FXR" ).front(), "EURUSD" );
+	EXPECT_TRUE( updates.at( 3 ).dels.empty() );
+	EXPECT_EQ( fieldsForKey( updates.at( 3 ), "ARQ:Markets:LIVE:FXR" ).at( "GBPUSD" ), "fx:GBPUSD:version-2" );
+}
+
+TEST( RedisMktDataCommonTest, PrepareLiveMarketScriptArgsGuardsEachPartitionWithItsOwnOffset )
+{
+	Redis::MD::RedisPartitionedHashUpdates updates;
+	updates[0].sets.emplace_back( "ARQ:Markets:LIVE:FXR", Redis::MD::RedisFields{ { "GBPUSD", "fx:GBPUSD" } } );
+	updates[3].dels.emplace_back( "ARQ:Markets:LIVE:FXR", Redis::MD::RedisFieldNames{ "EURUSD" } );
+
+	const StreamTopicPartitionOffsets offsets{
+		{ StreamTopicPartition{ "ARQ.MktData.Updates.FXR", 0 }, 42 },
+		{ StreamTopicPartition{ "ARQ.MktData.Updates.FXR", 3 }, 97 }
+	};
+
+	const Redis::MD::LiveMarketScriptArgs scriptArgs = Redis::MD::prepareLiveMarketScriptArgs( "LIVE", updates, offsets );
+
+	const std::vector<std::string> expectedKeys{ "ARQ:StreamOffsets:Markets:LIVE", "ARQ:Markets:LIVE:FXR", "ARQ:Markets:LIVE:FXR" };
+	EXPECT_EQ( scriptArgs.keys, expectedKeys );
+
+	const std::vector<std::string> expectedArgs{
+		"2", "ARQ.MktData.Updates.FXR-0", "42", "ARQ.MktData.Updates.FXR-3", "97",
+		"1", "1", "0", "1", "GBPUSD", "fx:GBPUSD",
+		"1", "0", "1", "2", "EURUSD"
+	};
+	EXPECT_EQ( scriptArgs.args, expectedArgs );
+}
+
+TEST( RedisMktDataCommonTest, DedupeScannedRecordsKeepsNewestOfIDsRepeatedAcrossScanPages )
+{
+	const auto scanned = [] ( std::string id, const int64_t asofUs, std::string page )
+	{
+		MD::Record<MD::FXRate> record = makeFXRecord( std::move( id ), true, std::move( page ) );
+		record.header.asofTs = Time::DateTime( Time::Microseconds( asofUs ) );
+		return record;
+	};
+
+	// FXR took two HSCAN replies and the hash was resized in between, so GBPUSD and EURUSD came back in both
+	MD::RecordCollection records;
+	auto& fxRecords = records.get<MD::Record<MD::FXRate>>();
+	fxRecords.push_back( scanned( "GBPUSD", 100, "page-1" ) );
+	fxRecords.push_back( scanned( "EURUSD", 100, "page-1" ) );
+	fxRecords.push_back( scanned( "USDJPY", 100, "page-2" ) );
+	fxRecords.push_back( scanned( "GBPUSD", 200, "page-2" ) ); // Updated between the replies - the newer one is kept
+	fxRecords.push_back( scanned( "EURUSD", 100, "page-2" ) ); // Unchanged - the later one is kept
+
+	// EQP came back in a single reply, so is left alone
+	records.get<MD::Record<MD::EQPrice>>().push_back( MD::Record<MD::EQPrice>{ .header = { .id = "AAPL" } } );
+	records.get<MD::Record<MD::EQPrice>>().push_back( MD::Record<MD::EQPrice>{ .header = { .id = "AAPL" } } );
+
+	const size_t numDuplicates = Redis::MD::dedupeScannedRecords( records, { MD::Type::FXR } );
+	EXPECT_EQ( numDuplicates, 2 );
+
+	// Survivors stay in the order they came
+	ASSERT_EQ( fxRecords.size(), 3 );
+	EXPECT_EQ( fxRecords[0].header.id, "USDJPY" );
+	EXPECT_EQ( fxRecords[1].header.id, "GBPUSD" );
+	EXPECT_EQ( fxRecords[1].header.lastUpdatedBy, "page-2" );
+	EXPECT_EQ( fxRecords[1].header.asofTs, Time::DateTime( Time::Microseconds( 200 ) ) );
+	EXPECT_EQ( fxRecords[2].header.id, "EURUSD" );
+	EXPECT_EQ( fxRecords[2].header.lastUpdatedBy, "page-2" );
+
+	EXPECT_EQ( records.get<MD::Record<MD::EQPrice>>().size(), 2 );
+}
+
+TEST( RedisMktDataCommonTest, DedupeByIDLeavesUniqueIDsUntouched )
+{
+	std::vector<MD::Record<MD::FXRate>> records{ makeFXRecord( "GBPUSD", true ), makeFXRecord( "EURUSD", true ) };
+
+	EXPECT_EQ( Redis::MD::dedupeByID( records ), 0 );
+	ASSERT_EQ( records.size(), 2 );
+	EXPECT_EQ( records[0].header.id, "GBPUSD" );
+	EXPECT_EQ( records[1].header.id, "EURUSD" );
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace ARQ
+{
+
+/**
+ * @brief A bounded, blocking multi-producer queue, drained either by a single consumer taking everything pending in one go (popAll) or
+ *        by several consumers taking an item each (pop).
+ *
+ * Producers block in push() while the queue is full. Once closed, pushes are rejected but the consumer can still drain whatever
+ * was already queued.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue( const size_t capacity )
+		: m_capacity( capacity ? capacity : 1 )
+	{}
+
+	BoundedQueue( const BoundedQueue& )            = delete;
+	BoundedQueue& operator=( const BoundedQueue& ) = delete;
+
+	/**
+	 * @brief Pushes an item, blocking while the queue is full.
+	 * @return false if the queue was closed (the item is discarded).
+	 */
+	bool push( T&& item )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_notFullCV.wait( lock, [this] () { return m_closed || m_items.size() < m_capacity; } );
+			if( m_closed )
+				return false;
+
+			m_items.push_back( std::move( item ) );
+		}
+		m_notEmptyCV.notify_one();
+
+		return true;
+	}
+
+	/**
+	 * @brief Pushes an item only if there is room.
+	 * @return false if the queue is full or closed (the item is left untouched).
+	 */
+	bool tryPush( T&& item )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			if( m_closed || m_items.size() >= m_capacity )
+				return false;
+
+			m_items.push_back( std::move( item ) );
+		}
+		m_notEmptyCV.notify_one();
+
+		return true;
+	}
+
+	/**
+	 * @brief Blocks until at least one item is available (or the queue is closed), then moves every pending item onto the end of out.
+	 * @return false once the queue is closed and fully drained.
+	 */
+	bool popAll( std::vector<T>& out )
+	{
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_notEmptyCV.wait( lock, [this] () { return m_closed || !m_items.empty(); } );
+			if( m_items.empty() )
+				return false;
+
+			out.reserve( out.size() + m_items.size() );
+			for( T& item : m_items )
+				out.push_back( std::move( item ) );
+			m_items.clear();
+		}
+		m_notFullCV.notify_all();
+
+		return true;
+	}
+
+	/**
+	 * @brief Blocks until an item is available (or the queue is closed), then pops it.
+	 * @return nullopt once the queue is closed and fully drained.
+	 */
+	[[nodiscard]] std::optional<T> pop()
+	{
+		std::optional<T> item;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_notEmptyCV.wait( lock, [this] () { return m_closed || !m_items.empty(); } );
+			if( m_items.empty() )
+				return std::nullopt;
+
+			item.emplace( std::move( m_items.front() ) );
+			m_items.pop_front();
+		}
+		m_notFullCV.notify_one();
+
+		return item;
+	}
+
+	/**
+	 * @brief As pop(), but gives up once the timeout has passed.
+	 * @return nullopt if nothing arrived in time, or once the queue is closed and fully drained - isClosed() and size() tell the two apart.
+	 */
+	template<typename Rep, typename Period>
+	[[nodiscard]] std::optional<T> popFor( const std::chrono::duration<Rep, Period>& timeout )
+	{
+		std::optional<T> item;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			if( !m_notEmptyCV.wait_for( lock, timeout, [this] () { return m_closed || !m_items.empty(); } ) || m_items.empty() )
+				return std::nullopt;
+
+			item.emplace( std::move( m_items.front() ) );
+			m_items.pop_front();
+		}
+		m_notFullCV.notify_one();
+
+		return item;
+	}
+
+	/**
+	 * @brief Non-blocking pop of a single item.
+	 */
+	[[nodiscard]] std::optional<T> tryPop()
+	{
+		std::optional<T> item;
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			if( m_items.empty() )
+				return std::nullopt;
+
+			item.emplace( std::move( m_items.front() ) );
+			m_items.pop_front();
+		}
+		m_notFullCV.notify_one();
+
+		return item;
+	}
+
+	/**
+	 * @brief Rejects further pushes and wakes any blocked producers and consumers.
+	 */
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_closed = true;
+		}
+		m_notFullCV.notify_all();
+		m_notEmptyCV.notify_all();
+	}
+
+	[[nodiscard]] size_t size() const
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		return m_items.size();
+	}
+
+	[[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+	[[nodiscard]] bool isClosed() const
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		return m_closed;
+	}
+
+private:
+	const size_t            m_capacity;
+	std::deque<T>           m_items;
+	bool                    m_closed = false;
+
+	mutable std::mutex      m_mutex;
+	std::condition_variable m_notFullCV;
+	std::condition_variable m_notEmptyCV;
+};
+
+}
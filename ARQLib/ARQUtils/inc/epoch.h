@@ -0,0 +1,70 @@
+#pragma once
+#include <ARQUtils/dll.h>
+
+#include <cstdint>
+#include <utility>
+
+namespace ARQ
+{
+
+class EpochGuard;
+
+/**
+ * @brief Process-wide epoch based reclamation, so readers can use shared objects without writing to any shared cache line.
+ *
+ * Readers pin the current epoch for the lifetime of an EpochGuard, which only writes to a slot owned by the reading thread.
+ * A writer that unpublishes an object stamps it with advance() and may destroy it once isSafeToReclaim( stamp ) - by then every
+ * reader that could still be looking at it has unpinned.
+ */
+class Epoch
+{
+public:
+	struct Slot; // A reader thread's pinned epoch - opaque outside of epoch.cpp
+
+	/**
+	 * @brief Moves on to the next epoch. Call after unpublishing an object.
+	 * @return The stamp to retire the unpublished object with.
+	 */
+	ARQUtils_API static uint64_t advance();
+
+	/**
+	 * @brief Whether no reader is still pinned at an epoch before the given stamp.
+	 */
+	[[nodiscard]] ARQUtils_API static bool isSafeToReclaim( const uint64_t retireEpoch );
+
+private:
+	ARQUtils_API static Slot* pin();
+	ARQUtils_API static void  unpin( Slot* const slot );
+
+	friend EpochGuard;
+};
+
+/**
+ * @brief Pins the current epoch until destroyed. Guards nest, and must be destroyed on the thread that created them.
+ */
+class EpochGuard
+{
+public:
+	EpochGuard()
+		: m_slot( Epoch::pin() )
+	{}
+
+	~EpochGuard()
+	{
+		if( m_slot )
+			Epoch::unpin( m_slot );
+	}
+
+	EpochGuard( EpochGuard&& other ) noexcept
+		: m_slot( std::exchange( other.m_slot, nullptr ) )
+	{}
+
+	EpochGuard( const EpochGuard& )            = delete;
+	EpochGuard& operator=( const EpochGuard& ) = delete;
+	EpochGuard& operator=( EpochGuard&& )      = delete;
+
+private:
+	Epoch::Slot* m_slot;
+};
+
+}
@@ -3,7 +3,12 @@
 
 #include <ARQUtils/time.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <cstdint>
 
 namespace ARQ
 {
@@ -40,6 +45,64 @@ private:
 	std::chrono::steady_clock::time_point m_tEnd;
 };
 
+/**
+ * @brief A lock free histogram of unsigned values, bucketed by powers of two.
+ *
+ * Bucket 0 counts zeros and bucket i counts values in [2^(i-1), 2^i), so percentiles are only accurate to within a factor of two -
+ * plenty for latencies and queue depths, and cheap enough to record on a hot path from any number of threads.
+ */
+class Histogram
+{
+public:
+	static constexpr size_t NUM_BUCKETS = 65;
+
+	struct Snapshot
+	{
+		std::array<uint64_t, NUM_BUCKETS> buckets {};
+		uint64_t                          count = 0;
+		uint64_t                          sum   = 0;
+		uint64_t                          max   = 0;
+
+		[[nodiscard]] double mean() const { return count ? static_cast<double>( sum ) / count : 0.0; }
+
+		/**
+		 * @brief The upper bound of the bucket holding the given percentile, capped at max - zero if nothing has been recorded.
+		 * @param pct In the range [0, 100].
+		 */
+		[[nodiscard]] ARQUtils_API uint64_t percentile( const double pct ) const;
+	};
+
+public:
+	void record( const uint64_t value )
+	{
+		m_buckets[bucketFor( value )].fetch_add( 1, std::memory_order_relaxed );
+		m_count.fetch_add( 1, std::memory_order_relaxed );
+		m_sum.fetch_add( value, std::memory_order_relaxed );
+
+		uint64_t prevMax = m_max.load( std::memory_order_relaxed );
+		while( value > prevMax && !m_max.compare_exchange_weak( prevMax, value, std::memory_order_relaxed ) );
+	}
+
+	template<Time::c_Duration Duration>
+	void record( const Duration duration )
+	{
+		record( static_cast<uint64_t>( std::max<typename Duration::rep>( duration.count(), 0 ) ) );
+	}
+
+	/**
+	 * @brief Copies out the counts - concurrent records may or may not be included.
+	 */
+	[[nodiscard]] ARQUtils_API Snapshot snapshot() const;
+
+	static constexpr size_t bucketFor( const uint64_t value ) { return static_cast<size_t>( std::bit_width( value ) ); }
+
+private:
+	std::array<std::atomic<uint64_t>, NUM_BUCKETS> m_buckets {};
+	std::atomic<uint64_t>                          m_count = 0;
+	std::atomic<uint64_t>                          m_sum   = 0;
+	std::atomic<uint64_t>                          m_max   = 0;
+};
+
 }
 
 }
\ No newline at end of file
@@ -57,6 +57,35 @@ inline FuncPtr DynaLib::getFunc( const std::string_view funcName, const DoThrow
 	return reinterpret_cast<FuncPtr>( iGetFunc( funcName, doThrow ) );
 }
 
+/**
+ * @brief A read-only memory mapping of a whole file, unmapped on destruction.
+ *
+ * The mapping stays valid after the file is renamed over or deleted. An empty file maps to a null data() with size() 0.
+ */
+class MappedFile
+{
+public:
+	ARQUtils_API MappedFile() = default;
+	ARQUtils_API explicit MappedFile( const std::filesystem::path& path );
+	ARQUtils_API ~MappedFile();
+
+	MappedFile( const MappedFile& )            = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	ARQUtils_API MappedFile( MappedFile&& other ) noexcept;
+	ARQUtils_API MappedFile& operator=( MappedFile&& other ) noexcept;
+
+	[[nodiscard]] const uint8_t* data() const noexcept { return m_data; }
+	[[nodiscard]] size_t         size() const noexcept { return m_size; }
+
+private:
+	void unmap() noexcept;
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t         m_size = 0;
+};
+
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ARQ
+{
+
+/**
+ * @brief A persistent (immutable, structurally shared), sparse, index-addressed array implemented as a 32-way radix trie.
+ *
+ * Lookups are a fixed number of array index operations (one per level - at most 4 levels for ~1M elements) with no hashing or
+ * key comparisons. Copying is O(1) and setting an element only copies the path from the root to that element, so other
+ * copies are unaffected. As with PersistentHashMap, nodes uniquely owned by the array being mutated are modified in place.
+ *
+ * Slots that have never been set hold a default-constructed T.
+ *
+ * @note A single array object must not be mutated concurrently, but separate copies may be read and mutated freely from different threads.
+ */
+template<typename T>
+class PersistentArray
+{
+public:
+	PersistentArray() = default;
+
+	/**
+	 * @brief The number of addressable slots (one past the highest index that has ever been set).
+	 */
+	[[nodiscard]] size_t size() const noexcept { return m_size; }
+
+	/**
+	 * @brief Looks up the slot at the given index.
+	 * @return A pointer to the slot (which may hold a default-constructed T if never set), or nullptr if the index is out of range.
+	 */
+	[[nodiscard]] const T* find( const size_t idx ) const noexcept
+	{
+		if( idx >= m_size )
+			return nullptr;
+
+		const Node* node = m_root.get();
+		for( uint32_t shift = m_shift; shift > 0; shift -= BITS_PER_LEVEL )
+		{
+			node = node->children[( idx >> shift ) & MASK].get();
+			if( !node )
+				return nullptr;
+		}
+
+		return &node->values[idx & MASK];
+	}
+
+	/**
+	 * @brief Sets the slot at the given index, growing the array if required.
+	 */
+	void set( const size_t idx, T value )
+	{
+		if( !m_root )
+			m_root = makeNode( 0 );
+
+		// Grow the trie upwards until the index fits
+		while( ( idx >> m_shift ) > MASK )
+		{
+			NodePtr newRoot = makeNode( m_shift + BITS_PER_LEVEL );
+			newRoot->children[0] = std::move( m_root );
+			m_root   = std::move( newRoot );
+			m_shift += BITS_PER_LEVEL;
+		}
+
+		NodePtr* nodePtr = &m_root;
+		for( uint32_t shift = m_shift; shift > 0; shift -= BITS_PER_LEVEL )
+		{
+			NodePtr& child = makeUnique( *nodePtr ).children[( idx >> shift ) & MASK];
+			if( !child )
+				child = makeNode( shift - BITS_PER_LEVEL );
+
+			nodePtr = &child;
+		}
+
+		makeUnique( *nodePtr ).values[idx & MASK] = std::move( value );
+
+		if( idx >= m_size )
+			m_size = idx + 1;
+	}
+
+	void clear() noexcept
+	{
+		m_root.reset();
+		m_shift = 0;
+		m_size  = 0;
+	}
+
+private:
+	static constexpr uint32_t BITS_PER_LEVEL = 5;
+	static constexpr uint32_t WIDTH          = 1u << BITS_PER_LEVEL;
+	static constexpr size_t   MASK           = WIDTH - 1;
+
+	struct Node;
+	using NodePtr = std::shared_ptr<Node>;
+
+	// Branch nodes only use children, leaf nodes (shift of zero) only use values
+	struct Node
+	{
+		std::vector<NodePtr> children;
+		std::vector<T>       values;
+	};
+
+private:
+	static NodePtr makeNode( const uint32_t shift )
+	{
+		NodePtr node = std::make_shared<Node>();
+		if( shift > 0 )
+			node->children.resize( WIDTH );
+		else
+			node->values.resize( WIDTH );
+
+		return node;
+	}
+
+	// Copy-on-write - only copy the node if something other than the slot we are holding references it
+	static Node& makeUnique( NodePtr& node )
+	{
+		if( node.use_count() != 1 )
+			node = std::make_shared<Node>( *node );
+		else
+			std::atomic_thread_fence( std::memory_order_acquire ); // Synchronise with any other owner that has just released its reference
+
+		return *node;
+	}
+
+private:
+	NodePtr  m_root;
+	uint32_t m_shift = 0;
+	size_t   m_size  = 0;
+};
+
+}
@@ -0,0 +1,435 @@
+#pragma once
+
+#include <ankerl/unordered_dense.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ARQ
+{
+
+/**
+ * @brief A persistent (immutable, structurally shared) hash map, implemented as a compressed hash array mapped trie (CHAMP).
+ *
+ * Copying a map is O(1) - the copy shares every node with the original. Mutating a map only copies the nodes on the path
+ * from the root to the touched key (O(log32 N)), so other copies are never affected and continue to share all untouched nodes.
+ * Nodes that are uniquely owned by the map being mutated (e.g. nodes already copied by an earlier mutation in the same batch)
+ * are modified in place rather than being copied again.
+ *
+ * @tparam Key      The key type.
+ * @tparam Value    The mapped type - should be cheap to copy (e.g. a shared_ptr) as values are copied when their leaf node is copied.
+ * @tparam Hash     Hash functor - should produce well distributed 64 bit hashes. May be transparent to allow heterogeneous lookup.
+ * @tparam KeyEqual Key equality functor. May be transparent to allow heterogeneous lookup.
+ *
+ * @note A single map object must not be mutated concurrently, but separate copies may be read and mutated freely from different threads.
+ */
+template<typename Key, typename Value, typename Hash = ankerl::unordered_dense::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class PersistentHashMap
+{
+public:
+	PersistentHashMap() = default;
+
+	[[nodiscard]] size_t size()  const noexcept { return m_size; }
+	[[nodiscard]] bool   empty() const noexcept { return m_size == 0; }
+
+	/**
+	 * @brief Looks up the value for the given key.
+	 * @return A pointer to the value (valid for as long as this map, or any copy sharing the node, is alive), or nullptr if not found.
+	 */
+	template<typename K>
+	[[nodiscard]] const Value* find( const K& key ) const
+	{
+		const Node* node  = m_root.get();
+		const HashT hash  = Hash{}( key );
+		uint32_t    shift = 0;
+
+		while( node )
+		{
+			if( shift >= HASH_BITS )
+			{
+				for( const Leaf& leaf : node->leaves )
+				{
+					if( KeyEqual{}( leaf.key, key ) )
+						return &leaf.value;
+				}
+				return nullptr;
+			}
+
+			const uint32_t bit = bitpos( hash, shift );
+			if( node->leafMap & bit )
+			{
+				const Leaf& leaf = node->leaves[index( node->leafMap, bit )];
+				return leaf.hash == hash && KeyEqual{}( leaf.key, key ) ? &leaf.value : nullptr;
+			}
+			else if( node->childMap & bit )
+			{
+				node   = node->children[index( node->childMap, bit )].get();
+				shift += BITS_PER_LEVEL;
+			}
+			else
+				return nullptr;
+		}
+
+		return nullptr;
+	}
+
+	template<typename K>
+	[[nodiscard]] bool contains( const K& key ) const { return find( key ) != nullptr; }
+
+	/**
+	 * @brief Inserts the key/value pair or overwrites the value if the key already exists.
+	 * @return true if a new key was inserted, false if an existing value was overwritten.
+	 */
+	bool set( Key key, Value value )
+	{
+		const HashT hash = Hash{}( key );
+
+		if( !m_root )
+			m_root = std::make_shared<Node>();
+
+		const bool inserted = setImpl( m_root, Leaf{ hash, std::move( key ), std::move( value ) }, 0 );
+		if( inserted )
+			++m_size;
+
+		return inserted;
+	}
+
+	/**
+	 * @brief Erases the given key if it exists.
+	 * @return true if the key was erased, false if it did not exist.
+	 */
+	template<typename K>
+	bool erase( const K& key )
+	{
+		// Check first so we don't needlessly copy the path to a key that isn't there
+		if( !contains( key ) )
+			return false;
+
+		eraseImpl( m_root, Hash{}( key ), key, 0 );
+		--m_size;
+
+		return true;
+	}
+
+	void clear() noexcept
+	{
+		m_root.reset();
+		m_size = 0;
+	}
+
+	/**
+	 * @brief Calls func( key, value ) for every entry in the map (in no particular order).
+	 */
+	template<typename F>
+	void forEach( F&& func ) const
+	{
+		if( m_root )
+			forEachImpl( *m_root, func );
+	}
+
+	/**
+	 * @brief Checks whether two maps share the same root node (i.e. are guaranteed to hold identical contents without comparing entries).
+	 */
+	[[nodiscard]] bool sharesRootWith( const PersistentHashMap& other ) const noexcept { return m_root == other.m_root; }
+
+	/**
+	 * @brief Calls func( key, before, after ) for every key whose value differs between this map and newer.
+	 *        before is nullptr for keys only in newer, after is nullptr for keys only in this map, and values are compared with ==.
+	 *
+	 * Subtrees shared between the two maps are skipped without being visited, so diffing two versions
+	 * derived from one another costs time proportional to the number of changes rather than the size of the map.
+	 */
+	template<typename F>
+	void diff( const PersistentHashMap& newer, F&& func ) const
+	{
+		diffImpl( m_root.get(), newer.m_root.get(), 0, func );
+	}
+
+private:
+	using HashT = uint64_t;
+
+	static constexpr uint32_t BITS_PER_LEVEL = 5;
+	static constexpr uint32_t HASH_BITS      = 64;
+
+	struct Leaf
+	{
+		HashT hash;
+		Key   key;
+		Value value;
+	};
+
+	struct Node;
+	using NodePtr = std::shared_ptr<Node>;
+
+	/*
+	 * Below HASH_BITS a node is a bitmap-indexed branch - leafMap/childMap say which of the 32 hash fragments
+	 * are stored inline as leaves and which point to child nodes. Past HASH_BITS all hash bits have been consumed,
+	 * so the node is a collision node that just holds a flat list of leaves.
+	 */
+	struct Node
+	{
+		uint32_t             leafMap  = 0;
+		uint32_t             childMap = 0;
+		std::vector<Leaf>    leaves;
+		std::vector<NodePtr> children;
+	};
+
+private:
+	static uint32_t bitpos( const HashT hash, const uint32_t shift ) noexcept
+	{
+		return 1u << ( ( hash >> shift ) & 0x1F );
+	}
+
+	static size_t index( const uint32_t bitmap, const uint32_t bit ) noexcept
+	{
+		return std::popcount( bitmap & ( bit - 1 ) );
+	}
+
+	// Copy-on-write - only copy the node if something other than the slot we are holding references it
+	static Node& makeUnique( NodePtr& node )
+	{
+		if( node.use_count() != 1 )
+			node = std::make_shared<Node>( *node );
+		else
+			std::atomic_thread_fence( std::memory_order_acquire ); // Synchronise with any other owner that has just released its reference
+
+		return *node;
+	}
+
+	static NodePtr mergeLeaves( Leaf&& lhs, Leaf&& rhs, const uint32_t shift )
+	{
+		NodePtr node = std::make_shared<Node>();
+
+		if( shift >= HASH_BITS )
+		{
+			node->leaves.reserve( 2 );
+			node->leaves.push_back( std::move( lhs ) );
+			node->leaves.push_back( std::move( rhs ) );
+			return node;
+		}
+
+		const uint32_t lhsBit = bitpos( lhs.hash, shift );
+		const uint32_t rhsBit = bitpos( rhs.hash, shift );
+		if( lhsBit == rhsBit )
+		{
+			node->childMap = lhsBit;
+			node->children.push_back( mergeLeaves( std::move( lhs ), std::move( rhs ), shift + BITS_PER_LEVEL ) );
+		}
+		else
+		{
+			node->leafMap = lhsBit | rhsBit;
+			node->leaves.reserve( 2 );
+			if( lhsBit < rhsBit )
+			{
+				node->leaves.push_back( std::move( lhs ) );
+				node->leaves.push_back( std::move( rhs ) );
+			}
+			else
+			{
+				node->leaves.push_back( std::move( rhs ) );
+				node->leaves.push_back( std::move( lhs ) );
+			}
+		}
+
+		return node;
+	}
+
+	static bool setImpl( NodePtr& nodePtr, Leaf&& newLeaf, const uint32_t shift )
+	{
+		Node& node = makeUnique( nodePtr );
+
+		if( shift >= HASH_BITS )
+		{
+			for( Leaf& leaf : node.leaves )
+			{
+				if( KeyEqual{}( leaf.key, newLeaf.key ) )
+				{
+					leaf.value = std::move( newLeaf.value );
+					return false;
+				}
+			}
+
+			node.leaves.push_back( std::move( newLeaf ) );
+			return true;
+		}
+
+		const uint32_t bit = bitpos( newLeaf.hash, shift );
+		if( node.leafMap & bit )
+		{
+			const size_t leafIdx = index( node.leafMap, bit );
+			Leaf&        leaf    = node.leaves[leafIdx];
+			if( leaf.hash == newLeaf.hash && KeyEqual{}( leaf.key, newLeaf.key ) )
+			{
+				leaf.value = std::move( newLeaf.value );
+				return false;
+			}
+
+			// Two different keys share this fragment - push both down into a new child node
+			NodePtr child = mergeLeaves( std::move( leaf ), std::move( newLeaf ), shift + BITS_PER_LEVEL );
+			node.leaves.erase( node.leaves.begin() + leafIdx );
+			node.leafMap ^= bit;
+
+			node.children.insert( node.children.begin() + index( node.childMap, bit ), std::move( child ) );
+			node.childMap |= bit;
+			return true;
+		}
+		else if( node.childMap & bit )
+			return setImpl( node.children[index( node.childMap, bit )], std::move( newLeaf ), shift + BITS_PER_LEVEL );
+		else
+		{
+			node.leaves.insert( node.leaves.begin() + index( node.leafMap, bit ), std::move( newLeaf ) );
+			node.leafMap |= bit;
+			return true;
+		}
+	}
+
+	// Assumes the key is present
+	template<typename K>
+	static void eraseImpl( NodePtr& nodePtr, const HashT hash, const K& key, const uint32_t shift )
+	{
+		Node& node = makeUnique( nodePtr );
+
+		if( shift >= HASH_BITS )
+		{
+			std::erase_if( node.leaves, [&key] ( const Leaf& leaf ) { return KeyEqual{}( leaf.key, key ); } );
+			return;
+		}
+
+		const uint32_t bit = bitpos( hash, shift );
+		if( node.leafMap & bit )
+		{
+			node.leaves.erase( node.leaves.begin() + index( node.leafMap, bit ) );
+			node.leafMap ^= bit;
+		}
+		else if( node.childMap & bit )
+		{
+			const size_t childIdx = index( node.childMap, bit );
+			NodePtr&     child    = node.children[childIdx];
+			eraseImpl( child, hash, key, shift + BITS_PER_LEVEL );
+
+			// Keep the trie compact - a child left holding a single leaf is pulled back up into this node
+			if( child->children.empty() && child->leaves.size() == 1 )
+			{
+				Leaf leaf = std::move( child->leaves.front() );
+				node.children.erase( node.children.begin() + childIdx );
+				node.childMap ^= bit;
+
+				node.leaves.insert( node.leaves.begin() + index( node.leafMap, bit ), std::move( leaf ) );
+				node.leafMap |= bit;
+			}
+		}
+	}
+
+	template<typename F>
+	static void forEachImpl( const Node& node, F&& func )
+	{
+		for( const Leaf& leaf : node.leaves )
+			func( leaf.key, leaf.value );
+		for( const NodePtr& child : node.children )
+			forEachImpl( *child, func );
+	}
+
+	// Reports a single leaf against every entry of a node (either side may be the older one)
+	template<typename F>
+	static void diffLeafAgainstNode( const Leaf& leaf, const Node& node, const bool leafIsOlder, F& func )
+	{
+		bool found = false;
+		forEachImpl( node, [&] ( const Key& key, const Value& value )
+		{
+			if( !found && KeyEqual{}( key, leaf.key ) )
+			{
+				found = true;
+				if( !( value == leaf.value ) )
+					leafIsOlder ? func( key, &leaf.value, &value ) : func( key, &value, &leaf.value );
+			}
+			else
+				leafIsOlder ? func( key, nullptr, &value ) : func( key, &value, nullptr );
+		} );
+
+		if( !found )
+			leafIsOlder ? func( leaf.key, &leaf.value, nullptr ) : func( leaf.key, nullptr, &leaf.value );
+	}
+
+	template<typename F>
+	static void diffImpl( const Node* older, const Node* newer, const uint32_t shift, F& func )
+	{
+		if( older == newer )
+			return;
+
+		if( !older || !newer )
+		{
+			const bool isOlder = older != nullptr;
+			forEachImpl( isOlder ? *older : *newer, [&] ( const Key& key, const Value& value )
+			{
+				isOlder ? func( key, &value, nullptr ) : func( key, nullptr, &value );
+			} );
+			return;
+		}
+
+		if( shift >= HASH_BITS )
+		{
+			for( const Leaf& leaf : older->leaves )
+			{
+				const auto it = std::ranges::find_if( newer->leaves, [&leaf] ( const Leaf& other ) { return KeyEqual{}( other.key, leaf.key ); } );
+				if( it == newer->leaves.end() )
+					func( leaf.key, &leaf.value, nullptr );
+				else if( !( it->value == leaf.value ) )
+					func( leaf.key, &leaf.value, &it->value );
+			}
+			for( const Leaf& leaf : newer->leaves )
+			{
+				if( std::ranges::none_of( older->leaves, [&leaf] ( const Leaf& other ) { return KeyEqual{}( other.key, leaf.key ); } ) )
+					func( leaf.key, nullptr, &leaf.value );
+			}
+			return;
+		}
+
+		uint32_t remaining = older->leafMap | older->childMap | newer->leafMap | newer->childMap;
+		while( remaining )
+		{
+			const uint32_t bit = remaining & ( ~remaining + 1 );
+			remaining ^= bit;
+
+			const Leaf* olderLeaf  = older->leafMap  & bit ? &older->leaves[index( older->leafMap, bit )]           : nullptr;
+			const Leaf* newerLeaf  = newer->leafMap  & bit ? &newer->leaves[index( newer->leafMap, bit )]           : nullptr;
+			const Node* olderChild = older->childMap & bit ? older->children[index( older->childMap, bit )].get() : nullptr;
+			const Node* newerChild = newer->childMap & bit ? newer->children[index( newer->childMap, bit )].get() : nullptr;
+
+			if( olderLeaf && newerLeaf )
+			{
+				if( olderLeaf->hash == newerLeaf->hash && KeyEqual{}( olderLeaf->key, newerLeaf->key ) )
+				{
+					if( !( olderLeaf->value == newerLeaf->value ) )
+						func( olderLeaf->key, &olderLeaf->value, &newerLeaf->value );
+				}
+				else
+				{
+					func( olderLeaf->key, &olderLeaf->value, nullptr );
+					func( newerLeaf->key, nullptr, &newerLeaf->value );
+				}
+			}
+			else if( olderLeaf && newerChild )
+				diffLeafAgainstNode( *olderLeaf, *newerChild, true, func );
+			else if( olderChild && newerLeaf )
+				diffLeafAgainstNode( *newerLeaf, *olderChild, false, func );
+			else if( olderLeaf )
+				func( olderLeaf->key, &olderLeaf->value, nullptr );
+			else if( newerLeaf )
+				func( newerLeaf->key, nullptr, &newerLeaf->value );
+			else
+				diffImpl( olderChild, newerChild, shift + BITS_PER_LEVEL, func );
+		}
+	}
+
+private:
+	NodePtr m_root;
+	size_t  m_size = 0;
+};
+
+}
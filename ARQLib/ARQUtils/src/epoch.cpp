@@ -0,0 +1,100 @@
+#include <ARQUtils/epoch.h>
+
+#include <atomic>
+
+namespace ARQ
+{
+
+// Each slot has a cache line to itself so pinning never contends with another thread
+struct alignas( 64 ) Epoch::Slot
+{
+	std::atomic<uint64_t> epoch = 0; // 0 when the owning thread isn't pinned
+	uint32_t              depth = 0; // Only touched by the owning thread
+	std::atomic<bool>     inUse = true;
+	Slot*                 next  = nullptr;
+};
+
+namespace
+{
+
+std::atomic<uint64_t>     s_globalEpoch = 1;
+std::atomic<Epoch::Slot*> s_slots       = nullptr; // Slots are never freed - a thread exiting hands its slot on to the next new thread
+
+class ThreadSlot
+{
+public:
+	~ThreadSlot()
+	{
+		if( m_slot )
+			m_slot->inUse.store( false, std::memory_order_release );
+	}
+
+	Epoch::Slot* get()
+	{
+		if( !m_slot )
+			m_slot = acquire();
+
+		return m_slot;
+	}
+
+private:
+	static Epoch::Slot* acquire()
+	{
+		for( Epoch::Slot* slot = s_slots.load( std::memory_order_acquire ); slot; slot = slot->next )
+		{
+			bool expected = false;
+			if( !slot->inUse.load( std::memory_order_relaxed ) && slot->inUse.compare_exchange_strong( expected, true, std::memory_order_acquire ) )
+				return slot;
+		}
+
+		Epoch::Slot* slot = new Epoch::Slot();
+		slot->next = s_slots.load( std::memory_order_relaxed );
+		while( !s_slots.compare_exchange_weak( slot->next, slot, std::memory_order_release, std::memory_order_relaxed ) );
+
+		return slot;
+	}
+
+private:
+	Epoch::Slot* m_slot = nullptr;
+};
+
+thread_local ThreadSlot t_slot;
+
+}
+
+uint64_t Epoch::advance()
+{
+	return s_globalEpoch.fetch_add( 1, std::memory_order_seq_cst ) + 1;
+}
+
+bool Epoch::isSafeToReclaim( const uint64_t retireEpoch )
+{
+	for( const Slot* slot = s_slots.load( std::memory_order_acquire ); slot; slot = slot->next )
+	{
+		const uint64_t pinned = slot->epoch.load( std::memory_order_seq_cst );
+		if( pinned && pinned < retireEpoch )
+			return false;
+	}
+
+	return true;
+}
+
+Epoch::Slot* Epoch::pin()
+{
+	Slot* slot = t_slot.get();
+
+	// Nested guards keep the outermost epoch, which is the more conservative of the two.
+	// The store must be seq_cst so it's ordered before the reader's subsequent load of whatever it is protecting
+	if( slot->depth++ == 0 )
+		slot->epoch.store( s_globalEpoch.load( std::memory_order_acquire ), std::memory_order_seq_cst );
+
+	return slot;
+}
+
+void Epoch::unpin( Slot* const slot )
+{
+	if( --slot->depth == 0 )
+		slot->epoch.store( 0, std::memory_order_release );
+}
+
+}
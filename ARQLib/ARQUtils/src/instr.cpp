@@ -1,5 +1,8 @@
 #include <ARQUtils/instr.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace ARQ
 {
 
@@ -23,6 +26,40 @@ void Timer::stop()
 		m_tEnd = std::chrono::steady_clock::now();
 }
 
+uint64_t Histogram::Snapshot::percentile( const double pct ) const
+{
+	if( !count )
+		return 0;
+
+	const uint64_t rank = std::max<uint64_t>( 1, static_cast<uint64_t>( std::ceil( std::clamp( pct, 0.0, 100.0 ) / 100.0 * count ) ) );
+
+	uint64_t seen = 0;
+	for( size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket )
+	{
+		seen += buckets[bucket];
+		if( seen >= rank )
+		{
+			// Bucket i holds values below 2^i
+			const uint64_t upper = bucket == 0 ? 0 : bucket >= 64 ? UINT64_MAX : ( uint64_t( 1 ) << bucket ) - 1;
+			return std::min( upper, max );
+		}
+	}
+
+	return max;
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+	Snapshot snap;
+	for( size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket )
+		snap.buckets[bucket] = m_buckets[bucket].load( std::memory_order_relaxed );
+
+	snap.count = m_count.load( std::memory_order_relaxed );
+	snap.sum   = m_sum.load( std::memory_order_relaxed );
+	snap.max   = m_max.load( std::memory_order_relaxed );
+	return snap;
+}
+
 }
 
 }
@@ -12,9 +12,14 @@
 	#include <sys/types.h>
 	#include <pthread.h>
 	#include <dlfcn.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
 #endif
 
 #include <atomic>
+#include <cstring>
+#include <utility>
 
 namespace ARQ
 {
@@ -297,6 +302,114 @@ void* DynaLib::iGetFunc( const std::string_view funcName, const DoThrow doThrow
 	return funcPtr;
 }
 
+MappedFile::MappedFile( const std::filesystem::path& path )
+{
+	#ifdef _WIN32
+
+	HANDLE file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if( file == INVALID_HANDLE_VALUE )
+		throw ARQException( std::format( "Could not open {0} to map: CreateFileW failed: {1}", path.string(), GetLastError() ) );
+
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx( file, &fileSize ) )
+	{
+		const DWORD err = GetLastError();
+		CloseHandle( file );
+		throw ARQException( std::format( "Could not map {0}: GetFileSizeEx failed: {1}", path.string(), err ) );
+	}
+
+	if( fileSize.QuadPart == 0 )
+	{
+		CloseHandle( file );
+		return;
+	}
+
+	// The view keeps the mapping, and the mapping the file, alive so both handles can be closed straight away
+	HANDLE mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	const DWORD mappingErr = GetLastError();
+	CloseHandle( file );
+	if( !mapping )
+		throw ARQException( std::format( "Could not map {0}: CreateFileMappingW failed: {1}", path.string(), mappingErr ) );
+
+	void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	const DWORD viewErr = GetLastError();
+	CloseHandle( mapping );
+	if( !view )
+		throw ARQException( std::format( "Could not map {0}: MapViewOfFile failed: {1}", path.string(), viewErr ) );
+
+	m_data = static_cast<const uint8_t*>( view );
+	m_size = static_cast<size_t>( fileSize.QuadPart );
+
+	#else
+
+	const int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+	if( fd == -1 )
+		throw ARQException( std::format( "Could not open {0} to map: {1}", path.string(), std::strerror( errno ) ) );
+
+	struct stat st;
+	if( fstat( fd, &st ) == -1 )
+	{
+		const int err = errno;
+		close( fd );
+		throw ARQException( std::format( "Could not map {0}: fstat failed: {1}", path.string(), std::strerror( err ) ) );
+	}
+
+	if( st.st_size == 0 )
+	{
+		close( fd );
+		return;
+	}
+
+	// The mapping holds its own reference to the file so the descriptor can be closed straight away
+	void* addr = mmap( nullptr, static_cast<size_t>( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+	const int err = errno;
+	close( fd );
+	if( addr == MAP_FAILED )
+		throw ARQException( std::format( "Could not map {0}: mmap failed: {1}", path.string(), std::strerror( err ) ) );
+
+	m_data = static_cast<const uint8_t*>( addr );
+	m_size = static_cast<size_t>( st.st_size );
+
+	#endif
+}
+
+MappedFile::~MappedFile()
+{
+	unmap();
+}
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept
+	: m_data( std::exchange( other.m_data, nullptr ) )
+	, m_size( std::exchange( other.m_size, 0 ) )
+{
+}
+
+MappedFile& MappedFile::operator=( MappedFile&& other ) noexcept
+{
+	if( this != &other )
+	{
+		unmap();
+		m_data = std::exchange( other.m_data, nullptr );
+		m_size = std::exchange( other.m_size, 0 );
+	}
+	return *this;
+}
+
+void MappedFile::unmap() noexcept
+{
+	if( !m_data )
+		return;
+
+	#ifdef _WIN32
+	UnmapViewOfFile( m_data );
+	#else
+	munmap( const_cast<uint8_t*>( m_data ), m_size );
+	#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
 }
 
 }
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <ARQUtils/bounded_queue.h>
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace ARQ;
+
+TEST( BoundedQueueTest, PopAllDrainsEverythingInOrder )
+{
+    BoundedQueue<int32_t> queue( 10 );
+    for( int32_t i = 0; i < 5; ++i )
+        EXPECT_TRUE( queue.push( std::move( i ) ) );
+
+    EXPECT_EQ( queue.size(), 5 );
+
+    std::vector<int32_t> out;
+    ASSERT_TRUE( queue.popAll( out ) );
+    EXPECT_EQ( out, ( std::vector<int32_t>{ 0, 1, 2, 3, 4 } ) );
+    EXPECT_EQ( queue.size(), 0 );
+}
+
+TEST( BoundedQueueTest, TryPushRespectsCapacity )
+{
+    BoundedQueue<int32_t> queue( 2 );
+    EXPECT_TRUE( queue.tryPush( 1 ) );
+    EXPECT_TRUE( queue.tryPush( 2 ) );
+    EXPECT_FALSE( queue.tryPush( 3 ) );
+
+    EXPECT_EQ( queue.tryPop(), 1 );
+    EXPECT_TRUE( queue.tryPush( 3 ) );
+}
+
+TEST( BoundedQueueTest, CloseRejectsPushesButAllowsDrain )
+{
+    BoundedQueue<int32_t> queue( 4 );
+    queue.push( 1 );
+    queue.close();
+
+    EXPECT_FALSE( queue.push( 2 ) );
+    EXPECT_TRUE( queue.isClosed() );
+
+    std::vector<int32_t> out;
+    EXPECT_TRUE( queue.popAll( out ) );
+    EXPECT_EQ( out, std::vector<int32_t>{ 1 } );
+    EXPECT_FALSE( queue.popAll( out ) );
+}
+
+TEST( BoundedQueueTest, MultipleProducersSingleConsumer )
+{
+    constexpr int32_t PRODUCERS    = 4;
+    constexpr int32_t PER_PRODUCER = 10'000;
+
+    BoundedQueue<int32_t> queue( 16 ); // Small capacity so producers regularly block
+
+    std::vector<std::thread> producers;
+    for( int32_t p = 0; p < PRODUCERS; ++p )
+    {
+        producers.emplace_back( [&queue, p] ()
+        {
+            for( int32_t i = 0; i < PER_PRODUCER; ++i )
+                queue.push( p * PER_PRODUCER + i );
+        } );
+    }
+
+    std::vector<int32_t> received;
+    std::thread consumer( [&queue, &received] ()
+    {
+        std::vector<int32_t> batch;
+        while( queue.popAll( batch ) )
+        {
+            EXPECT_LE( batch.size(), queue.capacity() );
+            received.insert( received.end(), batch.begin(), batch.end() );
+            batch.clear();
+        }
+    } );
+
+    for( auto& producer : producers )
+        producer.join();
+    queue.close();
+    consumer.join();
+
+    ASSERT_EQ( received.size(), PRODUCERS * PER_PRODUCER );
+    std::ranges::sort( received );
+    std::vector<int32_t> expected( PRODUCERS * PER_PRODUCER );
+    std::iota( expected.begin(), expected.end(), 0 );
+    EXPECT_EQ( received, expected );
+}
+
+TEST( BoundedQueueTest, SingleProducerMultipleConsumers )
+{
+    constexpr int32_t CONSUMERS = 4;
+    constexpr int32_t ITEMS     = 10'000;
+
+    BoundedQueue<int32_t> queue( 8 );
+
+    std::mutex           receivedMutex;
+    std::vector<int32_t> received;
+
+    std::vector<std::thread> consumers;
+    for( int32_t c = 0; c < CONSUMERS; ++c )
+    {
+        consumers.emplace_back( [&queue, &receivedMutex, &received] ()
+        {
+            while( const std::optional<int32_t> item = queue.pop() )
+            {
+                std::lock_guard<std::mutex> lock( receivedMutex );
+                received.push_back( *item );
+            }
+        } );
+    }
+
+    for( int32_t i = 0; i < ITEMS; ++i )
+        queue.push( int32_t( i ) );
+    queue.close();
+    for( auto& consumer : consumers )
+        consumer.join();
+
+    ASSERT_EQ( received.size(), ITEMS );
+    std::ranges::sort( received );
+    std::vector<int32_t> expected( ITEMS );
+    std::iota( expected.begin(), expected.end(), 0 );
+    EXPECT_EQ( received, expected );
+}
+
+TEST( BoundedQueueTest, PopForTimesOutUnlessAnItemArrives )
+{
+    using namespace std::chrono_literals;
+
+    BoundedQueue<int32_t> queue( 4 );
+    EXPECT_FALSE( queue.popFor( 10ms ).has_value() );
+    EXPECT_FALSE( queue.isClosed() );
+
+    std::thread producer( [&queue] ()
+    {
+        std::this_thread::sleep_for( 20ms );
+        queue.push( 7 );
+    } );
+    const std::optional<int32_t> item = queue.popFor( 10s );
+    producer.join();
+    ASSERT_TRUE( item.has_value() );
+    EXPECT_EQ( *item, 7 );
+
+    // Once closed, what's left is still handed out before it reports empty
+    queue.push( 8 );
+    queue.close();
+    EXPECT_EQ( queue.popFor( 10ms ), std::optional<int32_t>( 8 ) );
+    EXPECT_FALSE( queue.popFor( 10s ).has_value() );
+    EXPECT_TRUE( queue.isClosed() );
+}
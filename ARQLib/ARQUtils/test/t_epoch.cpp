@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <ARQUtils/epoch.h>
+
+#include <latch>
+#include <optional>
+#include <thread>
+
+using namespace ARQ;
+
+TEST( EpochTest, UnpinnedReadersNeverBlockReclamation )
+{
+    const uint64_t stamp = Epoch::advance();
+    EXPECT_TRUE( Epoch::isSafeToReclaim( stamp ) );
+
+    {
+        EpochGuard guard;
+    }
+    EXPECT_TRUE( Epoch::isSafeToReclaim( Epoch::advance() ) );
+}
+
+TEST( EpochTest, PinnedReaderBlocksReclamationOfLaterStampsOnly )
+{
+    const uint64_t before = Epoch::advance();
+
+    std::latch pinned( 1 );
+    std::latch release( 1 );
+    std::thread reader( [&] ()
+    {
+        EpochGuard guard;
+        pinned.count_down();
+        release.wait();
+    } );
+    pinned.wait();
+
+    // Anything retired before the reader pinned is already safe, anything after must wait for it
+    EXPECT_TRUE( Epoch::isSafeToReclaim( before ) );
+    const uint64_t after = Epoch::advance();
+    EXPECT_FALSE( Epoch::isSafeToReclaim( after ) );
+
+    release.count_down();
+    reader.join();
+    EXPECT_TRUE( Epoch::isSafeToReclaim( after ) );
+}
+
+TEST( EpochTest, NestedGuardsHoldTheOutermostEpoch )
+{
+    std::optional<EpochGuard> outer( std::in_place );
+    const uint64_t stamp = Epoch::advance();
+    {
+        EpochGuard inner;
+        EXPECT_FALSE( Epoch::isSafeToReclaim( stamp ) );
+    }
+    EXPECT_FALSE( Epoch::isSafeToReclaim( stamp ) );
+
+    outer.reset();
+    EXPECT_TRUE( Epoch::isSafeToReclaim( stamp ) );
+}
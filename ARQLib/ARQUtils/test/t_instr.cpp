@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <ARQUtils/instr.h>
+
+#include <thread>
+#include <vector>
+
+using namespace ARQ;
+using namespace std::chrono_literals;
+
+TEST( HistogramTest, EmptySnapshot )
+{
+	Instr::Histogram hist;
+	const auto snap = hist.snapshot();
+
+	EXPECT_EQ( snap.count, 0 );
+	EXPECT_EQ( snap.percentile( 50 ), 0 );
+	EXPECT_DOUBLE_EQ( snap.mean(), 0.0 );
+}
+
+TEST( HistogramTest, BucketsByPowersOfTwo )
+{
+	EXPECT_EQ( Instr::Histogram::bucketFor( 0 ), 0 );
+	EXPECT_EQ( Instr::Histogram::bucketFor( 1 ), 1 );
+	EXPECT_EQ( Instr::Histogram::bucketFor( 2 ), 2 );
+	EXPECT_EQ( Instr::Histogram::bucketFor( 3 ), 2 );
+	EXPECT_EQ( Instr::Histogram::bucketFor( 4 ), 3 );
+	EXPECT_EQ( Instr::Histogram::bucketFor( UINT64_MAX ), 64 );
+}
+
+TEST( HistogramTest, PercentilesAreBucketUpperBounds )
+{
+	Instr::Histogram hist;
+	for( uint64_t i = 1; i <= 100; ++i )
+		hist.record( i );
+
+	const auto snap = hist.snapshot();
+	EXPECT_EQ( snap.count, 100 );
+	EXPECT_EQ( snap.sum, 5050 );
+	EXPECT_EQ( snap.max, 100 );
+	EXPECT_DOUBLE_EQ( snap.mean(), 50.5 );
+
+	EXPECT_EQ( snap.percentile( 0 ), 1 );
+	EXPECT_EQ( snap.percentile( 50 ), 63 );  // 50 lies in [32, 64)
+	EXPECT_EQ( snap.percentile( 100 ), 100 ); // Capped at the max rather than 127
+}
+
+TEST( HistogramTest, RecordsDurationsInTheirOwnUnits )
+{
+	Instr::Histogram hist;
+	hist.record( std::chrono::microseconds( 1500 ) );
+	hist.record( std::chrono::microseconds( -5 ) ); // Clamped to zero
+
+	const auto snap = hist.snapshot();
+	EXPECT_EQ( snap.count, 2 );
+	EXPECT_EQ( snap.max, 1500 );
+	EXPECT_EQ( snap.buckets[0], 1 );
+}
+
+TEST( HistogramTest, ConcurrentRecords )
+{
+	Instr::Histogram hist;
+
+	std::vector<std::thread> threads;
+	for( int t = 0; t < 4; ++t )
+	{
+		threads.emplace_back( [&hist] ()
+		{
+			for( uint64_t i = 0; i < 10000; ++i )
+				hist.record( i % 8 );
+		} );
+	}
+	for( std::thread& thread : threads )
+		thread.join();
+
+	const auto snap = hist.snapshot();
+	EXPECT_EQ( snap.count, 40000 );
+	EXPECT_EQ( snap.max, 7 );
+	EXPECT_EQ( snap.buckets[0], 5000 );
+}
@@ -6,6 +6,7 @@
 
 #include <thread>
 #include <iostream>
+#include <fstream>
 #include <type_traits>
 
 using ::testing::HasSubstr;
@@ -92,3 +93,40 @@ TEST( OSUtilsTest, DynaLibLoadNonExistent )
         }
     }, ARQException );
 }
+
+TEST( OSUtilsTest, MapFile )
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / std::format( "t_ARQUtils_map_{}.bin", OS::procID() );
+    const std::string contents = "mapped file contents";
+    {
+        std::ofstream ofs( path, std::ios::binary );
+        ofs << contents;
+    }
+
+    OS::MappedFile file( path );
+    std::filesystem::remove( path ); // The mapping outlives the file
+
+    ASSERT_EQ( file.size(), contents.size() );
+    EXPECT_EQ( std::string_view( reinterpret_cast<const char*>( file.data() ), file.size() ), contents );
+
+    OS::MappedFile moved = std::move( file );
+    EXPECT_EQ( file.data(), nullptr );
+    EXPECT_EQ( moved.size(), contents.size() );
+}
+
+TEST( OSUtilsTest, MapEmptyFile )
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / std::format( "t_ARQUtils_map_empty_{}.bin", OS::procID() );
+    std::ofstream( path, std::ios::binary ).close();
+
+    OS::MappedFile file( path );
+    std::filesystem::remove( path );
+
+    EXPECT_EQ( file.data(), nullptr );
+    EXPECT_EQ( file.size(), 0 );
+}
+
+TEST( OSUtilsTest, MapMissingFile )
+{
+    EXPECT_THROW( OS::MappedFile( std::filesystem::temp_directory_path() / "t_ARQUtils_no_such_file.bin" ), ARQException );
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <ARQUtils/persistent_array.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace ARQ;
+
+TEST( PersistentArrayTest, SetAndFind )
+{
+    PersistentArray<int32_t> arr;
+    EXPECT_EQ( arr.size(), 0 );
+    EXPECT_EQ( arr.find( 0 ), nullptr );
+
+    arr.set( 3, 30 );
+    ASSERT_EQ( arr.size(), 4 );
+    ASSERT_NE( arr.find( 3 ), nullptr );
+    EXPECT_EQ( *arr.find( 3 ), 30 );
+
+    // Unset slots below size hold a default value, anything past size is out of range
+    ASSERT_NE( arr.find( 0 ), nullptr );
+    EXPECT_EQ( *arr.find( 0 ), 0 );
+    EXPECT_EQ( arr.find( 4 ), nullptr );
+}
+
+TEST( PersistentArrayTest, GrowsAcrossLevels )
+{
+    PersistentArray<int32_t> arr;
+    arr.set( 0, 1 );
+    arr.set( 1'000'000, 2 );
+    arr.set( 40'000, 3 );
+
+    EXPECT_EQ( arr.size(), 1'000'001 );
+    EXPECT_EQ( *arr.find( 0 ), 1 );
+    EXPECT_EQ( *arr.find( 1'000'000 ), 2 );
+    EXPECT_EQ( *arr.find( 40'000 ), 3 );
+    EXPECT_EQ( arr.find( 500'000 ), nullptr ); // Sparse - subtree never allocated
+}
+
+TEST( PersistentArrayTest, CopiesAreIsolatedFromLaterMutations )
+{
+    PersistentArray<std::shared_ptr<const int32_t>> original;
+    for( int32_t i = 0; i < 5'000; ++i )
+        original.set( i, std::make_shared<const int32_t>( i ) );
+
+    auto copy = original;
+    copy.set( 10, std::make_shared<const int32_t>( -10 ) );
+    copy.set( 11, nullptr );
+    copy.set( 100'000, std::make_shared<const int32_t>( 100'000 ) );
+
+    EXPECT_EQ( **original.find( 10 ), 10 );
+    EXPECT_EQ( **original.find( 11 ), 11 );
+    EXPECT_EQ( original.find( 100'000 ), nullptr );
+
+    EXPECT_EQ( **copy.find( 10 ), -10 );
+    EXPECT_EQ( *copy.find( 11 ), nullptr );
+    EXPECT_EQ( **copy.find( 100'000 ), 100'000 );
+
+    // Untouched slots share the same values
+    EXPECT_EQ( original.find( 4'000 )->get(), copy.find( 4'000 )->get() );
+}
+
+TEST( PersistentArrayTest, MatchesVectorUnderRandomisedOperations )
+{
+    std::mt19937 rng( 7 );
+
+    PersistentArray<int32_t> arr;
+    std::vector<int32_t>     expected;
+
+    std::vector<std::pair<PersistentArray<int32_t>, std::vector<int32_t>>> versions;
+
+    for( int32_t i = 0; i < 50'000; ++i )
+    {
+        const size_t idx = rng() % 5'000;
+        if( idx >= expected.size() )
+            expected.resize( idx + 1 );
+
+        expected[idx] = i;
+        arr.set( idx, i );
+
+        if( i % 5'000 == 0 )
+            versions.emplace_back( arr, expected );
+    }
+    versions.emplace_back( arr, expected );
+
+    for( const auto& [version, expectedVersion] : versions )
+    {
+        ASSERT_EQ( version.size(), expectedVersion.size() );
+        for( size_t i = 0; i < expectedVersion.size(); ++i )
+        {
+            const int32_t* val = version.find( i );
+            EXPECT_EQ( val ? *val : 0, expectedVersion[i] );
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <ARQUtils/hashers.h>
+#include <ARQUtils/persistent_hash_map.h>
+
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace ARQ;
+
+namespace
+{
+
+// Forces every key into a handful of buckets so that deep paths and collision nodes are exercised
+struct CollidingHash
+{
+    uint64_t operator()( const int32_t key ) const noexcept { return static_cast<uint64_t>( key % 3 ); }
+};
+
+using TransparentStringMap = PersistentHashMap<std::string, int32_t, AnkerlTransparentStringHash, std::equal_to<>>;
+
+}
+
+TEST( PersistentHashMapTest, SetFindAndErase )
+{
+    PersistentHashMap<int32_t, int32_t> map;
+    EXPECT_TRUE( map.empty() );
+    EXPECT_EQ( map.find( 1 ), nullptr );
+
+    EXPECT_TRUE( map.set( 1, 10 ) );
+    EXPECT_TRUE( map.set( 2, 20 ) );
+    EXPECT_FALSE( map.set( 1, 11 ) ); // Overwrite
+
+    ASSERT_EQ( map.size(), 2 );
+    ASSERT_NE( map.find( 1 ), nullptr );
+    EXPECT_EQ( *map.find( 1 ), 11 );
+    EXPECT_EQ( *map.find( 2 ), 20 );
+
+    EXPECT_TRUE( map.erase( 1 ) );
+    EXPECT_FALSE( map.erase( 1 ) );
+    EXPECT_FALSE( map.contains( 1 ) );
+    EXPECT_EQ( map.size(), 1 );
+}
+
+TEST( PersistentHashMapTest, CopiesAreIsolatedFromLaterMutations )
+{
+    PersistentHashMap<int32_t, int32_t> original;
+    for( int32_t i = 0; i < 1000; ++i )
+        original.set( i, i );
+
+    PersistentHashMap<int32_t, int32_t> copy = original;
+    EXPECT_TRUE( copy.sharesRootWith( original ) );
+
+    copy.set( 5, 500 );
+    copy.erase( 6 );
+    copy.set( 1000, 1000 );
+
+    EXPECT_FALSE( copy.sharesRootWith( original ) );
+
+    // Original is untouched
+    ASSERT_EQ( original.size(), 1000 );
+    EXPECT_EQ( *original.find( 5 ), 5 );
+    EXPECT_TRUE( original.contains( 6 ) );
+    EXPECT_FALSE( original.contains( 1000 ) );
+
+    // Copy sees its own changes
+    ASSERT_EQ( copy.size(), 1000 );
+    EXPECT_EQ( *copy.find( 5 ), 500 );
+    EXPECT_FALSE( copy.contains( 6 ) );
+    EXPECT_EQ( *copy.find( 1000 ), 1000 );
+}
+
+TEST( PersistentHashMapTest, HandlesFullHashCollisions )
+{
+    PersistentHashMap<int32_t, int32_t, CollidingHash> map;
+    for( int32_t i = 0; i < 100; ++i )
+        map.set( i, i * 2 );
+
+    const auto snapshot = map;
+    for( int32_t i = 0; i < 100; i += 2 )
+        EXPECT_TRUE( map.erase( i ) );
+
+    ASSERT_EQ( map.size(), 50 );
+    ASSERT_EQ( snapshot.size(), 100 );
+    for( int32_t i = 0; i < 100; ++i )
+    {
+        ASSERT_NE( snapshot.find( i ), nullptr );
+        EXPECT_EQ( *snapshot.find( i ), i * 2 );
+        EXPECT_EQ( map.contains( i ), i % 2 == 1 );
+    }
+}
+
+TEST( PersistentHashMapTest, SupportsHeterogeneousLookup )
+{
+    TransparentStringMap map;
+    map.set( "EUR/USD", 1 );
+
+    const std::string_view key = "EUR/USD";
+    ASSERT_NE( map.find( key ), nullptr );
+    EXPECT_EQ( *map.find( key ), 1 );
+    EXPECT_TRUE( map.erase( key ) );
+    EXPECT_TRUE( map.empty() );
+}
+
+TEST( PersistentHashMapTest, MatchesStdMapUnderRandomisedOperations )
+{
+    std::mt19937 rng( 42 );
+
+    PersistentHashMap<int32_t, int32_t> map;
+    std::map<int32_t, int32_t>          expected;
+
+    std::vector<std::pair<PersistentHashMap<int32_t, int32_t>, std::map<int32_t, int32_t>>> versions;
+
+    for( int32_t i = 0; i < 50'000; ++i )
+    {
+        const int32_t key = static_cast<int32_t>( rng() % 2'000 );
+        if( rng() % 3 )
+            EXPECT_EQ( map.set( key, i ), expected.insert_or_assign( key, i ).second );
+        else
+            EXPECT_EQ( map.erase( key ), expected.erase( key ) == 1 );
+
+        if( i % 5'000 == 0 )
+            versions.emplace_back( map, expected );
+    }
+    versions.emplace_back( map, expected );
+
+    // Every retained version must still match what the map looked like at that point
+    for( const auto& [version, expectedVersion] : versions )
+    {
+        ASSERT_EQ( version.size(), expectedVersion.size() );
+
+        size_t visited = 0;
+        version.forEach( [&] ( const int32_t key, const int32_t value )
+        {
+            ASSERT_TRUE( expectedVersion.contains( key ) );
+            EXPECT_EQ( expectedVersion.at( key ), value );
+            ++visited;
+        } );
+        EXPECT_EQ( visited, expectedVersion.size() );
+    }
+}
+
+TEST( PersistentHashMapTest, DiffReportsOnlyChangedKeys )
+{
+    std::mt19937 rng( 1337 );
+
+    // CollidingHash alongside the default hash so leaf vs child and collision node comparisons are covered
+    auto runDiff = [&rng] <typename Map> ( Map older )
+    {
+        for( int32_t i = 0; i < 3'000; ++i )
+            older.set( i, i );
+
+        Map                        newer = older;
+        std::map<int32_t, int32_t> expectedBefore, expectedAfter;
+        for( int32_t i = 0; i < 300; ++i )
+        {
+            const int32_t key = static_cast<int32_t>( rng() % 4'000 );
+            const int32_t* before = older.find( key );
+            if( rng() % 2 )
+                newer.set( key, -key - 1 );
+            else
+                newer.erase( key );
+
+            const int32_t* after = newer.find( key );
+            expectedBefore.erase( key );
+            expectedAfter.erase( key );
+            if( before )
+                expectedBefore[key] = *before;
+            if( after )
+                expectedAfter[key] = *after;
+            if( before && after && *before == *after )
+            {
+                expectedBefore.erase( key );
+                expectedAfter.erase( key );
+            }
+        }
+
+        std::map<int32_t, int32_t> actualBefore, actualAfter;
+        older.diff( newer, [&] ( const int32_t key, const int32_t* before, const int32_t* after )
+        {
+            ASSERT_TRUE( before || after );
+            if( before )
+                EXPECT_TRUE( actualBefore.emplace( key, *before ).second );
+            if( after )
+                EXPECT_TRUE( actualAfter.emplace( key, *after ).second );
+        } );
+
+        EXPECT_EQ( actualBefore, expectedBefore );
+        EXPECT_EQ( actualAfter, expectedAfter );
+
+        // Identical maps have no differences
+        size_t calls = 0;
+        newer.diff( newer, [&calls] ( auto&&... ) { ++calls; } );
+        EXPECT_EQ( calls, 0 );
+    };
+
+    runDiff( PersistentHashMap<int32_t, int32_t>() );
+    runDiff( PersistentHashMap<int32_t, int32_t, CollidingHash>() );
+}
@@ -95,7 +95,10 @@ class EntityDefinition:
                 member['optional'] = False
 
             cpp_type = self.types_data.get(member.get('type')).get('cpp')
+            member['cpp_type'] = cpp_type
             member['cpp_storage_type'] = cpp_type if not member['optional'] else f"std::optional<{cpp_type}>"
+            # Numeric members get a contiguous column in the entity's columnar (structure of arrays) form
+            member['columnar'] = member['format'] in ['Integer', 'Decimal']
 
 class TemplateMetadata:
     """Represents metadata extracted from a template file."""
@@ -0,0 +1,8 @@
+#include "service.h"
+
+using namespace ARQ;
+
+int main( int argc, char** argv )
+{
+	return ServiceRunner::run<MktDataHistoryProjectorService>( argc, argv );
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "service.h"
+
+#include <ARQUtils/algos.h>
+#include <ARQMarket/mktdata_meta.h>
+#include <ARQMarket/mktdata_topics.h>
+
+void MktDataHistoryProjectorService::onStartup()
+{
+	m_serialiser    = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
+	m_historySource = MD::MarketSourceFactory::inst().create( m_config.historyDSH );
+
+	const std::set<std::string_view> entities = Algos::makeEffectiveSet( m_config.entities, MD::Meta::getAllNames(), m_config.disabledEntities );
+	const auto updateTopics = entities
+		| std::views::transform( [] ( std::string_view name ) { return MD::getUpdateTopic( name ); } )
+		| std::ranges::to<std::set<std::string>>();
+
+	// Only committed updates are read, so nothing from an aborted transaction ever reaches the history DB
+	StreamConsumerOptions opts( "MktDataHistoryProjector::UpdateConsumer",
+								"ARQ.MktData.HistoryProjectors",
+								StreamConsumerOptions::FetchPreset::HighThroughput,
+								StreamConsumerOptions::AutoCommitOffsets::Disabled,
+								StreamConsumerOptions::AutoOffsetReset::Earliest,
+								StreamConsumerOptions::IsolationLevel::ReadCommitted );
+	m_updateConsumer = StreamingServiceFactory::inst().createConsumer( m_config.streamSvcDSH, opts );
+	m_updateConsumer->subscribe( updateTopics );
+
+	StreamProducerOptions prodOpts( "MktDataHistoryProjector::DLQProducer",
+									StreamProducerOptions::Preset::HighThroughput );
+	m_dlqProducer = StreamingServiceFactory::inst().createProducer( m_config.streamSvcDSH, prodOpts );
+
+	m_block = std::make_unique<Block>();
+}
+
+void MktDataHistoryProjectorService::onShutdown()
+{
+	stopInserters();
+	m_pendingBlocks.clear();
+	m_block.reset();
+
+	m_updateConsumer.reset();
+	m_dlqProducer.reset();
+	m_historySource.reset();
+	m_serialiser.reset();
+}
+
+void MktDataHistoryProjectorService::run()
+{
+	startInserters();
+
+	try
+	{
+		while( shouldRun() )
+		{
+			auto msgBatch = m_updateConsumer->poll( 100ms, StreamConsumerReadHeaders::SKIP_HEADERS );
+			if( !msgBatch->empty() )
+				processMsgBatch( std::move( msgBatch ), *m_block );
+
+			commitInsertedOffsets();
+
+			if( blockDue( *m_block ) )
+				sendBlock();
+		}
+
+		// Whatever's held goes in now rather than being read again on restart
+		if( m_block->offsets.size() )
+			sendBlock();
+	}
+	catch( ... )
+	{
+		stopInserters();
+		throw;
+	}
+
+	stopInserters();
+	commitInsertedOffsets();
+
+	Log( Module::EXE ).info( "Inserted {} records into the history DB in {} blocks", m_numRecordsInserted.load(), m_numBlocksInserted.load() );
+}
+
+void MktDataHistoryProjectorService::registerConfigOptions( Cfg::ConfigWrangler& cfg )
+{
+	cfg.add( m_config.streamSvcDSH,     "--streamServiceDSH", "The DSH of the streaming service to read updates from" );
+	cfg.add( m_config.historyDSH,       "--historyDSH",       "The DSH of the market history DB to write updates to" );
+	cfg.add( m_config.mkts,             "--mkts",             "The set of markets to process updates for. If empty, process updates on all markets." );
+	cfg.add( m_config.entities,         "--entities",         "The set of market data entities to process updates for. If empty, subscribes to all entities." );
+	cfg.add( m_config.disabledEntities, "--disabledEntities", "The set of market data entities to NOT process updates for." );
+	cfg.add( m_config.dbBackoffPolicy,  "--dbBackoffPolicy",  "The backoff policy to use when retrying inserts into the history DB\n" + std::string( BackoffPolicy::HelpText ) );
+	cfg.add( m_config.maxBlockRecords,  "--maxBlockRecords",  "Insert a block once it holds this many records, across every market and entity. Bigger blocks mean fewer, cheaper inserts" );
+	cfg.add( m_config.maxBlockAgeMs,    "--maxBlockAgeMs",    "Insert a block once this long has passed since its first poll, however few records it holds" );
+	cfg.add( m_config.numInserters,     "--numInserters",     "The number of blocks inserted into the history DB at once, each on its own connection. Offsets are still committed in order" );
+}
+
+void MktDataHistoryProjectorService::processMsgBatch( std::unique_ptr<IStreamConsumerMessageBatch> msgBatch, Block& block )
+{
+	Log( Module::EXE ).debug( "Processing {} update messages", msgBatch->size() );
+
+	if( block.offsets.empty() )
+		block.firstPolledAt = std::chrono::steady_clock::now();
+
+	bool anyDLQ = false;
+	for( const StreamConsumerMessageView& msg : *msgBatch )
+	{
+		// Every message counts towards what's committed, including any sent to the DLQ or for other markets. The committed offset is
+		// the next one to read
+		int64_t& commitOffset = block.offsets[StreamTopicPartition( std::string( msg.topic ), msg.partition )];
+		commitOffset = std::max( commitOffset, msg.offset + 1 );
+
+		ARQ_DO_IN_TRY( arqExc, errMsg );
+		{
+			const MD::Type entityType = MD::getTypeFromUpdateTopic( msg.topic );
+
+			MD::dispatch( entityType, [this, &msg, &block] <MD::c_MktData T> ()
+			{
+				auto rcdMsg = m_serialiser->deserialise<MD::RecordMessage<T>>( msg.data );
+				if( m_config.mkts.size() && !m_config.mkts.contains( rcdMsg.mktName ) )
+					return;
+
+				MD::RecordCollection& records = block.records[rcdMsg.mktName];
+				records.get<MD::Record<T>>().push_back( std::move( rcdMsg.record ) );
+				++block.numRecords;
+			} );
+		}
+		ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+		bool toDLQ = false;
+		if( arqExc.what().size() )
+		{
+			Log( Module::EXE ).error( arqExc, "Exception thrown when processing message so sending to DLQ [{}]", msg.idStr() );
+			toDLQ = true;
+		}
+		else if( errMsg.size() )
+		{
+			Log( Module::EXE ).error( "Exception thrown when processing message so sending to DLQ [{}] - what: {}", msg.idStr(), errMsg );
+			toDLQ = true;
+		}
+
+		if( toDLQ )
+		{
+			anyDLQ = true;
+			const std::string key = msg.key.has_value() ? std::string( msg.key->data() ) : "NO_KEY";
+			m_dlqProducer->send( StreamProducerMessage{
+				.topic = std::format( "{}.DLQ", msg.topic ),
+				.id = msg.offset,
+				.key = key,
+				.data = msg.data
+			} );
+		}
+	}
+
+	if( anyDLQ )
+		m_dlqProducer->flush();
+}
+
+bool MktDataHistoryProjectorService::blockDue( const Block& block ) const
+{
+	if( block.offsets.empty() )
+		return false;
+
+	return block.numRecords >= static_cast<size_t>( std::max<int64_t>( m_config.maxBlockRecords, 1 ) )
+		|| std::chrono::steady_clock::now() - block.firstPolledAt >= std::chrono::milliseconds( m_config.maxBlockAgeMs );
+}
+
+void MktDataHistoryProjectorService::sendBlock()
+{
+	Log( Module::EXE ).debug( "Sending a block of {} records across {} markets to be inserted into the history DB", m_block->numRecords, m_block->records.size() );
+
+	std::shared_ptr<Block> block = std::move( m_block );
+	m_block = std::make_unique<Block>();
+
+	m_pendingBlocks.push_back( block );
+	if( !m_insertQueue->push( std::move( block ) ) )
+		throw ARQException( "Cannot send a block to be inserted into the history DB as the inserters have stopped" );
+}
+
+void MktDataHistoryProjectorService::commitInsertedOffsets()
+{
+	// Blocks can be inserted out of order, but are only committed in order
+	StreamTopicPartitionOffsets toCommit;
+	while( m_pendingBlocks.size() && m_pendingBlocks.front()->done.load( std::memory_order_acquire ) )
+	{
+		const std::shared_ptr<Block> block = std::move( m_pendingBlocks.front() );
+		m_pendingBlocks.pop_front();
+
+		if( block->failed )
+		{
+			// Nothing from here on is committed, so every block not known to be inserted is read again on restart. An insert that fails
+			// while stopping isn't retried, so that's expected then
+			if( !shouldRun() )
+			{
+				Log( Module::EXE ).warn( "Stopped before every block was inserted into the history DB - the remaining {} blocks will be read again on restart", m_pendingBlocks.size() + 1 );
+				m_pendingBlocks.clear();
+				break;
+			}
+
+			static constexpr std::string_view errMsg = "A block failed to be inserted into the history DB - STOPPING SERVICE!";
+			Log( Module::EXE ).critical( errMsg );
+			throw ARQException( errMsg );
+		}
+
+		for( const auto& [tp, offset] : block->offsets )
+			toCommit[tp] = offset;
+	}
+
+	if( toCommit.size() )
+		m_updateConsumer->commitOffsetsAsync( toCommit );
+}
+
+void MktDataHistoryProjectorService::startInserters()
+{
+	const size_t numInserters = static_cast<size_t>( std::max<int64_t>( m_config.numInserters, 1 ) );
+
+	m_insertQueue = std::make_unique<BoundedQueue<std::shared_ptr<Block>>>( numInserters );
+	for( size_t i = 0; i < numInserters; ++i )
+		m_inserters.emplace_back( &MktDataHistoryProjectorService::runInserter, this );
+
+	Log( Module::EXE ).info( "Running with {} inserters", numInserters );
+}
+
+void MktDataHistoryProjectorService::stopInserters()
+{
+	// Everything already queued is still inserted
+	if( m_insertQueue )
+		m_insertQueue->close();
+
+	for( std::thread& inserter : m_inserters )
+	{
+		if( inserter.joinable() )
+			inserter.join();
+	}
+
+	m_inserters.clear();
+	m_insertQueue.reset();
+}
+
+void MktDataHistoryProjectorService::runInserter()
+{
+	BackoffPolicy backoffPolicy( m_config.dbBackoffPolicy );
+
+	while( std::optional<std::shared_ptr<Block>> block = m_insertQueue->pop() )
+	{
+		ARQ_DO_IN_TRY( arqExc, errMsg );
+		{
+			if( insertIntoHistoryDB( **block, backoffPolicy ) )
+			{
+				m_numRecordsInserted.fetch_add( ( *block )->numRecords, std::memory_order_relaxed );
+				m_numBlocksInserted.fetch_add( 1, std::memory_order_relaxed );
+			}
+			else
+				( *block )->failed = true;
+		}
+		ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+		if( arqExc.what().size() )
+		{
+			Log( Module::EXE ).error( arqExc, "Exception thrown when inserting a block into the history DB" );
+			( *block )->failed = true;
+		}
+		else if( errMsg.size() )
+		{
+			Log( Module::EXE ).error( "Exception thrown when inserting a block into the history DB - what: {}", errMsg );
+			( *block )->failed = true;
+		}
+
+		// The records aren't needed once inserted, and the block may wait on earlier ones before it's committed
+		( *block )->records.clear();
+		( *block )->done.store( true, std::memory_order_release );
+	}
+}
+
+bool MktDataHistoryProjectorService::insertIntoHistoryDB( Block& block, BackoffPolicy& backoffPolicy )
+{
+	// A market is dropped from the block once it's inserted, so a retry only inserts the markets still to go. Inserts aren't idempotent,
+	// so a block read again on restart is inserted again - history queries take the latest record for each AsofTs, so are unaffected
+	for( auto it = block.records.begin(); it != block.records.end(); )
+	{
+		const auto& [mktName, records] = *it;
+
+		backoffPolicy.reset();
+		while( true )
+		{
+			try
+			{
+				Log( Module::EXE ).debug( "Inserting {} market data entities for market [{}] into the history DB", records.size(), mktName );
+				m_historySource->save( mktName, records );
+				break;
+			}
+			catch( ARQException& e )
+			{
+				// Not retried once stopping
+				if( !shouldRun() )
+				{
+					Log( Module::EXE ).error( e, "Exception thrown when inserting market data entities for market [{}] into the history DB - not trying again as stopping", mktName );
+					return false;
+				}
+
+				auto delayTimeOpt = backoffPolicy.nextDelay();
+				if( delayTimeOpt )
+				{
+					Log( Module::EXE ).error( e, "Exception thrown when inserting market data entities for market [{}] into the history DB - trying again in {}ms ({})", mktName, *delayTimeOpt, backoffPolicy.attemptStr() );
+					std::this_thread::sleep_for( *delayTimeOpt );
+				}
+				else
+				{
+					Log( Module::EXE ).critical( e, "Exception thrown when inserting market data entities for market [{}] into the history DB - max insert attempts exceeded", mktName );
+					return false;
+				}
+			}
+		}
+
+		it = block.records.erase( it );
+	}
+
+	return true;
+}
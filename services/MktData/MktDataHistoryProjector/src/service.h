@@ -0,0 +1,94 @@
+#include <ARQUtils/backoff_policy.h>
+#include <ARQUtils/bounded_queue.h>
+#include <ARQCore/service_base.h>
+#include <ARQCore/serialiser.h>
+#include <ARQCore/streaming_service.h>
+#include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/mktdata_source.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace ARQ;
+
+class MktDataHistoryProjectorService : public ServiceBase
+{
+public:
+	std::string_view serviceName()        override { return "MktDataHistoryProjector"; };
+	std::string_view serviceDescription() override { return "The durable historical projection for market data. It consumes the committed update streams, "
+															"accumulates large blocks of records across markets, and writes them to the history DB with several "
+															"inserts in flight, committing stream offsets only once the records they cover are inserted."; }
+
+	void onStartup()  override;
+	void onShutdown() override;
+
+	void run() override;
+
+	void registerConfigOptions( Cfg::ConfigWrangler& cfg ) override;
+
+private:
+	struct Config
+	{
+		std::string streamSvcDSH = "Kafka";
+		std::string historyDSH   = "ClickHouseDB";
+
+		std::set<std::string> mkts; // If empty, process updates on all markets
+
+		std::set<std::string> entities; // If empty, subscribe to all entities
+		std::set<std::string> disabledEntities;
+
+		std::string dbBackoffPolicy = "1s-3-1m-5";
+
+		int64_t maxBlockRecords = 200'000; // A block is inserted once it holds this many records...
+		int64_t maxBlockAgeMs   = 1000;    // ...or once its first poll is this old
+		int64_t numInserters    = 4;       // Blocks inserted at once
+	} m_config;
+
+private:
+	// Records from one or more polls, across every market, inserted together. Its offsets are committed once it - and every block
+	// before it - is in the history DB
+	struct Block
+	{
+		std::unordered_map<std::string, MD::RecordCollection> records; // By market
+		StreamTopicPartitionOffsets                            offsets; // The next offset to read for every partition polled
+		size_t                                                 numRecords = 0;
+		std::chrono::steady_clock::time_point                  firstPolledAt;
+
+		std::atomic<bool>                                      done   = false;
+		std::atomic<bool>                                      failed = false;
+	};
+
+	void processMsgBatch( std::unique_ptr<IStreamConsumerMessageBatch> msgBatch, Block& block );
+	bool blockDue( const Block& block ) const;
+	void sendBlock();
+	void commitInsertedOffsets();
+
+	void startInserters();
+	void stopInserters();
+	void runInserter();
+	bool insertIntoHistoryDB( Block& block, BackoffPolicy& backoffPolicy );
+
+private:
+	std::shared_ptr<Serialiser>        m_serialiser;
+	std::shared_ptr<MD::IMarketSource> m_historySource;
+
+	std::shared_ptr<IStreamConsumer>   m_updateConsumer;
+	std::shared_ptr<IStreamProducer>   m_dlqProducer;
+
+	std::unique_ptr<Block>             m_block; // The block being filled - only touched on the poll loop
+
+	// Blocks sent to the inserters, oldest first - only touched on the poll loop. The queue is bounded by the number of inserters, so the
+	// poll loop blocks once every inserter is busy and one more block is waiting
+	std::deque<std::shared_ptr<Block>>                    m_pendingBlocks;
+	std::unique_ptr<BoundedQueue<std::shared_ptr<Block>>> m_insertQueue;
+	std::vector<std::thread>                              m_inserters;
+
+	std::atomic<uint64_t> m_numRecordsInserted = 0;
+	std::atomic<uint64_t> m_numBlocksInserted  = 0;
+};
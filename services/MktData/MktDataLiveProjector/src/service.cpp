@@ -1,30 +1,63 @@
 #include "service.h"
 
 #include <ARQUtils/algos.h>
+#include <ARQUtils/os.h>
+#include <ARQUtils/time.h>
 #include <ARQMarket/mktdata_entities.h>
 #include <ARQMarket/mktdata_meta.h>
 #include <ARQMarket/mktdata_topics.h>
 
 void MktDataLiveProjectorService::onStartup()
 {
-	m_backoffPolicy = BackoffPolicy( m_config.dbBackoffPolicy );
-
 	m_serialiser = SerialiserFactory::inst().create( SerialiserFactory::SerialiserImpl::Protobuf );
 
-	m_liveMarketStore = MD::LiveMarketStoreFactory::inst().create( m_config.liveDSH );
-
-	StreamConsumerOptions opts( "MktDataLiveProjector::UpdateConsumer",
-								"ARQ.MktData.LiveProjectors",
-								StreamConsumerOptions::FetchPreset::LowLatency,
-								StreamConsumerOptions::AutoCommitOffsets::Disabled,
-								StreamConsumerOptions::AutoOffsetReset::Earliest );
-	m_updateConsumer = StreamingServiceFactory::inst().createConsumer( m_config.streamSvcDSH, opts );
-
 	const std::set<std::string_view> entities = Algos::makeEffectiveSet( m_config.entities, MD::Meta::getAllNames(), m_config.disabledEntities );
 	const auto updateTopics = entities
 		| std::views::transform( [] ( std::string_view name ) { return MD::getUpdateTopic( name ); } )
 		| std::ranges::to<std::set<std::string>>();
-	m_updateConsumer->subscribe( updateTopics );
+
+	const MD::MarketUpdateEncoder::Config encoderConfig{
+		.maxMessageBytes    = static_cast<size_t>( std::max<int64_t>( m_config.maxPublishBytes, 1 ) ),
+		.deltaEncode        = m_config.deltaEncode,
+		.fullRecordInterval = std::chrono::milliseconds( m_config.fullRecordIntervalMs )
+	};
+
+	// Subscribers keep sequence numbers and delta bases per publisher, so every worker publishes as its own, and a restart as a new one
+	const int64_t startupTsUs = static_cast<int64_t>( Time::DateTime::nowUTC().microsecondsSinceEpoch() );
+
+	// Every worker's consumer is in the same group, so each is assigned its own share of the partitions
+	const size_t numWorkers = static_cast<size_t>( std::max<int64_t>( m_config.numWorkers, 1 ) );
+	for( size_t i = 0; i < numWorkers; ++i )
+	{
+		auto worker = std::make_unique<Worker>();
+		worker->id            = i;
+		worker->backoffPolicy = BackoffPolicy( m_config.dbBackoffPolicy );
+
+		if( m_config.conflationWindowMs > 0 )
+		{
+			worker->conflator.emplace( MD::MarketUpdateConflator::Config{
+				.window     = std::chrono::milliseconds( m_config.conflationWindowMs ),
+				.maxRecords = static_cast<size_t>( std::max<int64_t>( m_config.conflationMaxRecords, 0 ) )
+			} );
+		}
+
+		worker->encoder.emplace( encoderConfig, m_serialiser, std::format( "{}-{}-{}-{}", OS::procName(), OS::procID(), startupTsUs, i ) );
+
+		// A store of its own when there are several workers, so they don't queue behind each other's writes
+		worker->liveMarketStore = numWorkers > 1 ? MD::LiveMarketStoreFactory::inst().createUnshared( m_config.liveDSH )
+		                                         : MD::LiveMarketStoreFactory::inst().create( m_config.liveDSH );
+
+		const std::string consumerName = numWorkers > 1 ? std::format( "MktDataLiveProjector::UpdateConsumer{}", i ) : "MktDataLiveProjector::UpdateConsumer";
+		StreamConsumerOptions opts( consumerName,
+									"ARQ.MktData.LiveProjectors",
+									StreamConsumerOptions::FetchPreset::LowLatency,
+									StreamConsumerOptions::AutoCommitOffsets::Disabled,
+									StreamConsumerOptions::AutoOffsetReset::Earliest );
+		worker->updateConsumer = StreamingServiceFactory::inst().createConsumer( m_config.streamSvcDSH, opts );
+		worker->updateConsumer->subscribe( updateTopics );
+
+		m_workers.push_back( std::move( worker ) );
+	}
 
 	StreamProducerOptions prodOpts( "MktDataLiveProjector::DLQProducer" );
 	m_dlqProducer = StreamingServiceFactory::inst().createProducer( m_config.streamSvcDSH, prodOpts );
@@ -34,49 +67,346 @@ void MktDataLiveProjectorService::onStartup()
 
 void MktDataLiveProjectorService::onShutdown()
 {
-	m_updateConsumer.reset();
+	m_workers.clear();
 	m_dlqProducer.reset();
-	m_liveMarketStore.reset();
 	m_messagingService.reset();
 }
 
 void MktDataLiveProjectorService::run()
+{
+	if( m_workers.size() == 1 )
+	{
+		runWorker( *m_workers.front() );
+		return;
+	}
+
+	// A worker failing stops the rest, and its exception is rethrown once they all have
+	std::vector<std::thread> threads;
+	std::exception_ptr       workerError;
+	std::mutex               workerErrorMutex;
+	for( const std::unique_ptr<Worker>& worker : m_workers )
+	{
+		threads.emplace_back( [this, &worker = *worker, &workerError, &workerErrorMutex] ()
+		{
+			try
+			{
+				runWorker( worker );
+			}
+			catch( ... )
+			{
+				std::lock_guard<std::mutex> lock( workerErrorMutex );
+				if( !workerError )
+					workerError = std::current_exception();
+				m_stopWorkers = true;
+			}
+		} );
+	}
+
+	Log( Module::EXE ).info( "Running {} workers", threads.size() );
+
+	for( std::thread& thread : threads )
+		thread.join();
+
+	if( workerError )
+		std::rethrow_exception( workerError );
+}
+
+void MktDataLiveProjectorService::runWorker( Worker& worker )
+{
+	if( m_config.pipelined )
+		runPipelined( worker );
+	else
+		runSerial( worker );
+
+	if( worker.conflator )
+	{
+		const MD::MarketUpdateConflator::Stats stats = worker.conflator->getStats();
+		Log( Module::EXE ).info( "Worker {}: Conflation received {} records - forwarded {}, conflated {}", worker.id, stats.received, stats.forwarded, stats.conflated );
+	}
+
+	const MD::MarketUpdateEncoder::Stats encoderStats = worker.encoder->getStats();
+	Log( Module::EXE ).info( "Worker {}: Published {} batches in {} messages - {} chunked, {} records delta encoded leaving out {} decimals",
+							 worker.id, encoderStats.batches, encoderStats.messages, encoderStats.chunkedBatches, encoderStats.deltaRecords, encoderStats.decimalsLeftOut );
+}
+
+void MktDataLiveProjectorService::runSerial( Worker& worker )
 {
 	std::unordered_map<std::string, MD::MarketUpdateBatch> updateBatches;
+	StreamTopicPartitionOffsets                            commitOffsets; // Everything polled since the last commit, whether held by the conflator or on its way to the sinks
 	
-	while( shouldRun() )
+	while( keepRunning() )
 	{
 		updateBatches.clear();
 
-		auto msgBatch = m_updateConsumer->poll( 5ms, StreamConsumerReadHeaders::SKIP_HEADERS );
-		if( msgBatch->empty() )
+		auto msgBatch = worker.updateConsumer->poll( 5ms, StreamConsumerReadHeaders::SKIP_HEADERS );
+		const bool polled = !msgBatch->empty();
+		if( polled )
+			processMsgBatch( std::move( msgBatch ), updateBatches, commitOffsets );
+
+		if( worker.conflator )
+		{
+			worker.conflator->add( std::move( updateBatches ) );
+			if( !worker.conflator->due() )
+			{
+				// Nothing held means nothing polled is still waiting on the sinks
+				if( polled && worker.conflator->empty() )
+					commitSunkOffsets( worker, commitOffsets );
+				continue;
+			}
+
+			updateBatches = worker.conflator->take();
+		}
+		else if( !polled )
+			continue;
+
+		sinkAndCommit( worker, updateBatches, commitOffsets );
+	}
+
+	// Whatever's still held goes on now rather than being read again on restart
+	if( worker.conflator && !worker.conflator->empty() )
+	{
+		updateBatches = worker.conflator->take();
+		sinkAndCommit( worker, updateBatches, commitOffsets );
+	}
+}
+
+void MktDataLiveProjectorService::sinkAndCommit( Worker& worker, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches, StreamTopicPartitionOffsets& commitOffsets )
+{
+	stampPrevOffsets( worker, updateBatches );
+	if( insertIntoLiveMarketSource( worker, updateBatches ) && publishToMessagingService( worker, updateBatches ) )
+		commitSunkOffsets( worker, commitOffsets );
+}
+
+void MktDataLiveProjectorService::commitSunkOffsets( Worker& worker, StreamTopicPartitionOffsets& commitOffsets )
+{
+	// Exactly what reached the sinks, rather than wherever the consumer has got to
+	if( commitOffsets.size() )
+		worker.updateConsumer->commitOffsetsAsync( commitOffsets );
+	commitOffsets.clear();
+}
+
+void MktDataLiveProjectorService::runPipelined( Worker& worker )
+{
+	startPipeline( worker );
+
+	try
+	{
+		while( keepRunning() )
+		{
+			commitAppliedOffsets( worker );
+
+			auto msgBatch = worker.updateConsumer->poll( 5ms, StreamConsumerReadHeaders::SKIP_HEADERS );
+			if( msgBatch->empty() )
+				continue;
+
+			auto poll = std::make_shared<PipelinedPoll>();
+			poll->msgBatch      = std::move( msgBatch );
+			poll->pendingCommit = std::make_shared<PendingCommit>();
+
+			// Queued before the poll goes anywhere, so it can't be committed ahead of the polls before it
+			worker.pendingCommits.push_back( poll->pendingCommit );
+
+			// Both block while full, holding the poll loop back to the pace of the slowest stage
+			worker.decodeQueue->push( std::shared_ptr<PipelinedPoll>( poll ) );
+			worker.sinkQueue->push( std::move( poll ) );
+		}
+	}
+	catch( ... )
+	{
+		stopPipeline( worker );
+		throw;
+	}
+
+	stopPipeline( worker );
+	commitAppliedOffsets( worker );
+
+	const MD::LiveMarketStoreStats stats = worker.liveMarketStore->getStats();
+	Log( Module::EXE ).info( "Worker {}: Live market store applied {} batches ({} failed, {} already applied) in {} round trips - batches per round trip p50/p99/max: {}/{}/{}, round trip us p50/p99/max: {}/{}/{}",
+		worker.id, stats.applied, stats.failed, stats.skipped, stats.rttUs.count, stats.inFlight.percentile( 50 ), stats.inFlight.percentile( 99 ), stats.inFlight.max,
+		stats.rttUs.percentile( 50 ), stats.rttUs.percentile( 99 ), stats.rttUs.max );
+}
+
+void MktDataLiveProjectorService::startPipeline( Worker& worker )
+{
+	const size_t numDecoders = static_cast<size_t>( std::max<int64_t>( m_config.numDecoders, 1 ) );
+
+	worker.decodeQueue  = std::make_unique<BoundedQueue<std::shared_ptr<PipelinedPoll>>>( numDecoders * DECODES_PER_DECODER );
+	worker.sinkQueue    = std::make_unique<BoundedQueue<std::shared_ptr<PipelinedPoll>>>( MAX_POLLS_TO_SINK );
+	worker.publishQueue = std::make_unique<BoundedQueue<SinkBatches>>( MAX_POLLS_TO_PUBLISH );
+
+	for( size_t i = 0; i < numDecoders; ++i )
+		worker.decoders.emplace_back( &MktDataLiveProjectorService::runDecoder, this, std::ref( worker ) );
+	worker.sinkThread    = std::thread( &MktDataLiveProjectorService::runSinkStage, this, std::ref( worker ) );
+	worker.publishThread = std::thread( &MktDataLiveProjectorService::runPublishStage, this, std::ref( worker ) );
+
+	Log( Module::EXE ).info( "Worker {}: Running pipelined with {} decoders", worker.id, numDecoders );
+}
+
+void MktDataLiveProjectorService::stopPipeline( Worker& worker )
+{
+	// Each stage drains what's already queued for it before the next is stopped, so every poll taken is seen through to both sinks
+	worker.decodeQueue->close();
+	for( std::thread& decoder : worker.decoders )
+		decoder.join();
+	worker.decoders.clear();
+
+	worker.sinkQueue->close();
+	worker.sinkThread.join();
+	worker.liveMarketStore->flush();
+
+	worker.publishQueue->close();
+	worker.publishThread.join();
+}
+
+void MktDataLiveProjectorService::runDecoder( Worker& worker )
+{
+	while( std::optional<std::shared_ptr<PipelinedPoll>> poll = worker.decodeQueue->pop() )
+	{
+		PipelinedPoll& p = **poll;
+		try
+		{
+			processMsgBatch( std::move( p.msgBatch ), p.updateBatches, p.pendingCommit->offsets );
+			p.decodedPromise.set_value();
+		}
+		catch( ... )
+		{
+			p.decodedPromise.set_exception( std::current_exception() );
+		}
+	}
+}
+
+void MktDataLiveProjectorService::runSinkStage( Worker& worker )
+{
+	// The polls whose records are held in the conflator
+	std::vector<std::shared_ptr<PendingCommit>> heldCommits;
+
+	while( true )
+	{
+		std::optional<std::shared_ptr<PipelinedPoll>> poll;
+		if( const auto deadline = worker.conflator ? worker.conflator->deadline() : std::nullopt )
+		{
+			poll = worker.sinkQueue->popFor( *deadline - MD::MarketUpdateConflator::Clock::now() );
+			if( !poll && !( worker.sinkQueue->isClosed() && worker.sinkQueue->size() == 0 ) )
+			{
+				// The window has closed with nothing more arriving
+				forwardToSinks( worker, worker.conflator->take(), std::move( heldCommits ) );
+				heldCommits.clear();
+				continue;
+			}
+		}
+		else
+			poll = worker.sinkQueue->pop();
+
+		if( !poll )
+			break;
+
+		PipelinedPoll& p = **poll;
+
+		ARQ_DO_IN_TRY( arqExc, errMsg );
+		{
+			p.decoded.get();
+		}
+		ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+		if( arqExc.what().size() || errMsg.size() )
+		{
+			if( arqExc.what().size() )
+				Log( Module::EXE ).error( arqExc, "Exception thrown when decoding a poll" );
+			else
+				Log( Module::EXE ).error( "Exception thrown when decoding a poll - what: {}", errMsg );
+
+			// Never published, so the publish's count is let go here
+			p.pendingCommit->failed = true;
+			p.pendingCommit->numPending.fetch_sub( 1, std::memory_order_acq_rel );
+			continue;
+		}
+
+		if( !worker.conflator )
+		{
+			forwardToSinks( worker, std::move( p.updateBatches ), { p.pendingCommit } );
 			continue;
+		}
 
-		processMsgBatch( std::move( msgBatch ), updateBatches );
-		insertIntoLiveMarketSource( updateBatches );
-		publishToMessagingService( updateBatches );
-		m_updateConsumer->commitOffsetsAsync();
+		worker.conflator->add( std::move( p.updateBatches ) );
+		heldCommits.push_back( p.pendingCommit );
+
+		// A poll that left nothing held, e.g. one sent wholly to the DLQ, is let through straight away
+		if( worker.conflator->empty() || worker.conflator->due() )
+		{
+			forwardToSinks( worker, worker.conflator->take(), std::move( heldCommits ) );
+			heldCommits.clear();
+		}
+	}
+
+	if( heldCommits.size() )
+		forwardToSinks( worker, worker.conflator->take(), std::move( heldCommits ) );
+}
+
+void MktDataLiveProjectorService::forwardToSinks( Worker& worker, std::unordered_map<std::string, MD::MarketUpdateBatch>&& updateBatches, std::vector<std::shared_ptr<PendingCommit>>&& pendingCommits )
+{
+	stampPrevOffsets( worker, updateBatches );
+	queueForLiveMarketSource( worker, updateBatches, pendingCommits );
+
+	// The live store and the messaging service are written concurrently - live market consumers resolve the order between the two
+	// from the offsets
+	worker.publishQueue->push( SinkBatches{ .updateBatches = std::move( updateBatches ), .pendingCommits = std::move( pendingCommits ) } );
+}
+
+void MktDataLiveProjectorService::runPublishStage( Worker& worker )
+{
+	while( std::optional<SinkBatches> sinkBatches = worker.publishQueue->pop() )
+	{
+		bool published = false;
+		ARQ_DO_IN_TRY( arqExc, errMsg );
+		{
+			published = publishToMessagingService( worker, sinkBatches->updateBatches );
+		}
+		ARQ_END_TRY_AND_CATCH( arqExc, errMsg );
+
+		if( arqExc.what().size() )
+			Log( Module::EXE ).error( arqExc, "Exception thrown when publishing to the messaging service" );
+		else if( errMsg.size() )
+			Log( Module::EXE ).error( "Exception thrown when publishing to the messaging service - what: {}", errMsg );
+
+		for( const std::shared_ptr<PendingCommit>& pendingCommit : sinkBatches->pendingCommits )
+		{
+			if( !published )
+				pendingCommit->failed = true;
+			pendingCommit->numPending.fetch_sub( 1, std::memory_order_acq_rel );
+		}
 	}
 }
 
 void MktDataLiveProjectorService::registerConfigOptions( Cfg::ConfigWrangler& cfg )
 {
-	cfg.add( m_config.streamSvcDSH,     "--streamServiceDSH", "The DSH of the streaming service to read updates from" );
-	cfg.add( m_config.liveDSH,          "--liveDSH",          "The DSH of the live market source to write to" );
-	cfg.add( m_config.msgSvcDSH,        "--msgSvcDSH",        "The DSH of the messaging service to publish updates to" );
-	cfg.add( m_config.mkts,             "--mkts",             "The set of markets to process updates for. If empty, process updates on all markets." );
-	cfg.add( m_config.entities,         "--entities",         "The set of market data entities to process updates for. If empty, subscribes to all entities." );
-	cfg.add( m_config.disabledEntities, "--disabledEntities", "The set of market data entities to NOT process updates for." );
-	cfg.add( m_config.dbBackoffPolicy,  "--dbBackoffPolicy",  "The backoff policy to use when retrying saves to the live market source\n" + std::string( BackoffPolicy::HelpText ) );
+	cfg.add( m_config.streamSvcDSH,         "--streamServiceDSH",     "The DSH of the streaming service to read updates from" );
+	cfg.add( m_config.liveDSH,              "--liveDSH",              "The DSH of the live market source to write to" );
+	cfg.add( m_config.msgSvcDSH,            "--msgSvcDSH",            "The DSH of the messaging service to publish updates to" );
+	cfg.add( m_config.mkts,                 "--mkts",                 "The set of markets to process updates for. If empty, process updates on all markets." );
+	cfg.add( m_config.entities,             "--entities",             "The set of market data entities to process updates for. If empty, subscribes to all entities." );
+	cfg.add( m_config.disabledEntities,     "--disabledEntities",     "The set of market data entities to NOT process updates for." );
+	cfg.add( m_config.dbBackoffPolicy,      "--dbBackoffPolicy",      "The backoff policy to use when retrying saves to the live market source\n" + std::string( BackoffPolicy::HelpText ) );
+	cfg.add( m_config.pipelined,            "--pipelined",            "Run as a pipeline of stages on their own threads - polls are decoded on a pool of decoders, then applied to the live market source, with several batches in flight, and published to the messaging service concurrently. Stream offsets are committed in order as polls land in both" );
+	cfg.add( m_config.numDecoders,          "--numDecoders",          "The number of threads decoding polled updates when pipelined, for each worker" );
+	cfg.add( m_config.conflationWindowMs,   "--conflationWindowMs",   "Hold updates back for up to this long, forwarding only the newest record for each market, type and id. 0 forwards every record as it comes" );
+	cfg.add( m_config.conflationMaxRecords, "--conflationMaxRecords", "Forward what's held early once it holds this many records. 0 for no limit" );
+	cfg.add( m_config.numWorkers,           "--numWorkers",           "The number of workers, each consuming its own share of the update partitions with its own connections to the live market source" );
+	cfg.add( m_config.maxPublishBytes,      "--maxPublishBytes",      "Market update batches bigger than this when serialised are published in chunks. Keep it below the messaging service's max message size" );
+	cfg.add( m_config.deltaEncode,          "--deltaEncode",          "Publish only the decimals that changed since the last record for each id, with every record sent in full again every fullRecordIntervalMs. Only turn on once every subscriber understands chunked and delta encoded updates" );
+	cfg.add( m_config.fullRecordIntervalMs, "--fullRecordIntervalMs", "How often every record is published in full again when delta encoding" );
 }
 
-void MktDataLiveProjectorService::processMsgBatch( std::unique_ptr<IStreamConsumerMessageBatch> msgBatch, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches )
+void MktDataLiveProjectorService::processMsgBatch( std::unique_ptr<IStreamConsumerMessageBatch> msgBatch, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches, StreamTopicPartitionOffsets& commitOffsets )
 {
 	Log( Module::EXE ).debug( "Processing {} update messages", msgBatch->size() );
 
 	bool anyDLQ = false;
 	for( const StreamConsumerMessageView& msg : *msgBatch )
 	{
+		// Every message counts towards what's committed, including any sent to the DLQ. The committed offset is the next one to read
+		int64_t& commitOffset = commitOffsets[StreamTopicPartition( std::string( msg.topic ), msg.partition )];
+		commitOffset = std::max( commitOffset, msg.offset + 1 );
+
 		ARQ_DO_IN_TRY( arqExc, errMsg );
 		{
 			if( !msg.key.has_value() )
@@ -89,6 +419,7 @@ void MktDataLiveProjectorService::processMsgBatch( std::unique_ptr<IStreamConsum
 				auto rcdMsg = m_serialiser->deserialise<MD::RecordMessage<T>>( msg.data );
 				MD::MarketUpdateBatch& updateBatch = updateBatches[rcdMsg.mktName];
 				updateBatch.records.get<MD::Record<T>>().push_back( std::move( rcdMsg.record ) );
+				updateBatch.recordPartitions[MD::Traits<T>::typeEnum()].push_back( msg.partition );
 				updateBatch.offsets[StreamTopicPartition{ msg.topic, msg.partition }] = msg.offset;
 			} );
 		}
@@ -126,28 +457,53 @@ void MktDataLiveProjectorService::processMsgBatch( std::unique_ptr<IStreamConsum
 		updateBatch.marketName = MD::MarketName::fromStr( mktName );
 }
 
-void MktDataLiveProjectorService::insertIntoLiveMarketSource( const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches )
+void MktDataLiveProjectorService::stampPrevOffsets( Worker& worker, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches )
+{
+	for( auto& [mktName, updateBatch] : updateBatches )
+	{
+		if( updateBatch.records.empty() )
+			continue;
+
+		// Only the partitions this batch moves on - a subscriber that hasn't applied up to these has missed a batch
+		StreamTopicPartitionOffsets& lastOffsets = worker.lastPublishedOffsets[mktName];
+		for( const auto& [tp, offset] : updateBatch.offsets )
+		{
+			if( const auto it = lastOffsets.find( tp ); it != lastOffsets.end() )
+				updateBatch.prevOffsets[tp] = it->second;
+			lastOffsets[tp] = offset;
+		}
+	}
+}
+
+bool MktDataLiveProjectorService::insertIntoLiveMarketSource( Worker& worker, const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches )
 {
 	for( const auto& [mktName, updateBatch] : updateBatches )
 	{
 		if( updateBatch.records.empty() )
 			continue;
 
-		m_backoffPolicy.reset();
-		while( shouldRun() )
+		worker.backoffPolicy.reset();
+		while( true )
 		{
 			try
 			{
 				Log( Module::EXE ).debug( "Applying {} market data entities and their offsets for market [{}] to the live market store", updateBatch.records.size(), mktName );
-				m_liveMarketStore->apply( updateBatch );
+				worker.liveMarketStore->apply( updateBatch );
 				break;
 			}
 			catch( ARQException& e )
 			{
-				auto delayTimeOpt = m_backoffPolicy.nextDelay();
+				// Not retried once stopping
+				if( !keepRunning() )
+				{
+					Log( Module::EXE ).error( e, "Exception thrown when applying a batch to the live market store - not trying again as stopping" );
+					return false;
+				}
+
+				auto delayTimeOpt = worker.backoffPolicy.nextDelay();
 				if( delayTimeOpt )
 				{
-					Log( Module::EXE ).error( e, "Exception thrown when applying a batch to the live market store - trying again in {}ms ({})", *delayTimeOpt, m_backoffPolicy.attemptStr() );
+					Log( Module::EXE ).error( e, "Exception thrown when applying a batch to the live market store - trying again in {}ms ({})", *delayTimeOpt, worker.backoffPolicy.attemptStr() );
 					std::this_thread::sleep_for( *delayTimeOpt );
 				}
 				else
@@ -160,38 +516,132 @@ void MktDataLiveProjectorService::insertIntoLiveMarketSource( const std::unorder
 			}
 		}
 	}
+
+	return true;
 }
 
-void MktDataLiveProjectorService::publishToMessagingService( const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches )
+void MktDataLiveProjectorService::queueForLiveMarketSource( Worker& worker, const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches, const std::vector<std::shared_ptr<PendingCommit>>& pendingCommits )
 {
+	size_t numToQueue = 0;
+	for( const auto& [mktName, updateBatch] : updateBatches )
+	{
+		if( !updateBatch.records.empty() )
+			++numToQueue;
+	}
+
+	// Counted before any batch is queued, as the publish's count may already be let go - a poll mustn't look done while its batches are
+	// still being queued
+	for( const std::shared_ptr<PendingCommit>& pendingCommit : pendingCommits )
+		pendingCommit->numPending.fetch_add( numToQueue, std::memory_order_relaxed );
+
 	for( const auto& [mktName, updateBatch] : updateBatches )
 	{
 		if( updateBatch.records.empty() )
 			continue;
 
-		m_backoffPolicy.reset();
-		while( shouldRun() )
+		Log( Module::EXE ).debug( "Queueing {} market data entities and their offsets for market [{}] to the live market store", updateBatch.records.size(), mktName );
+
+		try
 		{
-			try
+			// Blocks while the store has as many batches in flight as it allows
+			worker.liveMarketStore->applyAsync( updateBatch, [pendingCommits, mktName] ( const std::optional<ARQException>& error )
+			{
+				if( error )
+					Log( Module::EXE ).error( *error, "Exception thrown when applying a batch for market [{}] to the live market store", mktName );
+
+				for( const std::shared_ptr<PendingCommit>& pendingCommit : pendingCommits )
+				{
+					if( error )
+						pendingCommit->failed = true;
+					pendingCommit->numPending.fetch_sub( 1, std::memory_order_acq_rel );
+				}
+			} );
+		}
+		catch( const ARQException& e )
+		{
+			// Neither this batch nor the ones after it will call back, so their counts are let go here
+			Log( Module::EXE ).error( e, "Exception thrown when queueing a batch for market [{}] to the live market store", mktName );
+			for( const std::shared_ptr<PendingCommit>& pendingCommit : pendingCommits )
+			{
+				pendingCommit->failed = true;
+				pendingCommit->numPending.fetch_sub( numToQueue, std::memory_order_acq_rel );
+			}
+			return;
+		}
+
+		--numToQueue;
+	}
+}
+
+void MktDataLiveProjectorService::commitAppliedOffsets( Worker& worker )
+{
+	// Polls can complete out of order, but are only committed in order
+	StreamTopicPartitionOffsets toCommit;
+	while( worker.pendingCommits.size() && worker.pendingCommits.front()->numPending.load( std::memory_order_acquire ) == 0 )
+	{
+		const std::shared_ptr<PendingCommit> pendingCommit = std::move( worker.pendingCommits.front() );
+		worker.pendingCommits.pop_front();
+
+		if( pendingCommit->failed )
+		{
+			// Nothing from here on is committed, so every batch not known to be in both sinks is read again on restart. A sink that
+			// fails while stopping isn't retried, so that's expected then
+			if( !keepRunning() )
 			{
-				Log( Module::EXE ).debug( "Publishing market update batch for market [{}] to the messaging service", mktName );
+				Log( Module::EXE ).warn( "Stopped before every poll reached both sinks - the remaining {} polls will be read again on restart", worker.pendingCommits.size() + 1 );
+				worker.pendingCommits.clear();
+				break;
+			}
 
-				Message msg{
-					.data = m_serialiser->serialise( updateBatch )
-				};
-				const std::string topic = std::string( UPDATES_PUB_TOPIC_PFX ) + mktName;
+			static constexpr std::string_view errMsg = "A poll failed to reach the live market store or the messaging service - STOPPING SERVICE!";
+			Log( Module::EXE ).critical( errMsg );
+			throw ARQException( errMsg );
+		}
+
+		for( const auto& [tp, offset] : pendingCommit->offsets )
+			toCommit[tp] = offset;
+	}
 
-				// Note: We assume that the publish message is small enough that it's below the max message size of the messaging service. If this is not the case, we would need to implement chunking logic here to split the batch into multiple messages.
-				m_messagingService->publish( topic, std::move( msg ) );
+	if( toCommit.size() )
+		worker.updateConsumer->commitOffsetsAsync( toCommit );
+}
 
+bool MktDataLiveProjectorService::publishToMessagingService( Worker& worker, const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches )
+{
+	for( const auto& [mktName, updateBatch] : updateBatches )
+	{
+		if( updateBatch.records.empty() )
+			continue;
+
+		// Encoded once, as the encoder's sequence numbers and delta bases move on with every message - a retry carries on from the
+		// message that failed
+		Log( Module::EXE ).debug( "Publishing market update batch for market [{}] to the messaging service", mktName );
+		std::vector<Message> msgs = worker.encoder->encode( updateBatch );
+		const std::string    topic = std::string( UPDATES_PUB_TOPIC_PFX ) + mktName;
+
+		worker.backoffPolicy.reset();
+		size_t nextMsg = 0;
+		while( true )
+		{
+			try
+			{
+				for( ; nextMsg < msgs.size(); ++nextMsg )
+					m_messagingService->publish( topic, msgs[nextMsg] );
 				break;
 			}
 			catch( ARQException& e )
 			{
-				auto delayTimeOpt = m_backoffPolicy.nextDelay();
+				// Not retried once stopping
+				if( !keepRunning() )
+				{
+					Log( Module::EXE ).error( e, "Exception thrown when publishing market update batch - not trying again as stopping" );
+					return false;
+				}
+
+				auto delayTimeOpt = worker.backoffPolicy.nextDelay();
 				if( delayTimeOpt )
 				{
-					Log( Module::EXE ).error( e, "Exception thrown when publishing market update batch - trying again in {}ms ({})", *delayTimeOpt, m_backoffPolicy.attemptStr() );
+					Log( Module::EXE ).error( e, "Exception thrown when publishing market update batch - trying again in {}ms ({})", *delayTimeOpt, worker.backoffPolicy.attemptStr() );
 					std::this_thread::sleep_for( *delayTimeOpt );
 				}
 				else
@@ -204,4 +654,6 @@ void MktDataLiveProjectorService::publishToMessagingService( const std::unordere
 			}
 		}
 	}
+
+	return true;
 }
@@ -1,15 +1,25 @@
 #include <ARQUtils/backoff_policy.h>
+#include <ARQUtils/bounded_queue.h>
 #include <ARQUtils/hashers.h>
 #include <ARQCore/service_base.h>
 #include <ARQCore/streaming_service.h>
 #include <ARQMarket/market.h>
+#include <ARQMarket/mktdata_conflator.h>
 #include <ARQMarket/mktdata_live_store.h>
 #include <ARQMarket/mktdata_source.h>
 #include <ARQMarket/mktdata_entities.h>
+#include <ARQMarket/mktdata_update_codec.h>
 #include <ARQMarket/market_live.h>
 
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 using namespace ARQ;
 
@@ -41,24 +51,116 @@ private:
 		std::set<std::string> disabledEntities;
 
 		std::string dbBackoffPolicy = "1s-3-1m-5";
+
+		bool    pipelined   = false; // Decode, apply to the live store and publish in stages on their own threads, committing offsets as polls land in both
+		int64_t numDecoders = 2;     // Threads decoding polls when pipelined, for each worker
+
+		int64_t conflationWindowMs   = 0; // Hold updates back this long, forwarding only the newest record for each id - 0 to forward every record
+		int64_t conflationMaxRecords = 0; // Forward early once this many records are held - 0 for no limit
+
+		int64_t numWorkers = 1; // Workers each consuming their own share of the partitions
+
+		int64_t maxPublishBytes      = MD::MarketUpdateEncoder::DEFAULT_MAX_MESSAGE_BYTES; // Published batches bigger than this are split into chunks
+		bool    deltaEncode          = false; // Leave decimals unchanged since an id's last published record off the wire - every subscriber must understand MarketUpdateMessage first
+		int64_t fullRecordIntervalMs = 5000;  // How often every record is published in full again when delta encoding
 	} m_config;
 
 	static constexpr std::string_view UPDATES_PUB_TOPIC_PFX = "ARQ.MktData.Updates.";
 
 private:
-	void processMsgBatch( std::unique_ptr<IStreamConsumerMessageBatch> msgBatch, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches );
-	void insertIntoLiveMarketSource( const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches );
-	void publishToMessagingService( const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches );
+	struct PendingCommit;
+	struct PipelinedPoll;
+	struct SinkBatches;
+	struct Worker;
+
+	bool keepRunning() const { return shouldRun() && !m_stopWorkers; }
+
+	void runWorker( Worker& worker );
+	void runSerial( Worker& worker );
+	void runPipelined( Worker& worker );
+	void sinkAndCommit( Worker& worker, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches, StreamTopicPartitionOffsets& commitOffsets );
+	void commitSunkOffsets( Worker& worker, StreamTopicPartitionOffsets& commitOffsets );
+
+	void processMsgBatch( std::unique_ptr<IStreamConsumerMessageBatch> msgBatch, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches, StreamTopicPartitionOffsets& commitOffsets );
+	bool insertIntoLiveMarketSource( Worker& worker, const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches );
+	void queueForLiveMarketSource( Worker& worker, const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches, const std::vector<std::shared_ptr<PendingCommit>>& pendingCommits );
+	void commitAppliedOffsets( Worker& worker );
+	bool publishToMessagingService( Worker& worker, const std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches );
+	void stampPrevOffsets( Worker& worker, std::unordered_map<std::string, MD::MarketUpdateBatch>& updateBatches );
+
+	void startPipeline( Worker& worker );
+	void stopPipeline( Worker& worker );
+	void runDecoder( Worker& worker );
+	void runSinkStage( Worker& worker );
+	void forwardToSinks( Worker& worker, std::unordered_map<std::string, MD::MarketUpdateBatch>&& updateBatches, std::vector<std::shared_ptr<PendingCommit>>&& pendingCommits );
+	void runPublishStage( Worker& worker );
 
 private:
 	std::shared_ptr<Serialiser> m_serialiser;
 
-	std::shared_ptr<MD::ILiveMarketStore> m_liveMarketStore;
-
-	std::shared_ptr<IStreamConsumer> m_updateConsumer;
 	std::shared_ptr<IStreamProducer> m_dlqProducer;
 
 	std::shared_ptr<IMessagingService> m_messagingService;
 
-	BackoffPolicy m_backoffPolicy;
+	// Pipelined mode - a poll's offsets are only committed once every batch from it, and from the polls before it, is both in the live
+	// store and published
+	struct PendingCommit
+	{
+		StreamTopicPartitionOffsets offsets;
+		std::atomic<size_t>         numPending = 1; // The publish, plus a count for each batch given to the live store
+		std::atomic<bool>           failed     = false;
+	};
+
+	struct PipelinedPoll
+	{
+		std::unique_ptr<IStreamConsumerMessageBatch>           msgBatch;
+		std::unordered_map<std::string, MD::MarketUpdateBatch> updateBatches;
+		std::shared_ptr<PendingCommit>                         pendingCommit;
+		std::promise<void>                                     decodedPromise;
+		std::future<void>                                      decoded = decodedPromise.get_future();
+	};
+
+	// What the sinks are given - the batches from one poll, or from every poll in a conflation window, and the commits to let go once
+	// they've landed
+	struct SinkBatches
+	{
+		std::unordered_map<std::string, MD::MarketUpdateBatch> updateBatches;
+		std::vector<std::shared_ptr<PendingCommit>>            pendingCommits;
+	};
+
+	// Polls are decoded out of order across the decoders, but the sink stage takes them in poll order off its own queue, waiting on each to
+	// be decoded. Both queues are bounded, so the poll loop blocks once the slowest stage is full
+	static constexpr size_t DECODES_PER_DECODER  = 4;
+	static constexpr size_t MAX_POLLS_TO_SINK    = 16;
+	static constexpr size_t MAX_POLLS_TO_PUBLISH = 16;
+
+	// Each worker has its own consumer in the group, so its own share of the partitions - everything from a partition is projected by
+	// the one worker, in order. The DLQ producer and the messaging service are shared, as both are safe to use from any thread
+	struct Worker
+	{
+		size_t                                id = 0;
+		std::shared_ptr<IStreamConsumer>      updateConsumer;
+		std::shared_ptr<MD::ILiveMarketStore> liveMarketStore;
+		BackoffPolicy                         backoffPolicy;
+
+		std::optional<MD::MarketUpdateConflator> conflator; // Only touched on the poll loop when serial, or the sink stage when pipelined
+		std::optional<MD::MarketUpdateEncoder>   encoder;   // Only touched by whichever thread publishes
+
+		std::unique_ptr<BoundedQueue<std::shared_ptr<PipelinedPoll>>> decodeQueue;
+		std::unique_ptr<BoundedQueue<std::shared_ptr<PipelinedPoll>>> sinkQueue;
+		std::unique_ptr<BoundedQueue<SinkBatches>>                    publishQueue;
+
+		std::vector<std::thread> decoders;
+		std::thread              sinkThread;
+		std::thread              publishThread;
+
+		std::deque<std::shared_ptr<PendingCommit>> pendingCommits; // Only touched on the poll loop
+
+		// The offsets of the last batch sent on for each market - stamped onto the next batch so subscribers can detect any they missed.
+		// Only touched in poll order, on the poll loop or the sink stage
+		std::unordered_map<std::string, StreamTopicPartitionOffsets> lastPublishedOffsets;
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::atomic<bool>                    m_stopWorkers = false;
 };
@@ -78,10 +78,16 @@ void FXFeedService::run()
     auto next_wake_time = std::chrono::steady_clock::now();
     const auto publish_interval = std::chrono::milliseconds( m_config.publishFrequencyMs );
 
+    // Every ccy for a tick goes out as one batch - kept outside the loop so it is only allocated once
+    std::vector<MD::Record<MD::FXRate>> records;
+    records.reserve( m_pathGenerators.size() );
+
     while( shouldRun() )
     {
         int64_t current_usec = Time::DateTime::nowUTC().microsecondsSinceEpoch();
 
+        records.clear();
+
         for( const auto& [ccy, pathGen] : m_pathGenerators )
         {
             // Grab the mid rate
@@ -101,15 +107,15 @@ void FXFeedService::run()
 
 			Log( Module::EXE ).debug( "Publishing {} rate update: mid={:.5f}, bid={:.5f}, ask={:.5f}", ccy, rate.mid, rate.bid, rate.ask );
 
-			MD::Record<MD::FXRate> record;
+			MD::Record<MD::FXRate>& record = records.emplace_back();
 			record.data            = rate;
             record.header.id       = ccy;
 			record.header.asofTs   = Time::DateTime::nowUTC();
             record.header.isActive = true;
-
-            m_publisher->publish( MD::MarketName::LIVE, std::move( record ) );
         }
 
+        m_publisher->publishBatch<MD::FXRate>( MD::MarketName::LIVE, records );
+
         next_wake_time += publish_interval;
         std::this_thread::sleep_until( next_wake_time );
     }